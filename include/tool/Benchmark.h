@@ -0,0 +1,424 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+using namespace std;
+
+//相机路径上的一个关键帧
+struct CameraKey {
+    float time = 0.0f;
+    glm::vec3 position = glm::vec3(0.0f);
+    float yaw = -90.0f, pitch = 0.0f, zoom = 45.0f;
+};
+
+//录制的相机路径，文本格式每行一个关键帧：时间 x y z yaw pitch zoom，#开头的行为注释
+//位置用Catmull-Rom样条插值（经过每个关键帧且速度连续），角度与视野线性插值
+class CameraPath {
+public:
+    vector<CameraKey> keys;
+
+    bool Load(const string &path){
+        ifstream file(path.c_str());
+        if(!file){
+            cout << "ERROR::CAMERA_PATH::FILE_NOT_FOUND: " << path << endl;
+            return false;
+        }
+        keys.clear();
+        string line;
+        while(getline(file, line)){
+            if(line.empty() || line[0] == '#')
+                continue;
+            istringstream stream(line);
+            CameraKey key;
+            if(stream >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch >> key.zoom)
+                keys.push_back(key);
+        }
+        if(keys.size() < 2){
+            cout << "ERROR::CAMERA_PATH::NEED_AT_LEAST_TWO_KEYS: " << path << endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool Save(const string &path) const{
+        ofstream file(path.c_str());
+        if(!file){
+            cout << "ERROR::CAMERA_PATH::CANNOT_WRITE: " << path << endl;
+            return false;
+        }
+        file << "# time x y z yaw pitch zoom" << endl;
+        for(unsigned int i = 0; i < keys.size(); i++){
+            const CameraKey &key = keys[i];
+            file << key.time << " " << key.position.x << " " << key.position.y << " " << key.position.z << " "
+                << key.yaw << " " << key.pitch << " " << key.zoom << endl;
+        }
+        return true;
+    }
+
+    //录制时追加当前相机状态，Camera为课程目录下的CustomCamera
+    template<class Camera>
+    void Record(float time, const Camera &camera){
+        CameraKey key;
+        key.time = time;
+        key.position = camera.Position;
+        key.yaw = camera.Yaw;
+        key.pitch = camera.Pitch;
+        key.zoom = camera.Zoom;
+        keys.push_back(key);
+    }
+
+    float Duration() const{
+        return keys.empty() ? 0.0f : keys.back().time;
+    }
+
+    //超出路径长度时停在最后一个关键帧
+    CameraKey Evaluate(float time) const{
+        if(keys.empty())
+            return CameraKey();
+        if(time <= keys.front().time)
+            return keys.front();
+        if(time >= keys.back().time)
+            return keys.back();
+        unsigned int i = 0;
+        while(i + 2 < keys.size() && keys[i + 1].time <= time)
+            i++;
+        const CameraKey &a = keys[i];
+        const CameraKey &b = keys[i + 1];
+        float t = (time - a.time) / max(b.time - a.time, 1e-6f);
+        //两端缺少的控制点用端点本身代替
+        const glm::vec3 &p0 = keys[i > 0 ? i - 1 : i].position;
+        const glm::vec3 &p3 = keys[i + 2 < keys.size() ? i + 2 : i + 1].position;
+        CameraKey result;
+        result.time = time;
+        float t2 = t * t, t3 = t2 * t;
+        result.position = 0.5f * ((2.0f * a.position) + (-p0 + b.position) * t + (2.0f * p0 - 5.0f * a.position + 4.0f * b.position - p3) * t2
+            + (-p0 + 3.0f * a.position - 3.0f * b.position + p3) * t3);
+        result.yaw = a.yaw + (b.yaw - a.yaw) * t;
+        result.pitch = a.pitch + (b.pitch - a.pitch) * t;
+        result.zoom = a.zoom + (b.zoom - a.zoom) * t;
+        return result;
+    }
+};
+
+//统计每帧的绘制调用与三角形数量：替换glad中绘制函数的指针，转发给原来的函数
+//不需要修改任何渲染代码，所有经过glad的绘制都会被统计；三角形数按图元类型、顶点数与实例数计算
+class DrawCounter {
+public:
+    unsigned long long drawCalls = 0;
+    unsigned long long triangles = 0;
+
+    static DrawCounter &Get(){
+        static DrawCounter instance;
+        return instance;
+    }
+
+    //gladLoadGL之后调用
+    void Install(){
+        if(installed)
+            return;
+        drawArrays = glad_glDrawArrays;
+        drawElements = glad_glDrawElements;
+        drawArraysInstanced = glad_glDrawArraysInstanced;
+        drawElementsInstanced = glad_glDrawElementsInstanced;
+        drawRangeElements = glad_glDrawRangeElements;
+        drawElementsBaseVertex = glad_glDrawElementsBaseVertex;
+        drawElementsInstancedBaseVertex = glad_glDrawElementsInstancedBaseVertex;
+        glad_glDrawArrays = hookDrawArrays;
+        glad_glDrawElements = hookDrawElements;
+        glad_glDrawArraysInstanced = hookDrawArraysInstanced;
+        glad_glDrawElementsInstanced = hookDrawElementsInstanced;
+        glad_glDrawRangeElements = hookDrawRangeElements;
+        glad_glDrawElementsBaseVertex = hookDrawElementsBaseVertex;
+        glad_glDrawElementsInstancedBaseVertex = hookDrawElementsInstancedBaseVertex;
+        installed = true;
+    }
+
+    void Reset(){
+        drawCalls = 0;
+        triangles = 0;
+    }
+
+private:
+    bool installed = false;
+    PFNGLDRAWARRAYSPROC drawArrays = nullptr;
+    PFNGLDRAWELEMENTSPROC drawElements = nullptr;
+    PFNGLDRAWARRAYSINSTANCEDPROC drawArraysInstanced = nullptr;
+    PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced = nullptr;
+    PFNGLDRAWRANGEELEMENTSPROC drawRangeElements = nullptr;
+    PFNGLDRAWELEMENTSBASEVERTEXPROC drawElementsBaseVertex = nullptr;
+    PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXPROC drawElementsInstancedBaseVertex = nullptr;
+
+    DrawCounter(){}
+
+    void count(GLenum mode, GLsizei count, GLsizei instances){
+        drawCalls++;
+        unsigned long long perInstance = 0;
+        if(mode == GL_TRIANGLES)
+            perInstance = count / 3;
+        else if((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count >= 3)
+            perInstance = count - 2;
+        triangles += perInstance * static_cast<unsigned long long>(max(instances, 0));
+    }
+
+    static void APIENTRY hookDrawArrays(GLenum mode, GLint first, GLsizei count){
+        Get().count(mode, count, 1);
+        Get().drawArrays(mode, first, count);
+    }
+    static void APIENTRY hookDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices){
+        Get().count(mode, count, 1);
+        Get().drawElements(mode, count, type, indices);
+    }
+    static void APIENTRY hookDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances){
+        Get().count(mode, count, instances);
+        Get().drawArraysInstanced(mode, first, count, instances);
+    }
+    static void APIENTRY hookDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances){
+        Get().count(mode, count, instances);
+        Get().drawElementsInstanced(mode, count, type, indices, instances);
+    }
+    static void APIENTRY hookDrawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices){
+        Get().count(mode, count, 1);
+        Get().drawRangeElements(mode, start, end, count, type, indices);
+    }
+    static void APIENTRY hookDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void *indices, GLint baseVertex){
+        Get().count(mode, count, 1);
+        Get().drawElementsBaseVertex(mode, count, type, indices, baseVertex);
+    }
+    static void APIENTRY hookDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances, GLint baseVertex){
+        Get().count(mode, count, instances);
+        Get().drawElementsInstancedBaseVertex(mode, count, type, indices, instances, baseVertex);
+    }
+};
+
+//命令行参数：
+//  --benchmark [路径文件]  回放相机路径，不给文件时使用课程目录下的CameraPath.txt，课程没有录制路径时相机停在初始位置
+//  --frames N              计时的帧数，默认为路径时长乘以帧率，没有路径时为STILL_FRAMES
+//  --warmup N              计时前先渲染的帧数（填充缓存、纹理池等），默认30
+//  --fps N                 每帧推进1/N秒，与真实耗时无关，默认60
+//  --report 文件           把结果写成JSON，默认output/benchmark.json
+//  --label 文本            写入报告的标签，例如提交号，方便对比不同版本
+struct BenchmarkOptions {
+    bool enabled = false;
+    string pathFile;
+    bool pathGiven = false;//命令行指定的路径文件必须存在
+    unsigned int frames = 0;
+    unsigned int warmup = 30;
+    float fps = 60.0f;
+    string report = "./output/benchmark.json";
+    string label;
+};
+
+inline BenchmarkOptions ParseBenchmarkArgs(int argc, char **argv, const string &defaultPath){
+    BenchmarkOptions options;
+    options.pathFile = defaultPath;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--benchmark"){
+            options.enabled = true;
+            if(i + 1 < argc && string(argv[i + 1]).compare(0, 2, "--") != 0)
+            {
+                options.pathFile = argv[++i];
+                options.pathGiven = true;
+            }
+        }
+        else if(arg == "--frames" && i + 1 < argc)
+            options.frames = static_cast<unsigned int>(atoi(argv[++i]));
+        else if(arg == "--warmup" && i + 1 < argc)
+            options.warmup = static_cast<unsigned int>(atoi(argv[++i]));
+        else if(arg == "--fps" && i + 1 < argc)
+            options.fps = static_cast<float>(atof(argv[++i]));
+        else if(arg == "--report" && i + 1 < argc)
+            options.report = argv[++i];
+        else if(arg == "--label" && i + 1 < argc)
+            options.label = argv[++i];
+    }
+    return options;
+}
+
+//基准测试：按固定步长回放相机路径，画面只取决于帧序号，与机器快慢无关
+//先渲染warmup帧（停在路径起点），之后每帧记录相邻两次EndFrame之间的真实耗时以及绘制统计，
+//全部完成后输出平均值、p50、p95、p99等统计到控制台与JSON文件
+//帧时间是帧与帧的间隔（吞吐量），需要关闭垂直同步才有意义
+class Benchmark {
+public:
+    static const unsigned int STILL_FRAMES = 600;//没有相机路径时计时的帧数
+    BenchmarkOptions options;
+    CameraPath path;
+
+    bool Begin(const BenchmarkOptions &options){
+        this->options = options;
+        if(!options.enabled)
+            return true;
+        if(options.fps <= 0.0f){
+            cout << "ERROR::BENCHMARK::INVALID_FPS " << options.fps << endl;
+            return false;
+        }
+        //大部分课程没有录制路径，此时只按固定帧数计时，画面仍然只取决于帧序号
+        if(!options.pathGiven && !ifstream(options.pathFile.c_str())){
+            cout << "Benchmark: no camera path at " << options.pathFile << ", the camera stays at its start pose" << endl;
+            if(this->options.frames == 0)
+                this->options.frames = STILL_FRAMES;
+            this->options.pathFile = "still";
+        }
+        else{
+            if(!path.Load(options.pathFile))
+                return false;
+            if(this->options.frames == 0)
+                this->options.frames = max(1u, static_cast<unsigned int>(path.Duration() * options.fps));
+        }
+        frameTimes.reserve(this->options.frames);
+        drawCalls.reserve(this->options.frames);
+        triangles.reserve(this->options.frames);
+        cout << "Benchmark: " << this->options.pathFile << ", " << options.warmup << " warmup + " << this->options.frames << " frames at " << options.fps << " fps" << endl;
+        return true;
+    }
+
+    //进入渲染循环前调用：Begin之后加载场景与资源的时间和绘制调用都不能算进第一帧
+    //Begin在解析命令行时调用，那时glad还没有加载，统计绘制调用的钩子在这里安装
+    void Start(){
+        if(!options.enabled)
+            return;
+        DrawCounter::Get().Install();
+        DrawCounter::Get().Reset();
+        lastEnd = chrono::steady_clock::now();
+    }
+
+    bool Active() const{
+        return options.enabled;
+    }
+
+    bool Done() const{
+        return options.enabled && frame >= options.warmup + options.frames;
+    }
+
+    //总共需要渲染的帧数
+    unsigned int TotalFrames() const{
+        return options.warmup + options.frames;
+    }
+
+    //当前帧的模拟时间，预热阶段停在0
+    float Time() const{
+        return frame < options.warmup ? 0.0f : (frame - options.warmup) / options.fps;
+    }
+
+    float DeltaTime() const{
+        return 1.0f / options.fps;
+    }
+
+    //把相机放到当前帧在路径上的位置，没有路径时不改变相机
+    //各课程的CustomCamera都有这些公有成员，ProcessMouseMovement(0, 0)只用来按新的角度更新方向向量
+    template<class Camera>
+    void Apply(Camera &camera) const{
+        if(path.keys.empty())
+            return;
+        CameraKey key = path.Evaluate(Time());
+        camera.Position = key.position;
+        camera.Yaw = key.yaw;
+        camera.Pitch = key.pitch;
+        camera.Zoom = key.zoom;
+        camera.ProcessMouseMovement(0.0f, 0.0f);
+    }
+
+    //交换缓冲之后调用
+    void EndFrame(){
+        if(!options.enabled || Done())
+            return;
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if(frame >= options.warmup){
+            frameTimes.push_back(chrono::duration<double, milli>(now - lastEnd).count());
+            drawCalls.push_back(DrawCounter::Get().drawCalls);
+            triangles.push_back(DrawCounter::Get().triangles);
+        }
+        DrawCounter::Get().Reset();
+        lastEnd = now;
+        frame++;
+        if(Done())
+            finish();
+    }
+
+private:
+    unsigned int frame = 0;
+    chrono::steady_clock::time_point lastEnd;
+    vector<double> frameTimes;//毫秒
+    vector<unsigned long long> drawCalls;
+    vector<unsigned long long> triangles;
+
+    //最近秩法求百分位数
+    static double percentile(const vector<double> &sorted, double p){
+        if(sorted.empty())
+            return 0.0;
+        size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+        rank = min(max(rank, (size_t)1), sorted.size());
+        return sorted[rank - 1];
+    }
+
+    template<typename T>
+    static double average(const vector<T> &values){
+        double sum = 0.0;
+        for(unsigned int i = 0; i < values.size(); i++)
+            sum += static_cast<double>(values[i]);
+        return values.empty() ? 0.0 : sum / values.size();
+    }
+
+    static string quote(const string &text){
+        string result = "\"";
+        for(unsigned int i = 0; i < text.size(); i++){
+            if(text[i] == '"' || text[i] == '\\')
+                result += '\\';
+            result += text[i];
+        }
+        return result + "\"";
+    }
+
+    void finish(){
+        vector<double> sorted = frameTimes;
+        sort(sorted.begin(), sorted.end());
+        double avg = average(frameTimes);
+        double p50 = percentile(sorted, 50.0), p95 = percentile(sorted, 95.0), p99 = percentile(sorted, 99.0);
+        unsigned long long maxDrawCalls = drawCalls.empty() ? 0 : *max_element(drawCalls.begin(), drawCalls.end());
+        unsigned long long maxTriangles = triangles.empty() ? 0 : *max_element(triangles.begin(), triangles.end());
+        const char *renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+
+        ostringstream json;
+        json << "{\n";
+        json << "  \"label\": " << quote(options.label) << ",\n";
+        json << "  \"path\": " << quote(options.pathFile) << ",\n";
+        json << "  \"renderer\": " << quote(renderer != nullptr ? renderer : "") << ",\n";
+        json << "  \"frames\": " << frameTimes.size() << ",\n";
+        json << "  \"warmupFrames\": " << options.warmup << ",\n";
+        json << "  \"timestep\": " << DeltaTime() << ",\n";
+        json << "  \"frameTimeMs\": {\"avg\": " << avg << ", \"min\": " << (sorted.empty() ? 0.0 : sorted.front())
+            << ", \"p50\": " << p50 << ", \"p95\": " << p95 << ", \"p99\": " << p99
+            << ", \"max\": " << (sorted.empty() ? 0.0 : sorted.back()) << "},\n";
+        json << "  \"fps\": " << (avg > 0.0 ? 1000.0 / avg : 0.0) << ",\n";
+        json << "  \"drawCalls\": {\"avg\": " << average(drawCalls) << ", \"max\": " << maxDrawCalls << "},\n";
+        json << "  \"triangles\": {\"avg\": " << average(triangles) << ", \"max\": " << maxTriangles << "},\n";
+        json << "  \"frameTimes\": [";
+        for(unsigned int i = 0; i < frameTimes.size(); i++)
+            json << (i > 0 ? ", " : "") << frameTimes[i];
+        json << "]\n}\n";
+
+        cout << "Benchmark: avg " << avg << " ms, p50 " << p50 << " ms, p95 " << p95 << " ms, p99 " << p99 << " ms, "
+            << average(drawCalls) << " draw calls, " << average(triangles) << " triangles per frame" << endl;
+        if(!options.report.empty()){
+            ofstream file(options.report.c_str());
+            if(file){
+                file << json.str();
+                cout << "Benchmark: report written to " << options.report << endl;
+            }
+            else
+                cout << "ERROR::BENCHMARK::CANNOT_WRITE: " << options.report << endl;
+        }
+    }
+};
+
+#endif
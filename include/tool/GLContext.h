@@ -0,0 +1,585 @@
+#ifndef GLCONTEXT_H
+#define GLCONTEXT_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <chrono>
+#include <iostream>
+#include <functional>
+#include <tool/Benchmark.h>
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+using namespace std;
+
+//EGL的类型与常量只声明用到的部分，libEGL在运行时用dlopen加载：
+//编译与链接都不依赖EGL，没有EGL的机器上窗口模式照常运行
+#ifndef __egl_h_
+typedef void *EGLDisplay;
+typedef void *EGLConfig;
+typedef void *EGLContext;
+typedef void *EGLSurface;
+typedef unsigned int EGLBoolean;
+typedef unsigned int EGLenum;
+typedef int EGLint;
+#define EGL_NONE 0x3038
+#define EGL_VENDOR 0x3053
+#define EGL_EXTENSIONS 0x3055
+#define EGL_SURFACE_TYPE 0x3033
+#define EGL_PBUFFER_BIT 0x0001
+#define EGL_RENDERABLE_TYPE 0x3040
+#define EGL_OPENGL_BIT 0x0008
+#define EGL_RED_SIZE 0x3024
+#define EGL_GREEN_SIZE 0x3023
+#define EGL_BLUE_SIZE 0x3022
+#define EGL_ALPHA_SIZE 0x3021
+#define EGL_DEPTH_SIZE 0x3025
+#define EGL_STENCIL_SIZE 0x3026
+#define EGL_WIDTH 0x3057
+#define EGL_HEIGHT 0x3056
+#define EGL_OPENGL_API 0x30A2
+#define EGL_CONTEXT_MAJOR_VERSION 0x3098
+#define EGL_CONTEXT_MINOR_VERSION 0x30FB
+#define EGL_CONTEXT_OPENGL_PROFILE_MASK 0x30FD
+#define EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT 0x00000001
+#define EGL_DEFAULT_DISPLAY ((void *)0)
+#define EGL_NO_DISPLAY ((EGLDisplay)0)
+#define EGL_NO_CONTEXT ((EGLContext)0)
+#define EGL_NO_SURFACE ((EGLSurface)0)
+#endif
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+enum ContextBackend {
+    CONTEXT_WINDOW = 0,//GLFW窗口
+    CONTEXT_EGL = 1//无窗口的EGL上下文，渲染到离屏表面
+};
+
+//所有课程的main都先调用GLContext::Get().Configure(argc, argv)，命令行参数：
+//  --headless       使用EGL创建无窗口上下文（可以在没有显示器与GPU的机器上用Mesa llvmpipe运行）
+//  --frames N       无窗口模式渲染N帧后退出，默认120
+//  --output 文件    退出前把最后一帧保存为PPM图片，用于回归测试
+//  --fps N          无窗口模式下每帧推进1/N秒，保证每次运行的画面完全一致，默认60
+//  --benchmark ...  回放相机路径并统计帧时间，其余参数见tool/Benchmark.h
+struct ContextOptions {
+    ContextBackend backend = CONTEXT_WINDOW;
+    unsigned int width = 800, height = 600;
+    string title = "LearnOpenGL";
+    unsigned int frames = 120;
+    float fps = 60.0f;
+    string output;
+    int majorVersion = 3, minorVersion = 3;//无窗口模式请求的OpenGL版本，由glfwWindowHint设置
+};
+
+inline ContextOptions ParseContextArgs(int argc, char **argv, unsigned int width, unsigned int height){
+    ContextOptions options;
+    options.width = width;
+    options.height = height;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--headless")
+            options.backend = CONTEXT_EGL;
+        else if(arg == "--frames" && i + 1 < argc)
+            options.frames = static_cast<unsigned int>(atoi(argv[++i]));
+        else if(arg == "--fps" && i + 1 < argc)
+            options.fps = static_cast<float>(atof(argv[++i]));
+        else if(arg == "--output" && i + 1 < argc)
+            options.output = argv[++i];
+    }
+    return options;
+}
+
+//OpenGL上下文：窗口模式包装GLFW，无窗口模式用EGL在pbuffer表面上渲染
+//pbuffer就是无窗口模式下的默认帧缓冲，渲染代码绑定帧缓冲0、调用glViewport等都不需要修改；
+//驱动不支持pbuffer时退回到无表面上下文加一个FBO，此时渲染代码需要用DefaultFramebuffer()代替0
+//无窗口模式下时间按固定步长推进，输入全部视为没有按下
+//基准测试挂在同一个主循环上：ShouldClose第一次调用时开始计时，SwapBuffers结束一帧，PollEvents之后把相机放到路径上
+class GLContext {
+public:
+    ContextOptions options;
+    GLFWwindow *window = nullptr;//无窗口模式下为nullptr
+    unsigned int frame = 0;//已经完成的帧数
+    Benchmark benchmark;
+
+    //进程中唯一的上下文，文件末尾的GLFW接口都转到这里
+    static GLContext &Get(){
+        static GLContext instance;
+        return instance;
+    }
+
+    //解析命令行参数，窗口大小与标题在glfwCreateWindow时给出
+    //第一个参数是课程目录（make run传入src/课程名/），基准测试默认回放其中的CameraPath.txt
+    void Configure(int argc, char **argv){
+        options = ParseContextArgs(argc, argv, options.width, options.height);
+        string lessonPath = argc > 1 && string(argv[1]).compare(0, 2, "--") != 0 ? argv[1] : "./";
+        if(!benchmark.Begin(ParseBenchmarkArgs(argc, argv, lessonPath + "CameraPath.txt")))
+            exit(EXIT_FAILURE);
+    }
+
+    //回放相机路径时由基准测试控制这个相机，没有CustomCamera的课程不需要调用
+    template<class Camera>
+    void AttachCamera(Camera &camera){
+        applyCamera = [this, &camera](){
+            benchmark.Apply(camera);
+        };
+    }
+
+    bool Create(const ContextOptions &options){
+        this->options = options;
+        //基准测试渲染完指定帧数后退出，无窗口模式的帧数也由它决定
+        if(benchmark.Active())
+            this->options.frames = benchmark.TotalFrames();
+        if(options.backend == CONTEXT_EGL && options.fps <= 0.0f){
+            cout << "ERROR::CONTEXT::INVALID_FPS " << options.fps << endl;
+            return false;
+        }
+        if(options.backend == CONTEXT_EGL)
+            return createEGL();
+        return createWindow();
+    }
+
+    bool IsHeadless() const{
+        return options.backend != CONTEXT_WINDOW;
+    }
+
+    //程序使用的"默认"帧缓冲，只有无表面的退回方案不是0
+    unsigned int DefaultFramebuffer() const{
+        return fallbackFBO;
+    }
+
+    bool ShouldClose(){
+        //第一次检查就是进入渲染循环，之前加载资源的时间与绘制调用不计入第一帧
+        if(benchmark.Active() && !benchmarkStarted){
+            benchmark.Start();
+            benchmarkStarted = true;
+            if(applyCamera)
+                applyCamera();
+        }
+        if(benchmark.Done())
+            return true;
+        if(IsHeadless())
+            return frame >= options.frames;
+        return glfwWindowShouldClose(window);
+    }
+
+    void Close(){
+        if(IsHeadless())
+            frame = options.frames;
+        else
+            glfwSetWindowShouldClose(window, true);
+    }
+
+    //窗口模式为真实时间，无窗口模式为帧数乘以固定步长，基准测试为路径上的时间
+    float Time() const{
+        if(benchmark.Active())
+            return benchmark.Time();
+        if(IsHeadless())
+            return frame / options.fps;
+        return static_cast<float>(glfwGetTime());
+    }
+
+    //回放路径时只响应ESC，按键不能改变画面
+    bool GetKey(int key) const{
+        if(benchmark.Active() && key != GLFW_KEY_ESCAPE)
+            return false;
+        return !IsHeadless() && glfwGetKey(window, key) == GLFW_PRESS;
+    }
+
+    void SetTitle(const string &title){
+        if(!IsHeadless())
+            glfwSetWindowTitle(window, title.c_str());
+    }
+
+    //窗口模式交换缓冲；无窗口模式计数，最后一帧按需保存图片；基准测试在这里结束一帧
+    void SwapBuffers(){
+        if(!IsHeadless()){
+            glfwSwapBuffers(window);
+            frame++;
+            benchmark.EndFrame();
+            return;
+        }
+        //固定步长下Time()不反映真实耗时，统计用墙上时间；glFinish保证计入GPU（软件光栅化）的时间
+        glFinish();
+        frame++;
+        if(frame == options.frames){
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+            cout << "Rendered " << frame << " frames in " << seconds << " s, " << seconds * 1000.0 / frame << " ms/frame" << endl;
+            if(!options.output.empty())
+                SaveFramebuffer(options.output);
+        }
+        benchmark.EndFrame();
+    }
+
+    //回放路径时在鼠标与滚轮回调之后设置相机，下一帧按路径上的位置渲染
+    void PollEvents(){
+        if(!IsHeadless())
+            glfwPollEvents();
+        if(benchmark.Active() && applyCamera)
+            applyCamera();
+    }
+
+    //当前上下文中OpenGL函数的地址，用于gladLoadGLLoader
+    void *GetProcAddress(const char *name){
+        if(!IsHeadless())
+            return (void *)glfwGetProcAddress(name);
+#ifndef _WIN32
+        if(library != nullptr)
+            return egl.GetProcAddress(name);
+#endif
+        return nullptr;
+    }
+
+    //把默认帧缓冲读回并保存为二进制PPM（P6），图片上下翻转为正常朝向
+    bool SaveFramebuffer(const string &path){
+        unsigned int width = options.width, height = options.height;
+        vector<unsigned char> pixels(width * height * 3);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, DefaultFramebuffer());
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        ofstream file(path.c_str(), ios::binary);
+        if(!file){
+            cout << "ERROR::CONTEXT::CANNOT_WRITE: " << path << endl;
+            return false;
+        }
+        file << "P6\n" << width << " " << height << "\n255\n";
+        for(int y = height - 1; y >= 0; y--)
+            file.write(reinterpret_cast<const char *>(&pixels[y * width * 3]), width * 3);
+        cout << "Saved frame " << frame << " to " << path << endl;
+        return true;
+    }
+
+    void Destroy(){
+        if(!IsHeadless()){
+            glfwTerminate();
+            return;
+        }
+#ifndef _WIN32
+        if(fallbackFBO != 0){
+            glDeleteFramebuffers(1, &fallbackFBO);
+            glDeleteRenderbuffers(2, fallbackRenderbuffers);
+        }
+        fallbackFBO = 0;
+        if(display != EGL_NO_DISPLAY){
+            egl.MakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if(context != EGL_NO_CONTEXT)
+                egl.DestroyContext(display, context);
+            if(surface != EGL_NO_SURFACE)
+                egl.DestroySurface(display, surface);
+            egl.Terminate(display);
+        }
+        if(library != nullptr)
+            dlclose(library);
+        library = nullptr;
+        display = EGL_NO_DISPLAY;
+        context = EGL_NO_CONTEXT;
+        surface = EGL_NO_SURFACE;
+#endif
+    }
+
+private:
+    //运行时加载的EGL函数
+    struct EGLFunctions {
+        void *(*GetProcAddress)(const char *);
+        EGLDisplay (*GetDisplay)(void *);
+        EGLDisplay (*GetPlatformDisplayEXT)(EGLenum, void *, const EGLint *);
+        EGLBoolean (*Initialize)(EGLDisplay, EGLint *, EGLint *);
+        EGLBoolean (*Terminate)(EGLDisplay);
+        const char *(*QueryString)(EGLDisplay, EGLint);
+        EGLBoolean (*ChooseConfig)(EGLDisplay, const EGLint *, EGLConfig *, EGLint, EGLint *);
+        EGLBoolean (*BindAPI)(EGLenum);
+        EGLContext (*CreateContext)(EGLDisplay, EGLConfig, EGLContext, const EGLint *);
+        EGLBoolean (*DestroyContext)(EGLDisplay, EGLContext);
+        EGLSurface (*CreatePbufferSurface)(EGLDisplay, EGLConfig, const EGLint *);
+        EGLBoolean (*DestroySurface)(EGLDisplay, EGLSurface);
+        EGLBoolean (*MakeCurrent)(EGLDisplay, EGLSurface, EGLSurface, EGLContext);
+        EGLint (*GetError)();
+    };
+
+    void *library = nullptr;
+    EGLFunctions egl;
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+    unsigned int fallbackFBO = 0;
+    unsigned int fallbackRenderbuffers[2] = {0, 0};
+    chrono::steady_clock::time_point startTime;
+    function<void()> applyCamera;
+    bool benchmarkStarted = false;
+
+    //无窗口模式下glad通过EGL获取函数地址
+    static GLContext *&current(){
+        static GLContext *instance = nullptr;
+        return instance;
+    }
+
+    static void *loadProc(const char *name){
+        return current()->egl.GetProcAddress(name);
+    }
+
+    bool createWindow(){
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        window = glfwCreateWindow(options.width, options.height, options.title.c_str(), NULL, NULL);
+        if(window == nullptr){
+            cout << "Failed to create GLFW window" << endl;
+            glfwTerminate();
+            return false;
+        }
+        glfwMakeContextCurrent(window);
+        if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+            cout << "Failed to initialize GLAD" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool createEGL(){
+#ifdef _WIN32
+        cout << "ERROR::CONTEXT::HEADLESS_NOT_SUPPORTED_ON_WINDOWS" << endl;
+        return false;
+#else
+        if(!loadEGL())
+            return false;
+        //优先使用Mesa的surfaceless平台，它不需要X11、Wayland或者显卡设备节点
+        const char *clientExtensions = egl.QueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if(clientExtensions != nullptr && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != nullptr && egl.GetPlatformDisplayEXT != nullptr)
+            display = egl.GetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if(display == EGL_NO_DISPLAY)
+            display = egl.GetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint major = 0, minor = 0;
+        if(display == EGL_NO_DISPLAY || !egl.Initialize(display, &major, &minor)){
+            cout << "ERROR::CONTEXT::EGL_INITIALIZE_FAILED: 0x" << hex << egl.GetError() << dec << endl;
+            return false;
+        }
+        egl.BindAPI(EGL_OPENGL_API);
+
+        //先找支持pbuffer的配置，找不到时使用任意支持桌面OpenGL的配置
+        EGLint pbufferAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+            EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8, EGL_NONE
+        };
+        EGLint anyAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLConfig config = nullptr;
+        EGLint count = 0;
+        bool pbuffer = egl.ChooseConfig(display, pbufferAttributes, &config, 1, &count) && count > 0;
+        if(!pbuffer && !(egl.ChooseConfig(display, anyAttributes, &config, 1, &count) && count > 0)){
+            cout << "ERROR::CONTEXT::NO_EGL_CONFIG" << endl;
+            return false;
+        }
+
+        EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, options.majorVersion, EGL_CONTEXT_MINOR_VERSION, options.minorVersion,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE
+        };
+        context = egl.CreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+        if(context == EGL_NO_CONTEXT){
+            cout << "ERROR::CONTEXT::EGL_CREATE_CONTEXT_FAILED: OpenGL " << options.majorVersion << "." << options.minorVersion
+                << ", 0x" << hex << egl.GetError() << dec << endl;
+            return false;
+        }
+        if(pbuffer){
+            EGLint surfaceAttributes[] = {EGL_WIDTH, (EGLint)options.width, EGL_HEIGHT, (EGLint)options.height, EGL_NONE};
+            surface = egl.CreatePbufferSurface(display, config, surfaceAttributes);
+        }
+        if(!egl.MakeCurrent(display, surface, surface, context)){
+            cout << "ERROR::CONTEXT::EGL_MAKE_CURRENT_FAILED: 0x" << hex << egl.GetError() << dec << endl;
+            return false;
+        }
+        current() = this;
+        if(!gladLoadGLLoader((GLADloadproc)loadProc)){
+            cout << "Failed to initialize GLAD" << endl;
+            return false;
+        }
+        if(surface == EGL_NO_SURFACE)
+            createFallbackFramebuffer();
+        startTime = chrono::steady_clock::now();
+        cout << "Headless EGL " << major << "." << minor << " (" << egl.QueryString(display, EGL_VENDOR) << "), "
+            << glGetString(GL_RENDERER) << ", " << (surface != EGL_NO_SURFACE ? "pbuffer" : "surfaceless + FBO") << endl;
+        return true;
+#endif
+    }
+
+#ifndef _WIN32
+    bool loadEGL(){
+        library = dlopen("libEGL.so.1", RTLD_NOW | RTLD_LOCAL);
+        if(library == nullptr)
+            library = dlopen("libEGL.so", RTLD_NOW | RTLD_LOCAL);
+        if(library == nullptr){
+            cout << "ERROR::CONTEXT::LIBEGL_NOT_FOUND" << endl;
+            return false;
+        }
+        egl.GetProcAddress = (void *(*)(const char *))dlsym(library, "eglGetProcAddress");
+        egl.GetDisplay = (EGLDisplay (*)(void *))dlsym(library, "eglGetDisplay");
+        egl.Initialize = (EGLBoolean (*)(EGLDisplay, EGLint *, EGLint *))dlsym(library, "eglInitialize");
+        egl.Terminate = (EGLBoolean (*)(EGLDisplay))dlsym(library, "eglTerminate");
+        egl.QueryString = (const char *(*)(EGLDisplay, EGLint))dlsym(library, "eglQueryString");
+        egl.ChooseConfig = (EGLBoolean (*)(EGLDisplay, const EGLint *, EGLConfig *, EGLint, EGLint *))dlsym(library, "eglChooseConfig");
+        egl.BindAPI = (EGLBoolean (*)(EGLenum))dlsym(library, "eglBindAPI");
+        egl.CreateContext = (EGLContext (*)(EGLDisplay, EGLConfig, EGLContext, const EGLint *))dlsym(library, "eglCreateContext");
+        egl.DestroyContext = (EGLBoolean (*)(EGLDisplay, EGLContext))dlsym(library, "eglDestroyContext");
+        egl.CreatePbufferSurface = (EGLSurface (*)(EGLDisplay, EGLConfig, const EGLint *))dlsym(library, "eglCreatePbufferSurface");
+        egl.DestroySurface = (EGLBoolean (*)(EGLDisplay, EGLSurface))dlsym(library, "eglDestroySurface");
+        egl.MakeCurrent = (EGLBoolean (*)(EGLDisplay, EGLSurface, EGLSurface, EGLContext))dlsym(library, "eglMakeCurrent");
+        egl.GetError = (EGLint (*)())dlsym(library, "eglGetError");
+        if(egl.GetProcAddress == nullptr || egl.Initialize == nullptr || egl.CreateContext == nullptr || egl.MakeCurrent == nullptr){
+            cout << "ERROR::CONTEXT::LIBEGL_INCOMPLETE" << endl;
+            return false;
+        }
+        //扩展函数只能通过eglGetProcAddress获取
+        egl.GetPlatformDisplayEXT = (EGLDisplay (*)(EGLenum, void *, const EGLint *))egl.GetProcAddress("eglGetPlatformDisplayEXT");
+        return true;
+    }
+#endif
+
+    //没有pbuffer时用FBO代替默认帧缓冲
+    void createFallbackFramebuffer(){
+        glGenFramebuffers(1, &fallbackFBO);
+        glGenRenderbuffers(2, fallbackRenderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, fallbackRenderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, options.width, options.height);
+        glBindRenderbuffer(GL_RENDERBUFFER, fallbackRenderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, options.width, options.height);
+        glBindFramebuffer(GL_FRAMEBUFFER, fallbackFBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, fallbackRenderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, fallbackRenderbuffers[1]);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            cout << "ERROR::CONTEXT::FRAMEBUFFER_NOT_COMPLETE" << endl;
+    }
+};
+
+//课程中的GLFW调用：本文件在glfw3.h之后包含，下面的宏把用到的GLFW函数换成这些同名的接口
+//窗口模式下直接调用GLFW，行为与原来完全相同；--headless时由GLContext::Get()的EGL上下文实现，
+//glfwCreateWindow返回一个只用来传给这些接口的句柄，按键全部视为没有按下，glfwGetTime按固定步长推进，
+//渲染够--frames帧后glfwWindowShouldClose返回true，课程本身的代码不需要任何修改
+//--benchmark在两种模式下都可以使用，时间与按键同样由GLContext接管
+inline int contextInit(){
+    return GLContext::Get().IsHeadless() ? GLFW_TRUE : glfwInit();
+}
+
+inline void contextTerminate(){
+    GLContext::Get().Destroy();
+}
+
+inline void contextWindowHint(int hint, int value){
+    GLContext &context = GLContext::Get();
+    if(!context.IsHeadless()){
+        glfwWindowHint(hint, value);
+        return;
+    }
+    if(hint == GLFW_CONTEXT_VERSION_MAJOR)
+        context.options.majorVersion = value;
+    else if(hint == GLFW_CONTEXT_VERSION_MINOR)
+        context.options.minorVersion = value;
+}
+
+//创建失败时返回nullptr，课程可以换一个版本重试
+inline GLFWwindow *contextCreateWindow(int width, int height, const char *title, GLFWmonitor *monitor, GLFWwindow *share){
+    GLContext &context = GLContext::Get();
+    if(!context.IsHeadless()){
+        GLFWwindow *window = glfwCreateWindow(width, height, title, monitor, share);
+        if(context.window == nullptr)
+            context.window = window;
+        return window;
+    }
+    context.options.width = width;
+    context.options.height = height;
+    context.options.title = title;
+    if(!context.Create(context.options)){
+        context.Destroy();
+        return nullptr;
+    }
+    return reinterpret_cast<GLFWwindow *>(&context);
+}
+
+inline void contextMakeContextCurrent(GLFWwindow *window){
+    if(!GLContext::Get().IsHeadless())
+        glfwMakeContextCurrent(window);
+}
+
+inline GLFWglproc contextGetProcAddress(const char *name){
+    return (GLFWglproc)GLContext::Get().GetProcAddress(name);
+}
+
+inline int contextWindowShouldClose(GLFWwindow *window){
+    return GLContext::Get().ShouldClose() ? GLFW_TRUE : GLFW_FALSE;
+}
+
+inline void contextSetWindowShouldClose(GLFWwindow *window, int value){
+    if(!GLContext::Get().IsHeadless())
+        glfwSetWindowShouldClose(window, value);
+    else if(value)
+        GLContext::Get().Close();
+}
+
+inline int contextGetKey(GLFWwindow *window, int key){
+    return GLContext::Get().GetKey(key) ? GLFW_PRESS : GLFW_RELEASE;
+}
+
+inline double contextGetTime(){
+    GLContext &context = GLContext::Get();
+    return context.IsHeadless() || context.benchmark.Active() ? context.Time() : glfwGetTime();
+}
+
+inline void contextSetWindowTitle(GLFWwindow *window, const char *title){
+    GLContext::Get().SetTitle(title);
+}
+
+inline void contextSwapBuffers(GLFWwindow *window){
+    GLContext::Get().SwapBuffers();
+}
+
+inline void contextPollEvents(){
+    GLContext::Get().PollEvents();
+}
+
+inline void contextSwapInterval(int interval){
+    if(!GLContext::Get().IsHeadless())
+        glfwSwapInterval(interval);
+}
+
+inline void contextSetInputMode(GLFWwindow *window, int mode, int value){
+    if(!GLContext::Get().IsHeadless())
+        glfwSetInputMode(window, mode, value);
+}
+
+//无窗口模式下没有窗口事件，回调不会被调用
+inline GLFWframebuffersizefun contextSetFramebufferSizeCallback(GLFWwindow *window, GLFWframebuffersizefun callback){
+    return GLContext::Get().IsHeadless() ? nullptr : glfwSetFramebufferSizeCallback(window, callback);
+}
+
+inline GLFWcursorposfun contextSetCursorPosCallback(GLFWwindow *window, GLFWcursorposfun callback){
+    return GLContext::Get().IsHeadless() ? nullptr : glfwSetCursorPosCallback(window, callback);
+}
+
+inline GLFWscrollfun contextSetScrollCallback(GLFWwindow *window, GLFWscrollfun callback){
+    return GLContext::Get().IsHeadless() ? nullptr : glfwSetScrollCallback(window, callback);
+}
+
+#define glfwInit contextInit
+#define glfwTerminate contextTerminate
+#define glfwWindowHint contextWindowHint
+#define glfwCreateWindow contextCreateWindow
+#define glfwMakeContextCurrent contextMakeContextCurrent
+#define glfwGetProcAddress contextGetProcAddress
+#define glfwWindowShouldClose contextWindowShouldClose
+#define glfwSetWindowShouldClose contextSetWindowShouldClose
+#define glfwGetKey contextGetKey
+#define glfwGetTime contextGetTime
+#define glfwSetWindowTitle contextSetWindowTitle
+#define glfwSwapBuffers contextSwapBuffers
+#define glfwPollEvents contextPollEvents
+#define glfwSwapInterval contextSwapInterval
+#define glfwSetInputMode contextSetInputMode
+#define glfwSetFramebufferSizeCallback contextSetFramebufferSizeCallback
+#define glfwSetCursorPosCallback contextSetCursorPosCallback
+#define glfwSetScrollCallback contextSetScrollCallback
+#endif
@@ -1,5 +1,6 @@
 #include <glad/glad.h>//glad用于管理opengl的函数指针
 #include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
 #include <iostream>
 using namespace std;
 
@@ -18,7 +19,8 @@ void processInput(GLFWwindow* window){
     }
 }
 
-int main(){
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
     //初始化glfw
     glfwInit();
     //设置glfw主要和次要版本
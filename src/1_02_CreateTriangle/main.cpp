@@ -1,5 +1,6 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
 #include <iostream>
 using namespace std;
 
@@ -32,7 +33,8 @@ void processInput(GLFWwindow* window){
     }
 }
 
-int main(){
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -1,5 +1,6 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
 #include "CustomShader.h"
 #include "CustomCamera.h"
 #include <iostream>
@@ -104,7 +105,9 @@ unsigned int loadTexture(char const * path)
     return textureID;
 }
 
-int main(){
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -0,0 +1,32 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+#ifdef INSTANCED
+//实例化数组，每个实例一个模型矩阵（占用位置7~10）和一个vec4数据
+layout (location = 7) in mat4 aInstanceMatrix;
+layout (location = 11) in vec4 aInstanceData;
+#endif
+
+out vec2 TexCoords;
+out vec3 Normal;
+out vec4 Tint;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+#ifdef INSTANCED
+    mat4 world = aInstanceMatrix;
+    Tint = aInstanceData;
+#else
+    mat4 world = model;
+    Tint = vec4(1.0, 1.0, 1.0, 0.0);
+#endif
+    TexCoords = aTexCoords;
+    //实例矩阵只包含旋转、均匀缩放和平移，可以直接用mat3变换法线
+    Normal = mat3(world) * aNormal;
+    gl_Position = projection * view * world * vec4(aPos, 1.0);
+}
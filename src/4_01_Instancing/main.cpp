@@ -0,0 +1,207 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomCamera.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "InstanceBuffer.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_01_Instancing/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+CustomCamera camera(glm::vec3(0.0f, 20.0f, 200.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -5.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//小行星数量，所有小行星只需要一次实例化绘制调用
+const unsigned int AMOUNT = 100000;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+//生成围绕行星的小行星带：半径上随机偏移、随机缩放和随机旋转
+void generateAsteroids(vector<glm::mat4> &matrices, vector<glm::vec4> &tints){
+    matrices.resize(AMOUNT);
+    tints.resize(AMOUNT);
+    srand(static_cast<unsigned int>(glfwGetTime()));
+    float radius = 150.0f;
+    float offset = 25.0f;
+    for(unsigned int i = 0; i < AMOUNT; i++){
+        glm::mat4 model = glm::mat4(1.0f);
+        //位移：分布在半径为radius的圆环上，偏移范围是[-offset, offset]
+        float angle = (float)i / (float)AMOUNT * 360.0f;
+        float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+        float x = sin(angle) * radius + displacement;
+        displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+        float y = displacement * 0.4f;//让行星带的高度比宽度小
+        displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+        float z = cos(angle) * radius + displacement;
+        model = glm::translate(model, glm::vec3(x, y, z));
+        //缩放：在0.05和0.25之间
+        float scale = (rand() % 20) / 100.0f + 0.05f;
+        model = glm::scale(model, glm::vec3(scale));
+        //旋转：绕一个半随机的轴旋转随机角度
+        float rotAngle = (float)(rand() % 360);
+        model = glm::rotate(model, rotAngle, glm::vec3(0.4f, 0.6f, 0.8f));
+        matrices[i] = model;
+        //每实例数据：灰褐色的随机色调，a分量为与纹理颜色的混合权重
+        float shade = 0.45f + (rand() % 40) / 100.0f;
+        tints[i] = glm::vec4(shade, shade * 0.9f, shade * 0.8f, 0.6f);
+    }
+}
+
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glEnable(GL_DEPTH_TEST);
+    //关闭垂直同步，方便观察实例化绘制的真实帧率
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 40.0f;
+
+    //同一份着色器文件编译出两个变体：行星使用uniform model，小行星使用实例化数组
+    CustomShader planetShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+    CustomShader asteroidShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str(), "INSTANCED");
+
+    //加载模型
+    Model planet("static/model/planet/planet.obj");
+    Model rock("static/model/rock/rock.obj");
+
+    //生成所有小行星的变换矩阵，并一次性上传到实例缓冲中
+    vector<glm::mat4> modelMatrices;
+    vector<glm::vec4> tints;
+    generateAsteroids(modelMatrices, tints);
+    InstanceBuffer asteroids(modelMatrices.data(), AMOUNT, tints.data());
+    rock.SetInstanceBuffer(asteroids);
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    while (!glfwWindowShouldClose(window)){
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        //每隔0.5秒在标题栏显示平均帧时间
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            string title = "LearnOpenGL - " + to_string(AMOUNT) + " asteroids - " + to_string(ms) + " ms/frame";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+        }
+
+        processInput(window);
+        glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
+        glm::vec3 lightDir(-0.2f, -1.0f, -0.3f);
+
+        //绘制行星
+        planetShader.use();
+        planetShader.setMat4("view", view);
+        planetShader.setMat4("projection", projection);
+        planetShader.setVec3("lightDir", lightDir);
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
+        model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
+        planetShader.setMat4("model", model);
+        planet.Draw(planetShader);
+
+        //绘制小行星：每个网格一次glDrawElementsInstanced
+        asteroidShader.use();
+        asteroidShader.setMat4("view", view);
+        asteroidShader.setMat4("projection", projection);
+        asteroidShader.setVec3("lightDir", lightDir);
+        rock.DrawInstanced(asteroidShader, asteroids.count);
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    asteroids.Release();
+    glfwTerminate();
+
+    return 0;
+}
\ No newline at end of file
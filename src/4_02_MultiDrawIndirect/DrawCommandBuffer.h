@@ -0,0 +1,212 @@
+#ifndef DRAWCOMMANDBUFFER_H
+#define DRAWCOMMANDBUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include "CustomShader.h"
+#include "MeshPool.h"
+using namespace std;
+
+//绘制编号使用的顶点属性位置，配合baseInstance得到每个绘制在存储缓冲中的下标
+#define DRAW_ID_LOCATION 12
+//存储缓冲的绑定点，与IndirectVertexShader.glsl中的binding一致
+#define DRAW_BUFFER_BINDING 0
+#define MATERIAL_BUFFER_BINDING 1
+
+//glMultiDrawElementsIndirect读取的命令格式，布局由OpenGL规定，不能改动
+struct DrawElementsIndirectCommand {
+    GLuint count;//索引数量
+    GLuint instanceCount;//实例数量
+    GLuint firstIndex;//起始索引
+    GLint baseVertex;//顶点偏移
+    GLuint baseInstance;//实例偏移，这里用作第一个绘制在DrawData数组中的下标
+};
+
+//每个绘制的数据，按std430布局存放：模型矩阵 + params(x为材质下标)
+struct DrawData {
+    glm::mat4 model;
+    glm::vec4 params;
+};
+
+//材质表，所有绘制共享
+struct MaterialData {
+    glm::vec4 diffuse;
+    glm::vec4 specular;//w为反光度
+};
+
+//CPU端的绘制命令缓冲
+//每帧先Add所有可见的绘制，再Build打包成间接绘制命令，最后Submit
+//支持GL4.3时整帧只需要一次glMultiDrawElementsIndirect；GL3.3上退化为每条命令一次glDrawElementsInstancedBaseVertex
+class DrawCommandBuffer {
+public:
+    vector<DrawElementsIndirectCommand> commands;
+    vector<DrawData> draws;//已按网格排序，与commands的baseInstance对应
+
+    //indirect为false时强制使用GL3.3的回退路径
+    void Init(MeshPool &pool, bool indirect){
+        useIndirect = indirect && GLAD_GL_VERSION_4_3;
+        this->pool = &pool;
+        glGenBuffers(1, &drawBuffer);
+        glGenBuffers(1, &materialBuffer);
+        if(useIndirect){
+            glGenBuffers(1, &commandBuffer);
+            glGenBuffers(1, &drawIDBuffer);
+        }else{
+            //GL3.3没有存储缓冲，改用缓冲纹理读取同一份数据
+            glGenTextures(1, &drawTexture);
+            glGenTextures(1, &materialTexture);
+        }
+    }
+
+    bool IsIndirect() const{
+        return useIndirect;
+    }
+
+    void SetMaterials(const vector<MaterialData> &materials){
+        uploadStorage(materialBuffer, materials.size() * sizeof(MaterialData), materials.data(), materialCapacity);
+        if(!useIndirect){
+            glBindTexture(GL_TEXTURE_BUFFER, materialTexture);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, materialBuffer);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+        }
+    }
+
+    //开始新的一帧
+    void Begin(){
+        pending.clear();
+    }
+
+    //记录一次绘制
+    void Add(unsigned int meshID, const glm::mat4 &model, unsigned int material){
+        PendingDraw draw;
+        draw.meshID = meshID;
+        draw.data.model = model;
+        draw.data.params = glm::vec4((float)material, 0.0f, 0.0f, 0.0f);
+        pending.push_back(draw);
+    }
+
+    //按网格排序后打包：使用同一网格的连续绘制合并为一条instanceCount>1的命令
+    void Build(){
+        stable_sort(pending.begin(), pending.end(), [](const PendingDraw &a, const PendingDraw &b){
+            return a.meshID < b.meshID;
+        });
+        commands.clear();
+        draws.resize(pending.size());
+        for(unsigned int i = 0; i < pending.size(); i++){
+            draws[i] = pending[i].data;
+            if(!commands.empty() && pending[i - 1].meshID == pending[i].meshID){
+                commands.back().instanceCount++;
+                continue;
+            }
+            const MeshRange &range = pool->ranges[pending[i].meshID];
+            DrawElementsIndirectCommand cmd;
+            cmd.count = range.indexCount;
+            cmd.instanceCount = 1;
+            cmd.firstIndex = range.firstIndex;
+            cmd.baseVertex = range.baseVertex;
+            cmd.baseInstance = i;
+            commands.push_back(cmd);
+        }
+    }
+
+    //提交绘制，返回本帧产生的绘制调用次数
+    unsigned int Submit(CustomShader &shader){
+        if(commands.empty())
+            return 0;
+        uploadStorage(drawBuffer, draws.size() * sizeof(DrawData), draws.data(), drawCapacity);
+        glBindVertexArray(pool->VAO);
+        shader.use();
+
+        if(useIndirect){
+            ensureDrawIDs(static_cast<unsigned int>(draws.size()));
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BUFFER_BINDING, drawBuffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BUFFER_BINDING, materialBuffer);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            //命令缓冲每帧重新填充，先孤立旧的存储再上传
+            GLsizeiptr size = commands.size() * sizeof(DrawElementsIndirectCommand);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, commands.data());
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, static_cast<GLsizei>(commands.size()), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            glBindVertexArray(0);
+            return 1;
+        }
+
+        //回退路径：缓冲纹理 + 每条命令一次实例化绘制，drawBase代替baseInstance
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, drawTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, drawBuffer);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_BUFFER, materialTexture);
+        shader.setInt("drawBuffer", 0);
+        shader.setInt("materialBuffer", 1);
+        int drawBaseLocation = glGetUniformLocation(shader.ID, "drawBase");
+        for(unsigned int i = 0; i < commands.size(); i++){
+            const DrawElementsIndirectCommand &cmd = commands[i];
+            glUniform1i(drawBaseLocation, static_cast<int>(cmd.baseInstance));
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cmd.count, GL_UNSIGNED_INT,
+                (void*)(cmd.firstIndex * sizeof(unsigned int)), cmd.instanceCount, cmd.baseVertex);
+        }
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(0);
+        return static_cast<unsigned int>(commands.size());
+    }
+
+    void Release(){
+        glDeleteBuffers(1, &drawBuffer);
+        glDeleteBuffers(1, &materialBuffer);
+        if(useIndirect){
+            glDeleteBuffers(1, &commandBuffer);
+            glDeleteBuffers(1, &drawIDBuffer);
+        }else{
+            glDeleteTextures(1, &drawTexture);
+            glDeleteTextures(1, &materialTexture);
+        }
+    }
+
+private:
+    struct PendingDraw {
+        unsigned int meshID;
+        DrawData data;
+    };
+    vector<PendingDraw> pending;
+    MeshPool *pool = nullptr;
+    bool useIndirect = false;
+    unsigned int commandBuffer = 0, drawBuffer = 0, materialBuffer = 0, drawIDBuffer = 0;
+    unsigned int drawTexture = 0, materialTexture = 0;
+    size_t drawCapacity = 0, materialCapacity = 0;
+    unsigned int drawIDCapacity = 0;
+
+    //上传到存储缓冲，容量不够时重新分配
+    void uploadStorage(unsigned int buffer, size_t size, const void *data, size_t &capacity){
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        if(size > capacity){
+            glBufferData(GL_TEXTURE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+            capacity = size;
+        }else{
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    //绘制编号缓冲保存0,1,2...，属性除数为1，读取位置由baseInstance + gl_InstanceID决定
+    //于是着色器里的aDrawID就是当前实例在DrawData数组中的下标
+    void ensureDrawIDs(unsigned int count){
+        if(count <= drawIDCapacity)
+            return;
+        drawIDCapacity = max(count, drawIDCapacity * 2);
+        vector<GLuint> ids(drawIDCapacity);
+        for(unsigned int i = 0; i < drawIDCapacity; i++)
+            ids[i] = i;
+        glBindVertexArray(pool->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, drawIDBuffer);
+        glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(DRAW_ID_LOCATION);
+        glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+        glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+#endif
@@ -0,0 +1,31 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+//GL3.3没有存储缓冲，使用缓冲纹理读取与间接绘制路径相同的数据
+//每个DrawData占5个RGBA32F纹素，每个MaterialData占2个
+uniform samplerBuffer drawBuffer;
+uniform samplerBuffer materialBuffer;
+uniform int drawBase;//当前命令第一个绘制的下标，代替baseInstance
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 Normal;
+out vec3 FragPos;
+flat out vec4 Diffuse;
+flat out vec4 Specular;
+
+void main()
+{
+    int id = (drawBase + gl_InstanceID) * 5;
+    mat4 model = mat4(texelFetch(drawBuffer, id), texelFetch(drawBuffer, id + 1),
+                      texelFetch(drawBuffer, id + 2), texelFetch(drawBuffer, id + 3));
+    int material = int(texelFetch(drawBuffer, id + 4).x) * 2;
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    FragPos = worldPos.xyz;
+    Normal = mat3(model) * aNormal;
+    Diffuse = texelFetch(materialBuffer, material);
+    Specular = texelFetch(materialBuffer, material + 1);
+    gl_Position = projection * view * worldPos;
+}
@@ -0,0 +1,42 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+//绘制编号：属性除数为1，读取位置为baseInstance + gl_InstanceID
+layout (location = 12) in uint aDrawID;
+
+struct DrawData{
+    mat4 model;
+    vec4 params;//x为材质下标
+};
+struct MaterialData{
+    vec4 diffuse;
+    vec4 specular;//w为反光度
+};
+
+//所有绘制共享的存储缓冲
+layout (std430, binding = 0) readonly buffer DrawBuffer{
+    DrawData draws[];
+};
+layout (std430, binding = 1) readonly buffer MaterialBuffer{
+    MaterialData materials[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 Normal;
+out vec3 FragPos;
+flat out vec4 Diffuse;
+flat out vec4 Specular;
+
+void main()
+{
+    DrawData draw = draws[aDrawID];
+    MaterialData material = materials[uint(draw.params.x)];
+    vec4 worldPos = draw.model * vec4(aPos, 1.0);
+    FragPos = worldPos.xyz;
+    Normal = mat3(draw.model) * aNormal;
+    Diffuse = material.diffuse;
+    Specular = material.specular;
+    gl_Position = projection * view * worldPos;
+}
@@ -0,0 +1,150 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <string>
+#include <vector>
+#include "CustomShader.h"
+#include "InstanceBuffer.h"
+using namespace std;
+
+//通过使用Assimp，我们可以加载不同的模型到程序中，但是载入后它们都被储存为Assimp的数据结构
+//我们最终仍要将这些数据转换为OpenGL能够理解的格式，这样才能渲染这个物体
+
+#define MAX_BONE_INFLUENCE 4
+
+//顶点
+struct Vertex {
+    glm::vec3 Position;//位置
+    glm::vec3 Normal;//法线
+    glm::vec2 TexCoords;//纹理坐标
+    glm::vec3 Tangent;//切线
+    glm::vec3 Bitangent;//副切线
+	//bone indexes which will influence this vertex
+	int m_BoneIDs[MAX_BONE_INFLUENCE];
+	//weights from each bone
+	float m_Weights[MAX_BONE_INFLUENCE];
+};
+
+//纹理数据
+struct Texture {
+    unsigned int id;
+    string type;//纹理类型，比如是漫反射贴图或者镜面光贴图
+    string path;//储存纹理的路径，用于与其它纹理进行比较
+};
+
+//网格类
+class Mesh {
+public:
+    //网格数据
+    vector<Vertex> vertices;//顶点
+    vector<unsigned int> indices;//索引
+    vector<Texture> textures;//纹理 
+
+    //初始化网格数据与缓冲区
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures){
+        this->vertices = vertices;
+        this->indices = indices;
+        this->textures = textures;
+        setupMesh();
+    }
+
+    //绘制网格，将着色器传入网格类中可以让我们在绘制之前设置一些uniform
+    void Draw(CustomShader &shader){
+        bindTextures(shader);
+
+        // 绘制网格
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
+
+    //把实例缓冲的属性绑定到网格的VAO上，之后即可用DrawInstanced一次绘制所有实例
+    //着色器需要以"INSTANCED"宏编译，从而使用实例属性代替uniform model
+    void SetInstanceBuffer(const InstanceBuffer &instances){
+        glBindVertexArray(VAO);
+        instances.BindAttributes();
+        glBindVertexArray(0);
+    }
+
+    //实例化绘制：一次绘制调用绘制instanceCount个实例
+    void DrawInstanced(CustomShader &shader, unsigned int instanceCount){
+        if(instanceCount == 0)
+            return;
+        bindTextures(shader);
+
+        glBindVertexArray(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0, instanceCount);
+        glBindVertexArray(0);
+    }
+private:
+    unsigned int VAO, VBO, EBO;
+    //绑定网格的纹理，并设置着色器中对应的采样器
+    void bindTextures(CustomShader &shader){
+        unsigned int diffuseNr = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr = 1;
+        unsigned int heightNr = 1;
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i); // 在绑定之前激活相应的纹理单元
+            // 获取纹理序号（diffuse_textureN 中的 N）
+            string number;
+            string name = textures[i].type;
+            if(name == "texture_diffuse")
+                number = std::to_string(diffuseNr++);
+            else if(name == "texture_specular")
+                number = std::to_string(specularNr++);
+            else if(name == "texture_normal")
+                number = std::to_string(normalNr++); // transfer unsigned int to string
+            else if(name == "texture_height")
+                number = std::to_string(heightNr++); // transfer unsigned int to string
+
+            shader.setInt(("material." + name + number).c_str(), i);
+            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+    //初始化缓冲区
+    void setupMesh(){
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+        //结构体的内存空间是连续的，所以可以使用vertices.size() * sizeof(Vertex)直接计算结构体的大小
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+
+        // 顶点位置
+        glEnableVertexAttribArray(0);   
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // 顶点法线
+        glEnableVertexAttribArray(1);   
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // 顶点纹理坐标
+        glEnableVertexAttribArray(2);   
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        // 切线
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        // 副切线
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+		// ids
+		glEnableVertexAttribArray(5);
+		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+		// weights
+		glEnableVertexAttribArray(6);
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+
+        glBindVertexArray(0);
+    }
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef MESHPOOL_H
+#define MESHPOOL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "Mesh.h"
+#include "Model.h"
+using namespace std;
+
+//网格在共享缓冲中的位置，正好对应DrawElementsIndirectCommand中的count/firstIndex/baseVertex
+struct MeshRange {
+    unsigned int indexCount;
+    unsigned int firstIndex;//在共享索引缓冲中的起始位置（以索引为单位）
+    int baseVertex;//在共享顶点缓冲中的起始位置（以顶点为单位）
+};
+
+//网格池：把许多网格的顶点与索引合并进同一个VAO/VBO/EBO
+//glMultiDrawElementsIndirect一次只能使用一个VAO，所以所有参与多重绘制的网格都必须放在同一组缓冲里
+class MeshPool {
+public:
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    vector<MeshRange> ranges;//按网格编号索引
+
+    //添加一个网格，返回网格编号。数据先留在CPU端，调用Upload后才会上传
+    unsigned int AddMesh(const vector<Vertex> &meshVertices, const vector<unsigned int> &meshIndices){
+        MeshRange range;
+        range.indexCount = static_cast<unsigned int>(meshIndices.size());
+        range.firstIndex = static_cast<unsigned int>(indices.size());
+        range.baseVertex = static_cast<int>(vertices.size());
+        vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+        //索引保持相对于网格自身，由baseVertex在绘制时加上偏移
+        indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+        ranges.push_back(range);
+        return static_cast<unsigned int>(ranges.size() - 1);
+    }
+
+    //添加模型中的所有网格，返回第一个网格的编号，网格编号是连续的
+    unsigned int AddModel(const Model &model){
+        unsigned int first = static_cast<unsigned int>(ranges.size());
+        for(unsigned int i = 0; i < model.meshes.size(); i++){
+            AddMesh(model.meshes[i].vertices, model.meshes[i].indices);
+        }
+        return first;
+    }
+
+    unsigned int MeshCount() const{
+        return static_cast<unsigned int>(ranges.size());
+    }
+
+    //创建共享缓冲并上传全部数据，之后释放CPU端的拷贝
+    void Upload(){
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+        // 顶点位置
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // 顶点法线
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // 顶点纹理坐标
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+
+        glBindVertexArray(0);
+
+        vertices.clear();
+        vertices.shrink_to_fit();
+        indices.clear();
+        indices.shrink_to_fit();
+    }
+
+    void Release(){
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+
+private:
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+};
+#endif
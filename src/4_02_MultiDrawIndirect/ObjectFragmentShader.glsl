@@ -0,0 +1,36 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec3 FragPos;
+flat in vec4 Diffuse;
+flat in vec4 Specular;
+
+//定向光
+struct DirLight{
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform vec3 viewPos;
+uniform DirLight dirLight;
+
+void main()
+{
+    vec3 normal = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 lightDir = normalize(-dirLight.direction);
+    // 漫反射着色
+    float diff = max(dot(normal, lightDir), 0.0);
+    // 镜面光着色（Blinn-Phong）
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), Specular.w);
+    // 合并结果
+    vec3 ambient = dirLight.ambient * Diffuse.rgb;
+    vec3 diffuse = dirLight.diffuse * diff * Diffuse.rgb;
+    vec3 specular = dirLight.specular * spec * Specular.rgb;
+    FragColor = vec4(ambient + diffuse + specular, 1.0);
+}
@@ -0,0 +1,297 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomCamera.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "MeshPool.h"
+#include "DrawCommandBuffer.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_02_MultiDrawIndirect/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+CustomCamera camera(glm::vec3(0.0f, 30.0f, 120.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -15.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//场景规模：程序生成的网格变体数量、物体数量（GRID_SIZE * GRID_SIZE）与材质数量
+const unsigned int MESH_VARIANTS = 2048;
+const unsigned int GRID_SIZE = 100;
+const unsigned int MATERIAL_COUNT = 64;
+bool useIndirect = true;
+bool toggleKeyDown = false;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //M键在多重间接绘制与GL3.3回退路径之间切换
+    bool toggle = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+    if(toggle && !toggleKeyDown)
+        useIndirect = !useIndirect;
+    toggleKeyDown = toggle;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+//程序生成一块岩石：对单位球的顶点做随机起伏，每个seed得到一个不同的网格
+void generateRock(unsigned int seed, vector<Vertex> &vertices, vector<unsigned int> &indices){
+    const unsigned int stacks = 8 + seed % 8;
+    const unsigned int slices = 10 + seed % 10;
+    srand(seed);
+    float bumps[4];
+    for(unsigned int i = 0; i < 4; i++)
+        bumps[i] = (rand() % 100) / 100.0f * 0.25f;
+    vertices.clear();
+    indices.clear();
+    for(unsigned int y = 0; y <= stacks; y++){
+        float v = (float)y / stacks;
+        float phi = v * glm::pi<float>();
+        for(unsigned int x = 0; x <= slices; x++){
+            float u = (float)x / slices;
+            float theta = u * 2.0f * glm::pi<float>();
+            glm::vec3 dir(cos(theta) * sin(phi), cos(phi), sin(theta) * sin(phi));
+            float r = 1.0f + bumps[0] * sin(3.0f * theta) + bumps[1] * cos(5.0f * phi)
+                    + bumps[2] * sin(2.0f * theta + 4.0f * phi) - bumps[3] * fabs(dir.y);
+            Vertex vertex = {};
+            vertex.Position = dir * r;
+            vertex.Normal = dir;//近似法线，足够用于演示
+            vertex.TexCoords = glm::vec2(u, v);
+            vertices.push_back(vertex);
+        }
+    }
+    for(unsigned int y = 0; y < stacks; y++){
+        for(unsigned int x = 0; x < slices; x++){
+            unsigned int i0 = y * (slices + 1) + x;
+            unsigned int i1 = i0 + slices + 1;
+            indices.push_back(i0);
+            indices.push_back(i1);
+            indices.push_back(i0 + 1);
+            indices.push_back(i0 + 1);
+            indices.push_back(i1);
+            indices.push_back(i1 + 1);
+        }
+    }
+}
+
+//网格包围球半径（相对原点），用于把不同尺寸的网格缩放到相近大小
+float meshRadius(const vector<Vertex> &vertices){
+    float radius = 0.0f;
+    for(unsigned int i = 0; i < vertices.size(); i++)
+        radius = max(radius, glm::length(vertices[i].Position));
+    return radius > 0.0f ? radius : 1.0f;
+}
+
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    glfwInit();
+    //glMultiDrawElementsIndirect与存储缓冲需要GL4.3，创建失败时退回GL3.3
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    }
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glEnable(GL_DEPTH_TEST);
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 30.0f;
+
+    //把所有网格放入同一个网格池
+    MeshPool pool;
+    vector<float> radii;
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    for(unsigned int i = 0; i < MESH_VARIANTS; i++){
+        generateRock(i + 1, vertices, indices);
+        pool.AddMesh(vertices, indices);
+        radii.push_back(meshRadius(vertices));
+    }
+    const char *modelPaths[] = {
+        "static/model/rock/rock.obj",
+        "static/model/planet/planet.obj",
+        "static/model/teapot/teapot.obj"
+    };
+    for(const char *path : modelPaths){
+        Model model(path);
+        pool.AddModel(model);
+        for(unsigned int i = 0; i < model.meshes.size(); i++)
+            radii.push_back(meshRadius(model.meshes[i].vertices));
+    }
+    pool.Upload();
+    cout << "MeshPool: " << pool.MeshCount() << " meshes" << endl;
+
+    //材质表
+    vector<MaterialData> materials(MATERIAL_COUNT);
+    srand(42);
+    for(unsigned int i = 0; i < MATERIAL_COUNT; i++){
+        glm::vec3 color((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f);
+        materials[i].diffuse = glm::vec4(0.2f + 0.8f * color, 1.0f);
+        materials[i].specular = glm::vec4(glm::vec3(0.5f), 8.0f + (rand() % 120));
+    }
+
+    //GL4.3上同时准备两条路径，方便按M键对比
+    DrawCommandBuffer indirectDraws, fallbackDraws;
+    CustomShader *indirectShader = nullptr;
+    if(GLAD_GL_VERSION_4_3){
+        indirectDraws.Init(pool, true);
+        indirectDraws.SetMaterials(materials);
+        indirectShader = new CustomShader((Path + "IndirectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+    }else{
+        useIndirect = false;
+        cout << "GL 4.3 not available, using the GL 3.3 fallback loop" << endl;
+    }
+    fallbackDraws.Init(pool, false);
+    fallbackDraws.SetMaterials(materials);
+    CustomShader fallbackShader((Path + "FallbackVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+
+    //每个格子放置一个物体，随机选择网格与材质
+    struct Object {
+        unsigned int mesh;
+        unsigned int material;
+        glm::mat4 model;
+    };
+    vector<Object> objects;
+    for(unsigned int z = 0; z < GRID_SIZE; z++){
+        for(unsigned int x = 0; x < GRID_SIZE; x++){
+            Object object;
+            object.mesh = rand() % pool.MeshCount();
+            object.material = rand() % MATERIAL_COUNT;
+            glm::vec3 position((x - GRID_SIZE / 2.0f) * 3.0f, 0.0f, (z - GRID_SIZE / 2.0f) * 3.0f);
+            object.model = glm::translate(glm::mat4(1.0f), position);
+            object.model = glm::rotate(object.model, (float)(rand() % 360), glm::vec3(0.0f, 1.0f, 0.0f));
+            object.model = glm::scale(object.model, glm::vec3(1.2f / radii[object.mesh]));
+            objects.push_back(object);
+        }
+    }
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    unsigned int drawCalls = 0;
+    while (!glfwWindowShouldClose(window)){
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            string title = string("LearnOpenGL - ") + (useIndirect ? "MultiDrawIndirect" : "GL3.3 fallback") + " - "
+                + to_string(objects.size()) + " objects, " + to_string(drawCalls) + " draw calls - " + to_string(ms) + " ms/frame";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+        }
+
+        processInput(window);
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 500.0f);
+
+        DrawCommandBuffer &draws = useIndirect ? indirectDraws : fallbackDraws;
+        CustomShader &shader = useIndirect ? *indirectShader : fallbackShader;
+        shader.use();
+        shader.setMat4("view", view);
+        shader.setMat4("projection", projection);
+        shader.setVec3("viewPos", camera.Position);
+        shader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+        shader.setVec3("dirLight.ambient", 0.1f, 0.1f, 0.1f);
+        shader.setVec3("dirLight.diffuse", 0.8f, 0.8f, 0.8f);
+        shader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
+
+        //每帧在CPU上重新记录命令，之后可以在这里插入剔除
+        draws.Begin();
+        for(unsigned int i = 0; i < objects.size(); i++)
+            draws.Add(objects[i].mesh, objects[i].model, objects[i].material);
+        draws.Build();
+        drawCalls = draws.Submit(shader);
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    if(indirectShader != nullptr){
+        indirectDraws.Release();
+        delete indirectShader;
+    }
+    fallbackDraws.Release();
+    pool.Release();
+    glfwTerminate();
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,183 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+//帧区域数量：CPU写第N帧时，GPU可能还在读第N-1、N-2帧的数据
+#define RING_FRAME_REGIONS 3
+
+//一次分配的结果：ptr为可直接写入的内存，offset为在缓冲中的偏移（用于glBindBufferRange等）
+struct RingAllocation {
+    void *ptr;
+    GLintptr offset;
+    GLsizeiptr size;
+};
+
+//同步统计，用于观察CPU等待GPU的情况
+struct RingBufferStats {
+    unsigned int waits = 0;//本帧需要等待栅栏的次数
+    double stallMs = 0.0;//本帧等待栅栏花费的时间
+    double totalStallMs = 0.0;//累计等待时间
+    size_t bytesThisFrame = 0;//本帧写入的字节数
+    size_t overflows = 0;//累计分配失败次数（区域容量不够）
+};
+
+//每帧动态数据的上传分配器
+//缓冲被分成RING_FRAME_REGIONS个区域，每帧线性分配当前区域，帧结束时插入glFenceSync
+//支持ARB_buffer_storage（GL4.4）时使用持久映射：CPU直接写入映射内存，没有驱动端的拷贝
+//否则退回孤立（orphaning）方式：先写到CPU端暂存区，Flush时用glBufferSubData上传
+class RingBuffer {
+public:
+    unsigned int ID = 0;
+    RingBufferStats stats;
+
+    //regionSize为每帧可用的字节数，persistent为false时强制使用孤立方式
+    void Init(size_t regionSize, bool persistent = true){
+        this->regionSize = regionSize;
+        this->persistent = persistent && GLAD_GL_VERSION_4_4;
+        size_t totalSize = regionSize * RING_FRAME_REGIONS;
+        glGenBuffers(1, &ID);
+        //绑定到GL_COPY_WRITE_BUFFER创建存储，不影响其它绑定点
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        if(this->persistent){
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+            mapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+            if(mapped == nullptr){
+                //glBufferStorage的存储不可变，不能再用glBufferData，换一个新的缓冲后退回孤立方式
+                cout << "ERROR::RINGBUFFER::PERSISTENT_MAP_FAILED" << endl;
+                this->persistent = false;
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+                glDeleteBuffers(1, &ID);
+                glGenBuffers(1, &ID);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            }
+        }
+        if(!this->persistent){
+            glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+            staging.resize(regionSize);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        for(unsigned int i = 0; i < RING_FRAME_REGIONS; i++)
+            fences[i] = 0;
+    }
+
+    bool IsPersistent() const{
+        return persistent;
+    }
+
+    //开始新的一帧：切换到下一个区域，如果GPU还在使用该区域就等待它的栅栏
+    void BeginFrame(){
+        region = (region + 1) % RING_FRAME_REGIONS;
+        head = 0;
+        flushed = 0;
+        stats.waits = 0;
+        stats.stallMs = 0.0;
+        stats.bytesThisFrame = 0;
+        if(persistent){
+            waitFence(fences[region]);
+            fences[region] = 0;
+        }else{
+            //孤立旧存储：驱动会分配新的存储，GPU仍在读的旧存储不会被覆盖，CPU不需要等待
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            glBufferData(GL_COPY_WRITE_BUFFER, regionSize * RING_FRAME_REGIONS, nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+    }
+
+    //在当前区域内分配size字节，alignment为偏移的对齐要求（例如GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT）
+    //对齐的是在整个缓冲中的偏移：regionSize不一定是alignment的倍数，只对齐区域内的偏移会让后面区域的分配错位
+    //容量不足时返回ptr为nullptr的分配
+    RingAllocation Allocate(size_t size, size_t alignment = 16){
+        RingAllocation allocation = {nullptr, 0, 0};
+        size_t base = region * regionSize;
+        size_t start = (base + head + alignment - 1) / alignment * alignment - base;
+        if(start + size > regionSize){
+            stats.overflows++;
+            return allocation;
+        }
+        head = start + size;
+        stats.bytesThisFrame += size;
+        allocation.offset = static_cast<GLintptr>(base + start);
+        allocation.size = static_cast<GLsizeiptr>(size);
+        allocation.ptr = persistent ? (void*)(mapped + allocation.offset) : (void*)(staging.data() + start);
+        return allocation;
+    }
+
+    //在使用刚写入的数据绘制之前调用
+    //持久映射使用了GL_MAP_COHERENT_BIT，写入对GPU自动可见，不需要任何操作
+    //孤立方式下把上次Flush之后写入的部分上传
+    void Flush(){
+        if(persistent || head <= flushed)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, region * regionSize + flushed, head - flushed, staging.data() + flushed);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        flushed = head;
+    }
+
+    //帧内所有使用该区域的绘制提交之后调用，插入栅栏标记GPU何时读完
+    //孤立方式由驱动负责同步，不需要栅栏
+    void EndFrame(){
+        Flush();
+        if(persistent)
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void Release(){
+        for(unsigned int i = 0; i < RING_FRAME_REGIONS; i++){
+            if(fences[i] != 0)
+                glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+        if(persistent && mapped != nullptr){
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        mapped = nullptr;
+        glDeleteBuffers(1, &ID);
+        ID = 0;
+    }
+
+private:
+    size_t regionSize = 0;
+    bool persistent = false;
+    char *mapped = nullptr;
+    vector<char> staging;
+    GLsync fences[RING_FRAME_REGIONS];
+    unsigned int region = 0;
+    size_t head = 0;//当前区域已分配的字节数
+    size_t flushed = 0;//当前区域已上传的字节数（孤立方式）
+
+    //等待栅栏，并记录CPU被阻塞的次数与时间
+    void waitFence(GLsync fence){
+        if(fence == 0)
+            return;
+        //先不等待地查询一次，已经完成的栅栏不计入统计
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if(result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED){
+            glDeleteSync(fence);
+            return;
+        }
+        double start = glfwGetTime();
+        stats.waits++;
+        //第一次等待需要刷新命令队列，否则栅栏可能永远不会被提交
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        do{
+            result = glClientWaitSync(fence, flags, 1000000);//1ms
+            flags = 0;
+        }while(result == GL_TIMEOUT_EXPIRED);
+        if(result == GL_WAIT_FAILED)
+            cout << "ERROR::RINGBUFFER::WAIT_FAILED" << endl;
+        double elapsed = (glfwGetTime() - start) * 1000.0;
+        stats.stallMs += elapsed;
+        stats.totalStallMs += elapsed;
+        glDeleteSync(fence);
+    }
+};
+#endif
@@ -0,0 +1,46 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+in vec4 Tint;
+
+struct Material{
+    sampler2D texture_diffuse1;
+};
+
+#define MAX_POINT_LIGHTS 64
+
+//点光源，按std140布局打包成两个vec4
+struct PointLight{
+    vec4 position;//w为一次项衰减系数
+    vec4 color;//w为二次项衰减系数
+};
+
+//光源数组每帧由CPU写入环形缓冲，再通过glBindBufferRange绑定到绑定点0
+layout (std140) uniform LightBlock{
+    ivec4 lightCount;//x为有效的点光源数量
+    PointLight pointLights[MAX_POINT_LIGHTS];
+};
+
+uniform Material material;
+uniform vec3 lightDir;
+
+void main()
+{
+    vec3 albedo = texture(material.texture_diffuse1, TexCoords).rgb;
+    //Tint.a为每实例颜色的混合权重
+    albedo = mix(albedo, Tint.rgb, Tint.a);
+    vec3 norm = normalize(Normal);
+    float diff = max(dot(norm, normalize(-lightDir)), 0.0);
+    vec3 result = albedo * (0.1 + 0.5 * diff);
+    for(int i = 0; i < lightCount.x; i++){
+        vec3 toLight = pointLights[i].position.xyz - FragPos;
+        float distance = length(toLight);
+        float attenuation = 1.0 / (1.0 + pointLights[i].position.w * distance + pointLights[i].color.w * distance * distance);
+        float d = max(dot(norm, toLight / distance), 0.0);
+        result += albedo * pointLights[i].color.rgb * d * attenuation;
+    }
+    FragColor = vec4(result, 1.0);
+}
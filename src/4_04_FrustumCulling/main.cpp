@@ -0,0 +1,339 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomCamera.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "InstanceBuffer.h"
+#include "RingBuffer.h"
+#include "Frustum.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_04_FrustumCulling/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+CustomCamera camera(glm::vec3(0.0f, 20.0f, 200.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -5.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//小行星数量，每帧只有通过视锥体剔除的小行星会写入环形缓冲
+const unsigned int AMOUNT = 100000;
+const unsigned int NR_POINT_LIGHTS = 64;
+bool cullingEnabled = true;
+bool toggleKeyDown = false;
+
+//每颗小行星的轨道参数，矩阵由它们每帧计算得到
+struct Asteroid {
+    float radius;//轨道半径
+    float angle;//初始角度
+    float height;
+    float scale;
+    float spin;//自转速度
+    float orbitSpeed;//公转速度
+};
+
+//与着色器中的LightBlock布局一致（std140）
+struct GPUPointLight {
+    glm::vec4 position;//w为一次项衰减系数
+    glm::vec4 color;//w为二次项衰减系数
+};
+struct LightBlock {
+    glm::ivec4 lightCount;
+    GPUPointLight pointLights[NR_POINT_LIGHTS];
+};
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //C键开关视锥体剔除，方便对比
+    bool toggle = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    if(toggle && !toggleKeyDown)
+        cullingEnabled = !cullingEnabled;
+    toggleKeyDown = toggle;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+//生成小行星的轨道参数
+void generateAsteroids(vector<Asteroid> &asteroids, vector<glm::vec4> &tints){
+    asteroids.resize(AMOUNT);
+    tints.resize(AMOUNT);
+    srand(static_cast<unsigned int>(glfwGetTime()));
+    float radius = 150.0f;
+    float offset = 25.0f;
+    for(unsigned int i = 0; i < AMOUNT; i++){
+        Asteroid &a = asteroids[i];
+        a.angle = (float)i / (float)AMOUNT * glm::two_pi<float>();
+        a.radius = radius + (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+        a.height = ((rand() % (int)(2 * offset * 100)) / 100.0f - offset) * 0.4f;
+        a.scale = (rand() % 20) / 100.0f + 0.05f;
+        a.spin = (rand() % 200) / 100.0f - 1.0f;
+        //内圈比外圈转得快
+        a.orbitSpeed = 2.0f / a.radius;
+        float shade = 0.45f + (rand() % 40) / 100.0f;
+        tints[i] = glm::vec4(shade, shade * 0.9f, shade * 0.8f, 0.6f);
+    }
+}
+
+//小行星第time秒时的位置
+glm::vec3 asteroidPosition(const Asteroid &a, float time){
+    float angle = a.angle + a.orbitSpeed * time;
+    return glm::vec3(sin(angle) * a.radius, a.height, cos(angle) * a.radius);
+}
+
+//计算所有小行星在世界空间的包围球，旋转不改变包围球，所以只需要位置和缩放
+//local为岩石模型在模型空间的包围球
+void computeAsteroidSpheres(const vector<Asteroid> &asteroids, const BoundingSphere &local, float time, SphereSoA &spheres){
+    spheres.Resize(static_cast<unsigned int>(asteroids.size()));
+    //包围球中心不一定在原点，保守地把中心偏移量计入半径
+    float radius = local.radius + glm::length(local.center);
+    for(unsigned int i = 0; i < asteroids.size(); i++){
+        glm::vec3 position = asteroidPosition(asteroids[i], time);
+        spheres.x[i] = position.x;
+        spheres.y[i] = position.y;
+        spheres.z[i] = position.z;
+        spheres.r[i] = radius * asteroids[i].scale;
+    }
+}
+
+//只为可见的小行星计算矩阵，并连同颜色一起直接写入映射内存，只写不读
+void writeVisibleAsteroids(const vector<Asteroid> &asteroids, const vector<glm::vec4> &tints, const vector<unsigned int> &visible,
+    float time, glm::mat4 *matrices, glm::vec4 *outTints){
+    const glm::vec3 axis = glm::normalize(glm::vec3(0.4f, 0.6f, 0.8f));
+    for(unsigned int i = 0; i < visible.size(); i++){
+        const Asteroid &a = asteroids[visible[i]];
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), asteroidPosition(a, time));
+        model = glm::rotate(model, a.spin * time, axis);
+        matrices[i] = glm::scale(model, glm::vec3(a.scale));
+        outTints[i] = tints[visible[i]];
+    }
+}
+
+//光源在行星带中绕行
+void writeLights(float time, LightBlock *block){
+    block->lightCount = glm::ivec4(NR_POINT_LIGHTS, 0, 0, 0);
+    for(unsigned int i = 0; i < NR_POINT_LIGHTS; i++){
+        float angle = (float)i / NR_POINT_LIGHTS * glm::two_pi<float>() - time * 0.2f;
+        float radius = 140.0f + 20.0f * sin(i * 1.7f);
+        glm::vec3 position(sin(angle) * radius, 6.0f * sin(time + i), cos(angle) * radius);
+        glm::vec3 color(0.5f + 0.5f * sin(i * 0.9f), 0.5f + 0.5f * sin(i * 1.3f + 2.0f), 0.5f + 0.5f * sin(i * 2.1f + 4.0f));
+        block->pointLights[i].position = glm::vec4(position, 0.09f);
+        block->pointLights[i].color = glm::vec4(color * 3.0f, 0.032f);
+    }
+}
+
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    glfwInit();
+    //持久映射需要GL4.4（ARB_buffer_storage），创建失败时退回GL3.3并使用孤立方式
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    }
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glEnable(GL_DEPTH_TEST);
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 40.0f;
+
+    CustomShader planetShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+    CustomShader asteroidShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str(), "INSTANCED");
+    //GL3.3的着色器不能写binding，在这里把两个程序的LightBlock都指定到绑定点0
+    glUniformBlockBinding(planetShader.ID, glGetUniformBlockIndex(planetShader.ID, "LightBlock"), 0);
+    glUniformBlockBinding(asteroidShader.ID, glGetUniformBlockIndex(asteroidShader.ID, "LightBlock"), 0);
+
+    //加载模型
+    Model planet("static/model/planet/planet.obj");
+    Model rock("static/model/rock/rock.obj");
+
+    //可见集合每帧变化，矩阵和颜色都按可见顺序写入环形缓冲
+    vector<Asteroid> asteroids;
+    vector<glm::vec4> tints;
+    generateAsteroids(asteroids, tints);
+    SphereSoA asteroidSpheres;
+    vector<unsigned int> visible;
+    FrustumCuller culler;
+    cout << "rock bounding sphere radius: " << rock.sphere.radius << ", planet: " << planet.sphere.radius << endl;
+
+    GLint uboAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+
+    //每帧区域：最坏情况下全部小行星的矩阵与颜色 + 光源块 + 对齐余量
+    size_t regionSize = AMOUNT * (sizeof(glm::mat4) + sizeof(glm::vec4)) + sizeof(LightBlock) + 3 * uboAlignment;
+    RingBuffer ring;
+    ring.Init(regionSize);
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    unsigned int stallCount = 0;
+    double stallMs = 0.0;
+    while (!glfwWindowShouldClose(window)){
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        //显示平均帧时间与剔除统计
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame - culling "
+                + (cullingEnabled ? "on" : "off") + ": " + to_string(culler.stats.visible / frameCount) + "/"
+                + to_string(culler.stats.tested / frameCount) + " visible, " + to_string(culler.stats.ms / frameCount)
+                + " ms - " + to_string(stallCount) + " stalls, " + to_string(stallMs) + " ms stalled";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+            stallCount = 0;
+            stallMs = 0.0;
+            culler.stats.Reset();
+        }
+
+        processInput(window);
+
+        //切换到下一帧区域，必要时等待GPU读完
+        ring.BeginFrame();
+        stallCount += ring.stats.waits;
+        stallMs += ring.stats.stallMs;
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
+        glm::vec3 lightDir(-0.2f, -1.0f, -0.3f);
+        //从CustomCamera的视图投影矩阵中提取视锥体平面
+        Frustum frustum = Frustum::FromMatrix(projection * view);
+
+        //剔除小行星：包围球变换到世界空间后，每次迭代测试8个
+        computeAsteroidSpheres(asteroids, rock.sphere, currentFrame, asteroidSpheres);
+        if(cullingEnabled){
+            culler.CullSpheres(frustum, asteroidSpheres, visible);
+        }else{
+            visible.resize(AMOUNT);
+            for(unsigned int i = 0; i < AMOUNT; i++)
+                visible[i] = i;
+        }
+        unsigned int visibleCount = static_cast<unsigned int>(visible.size());
+
+        //动态数据直接写入映射内存
+        RingAllocation matrices = ring.Allocate(max(visibleCount, 1u) * sizeof(glm::mat4), 16);
+        RingAllocation instanceTints = ring.Allocate(max(visibleCount, 1u) * sizeof(glm::vec4), 16);
+        RingAllocation lights = ring.Allocate(sizeof(LightBlock), uboAlignment);
+        if(matrices.ptr == nullptr || instanceTints.ptr == nullptr || lights.ptr == nullptr){
+            cout << "ERROR::RINGBUFFER::OUT_OF_SPACE" << endl;
+            break;
+        }
+        writeVisibleAsteroids(asteroids, tints, visible, currentFrame, (glm::mat4*)matrices.ptr, (glm::vec4*)instanceTints.ptr);
+        writeLights(currentFrame, (LightBlock*)lights.ptr);
+        ring.Flush();
+
+        //实例属性与光源块都直接指向环形缓冲中本帧的区域
+        rock.SetInstanceSource(ring.ID, matrices.offset, ring.ID, instanceTints.offset);
+        glBindBufferRange(GL_UNIFORM_BUFFER, 0, ring.ID, lights.offset, lights.size);
+
+        glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        //绘制行星，用世界空间包围盒测试
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
+        model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
+        if(!cullingEnabled || frustum.TestAABB(planet.aabb.Transform(model))){
+            planetShader.use();
+            planetShader.setMat4("view", view);
+            planetShader.setMat4("projection", projection);
+            planetShader.setVec3("lightDir", lightDir);
+            planetShader.setMat4("model", model);
+            planet.Draw(planetShader);
+        }
+
+        //绘制小行星
+        asteroidShader.use();
+        asteroidShader.setMat4("view", view);
+        asteroidShader.setMat4("projection", projection);
+        asteroidShader.setVec3("lightDir", lightDir);
+        rock.DrawInstanced(asteroidShader, visibleCount);
+
+        //本帧使用该区域的绘制都已提交，插入栅栏
+        ring.EndFrame();
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    ring.Release();
+    glfwTerminate();
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,309 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <chrono>
+#include "Bounds.h"
+using namespace std;
+
+//SIMD指令集选择：编译时加上-mavx会使用AVX一次处理8个包围体，否则用SSE两组4宽寄存器处理8个
+#if defined(__AVX__)
+#define FRUSTUM_USE_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_USE_SSE
+#include <emmintrin.h>
+#endif
+
+//包围体与视锥体的关系
+enum FrustumTest {
+    FRUSTUM_OUTSIDE,
+    FRUSTUM_INTERSECT,
+    FRUSTUM_INSIDE
+};
+
+//视锥体，由6个平面组成，平面法线指向视锥体内部
+//点p在平面内侧当且仅当 dot(plane.xyz, p) + plane.w >= 0
+struct Frustum {
+    glm::vec4 planes[6];//左、右、下、上、近、远
+
+    //从投影矩阵 * 观察矩阵中提取平面（Gribb/Hartmann方法），得到的是世界空间的平面
+    static Frustum FromMatrix(const glm::mat4 &viewProjection){
+        //glm是列主序，m[col][row]，这里取出矩阵的4行
+        glm::vec4 row[4];
+        for(int i = 0; i < 4; i++)
+            row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        Frustum frustum;
+        frustum.planes[0] = row[3] + row[0];
+        frustum.planes[1] = row[3] - row[0];
+        frustum.planes[2] = row[3] + row[1];
+        frustum.planes[3] = row[3] - row[1];
+        frustum.planes[4] = row[3] + row[2];
+        frustum.planes[5] = row[3] - row[2];
+        //归一化，使平面方程的结果就是有符号距离，才能直接和半径比较
+        for(int i = 0; i < 6; i++)
+            frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+        return frustum;
+    }
+
+    bool TestSphere(const glm::vec3 &center, float radius) const{
+        for(int i = 0; i < 6; i++){
+            if(glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+                return false;
+        }
+        return true;
+    }
+
+    bool TestAABB(const AABB &box) const{
+        glm::vec3 center = box.Center();
+        glm::vec3 extents = box.Extents();
+        for(int i = 0; i < 6; i++){
+            glm::vec3 normal = glm::vec3(planes[i]);
+            //包围盒在平面法线方向上的投影半径
+            float radius = glm::dot(glm::abs(normal), extents);
+            if(glm::dot(normal, center) + planes[i].w < -radius)
+                return false;
+        }
+        return true;
+    }
+
+    //区分完全在内部与相交，完全在内部的子树不需要再测试其中的节点
+    FrustumTest ClassifyAABB(const AABB &box) const{
+        glm::vec3 center = box.Center();
+        glm::vec3 extents = box.Extents();
+        FrustumTest result = FRUSTUM_INSIDE;
+        for(int i = 0; i < 6; i++){
+            glm::vec3 normal = glm::vec3(planes[i]);
+            float radius = glm::dot(glm::abs(normal), extents);
+            float distance = glm::dot(normal, center) + planes[i].w;
+            if(distance < -radius)
+                return FRUSTUM_OUTSIDE;
+            if(distance < radius)
+                result = FRUSTUM_INTERSECT;
+        }
+        return result;
+    }
+};
+
+//结构数组形式的包围球，SIMD一次读取连续的x、y、z、r
+struct SphereSoA {
+    vector<float> x, y, z, r;
+
+    void Resize(unsigned int count){
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+        r.resize(count);
+    }
+    unsigned int Size() const{
+        return static_cast<unsigned int>(x.size());
+    }
+    void Set(unsigned int i, const BoundingSphere &sphere){
+        x[i] = sphere.center.x;
+        y[i] = sphere.center.y;
+        z[i] = sphere.center.z;
+        r[i] = sphere.radius;
+    }
+};
+
+//结构数组形式的包围盒（中心 + 半长）
+struct AABBSoA {
+    vector<float> cx, cy, cz, ex, ey, ez;
+
+    void Resize(unsigned int count){
+        cx.resize(count);
+        cy.resize(count);
+        cz.resize(count);
+        ex.resize(count);
+        ey.resize(count);
+        ez.resize(count);
+    }
+    unsigned int Size() const{
+        return static_cast<unsigned int>(cx.size());
+    }
+    void Set(unsigned int i, const AABB &box){
+        glm::vec3 c = box.Center();
+        glm::vec3 e = box.Extents();
+        cx[i] = c.x;
+        cy[i] = c.y;
+        cz[i] = c.z;
+        ex[i] = e.x;
+        ey[i] = e.y;
+        ez[i] = e.z;
+    }
+};
+
+//剔除统计
+struct CullingStats {
+    unsigned int tested = 0;//参与测试的包围体数量
+    unsigned int visible = 0;//通过测试的数量
+    double ms = 0.0;//剔除耗时
+
+    void Reset(){
+        tested = visible = 0;
+        ms = 0.0;
+    }
+    unsigned int Culled() const{
+        return tested - visible;
+    }
+};
+
+//视锥体剔除器，visible中输出可见包围体的下标（按原顺序）
+class FrustumCuller {
+public:
+    CullingStats stats;
+
+    void CullSpheres(const Frustum &frustum, const SphereSoA &spheres, vector<unsigned int> &visible){
+        auto start = chrono::high_resolution_clock::now();
+        unsigned int count = spheres.Size();
+        visible.resize(count);
+        unsigned int visibleCount = 0;
+        unsigned int i = 0;
+#if defined(FRUSTUM_USE_AVX)
+        __m256 planes[6][4];
+        for(int p = 0; p < 6; p++)
+            for(int k = 0; k < 4; k++)
+                planes[p][k] = _mm256_set1_ps(frustum.planes[p][k]);
+        for(; i + 8 <= count; i += 8){
+            __m256 x = _mm256_loadu_ps(&spheres.x[i]);
+            __m256 y = _mm256_loadu_ps(&spheres.y[i]);
+            __m256 z = _mm256_loadu_ps(&spheres.z[i]);
+            __m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.r[i]));
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for(int p = 0; p < 6; p++){
+                __m256 d = _mm256_add_ps(_mm256_mul_ps(planes[p][0], x), planes[p][3]);
+                d = _mm256_add_ps(d, _mm256_mul_ps(planes[p][1], y));
+                d = _mm256_add_ps(d, _mm256_mul_ps(planes[p][2], z));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+            }
+            visibleCount = appendMask(_mm256_movemask_ps(inside), i, visible, visibleCount);
+        }
+#elif defined(FRUSTUM_USE_SSE)
+        __m128 planes[6][4];
+        for(int p = 0; p < 6; p++)
+            for(int k = 0; k < 4; k++)
+                planes[p][k] = _mm_set1_ps(frustum.planes[p][k]);
+        //每次迭代处理8个包围球：两组4宽寄存器交错计算，隐藏乘加的延迟
+        for(; i + 8 <= count; i += 8){
+            __m128 x0 = _mm_loadu_ps(&spheres.x[i]), x1 = _mm_loadu_ps(&spheres.x[i + 4]);
+            __m128 y0 = _mm_loadu_ps(&spheres.y[i]), y1 = _mm_loadu_ps(&spheres.y[i + 4]);
+            __m128 z0 = _mm_loadu_ps(&spheres.z[i]), z1 = _mm_loadu_ps(&spheres.z[i + 4]);
+            __m128 negR0 = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.r[i]));
+            __m128 negR1 = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.r[i + 4]));
+            __m128 inside0 = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            __m128 inside1 = inside0;
+            for(int p = 0; p < 6; p++){
+                __m128 d0 = _mm_add_ps(_mm_mul_ps(planes[p][0], x0), planes[p][3]);
+                __m128 d1 = _mm_add_ps(_mm_mul_ps(planes[p][0], x1), planes[p][3]);
+                d0 = _mm_add_ps(d0, _mm_mul_ps(planes[p][1], y0));
+                d1 = _mm_add_ps(d1, _mm_mul_ps(planes[p][1], y1));
+                d0 = _mm_add_ps(d0, _mm_mul_ps(planes[p][2], z0));
+                d1 = _mm_add_ps(d1, _mm_mul_ps(planes[p][2], z1));
+                inside0 = _mm_and_ps(inside0, _mm_cmpge_ps(d0, negR0));
+                inside1 = _mm_and_ps(inside1, _mm_cmpge_ps(d1, negR1));
+            }
+            int mask = _mm_movemask_ps(inside0) | (_mm_movemask_ps(inside1) << 4);
+            visibleCount = appendMask(mask, i, visible, visibleCount);
+        }
+#endif
+        //剩余不足8个的部分（或没有SIMD时的全部）逐个测试
+        for(; i < count; i++){
+            if(frustum.TestSphere(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.r[i]))
+                visible[visibleCount++] = i;
+        }
+        visible.resize(visibleCount);
+        record(start, count, visibleCount);
+    }
+
+    void CullAABBs(const Frustum &frustum, const AABBSoA &boxes, vector<unsigned int> &visible){
+        auto start = chrono::high_resolution_clock::now();
+        unsigned int count = boxes.Size();
+        visible.resize(count);
+        unsigned int visibleCount = 0;
+        unsigned int i = 0;
+#if defined(FRUSTUM_USE_AVX)
+        __m256 planes[6][4], absPlanes[6][3];
+        for(int p = 0; p < 6; p++){
+            for(int k = 0; k < 4; k++)
+                planes[p][k] = _mm256_set1_ps(frustum.planes[p][k]);
+            for(int k = 0; k < 3; k++)
+                absPlanes[p][k] = _mm256_set1_ps(fabs(frustum.planes[p][k]));
+        }
+        for(; i + 8 <= count; i += 8){
+            __m256 cx = _mm256_loadu_ps(&boxes.cx[i]), cy = _mm256_loadu_ps(&boxes.cy[i]), cz = _mm256_loadu_ps(&boxes.cz[i]);
+            __m256 ex = _mm256_loadu_ps(&boxes.ex[i]), ey = _mm256_loadu_ps(&boxes.ey[i]), ez = _mm256_loadu_ps(&boxes.ez[i]);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for(int p = 0; p < 6; p++){
+                __m256 d = _mm256_add_ps(_mm256_mul_ps(planes[p][0], cx), planes[p][3]);
+                d = _mm256_add_ps(d, _mm256_mul_ps(planes[p][1], cy));
+                d = _mm256_add_ps(d, _mm256_mul_ps(planes[p][2], cz));
+                __m256 r = _mm256_mul_ps(absPlanes[p][0], ex);
+                r = _mm256_add_ps(r, _mm256_mul_ps(absPlanes[p][1], ey));
+                r = _mm256_add_ps(r, _mm256_mul_ps(absPlanes[p][2], ez));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+            visibleCount = appendMask(_mm256_movemask_ps(inside), i, visible, visibleCount);
+        }
+#elif defined(FRUSTUM_USE_SSE)
+        __m128 planes[6][4], absPlanes[6][3];
+        for(int p = 0; p < 6; p++){
+            for(int k = 0; k < 4; k++)
+                planes[p][k] = _mm_set1_ps(frustum.planes[p][k]);
+            for(int k = 0; k < 3; k++)
+                absPlanes[p][k] = _mm_set1_ps(fabs(frustum.planes[p][k]));
+        }
+        for(; i + 8 <= count; i += 8){
+            int mask = 0;
+            //两组各4个包围盒
+            for(unsigned int h = 0; h < 8; h += 4){
+                __m128 cx = _mm_loadu_ps(&boxes.cx[i + h]), cy = _mm_loadu_ps(&boxes.cy[i + h]), cz = _mm_loadu_ps(&boxes.cz[i + h]);
+                __m128 ex = _mm_loadu_ps(&boxes.ex[i + h]), ey = _mm_loadu_ps(&boxes.ey[i + h]), ez = _mm_loadu_ps(&boxes.ez[i + h]);
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for(int p = 0; p < 6; p++){
+                    __m128 d = _mm_add_ps(_mm_mul_ps(planes[p][0], cx), planes[p][3]);
+                    d = _mm_add_ps(d, _mm_mul_ps(planes[p][1], cy));
+                    d = _mm_add_ps(d, _mm_mul_ps(planes[p][2], cz));
+                    __m128 r = _mm_mul_ps(absPlanes[p][0], ex);
+                    r = _mm_add_ps(r, _mm_mul_ps(absPlanes[p][1], ey));
+                    r = _mm_add_ps(r, _mm_mul_ps(absPlanes[p][2], ez));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+                }
+                mask |= _mm_movemask_ps(inside) << h;
+            }
+            visibleCount = appendMask(mask, i, visible, visibleCount);
+        }
+#endif
+        for(; i < count; i++){
+            AABB box;
+            glm::vec3 c(boxes.cx[i], boxes.cy[i], boxes.cz[i]);
+            glm::vec3 e(boxes.ex[i], boxes.ey[i], boxes.ez[i]);
+            box.min = c - e;
+            box.max = c + e;
+            if(frustum.TestAABB(box))
+                visible[visibleCount++] = i;
+        }
+        visible.resize(visibleCount);
+        record(start, count, visibleCount);
+    }
+
+private:
+    //把8位掩码中为1的位对应的下标写入输出
+    static unsigned int appendMask(int mask, unsigned int base, vector<unsigned int> &visible, unsigned int visibleCount){
+        while(mask != 0){
+            int bit = 0;
+            while(((mask >> bit) & 1) == 0)
+                bit++;
+            visible[visibleCount++] = base + bit;
+            mask &= mask - 1;
+        }
+        return visibleCount;
+    }
+
+    void record(chrono::high_resolution_clock::time_point start, unsigned int tested, unsigned int visibleCount){
+        stats.tested += tested;
+        stats.visible += visibleCount;
+        stats.ms += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    }
+};
+#endif
@@ -0,0 +1,227 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Mesh.h"
+#include "Model.h"
+#include "Bounds.h"
+#include "Frustum.h"
+#include "CustomShader.h"
+using namespace std;
+
+//场景图更新与剔除的统计
+struct SceneGraphStats {
+    unsigned int transformsUpdated = 0;//本帧重新计算世界矩阵的节点数
+    unsigned int nodesVisited = 0;//剔除时访问的节点数
+    unsigned int subtreesCulled = 0;//整棵子树被剔除的次数
+    unsigned int subtreesAccepted = 0;//整棵子树完全在视锥体内、跳过内部测试的次数
+    unsigned int visibleMeshes = 0;
+};
+
+//场景图：节点按深度优先顺序存放在扁平数组中，父节点总在子节点之前
+//于是每棵子树都是数组中连续的一段[i, subtreeEnd[i])，更新和剔除都可以顺序遍历，并整段跳过子树
+//节点数据使用结构数组（SoA）存放，局部矩阵、世界矩阵、包围盒分别连续存放
+class SceneGraph {
+public:
+    vector<string> names;
+    vector<int> parents;//父节点下标，根节点为-1
+    vector<unsigned int> subtreeEnds;//子树末尾（不含）
+    vector<glm::mat4> localTransforms;//相对父节点的变换
+    vector<glm::mat4> worldTransforms;//世界变换
+    vector<AABB> localBounds;//节点自身网格在节点空间的包围盒
+    vector<AABB> worldBounds;//节点自身网格在世界空间的包围盒
+    vector<AABB> subtreeBounds;//整棵子树在世界空间的包围盒
+    vector<unsigned int> meshOffsets;//节点网格在meshRefs中的起始位置
+    vector<unsigned int> meshCounts;
+    vector<Mesh*> meshRefs;//所有节点引用的网格
+    SceneGraphStats stats;
+
+    unsigned int Size() const{
+        return static_cast<unsigned int>(parents.size());
+    }
+
+    //添加节点，作为parent的最后一个子节点插入到parent子树的末尾
+    //parent位于数组最右侧的路径上时（例如一直往根节点下追加）只需要在末尾追加，否则需要整体后移
+    int AddNode(int parent, const string &name, const glm::mat4 &local){
+        unsigned int pos = parent < 0 ? Size() : subtreeEnds[parent];
+        bool append = pos == Size();
+        if(!append){
+            //pos之后的节点整体后移一位
+            for(unsigned int j = pos; j < Size(); j++){
+                subtreeEnds[j]++;
+                if(parents[j] >= (int)pos)
+                    parents[j]++;
+            }
+        }
+        //所有祖先的子树都多了一个节点
+        for(int a = parent; a >= 0; a = parents[a])
+            subtreeEnds[a]++;
+
+        names.insert(names.begin() + pos, name);
+        parents.insert(parents.begin() + pos, parent);
+        subtreeEnds.insert(subtreeEnds.begin() + pos, pos + 1);
+        localTransforms.insert(localTransforms.begin() + pos, local);
+        worldTransforms.insert(worldTransforms.begin() + pos, glm::mat4(1.0f));
+        localBounds.insert(localBounds.begin() + pos, AABB());
+        worldBounds.insert(worldBounds.begin() + pos, AABB());
+        subtreeBounds.insert(subtreeBounds.begin() + pos, AABB());
+        meshOffsets.insert(meshOffsets.begin() + pos, static_cast<unsigned int>(meshRefs.size()));
+        meshCounts.insert(meshCounts.begin() + pos, 0);
+        dirty.insert(dirty.begin() + pos, 1);
+        childDirty.insert(childDirty.begin() + pos, 0);
+        boundsDirty.insert(boundsDirty.begin() + pos, 0);
+        changed.insert(changed.begin() + pos, 0);
+        markAncestors(static_cast<int>(pos));
+        return static_cast<int>(pos);
+    }
+
+    //给节点添加网格，网格只能添加给最近添加的节点，保证meshRefs中的范围连续
+    void AddMesh(int node, Mesh *mesh){
+        if(meshCounts[node] == 0)
+            meshOffsets[node] = static_cast<unsigned int>(meshRefs.size());
+        meshRefs.push_back(mesh);
+        meshCounts[node]++;
+        localBounds[node].Expand(mesh->aabb);
+        dirty[node] = 1;
+        markAncestors(node);
+    }
+
+    //实例化模型的节点层级，返回模型根节点在场景图中的下标
+    int AddModel(Model &model, int parent, const glm::mat4 &transform){
+        vector<int> mapping(model.nodes.size());
+        for(unsigned int i = 0; i < model.nodes.size(); i++){
+            const ModelNode &node = model.nodes[i];
+            int nodeParent = node.parent < 0 ? parent : mapping[node.parent];
+            glm::mat4 local = node.parent < 0 ? transform * node.transform : node.transform;
+            mapping[i] = AddNode(nodeParent, node.name, local);
+            for(unsigned int m = 0; m < node.meshes.size(); m++)
+                AddMesh(mapping[i], &model.meshes[node.meshes[m]]);
+            //后添加的节点可能让前面的节点后移，需要修正映射
+            for(unsigned int k = 0; k < i; k++){
+                if(mapping[k] >= mapping[i])
+                    mapping[k]++;
+            }
+        }
+        return model.nodes.empty() ? -1 : mapping[0];
+    }
+
+    //修改局部变换，只标记脏，真正的计算在Update中进行
+    void SetLocalTransform(int node, const glm::mat4 &local){
+        localTransforms[node] = local;
+        if(!dirty[node]){
+            dirty[node] = 1;
+            markAncestors(node);
+        }
+    }
+
+    //重新计算脏节点及其子树的世界矩阵与包围盒，没有变化的子树整段跳过
+    void Update(){
+        stats.transformsUpdated = 0;
+        unsigned int count = Size();
+        unsigned int i = 0;
+        while(i < count){
+            int parent = parents[i];
+            bool parentChanged = parent >= 0 && changed[parent];
+            if(!dirty[i] && !childDirty[i] && !parentChanged){
+                //整棵子树都没有变化
+                i = subtreeEnds[i];
+                continue;
+            }
+            changed[i] = dirty[i] || parentChanged;
+            if(changed[i]){
+                worldTransforms[i] = parent >= 0 ? worldTransforms[parent] * localTransforms[i] : localTransforms[i];
+                worldBounds[i] = localBounds[i].IsValid() ? localBounds[i].Transform(worldTransforms[i]) : AABB();
+                stats.transformsUpdated++;
+            }
+            //自身或后代发生变化的节点，子树包围盒需要重新合并
+            boundsDirty[i] = 1;
+            dirty[i] = 0;
+            childDirty[i] = 0;
+            i++;
+        }
+        if(accumBounds.size() != count)
+            accumBounds.assign(count, AABB());
+        //逆序遍历，子节点总在父节点之后，所以处理到父节点时它的子节点都已经合并进accumBounds
+        for(int j = (int)count - 1; j >= 0; j--){
+            if(boundsDirty[j]){
+                //子树包围盒 = 自身包围盒 + 所有子节点的子树包围盒
+                AABB bounds = worldBounds[j];
+                bounds.Expand(accumBounds[j]);
+                subtreeBounds[j] = bounds;
+                accumBounds[j] = AABB();
+            }
+            //父节点需要重新合并时，不论子节点是否变化都要合并进去
+            int parent = parents[j];
+            if(parent >= 0 && boundsDirty[parent])
+                accumBounds[parent].Expand(subtreeBounds[j]);
+            boundsDirty[j] = 0;
+        }
+    }
+
+    //层次剔除：子树包围盒在视锥体外时整段跳过，完全在内部时其中的节点不再测试
+    void Cull(const Frustum &frustum, vector<unsigned int> &visibleNodes){
+        visibleNodes.clear();
+        stats.nodesVisited = 0;
+        stats.subtreesCulled = 0;
+        stats.subtreesAccepted = 0;
+        stats.visibleMeshes = 0;
+        unsigned int count = Size();
+        unsigned int i = 0;
+        while(i < count){
+            stats.nodesVisited++;
+            FrustumTest test = subtreeBounds[i].IsValid() ? frustum.ClassifyAABB(subtreeBounds[i]) : FRUSTUM_OUTSIDE;
+            if(test == FRUSTUM_OUTSIDE){
+                if(subtreeEnds[i] > i + 1 || meshCounts[i] > 0)
+                    stats.subtreesCulled++;
+                i = subtreeEnds[i];
+                continue;
+            }
+            if(test == FRUSTUM_INSIDE){
+                if(subtreeEnds[i] > i + 1)
+                    stats.subtreesAccepted++;
+                for(unsigned int j = i; j < subtreeEnds[i]; j++)
+                    addVisible(j, visibleNodes);
+                i = subtreeEnds[i];
+                continue;
+            }
+            //相交：节点自身的网格单独测试，再继续测试子节点
+            if(meshCounts[i] > 0 && frustum.TestAABB(worldBounds[i]))
+                addVisible(i, visibleNodes);
+            i++;
+        }
+    }
+
+    //绘制可见节点的网格
+    void Draw(CustomShader &shader, const vector<unsigned int> &visibleNodes){
+        for(unsigned int n = 0; n < visibleNodes.size(); n++){
+            unsigned int node = visibleNodes[n];
+            shader.setMat4("model", worldTransforms[node]);
+            for(unsigned int m = 0; m < meshCounts[node]; m++)
+                meshRefs[meshOffsets[node] + m]->Draw(shader);
+        }
+    }
+
+private:
+    vector<uint8_t> dirty;//局部变换或网格发生了变化
+    vector<uint8_t> childDirty;//有后代节点是脏的
+    vector<uint8_t> boundsDirty;//子树包围盒需要重新合并
+    vector<uint8_t> changed;//本次Update中世界矩阵发生了变化
+    vector<AABB> accumBounds;//合并子树包围盒时的临时结果
+
+    //沿父节点向上标记，直到遇到已经标记过的祖先
+    void markAncestors(int node){
+        for(int a = parents[node]; a >= 0 && !childDirty[a]; a = parents[a])
+            childDirty[a] = 1;
+    }
+
+    void addVisible(unsigned int node, vector<unsigned int> &visibleNodes){
+        if(meshCounts[node] == 0)
+            return;
+        visibleNodes.push_back(node);
+        stats.visibleMeshes += meshCounts[node];
+    }
+};
+#endif
@@ -0,0 +1,202 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomCamera.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "SceneGraph.h"
+#include "Frustum.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_05_SceneGraph/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+CustomCamera camera(glm::vec3(0.0f, 15.0f, 60.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -15.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//场景中模型实例的网格尺寸（GRID_SIZE * GRID_SIZE个实例），每隔ANIMATED_STRIDE个实例有一个在转动
+const unsigned int GRID_SIZE = 16;
+const unsigned int ANIMATED_STRIDE = 8;
+bool cullingEnabled = true;
+bool toggleKeyDown = false;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //C键开关层次剔除
+    bool toggle = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    if(toggle && !toggleKeyDown)
+        cullingEnabled = !cullingEnabled;
+    toggleKeyDown = toggle;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glEnable(GL_DEPTH_TEST);
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 15.0f;
+
+    CustomShader myShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+
+    //加载模型，节点层级与节点变换都会被保留
+    Model nanosuit("static/model/nanosuit/nanosuit.obj");
+    cout << "nanosuit: " << nanosuit.nodes.size() << " nodes, " << nanosuit.meshes.size() << " meshes" << endl;
+
+    //构建场景图：根节点 -> 每行一个节点 -> 每个格子一个模型实例
+    //行节点让剔除可以先整行跳过，再到单个实例，最后到实例中的网格
+    SceneGraph scene;
+    int root = scene.AddNode(-1, "root", glm::mat4(1.0f));
+    vector<int> instances;
+    for(unsigned int z = 0; z < GRID_SIZE; z++){
+        int row = scene.AddNode(root, "row" + to_string(z), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, (z - GRID_SIZE / 2.0f) * 6.0f)));
+        for(unsigned int x = 0; x < GRID_SIZE; x++){
+            glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3((x - GRID_SIZE / 2.0f) * 5.0f, 0.0f, 0.0f));
+            transform = glm::scale(transform, glm::vec3(0.4f));
+            instances.push_back(scene.AddModel(nanosuit, row, transform));
+        }
+    }
+    //保存每个实例根节点的初始变换，动画在它的基础上旋转
+    vector<glm::mat4> baseTransforms;
+    for(unsigned int i = 0; i < instances.size(); i++)
+        baseTransforms.push_back(scene.localTransforms[instances[i]]);
+    cout << "scene graph: " << scene.Size() << " nodes" << endl;
+
+    vector<unsigned int> visibleNodes;
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    while (!glfwWindowShouldClose(window)){
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        processInput(window);
+
+        //只有部分实例在转动，Update只会重新计算这些实例的子树
+        for(unsigned int i = 0; i < instances.size(); i += ANIMATED_STRIDE){
+            glm::mat4 local = glm::rotate(baseTransforms[i], currentFrame, glm::vec3(0.0f, 1.0f, 0.0f));
+            scene.SetLocalTransform(instances[i], local);
+        }
+        scene.Update();
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 500.0f);
+        if(cullingEnabled){
+            scene.Cull(Frustum::FromMatrix(projection * view), visibleNodes);
+        }else{
+            visibleNodes.clear();
+            scene.stats.visibleMeshes = 0;
+            for(unsigned int i = 0; i < scene.Size(); i++){
+                if(scene.meshCounts[i] > 0){
+                    visibleNodes.push_back(i);
+                    scene.stats.visibleMeshes += scene.meshCounts[i];
+                }
+            }
+        }
+
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            string title = "LearnOpenGL - " + to_string(ms) + " ms/frame - " + to_string(scene.stats.transformsUpdated) + " transforms updated - culling "
+                + (cullingEnabled ? "on" : "off") + ": " + to_string(scene.stats.visibleMeshes) + " meshes visible, "
+                + to_string(scene.stats.nodesVisited) + " nodes visited, " + to_string(scene.stats.subtreesCulled) + " subtrees culled";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+        }
+
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        myShader.use();
+        myShader.setMat4("view", view);
+        myShader.setMat4("projection", projection);
+        myShader.setVec3("lightDir", glm::vec3(-0.2f, -1.0f, -0.3f));
+        scene.Draw(myShader, visibleNodes);
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    glfwTerminate();
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D depthMap;
+uniform float near_plane;
+uniform float far_plane;
+
+//把NDC深度还原为线性深度，否则远处的遮挡体几乎都显示为白色
+float LinearizeDepth(float depth)
+{
+    return (2.0 * near_plane * far_plane) / (far_plane + near_plane - depth * (far_plane - near_plane));
+}
+
+void main()
+{
+    float depth = texture(depthMap, TexCoords).r;
+    //没有被遮挡体覆盖的像素显示为蓝色
+    if(depth >= 1.0)
+        FragColor = vec4(0.0, 0.0, 0.3, 1.0);
+    else
+        FragColor = vec4(vec3(LinearizeDepth(depth) / far_plane), 1.0);
+}
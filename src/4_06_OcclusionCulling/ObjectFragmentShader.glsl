@@ -0,0 +1,22 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 Normal;
+in vec4 Tint;
+
+struct Material{
+    sampler2D texture_diffuse1;
+};
+
+uniform Material material;
+uniform vec3 lightDir;
+
+void main()
+{
+    vec3 albedo = texture(material.texture_diffuse1, TexCoords).rgb;
+    //Tint.a为每实例颜色的混合权重
+    albedo = mix(albedo, Tint.rgb, Tint.a);
+    float diff = max(dot(normalize(Normal), normalize(-lightDir)), 0.0);
+    FragColor = vec4(albedo * (0.15 + 0.85 * diff), 1.0);
+}
@@ -0,0 +1,288 @@
+#ifndef OCCLUSIONBUFFER_H
+#define OCCLUSIONBUFFER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cfloat>
+#include "Bounds.h"
+using namespace std;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_USE_SSE
+#include <emmintrin.h>
+#endif
+
+//层次深度缓冲的分块大小，每个分块保存块内最远的深度
+#define OCCLUSION_TILE_SIZE 8
+
+//遮挡剔除统计
+struct OcclusionStats {
+    unsigned int occluderTriangles = 0;//本帧光栅化的遮挡体三角形
+    unsigned int tested = 0;//测试的包围盒数量
+    unsigned int occluded = 0;//被遮挡的数量
+    double rasterMs = 0.0;//光栅化遮挡体的耗时
+    double testMs = 0.0;//测试包围盒的耗时
+
+    void Reset(){
+        occluderTriangles = tested = occluded = 0;
+        rasterMs = testMs = 0.0;
+    }
+};
+
+//CPU软件遮挡剔除
+//把选定的遮挡体（通常是墙、建筑这类大而简单的网格）光栅化到一个低分辨率深度缓冲中，
+//再把候选物体的屏幕空间包围矩形与分块最远深度比较，整个矩形都在遮挡体之后的物体不需要提交给GPU
+//深度使用NDC的z（-1为近平面，1为远平面），它在屏幕空间中是线性的，可以直接按平面方程插值
+class OcclusionBuffer {
+public:
+    unsigned int width = 0, height = 0;
+    unsigned int tilesX = 0, tilesY = 0;
+    vector<float> depth;//逐像素深度，行优先，第0行在屏幕底部
+    vector<float> tileMaxDepth;//每个分块内最远的深度
+    OcclusionStats stats;
+
+    //宽高需要是分块大小的整数倍，threadCount为0时使用硬件线程数
+    void Init(unsigned int width, unsigned int height, unsigned int threadCount = 0){
+        this->width = width / OCCLUSION_TILE_SIZE * OCCLUSION_TILE_SIZE;
+        this->height = height / OCCLUSION_TILE_SIZE * OCCLUSION_TILE_SIZE;
+        tilesX = this->width / OCCLUSION_TILE_SIZE;
+        tilesY = this->height / OCCLUSION_TILE_SIZE;
+        depth.assign(this->width * this->height, 1.0f);
+        tileMaxDepth.assign(tilesX * tilesY, 1.0f);
+        if(threadCount == 0)
+            threadCount = max(1u, thread::hardware_concurrency());
+        //每个线程负责若干整行分块组成的水平条带，条带之间没有共享的写入
+        this->threadCount = min(threadCount, tilesY);
+    }
+
+    //开始新的一帧，清空深度与遮挡体
+    void BeginFrame(const glm::mat4 &viewProjection){
+        this->viewProjection = viewProjection;
+        triangles.clear();
+        stats.Reset();
+    }
+
+    //添加遮挡体网格，完成变换、近平面裁剪、背面剔除与三角形设置，真正的光栅化在Rasterize中多线程进行
+    void AddOccluder(const vector<glm::vec3> &positions, const vector<unsigned int> &indices, const glm::mat4 &model){
+        glm::mat4 mvp = viewProjection * model;
+        clipVertices.resize(positions.size());
+        for(unsigned int i = 0; i < positions.size(); i++)
+            clipVertices[i] = mvp * glm::vec4(positions[i], 1.0f);
+        for(unsigned int i = 0; i + 2 < indices.size(); i += 3){
+            glm::vec4 v[3] = {clipVertices[indices[i]], clipVertices[indices[i + 1]], clipVertices[indices[i + 2]]};
+            clipAndSetup(v);
+        }
+    }
+
+    //多线程光栅化所有遮挡体三角形，并更新分块最远深度
+    void Rasterize(){
+        auto start = chrono::high_resolution_clock::now();
+        stats.occluderTriangles = static_cast<unsigned int>(triangles.size());
+        unsigned int tileRowsPerBand = (tilesY + threadCount - 1) / threadCount;
+        vector<thread> workers;
+        for(unsigned int band = 1; band < threadCount; band++){
+            unsigned int y0 = band * tileRowsPerBand * OCCLUSION_TILE_SIZE;
+            unsigned int y1 = min(height, y0 + tileRowsPerBand * OCCLUSION_TILE_SIZE);
+            if(y0 < y1)
+                workers.emplace_back(&OcclusionBuffer::rasterizeBand, this, y0, y1);
+        }
+        //主线程处理第一个条带
+        rasterizeBand(0, min(height, tileRowsPerBand * OCCLUSION_TILE_SIZE));
+        for(unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+        stats.rasterMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    }
+
+    //测试世界空间包围盒是否可能可见，被遮挡时返回false
+    bool TestAABB(const AABB &box){
+        auto start = chrono::high_resolution_clock::now();
+        stats.tested++;
+        bool visible = testAABB(box);
+        if(!visible)
+            stats.occluded++;
+        stats.testMs += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        return visible;
+    }
+
+private:
+    //屏幕空间三角形：边函数 e(x, y) = a*x + b*y + c，三个边函数都不小于0时像素在三角形内
+    struct Triangle {
+        float edgeA[3], edgeB[3], edgeC[3];
+        float zA, zB, zC;//深度平面 z(x, y) = zA*x + zB*y + zC
+        int minX, maxX, minY, maxY;//像素包围矩形（闭区间）
+    };
+    vector<Triangle> triangles;
+    vector<glm::vec4> clipVertices;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    unsigned int threadCount = 1;
+
+    //裁剪空间中z >= -w为近平面内侧
+    static float nearDistance(const glm::vec4 &v){
+        return v.z + v.w;
+    }
+
+    //只对近平面做裁剪（Sutherland-Hodgman），其它平面由包围矩形与屏幕求交处理
+    void clipAndSetup(const glm::vec4 v[3]){
+        glm::vec4 polygon[4];
+        unsigned int count = 0;
+        for(unsigned int i = 0; i < 3; i++){
+            const glm::vec4 &a = v[i];
+            const glm::vec4 &b = v[(i + 1) % 3];
+            float da = nearDistance(a), db = nearDistance(b);
+            if(da >= 0.0f)
+                polygon[count++] = a;
+            if((da >= 0.0f) != (db >= 0.0f))
+                polygon[count++] = a + (b - a) * (da / (da - db));
+        }
+        if(count < 3)
+            return;
+        setupTriangle(polygon[0], polygon[1], polygon[2]);
+        if(count == 4)
+            setupTriangle(polygon[0], polygon[2], polygon[3]);
+    }
+
+    void setupTriangle(const glm::vec4 &c0, const glm::vec4 &c1, const glm::vec4 &c2){
+        //透视除法并映射到像素坐标
+        glm::vec3 p[3];
+        const glm::vec4 *c[3] = {&c0, &c1, &c2};
+        for(int i = 0; i < 3; i++){
+            float invW = 1.0f / c[i]->w;
+            p[i].x = (c[i]->x * invW * 0.5f + 0.5f) * width;
+            p[i].y = (c[i]->y * invW * 0.5f + 0.5f) * height;
+            p[i].z = c[i]->z * invW;
+        }
+        //有向面积，逆时针为正面，背面与退化三角形直接丢弃
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+        if(area <= 0.0f)
+            return;
+        Triangle tri;
+        float minX = min(p[0].x, min(p[1].x, p[2].x));
+        float maxX = max(p[0].x, max(p[1].x, p[2].x));
+        float minY = min(p[0].y, min(p[1].y, p[2].y));
+        float maxY = max(p[0].y, max(p[1].y, p[2].y));
+        tri.minX = max(0, (int)floor(minX));
+        tri.maxX = min((int)width - 1, (int)ceil(maxX));
+        tri.minY = max(0, (int)floor(minY));
+        tri.maxY = min((int)height - 1, (int)ceil(maxY));
+        if(tri.minX > tri.maxX || tri.minY > tri.maxY)
+            return;
+        //边i为从p[i]到p[i+1]的边的对边函数，归一化后直接等于重心坐标
+        float invArea = 1.0f / area;
+        for(int i = 0; i < 3; i++){
+            const glm::vec3 &a = p[(i + 1) % 3];
+            const glm::vec3 &b = p[(i + 2) % 3];
+            tri.edgeA[i] = (a.y - b.y) * invArea;
+            tri.edgeB[i] = (b.x - a.x) * invArea;
+            tri.edgeC[i] = (a.x * b.y - a.y * b.x) * invArea;
+        }
+        //深度按重心坐标插值，整理成平面方程
+        tri.zA = tri.edgeA[0] * p[0].z + tri.edgeA[1] * p[1].z + tri.edgeA[2] * p[2].z;
+        tri.zB = tri.edgeB[0] * p[0].z + tri.edgeB[1] * p[1].z + tri.edgeB[2] * p[2].z;
+        tri.zC = tri.edgeC[0] * p[0].z + tri.edgeC[1] * p[1].z + tri.edgeC[2] * p[2].z;
+        triangles.push_back(tri);
+    }
+
+    //光栅化[y0, y1)行，同时清空并更新这些行对应的分块
+    void rasterizeBand(unsigned int y0, unsigned int y1){
+        fill(depth.begin() + y0 * width, depth.begin() + y1 * width, 1.0f);
+        for(unsigned int t = 0; t < triangles.size(); t++){
+            const Triangle &tri = triangles[t];
+            int rowStart = max(tri.minY, (int)y0);
+            int rowEnd = min(tri.maxY, (int)y1 - 1);
+            for(int y = rowStart; y <= rowEnd; y++)
+                rasterizeRow(tri, y);
+        }
+        //分块最远深度：分块内所有像素都被遮挡体覆盖时才小于1
+        for(unsigned int ty = y0 / OCCLUSION_TILE_SIZE; ty < y1 / OCCLUSION_TILE_SIZE; ty++){
+            for(unsigned int tx = 0; tx < tilesX; tx++){
+                float farthest = 0.0f;
+                for(unsigned int y = 0; y < OCCLUSION_TILE_SIZE; y++){
+                    const float *row = &depth[(ty * OCCLUSION_TILE_SIZE + y) * width + tx * OCCLUSION_TILE_SIZE];
+                    for(unsigned int x = 0; x < OCCLUSION_TILE_SIZE; x++)
+                        farthest = max(farthest, row[x]);
+                }
+                tileMaxDepth[ty * tilesX + tx] = farthest;
+            }
+        }
+    }
+
+    //光栅化三角形的一行，SSE一次处理4个像素
+    void rasterizeRow(const Triangle &tri, int y){
+        float py = y + 0.5f;
+        float *row = &depth[y * width];
+        int x = tri.minX & ~3;//对齐到4个像素
+#if defined(OCCLUSION_USE_SSE)
+        __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        __m128 e0c = _mm_set1_ps(tri.edgeB[0] * py + tri.edgeC[0]);
+        __m128 e1c = _mm_set1_ps(tri.edgeB[1] * py + tri.edgeC[1]);
+        __m128 e2c = _mm_set1_ps(tri.edgeB[2] * py + tri.edgeC[2]);
+        __m128 zc = _mm_set1_ps(tri.zB * py + tri.zC);
+        __m128 e0a = _mm_set1_ps(tri.edgeA[0]), e1a = _mm_set1_ps(tri.edgeA[1]), e2a = _mm_set1_ps(tri.edgeA[2]);
+        __m128 za = _mm_set1_ps(tri.zA);
+        __m128 zero = _mm_setzero_ps();
+        for(; x <= tri.maxX; x += 4){
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            __m128 w0 = _mm_add_ps(_mm_mul_ps(e0a, px), e0c);
+            __m128 w1 = _mm_add_ps(_mm_mul_ps(e1a, px), e1c);
+            __m128 w2 = _mm_add_ps(_mm_mul_ps(e2a, px), e2c);
+            __m128 inside = _mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_and_ps(_mm_cmpge_ps(w1, zero), _mm_cmpge_ps(w2, zero)));
+            if(_mm_movemask_ps(inside) == 0)
+                continue;
+            __m128 z = _mm_add_ps(_mm_mul_ps(za, px), zc);
+            __m128 old = _mm_loadu_ps(row + x);
+            //在三角形内的像素取更近的深度，其余像素保持原值
+            __m128 nearer = _mm_min_ps(old, z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+        }
+#else
+        for(; x <= tri.maxX && x < (int)width; x++){
+            float px = x + 0.5f;
+            float w0 = tri.edgeA[0] * px + tri.edgeB[0] * py + tri.edgeC[0];
+            float w1 = tri.edgeA[1] * px + tri.edgeB[1] * py + tri.edgeC[1];
+            float w2 = tri.edgeA[2] * px + tri.edgeB[2] * py + tri.edgeC[2];
+            if(w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f){
+                float z = tri.zA * px + tri.zB * py + tri.zC;
+                row[x] = min(row[x], z);
+            }
+        }
+#endif
+    }
+
+    bool testAABB(const AABB &box) const{
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+        for(int i = 0; i < 8; i++){
+            glm::vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+            glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+            //包围盒跨过近平面时无法可靠地投影，保守地认为可见
+            if(nearDistance(clip) <= 0.0f)
+                return true;
+            float invW = 1.0f / clip.w;
+            float x = (clip.x * invW * 0.5f + 0.5f) * width;
+            float y = (clip.y * invW * 0.5f + 0.5f) * height;
+            minX = min(minX, x);
+            maxX = max(maxX, x);
+            minY = min(minY, y);
+            maxY = max(maxY, y);
+            minZ = min(minZ, clip.z * invW);
+        }
+        //完全在屏幕外（视锥体剔除通常已经处理）
+        if(maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+            return false;
+        int tx0 = max(0, (int)minX) / OCCLUSION_TILE_SIZE;
+        int ty0 = max(0, (int)minY) / OCCLUSION_TILE_SIZE;
+        int tx1 = min((int)width - 1, (int)maxX) / OCCLUSION_TILE_SIZE;
+        int ty1 = min((int)height - 1, (int)maxY) / OCCLUSION_TILE_SIZE;
+        //只要有一个分块的最远深度比包围盒最近的点更远，包围盒就可能露出来
+        for(int ty = ty0; ty <= ty1; ty++){
+            for(int tx = tx0; tx <= tx1; tx++){
+                if(minZ <= tileMaxDepth[ty * tilesX + tx])
+                    return true;
+            }
+        }
+        return false;
+    }
+};
+#endif
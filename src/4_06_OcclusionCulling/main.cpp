@@ -0,0 +1,409 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomCamera.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "InstanceBuffer.h"
+#include "Frustum.h"
+#include "OcclusionBuffer.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_06_OcclusionCulling/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+//遮挡缓冲的分辨率，只需要屏幕的几分之一
+const unsigned int OCCLUSION_WIDTH = 256;
+const unsigned int OCCLUSION_HEIGHT = 192;
+
+CustomCamera camera(glm::vec3(15.0f, 4.0f, 15.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//城市由GRID_SIZE*GRID_SIZE栋建筑组成，建筑之间是街道，岩石散落在街道上
+const int GRID_SIZE = 20;
+const float BLOCK_SPACING = 30.0f;
+const unsigned int ROCK_AMOUNT = 30000;
+//每帧最多使用的遮挡体数量
+const unsigned int MAX_OCCLUDERS = 48;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 1000.0f;
+
+bool occlusionEnabled = true;
+bool showOcclusionBuffer = false;
+bool occlusionKeyDown = false;
+bool debugKeyDown = false;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //O键开关遮挡剔除，V键显示遮挡缓冲
+    bool toggle = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+    if(toggle && !occlusionKeyDown)
+        occlusionEnabled = !occlusionEnabled;
+    occlusionKeyDown = toggle;
+    toggle = glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS;
+    if(toggle && !debugKeyDown)
+        showOcclusionBuffer = !showOcclusionBuffer;
+    debugKeyDown = toggle;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+//以原点为中心的单位立方体，每个面4个顶点以便使用各自的法线，三角形按逆时针朝外
+Mesh createCube(){
+    const glm::vec3 normals[6] = {
+        glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+        glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+    };
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    for(int face = 0; face < 6; face++){
+        glm::vec3 n = normals[face];
+        //面上的两个切向量，满足 u x v = n
+        glm::vec3 u = glm::abs(n.y) > 0.5f ? glm::vec3(0, 0, n.y) : glm::vec3(-n.z, 0, n.x);
+        glm::vec3 v = glm::cross(n, u);
+        unsigned int base = static_cast<unsigned int>(vertices.size());
+        for(int i = 0; i < 4; i++){
+            float su = (i == 1 || i == 2) ? 0.5f : -0.5f;
+            float sv = (i >= 2) ? 0.5f : -0.5f;
+            Vertex vertex = {};
+            vertex.Position = n * 0.5f + u * su + v * sv;
+            vertex.Normal = n;
+            vertex.TexCoords = glm::vec2(su + 0.5f, sv + 0.5f);
+            vertices.push_back(vertex);
+        }
+        unsigned int quad[6] = {0, 1, 2, 0, 2, 3};
+        for(int i = 0; i < 6; i++)
+            indices.push_back(base + quad[i]);
+    }
+    return Mesh(vertices, indices, vector<Texture>());
+}
+
+//生成建筑：第0个实例是地面，不参与遮挡
+void generateBuildings(vector<glm::mat4> &matrices, vector<glm::vec4> &tints, vector<AABB> &bounds){
+    matrices.clear();
+    tints.clear();
+    bounds.clear();
+    float extent = GRID_SIZE * BLOCK_SPACING;
+    glm::mat4 ground = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, 0.0f));
+    matrices.push_back(glm::scale(ground, glm::vec3(extent, 1.0f, extent)));
+    tints.push_back(glm::vec4(0.25f, 0.25f, 0.28f, 1.0f));
+    for(int x = 0; x < GRID_SIZE; x++){
+        for(int z = 0; z < GRID_SIZE; z++){
+            float height = 15.0f + (rand() % 4500) / 100.0f;
+            glm::vec3 center((x - GRID_SIZE / 2) * BLOCK_SPACING, height * 0.5f, (z - GRID_SIZE / 2) * BLOCK_SPACING);
+            glm::vec3 size(BLOCK_SPACING * 0.6f, height, BLOCK_SPACING * 0.6f);
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), center);
+            matrices.push_back(glm::scale(model, size));
+            float shade = 0.5f + (rand() % 30) / 100.0f;
+            tints.push_back(glm::vec4(shade, shade * 0.95f, shade * 0.9f, 1.0f));
+            AABB box;
+            box.min = center - size * 0.5f;
+            box.max = center + size * 0.5f;
+            bounds.push_back(box);
+        }
+    }
+}
+
+//在街道上随机放置岩石，避开建筑占据的区域
+void generateRocks(const Model &rock, vector<glm::mat4> &matrices, vector<glm::vec4> &tints, AABBSoA &bounds){
+    matrices.resize(ROCK_AMOUNT);
+    tints.resize(ROCK_AMOUNT);
+    bounds.Resize(ROCK_AMOUNT);
+    float extent = GRID_SIZE * BLOCK_SPACING;
+    float halfBuilding = BLOCK_SPACING * 0.3f;
+    for(unsigned int i = 0; i < ROCK_AMOUNT; i++){
+        glm::vec3 position;
+        do{
+            position.x = (rand() % 10000) / 10000.0f * extent - extent * 0.5f - BLOCK_SPACING * 0.5f;
+            position.z = (rand() % 10000) / 10000.0f * extent - extent * 0.5f - BLOCK_SPACING * 0.5f;
+            //到最近的建筑中心的距离
+            float dx = fabs(position.x - round(position.x / BLOCK_SPACING) * BLOCK_SPACING);
+            float dz = fabs(position.z - round(position.z / BLOCK_SPACING) * BLOCK_SPACING);
+            if(dx > halfBuilding + 2.0f || dz > halfBuilding + 2.0f)
+                break;
+        }while(true);
+        float scale = 0.3f + (rand() % 70) / 100.0f;
+        position.y = scale;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+        model = glm::rotate(model, (rand() % 360) / 180.0f * glm::pi<float>(), glm::vec3(0.4f, 0.6f, 0.8f));
+        matrices[i] = glm::scale(model, glm::vec3(scale));
+        float shade = 0.45f + (rand() % 40) / 100.0f;
+        tints[i] = glm::vec4(shade, shade * 0.9f, shade * 0.8f, 0.6f);
+        bounds.Set(i, rock.aabb.Transform(matrices[i]));
+    }
+}
+
+//选择遮挡体：在视锥体内、并且投影到屏幕上足够大的建筑，按估计的屏幕尺寸从大到小取前MAX_OCCLUDERS个
+void selectOccluders(const vector<AABB> &buildings, const Frustum &frustum, const glm::vec3 &eye, vector<unsigned int> &occluders){
+    vector<pair<float, unsigned int> > candidates;
+    for(unsigned int i = 0; i < buildings.size(); i++){
+        const AABB &box = buildings[i];
+        if(!frustum.TestAABB(box))
+            continue;
+        //包围盒对角线长度除以到相机的距离，近似为屏幕上的张角
+        float distance = max(glm::length(box.Center() - eye), 1.0f);
+        float size = glm::length(box.Extents()) / distance;
+        if(size > 0.1f)
+            candidates.push_back(make_pair(size, i));
+    }
+    unsigned int count = min(static_cast<unsigned int>(candidates.size()), MAX_OCCLUDERS);
+    partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+        [](const pair<float, unsigned int> &a, const pair<float, unsigned int> &b){ return a.first > b.first; });
+    occluders.resize(count);
+    for(unsigned int i = 0; i < count; i++)
+        occluders[i] = candidates[i].second;
+}
+
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glEnable(GL_DEPTH_TEST);
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 20.0f;
+
+    CustomShader objectShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str(), "INSTANCED");
+    CustomShader debugShader((Path + "DebugVertexShader.glsl").c_str(), (Path + "DebugFragmentShader.glsl").c_str());
+
+    Model rock("static/model/rock/rock.obj");
+    Mesh cube = createCube();
+    //遮挡体直接使用立方体网格的位置与索引
+    vector<glm::vec3> cubePositions;
+    for(unsigned int i = 0; i < cube.vertices.size(); i++)
+        cubePositions.push_back(cube.vertices[i].Position);
+
+    srand(static_cast<unsigned int>(glfwGetTime()));
+    vector<glm::mat4> buildingMatrices;
+    vector<glm::vec4> buildingTints;
+    vector<AABB> buildingBounds;
+    generateBuildings(buildingMatrices, buildingTints, buildingBounds);
+    InstanceBuffer buildingInstances(buildingMatrices.data(), static_cast<unsigned int>(buildingMatrices.size()), buildingTints.data());
+    cube.SetInstanceBuffer(buildingInstances);
+
+    vector<glm::mat4> rockMatrices;
+    vector<glm::vec4> rockTints;
+    AABBSoA rockBounds;
+    generateRocks(rock, rockMatrices, rockTints, rockBounds);
+    //可见集合每帧变化，只上传通过两级剔除的岩石
+    vector<glm::mat4> visibleMatrices;
+    vector<glm::vec4> visibleTints;
+    InstanceBuffer rockInstances(rockMatrices.data(), ROCK_AMOUNT, rockTints.data(), GL_STREAM_DRAW);
+    rock.SetInstanceBuffer(rockInstances);
+
+    FrustumCuller frustumCuller;
+    OcclusionBuffer occlusion;
+    occlusion.Init(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+    vector<unsigned int> inFrustum;
+    vector<unsigned int> occluders;
+
+    //遮挡缓冲的调试纹理与全屏四边形
+    unsigned int occlusionTexture;
+    glGenTextures(1, &occlusionTexture);
+    glBindTexture(GL_TEXTURE_2D, occlusionTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, occlusion.width, occlusion.height, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    float quadVertices[] = {-1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f};
+    unsigned int quadVAO, quadVBO;
+    glGenVertexArrays(1, &quadVAO);
+    glGenBuffers(1, &quadVBO);
+    glBindVertexArray(quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glBindVertexArray(0);
+    debugShader.use();
+    debugShader.setInt("depthMap", 0);
+    debugShader.setFloat("near_plane", NEAR_PLANE);
+    debugShader.setFloat("far_plane", FAR_PLANE);
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    unsigned int occluderTriangles = 0;
+    unsigned int tested = 0;
+    unsigned int occluded = 0;
+    double rasterMs = 0.0;
+    double testMs = 0.0;
+    while (!glfwWindowShouldClose(window)){
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        //显示平均帧时间与遮挡剔除统计
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame - occlusion "
+                + (occlusionEnabled ? "on" : "off") + ": " + to_string(occluded / frameCount) + "/"
+                + to_string(tested / frameCount) + " occluded, " + to_string(occluderTriangles / frameCount)
+                + " occluder tris, raster " + to_string(rasterMs / frameCount) + " ms, test " + to_string(testMs / frameCount) + " ms";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+            occluderTriangles = tested = occluded = 0;
+            rasterMs = testMs = 0.0;
+        }
+
+        processInput(window);
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+        glm::mat4 viewProjection = projection * view;
+        glm::vec3 lightDir(-0.2f, -1.0f, -0.3f);
+        Frustum frustum = Frustum::FromMatrix(viewProjection);
+
+        //先做视锥体剔除，再对剩下的岩石做遮挡测试
+        frustumCuller.CullAABBs(frustum, rockBounds, inFrustum);
+        visibleMatrices.clear();
+        visibleTints.clear();
+        if(occlusionEnabled){
+            //把选出的遮挡体光栅化到低分辨率深度缓冲
+            occlusion.BeginFrame(viewProjection);
+            selectOccluders(buildingBounds, frustum, camera.Position, occluders);
+            for(unsigned int i = 0; i < occluders.size(); i++)
+                occlusion.AddOccluder(cubePositions, cube.indices, buildingMatrices[occluders[i] + 1]);
+            occlusion.Rasterize();
+            for(unsigned int i = 0; i < inFrustum.size(); i++){
+                unsigned int index = inFrustum[i];
+                glm::vec3 center(rockBounds.cx[index], rockBounds.cy[index], rockBounds.cz[index]);
+                glm::vec3 extents(rockBounds.ex[index], rockBounds.ey[index], rockBounds.ez[index]);
+                AABB box;
+                box.min = center - extents;
+                box.max = center + extents;
+                if(occlusion.TestAABB(box)){
+                    visibleMatrices.push_back(rockMatrices[index]);
+                    visibleTints.push_back(rockTints[index]);
+                }
+            }
+            occluderTriangles += occlusion.stats.occluderTriangles;
+            tested += occlusion.stats.tested;
+            occluded += occlusion.stats.occluded;
+            rasterMs += occlusion.stats.rasterMs;
+            testMs += occlusion.stats.testMs;
+        }else{
+            for(unsigned int i = 0; i < inFrustum.size(); i++){
+                visibleMatrices.push_back(rockMatrices[inFrustum[i]]);
+                visibleTints.push_back(rockTints[inFrustum[i]]);
+            }
+        }
+        unsigned int visibleCount = static_cast<unsigned int>(visibleMatrices.size());
+        if(visibleCount > 0)
+            rockInstances.Update(visibleMatrices.data(), visibleCount, visibleTints.data());
+
+        glClearColor(0.55f, 0.65f, 0.8f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        objectShader.use();
+        objectShader.setMat4("view", view);
+        objectShader.setMat4("projection", projection);
+        objectShader.setVec3("lightDir", lightDir);
+        cube.DrawInstanced(objectShader, buildingInstances.count);
+        rock.DrawInstanced(objectShader, visibleCount);
+
+        //在左下角显示遮挡缓冲
+        if(showOcclusionBuffer && occlusionEnabled){
+            glBindTexture(GL_TEXTURE_2D, occlusionTexture);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, occlusion.width, occlusion.height, GL_RED, GL_FLOAT, occlusion.depth.data());
+            glViewport(0, 0, occlusion.width, occlusion.height);
+            glDisable(GL_DEPTH_TEST);
+            debugShader.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glBindVertexArray(0);
+            glEnable(GL_DEPTH_TEST);
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        }
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    glDeleteVertexArrays(1, &quadVAO);
+    glDeleteBuffers(1, &quadVBO);
+    glDeleteTextures(1, &occlusionTexture);
+    buildingInstances.Release();
+    rockInstances.Release();
+    glfwTerminate();
+
+    return 0;
+}
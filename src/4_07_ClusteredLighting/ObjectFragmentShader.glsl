@@ -0,0 +1,112 @@
+#version 330 core
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+in float ViewDepth;
+out vec4 FragColor;
+
+struct Material{
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+//定向光
+struct DirLight{
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+//分簇数据，布局见ClusteredLights.h
+uniform usamplerBuffer clusters;//每个簇：x为索引偏移，y为光源数量
+uniform usamplerBuffer lightIndices;
+uniform samplerBuffer lightData;//每个光源4个texel
+uniform float clusterScale;
+uniform float clusterBias;
+uniform vec2 clusterTileSize;
+
+#define CLUSTER_X 16
+#define CLUSTER_Y 12
+#define CLUSTER_Z 24
+
+uniform vec3 viewPos;
+uniform Material material;
+uniform DirLight dirLight;//定向光
+uniform bool showHeatmap;//显示每个簇的光源数量
+
+//计算定向光分量
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor){
+    vec3 lightDir = normalize(-light.direction);
+    // 漫反射着色
+    float diff = max(dot(normal, lightDir), 0.0);
+    // 镜面光着色
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // 合并结果
+    vec3 ambient = light.ambient * diffuseColor;
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+    vec3 specular = light.specular * spec * specularColor;
+    return (ambient + diffuse + specular);
+}
+
+//计算簇中一个点光源或聚光灯的分量，点光源不再带环境光，上千个光源的环境光叠加没有意义
+vec3 CalcClusterLight(int index, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 diffuseColor, vec3 specularColor){
+    vec4 positionRadius = texelFetch(lightData, index * 4);
+    vec3 toLight = positionRadius.xyz - fragPos;
+    float distance = length(toLight);
+    //超出推导出的半径时贡献已可以忽略
+    if(distance > positionRadius.w)
+        return vec3(0.0);
+    vec4 colorType = texelFetch(lightData, index * 4 + 1);
+    vec4 attenuationTerms = texelFetch(lightData, index * 4 + 3);
+    vec3 lightDir = toLight / distance;
+    // 漫反射着色
+    float diff = max(dot(normal, lightDir), 0.0);
+    // 镜面光着色
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // 衰减
+    float attenuation = 1.0 / (attenuationTerms.x + attenuationTerms.y * distance + attenuationTerms.z * (distance * distance));
+    //聚光灯的平滑边缘
+    if(colorType.w > 0.5){
+        vec4 directionCutOff = texelFetch(lightData, index * 4 + 2);
+        float theta = dot(lightDir, -directionCutOff.xyz);
+        float epsilon = attenuationTerms.w - directionCutOff.w;
+        attenuation *= clamp((theta - directionCutOff.w) / epsilon, 0.0, 1.0);
+    }
+    return colorType.rgb * (diff * diffuseColor + spec * specularColor) * attenuation;
+}
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 diffuseColor = texture(material.diffuse, TexCoords).rgb;
+    vec3 specularColor = texture(material.specular, TexCoords).rgb;
+
+    //定向光
+    vec3 result = CalcDirLight(dirLight, norm, viewDir, diffuseColor, specularColor);
+
+    //找到片段所在的簇：屏幕分块 + 指数深度切片
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterTileSize), ivec2(0), ivec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+    int slice = clamp(int(log(ViewDepth) * clusterScale - clusterBias), 0, CLUSTER_Z - 1);
+    int cluster = (slice * CLUSTER_Y + tile.y) * CLUSTER_X + tile.x;
+    uvec2 offsetCount = texelFetch(clusters, cluster).xy;
+
+    //只遍历簇中的光源
+    for(uint i = 0u; i < offsetCount.y; i++){
+        int index = int(texelFetch(lightIndices, int(offsetCount.x + i)).r);
+        result += CalcClusterLight(index, norm, FragPos, viewDir, diffuseColor, specularColor);
+    }
+
+    if(showHeatmap){
+        //0个光源为蓝色，64个及以上为红色
+        float t = clamp(float(offsetCount.y) / 64.0, 0.0, 1.0);
+        result = mix(result, mix(vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0), t), 0.6);
+    }
+
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,421 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "InstanceBuffer.h"
+#include "ClusteredLights.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_07_ClusteredLighting/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 200.0f;
+
+CustomCamera camera(glm::vec3(0.0f, 8.0f, 20.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -20.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//箱子铺满GRID_SIZE*GRID_SIZE个格子，光源在箱子之间移动
+const int GRID_SIZE = 64;
+const float CELL_SIZE = 2.0f;
+const unsigned int MAX_LIGHTS = 4096;
+unsigned int activeLights = 1024;
+bool showHeatmap = false;
+bool moreKeyDown = false;
+bool lessKeyDown = false;
+bool heatmapKeyDown = false;
+
+//光源的运动参数
+struct LightMotion {
+    glm::vec3 center;
+    float radius;
+    float speed;
+    float phase;
+};
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //=键与-键把光源数量加倍或减半，H键显示每个簇的光源数量
+    bool key = glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS;
+    if(key && !moreKeyDown && activeLights < MAX_LIGHTS)
+        activeLights *= 2;
+    moreKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS;
+    if(key && !lessKeyDown && activeLights > 64)
+        activeLights /= 2;
+    lessKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+    if(key && !heatmapKeyDown)
+        showHeatmap = !showHeatmap;
+    heatmapKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+unsigned int loadTexture(char const * path)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    if (data)
+    {
+        GLenum format;
+        if (nrComponents == 1)
+            format = GL_RED;
+        else if (nrComponents == 3)
+            format = GL_RGB;
+        else if (nrComponents == 4)
+            format = GL_RGBA;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        stbi_image_free(data);
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        stbi_image_free(data);
+    }
+
+    return textureID;
+}
+
+//地面由扁平的箱子铺成，部分格子上再随机堆叠1~3个箱子
+void generateCrates(vector<glm::mat4> &matrices){
+    float half = GRID_SIZE * CELL_SIZE * 0.5f;
+    for(int x = 0; x < GRID_SIZE; x++){
+        for(int z = 0; z < GRID_SIZE; z++){
+            glm::vec3 cell(x * CELL_SIZE - half, 0.0f, z * CELL_SIZE - half);
+            glm::mat4 floor = glm::translate(glm::mat4(1.0f), cell + glm::vec3(0.0f, -0.05f, 0.0f));
+            matrices.push_back(glm::scale(floor, glm::vec3(CELL_SIZE, 0.1f, CELL_SIZE)));
+            if(rand() % 100 < 35){
+                int stack = 1 + rand() % 3;
+                for(int i = 0; i < stack; i++){
+                    glm::mat4 model = glm::translate(glm::mat4(1.0f), cell + glm::vec3(0.0f, 0.5f + i, 0.0f));
+                    matrices.push_back(glm::rotate(model, glm::radians((float)(rand() % 90)), glm::vec3(0.0f, 1.0f, 0.0f)));
+                }
+            }
+        }
+    }
+}
+
+//生成全部光源，每4个中有1个是朝下的聚光灯
+//衰减系数取自常用的距离表（7、13、20），半径由ComputeLightRadius推导
+void generateLights(vector<ClusterLight> &lights, vector<LightMotion> &motions){
+    const float attenuations[3][2] = {{0.7f, 1.8f}, {0.35f, 0.44f}, {0.22f, 0.20f}};
+    float half = GRID_SIZE * CELL_SIZE * 0.5f;
+    lights.resize(MAX_LIGHTS);
+    motions.resize(MAX_LIGHTS);
+    for(unsigned int i = 0; i < MAX_LIGHTS; i++){
+        ClusterLight &light = lights[i];
+        int preset = rand() % 3;
+        light.constant = 1.0f;
+        light.linear = attenuations[preset][0];
+        light.quadratic = attenuations[preset][1];
+        light.color = glm::vec3(0.3f + (rand() % 70) / 100.0f, 0.3f + (rand() % 70) / 100.0f, 0.3f + (rand() % 70) / 100.0f);
+        if(i % 4 == 3){
+            light.type = LIGHT_SPOT;
+            light.cutOff = glm::cos(glm::radians(20.0f));
+            light.outerCutOff = glm::cos(glm::radians(30.0f));
+        }
+        LightMotion &motion = motions[i];
+        motion.center = glm::vec3((rand() % 10000) / 10000.0f * 2.0f * half - half, 0.5f + (rand() % 350) / 100.0f,
+            (rand() % 10000) / 10000.0f * 2.0f * half - half);
+        motion.radius = 1.0f + (rand() % 300) / 100.0f;
+        motion.speed = 0.3f + (rand() % 100) / 100.0f;
+        motion.phase = (rand() % 628) / 100.0f;
+    }
+}
+
+//光源绕各自的中心移动，聚光灯在移动的同时摆动方向
+void updateLights(vector<ClusterLight> &lights, const vector<LightMotion> &motions, float time,
+    vector<glm::mat4> &markers, vector<glm::vec4> &markerColors){
+    for(unsigned int i = 0; i < activeLights; i++){
+        const LightMotion &motion = motions[i];
+        float angle = motion.phase + motion.speed * time;
+        lights[i].position = motion.center + glm::vec3(cos(angle), 0.0f, sin(angle)) * motion.radius;
+        if(lights[i].type == LIGHT_SPOT)
+            lights[i].direction = glm::normalize(glm::vec3(0.5f * cos(angle * 2.0f), -1.0f, 0.5f * sin(angle * 2.0f)));
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), lights[i].position);
+        markers[i] = glm::scale(model, glm::vec3(0.1f));
+        markerColors[i] = glm::vec4(lights[i].color, 1.0f);
+    }
+}
+
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glEnable(GL_DEPTH_TEST);
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 10.0f;
+
+    CustomShader objectShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+    CustomShader lightShader((Path + "LightVertexShader.glsl").c_str(), (Path + "LightFragmentShader.glsl").c_str());
+
+    float vertices[] = {
+        // positions          // normals           // texture coords
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+        0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+    };
+
+    unsigned int VBO, ObjectVAO, LightVAO;
+    glGenVertexArrays(1, &ObjectVAO);
+    glGenBuffers(1, &VBO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindVertexArray(ObjectVAO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    //箱子的模型矩阵是静态的
+    srand(static_cast<unsigned int>(glfwGetTime()));
+    vector<glm::mat4> crateMatrices;
+    generateCrates(crateMatrices);
+    InstanceBuffer crates(crateMatrices.data(), static_cast<unsigned int>(crateMatrices.size()));
+    crates.BindAttributes();
+
+    glGenVertexArrays(1, &LightVAO);
+    glBindVertexArray(LightVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    //光源方块每帧移动
+    vector<ClusterLight> lights;
+    vector<LightMotion> motions;
+    generateLights(lights, motions);
+    vector<glm::mat4> markers(MAX_LIGHTS);
+    vector<glm::vec4> markerColors(MAX_LIGHTS);
+    InstanceBuffer lightMarkers(markers.data(), MAX_LIGHTS, markerColors.data(), GL_STREAM_DRAW);
+    lightMarkers.BindAttributes();
+    glBindVertexArray(0);
+
+    unsigned int diffuseMap = loadTexture("./static/texture/container2.png");
+    unsigned int specularMap = loadTexture("./static/texture/container2_specular.png");
+
+    objectShader.use();
+    objectShader.setInt("material.diffuse", 0);
+    objectShader.setInt("material.specular", 1);
+
+    ClusteredLights clusters;
+    clusters.Init();
+    //当前使用的光源，每帧从lights中复制前activeLights个
+    vector<ClusterLight> frameLights;
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    double assignMs = 0.0;
+    unsigned int visibleLights = 0;
+    unsigned int maxPerCluster = 0;
+    unsigned long long indexCount = 0;
+    while (!glfwWindowShouldClose(window)){
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        //显示平均帧时间与分簇统计
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame - " + to_string(activeLights) + " lights, "
+                + to_string(visibleLights / frameCount) + " visible, " + to_string(indexCount / frameCount) + " indices, max "
+                + to_string(maxPerCluster) + " per cluster, assign " + to_string(assignMs / frameCount) + " ms";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+            assignMs = 0.0;
+            visibleLights = maxPerCluster = 0;
+            indexCount = 0;
+        }
+
+        processInput(window);
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+
+        //移动光源并分配到簇中
+        updateLights(lights, motions, currentFrame, markers, markerColors);
+        frameLights.assign(lights.begin(), lights.begin() + activeLights);
+        clusters.SetProjection(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE, SCR_WIDTH, SCR_HEIGHT);
+        clusters.Update(frameLights, view);
+        lightMarkers.Update(markers.data(), activeLights, markerColors.data());
+        assignMs += clusters.stats.assignMs;
+        visibleLights += clusters.stats.visibleLights;
+        indexCount += clusters.stats.indices;
+        maxPerCluster = max(maxPerCluster, clusters.stats.maxPerCluster);
+
+        glClearColor(0.02f, 0.02f, 0.02f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        
+        objectShader.use();
+        objectShader.setFloat("material.shininess", 32.0f);
+        objectShader.setVec3("viewPos", camera.Position);
+        objectShader.setBool("showHeatmap", showHeatmap);
+
+        //很暗的定向光，场景主要由点光源与聚光灯照亮
+        objectShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+        objectShader.setVec3("dirLight.ambient", 0.02f, 0.02f, 0.02f);
+        objectShader.setVec3("dirLight.diffuse", 0.05f, 0.05f, 0.05f);
+        objectShader.setVec3("dirLight.specular", 0.1f, 0.1f, 0.1f);
+
+        objectShader.setMat4("view", view);
+        objectShader.setMat4("projection", projection);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, diffuseMap);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, specularMap);
+        //分簇数据使用纹理单元2~4
+        clusters.Bind(objectShader, 2);
+
+        glBindVertexArray(ObjectVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, crates.count);
+
+        //渲染光源方块
+        lightShader.use();
+        lightShader.setMat4("projection", projection);
+        lightShader.setMat4("view", view);
+        glBindVertexArray(LightVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, activeLights);
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+    glDeleteVertexArrays(1, &ObjectVAO);
+    glDeleteVertexArrays(1, &LightVAO);
+    glDeleteBuffers(1, &VBO);
+    crates.Release();
+    lightMarkers.Release();
+    clusters.Release();
+    
+    glfwTerminate();
+
+    return 0;
+}
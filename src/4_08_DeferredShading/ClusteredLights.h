@@ -0,0 +1,312 @@
+#ifndef CLUSTEREDLIGHTS_H
+#define CLUSTEREDLIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "CustomShader.h"
+using namespace std;
+
+//簇的划分：屏幕上CLUSTER_X*CLUSTER_Y个分块，深度方向CLUSTER_Z个按指数划分的切片
+#define CLUSTER_X 16
+#define CLUSTER_Y 12
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+//每个光源在缓冲纹理中占用的texel数量
+#define LIGHT_TEXELS 4
+//衰减小于该值时认为光源已经没有贡献，用来推导光源半径
+#define LIGHT_CUTOFF (5.0f / 256.0f)
+
+enum LightType {
+    LIGHT_POINT = 0,
+    LIGHT_SPOT = 1
+};
+
+//CPU端的光源描述，点光源与聚光灯共用
+struct ClusterLight {
+    glm::vec3 position;
+    glm::vec3 color;//漫反射与镜面光颜色
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);//聚光灯方向
+    float constant = 1.0f;
+    float linear = 0.09f;
+    float quadratic = 0.032f;
+    float cutOff = 1.0f;//聚光灯内切光角的余弦
+    float outerCutOff = 1.0f;//聚光灯外切光角的余弦
+    LightType type = LIGHT_POINT;
+};
+
+//由常数项、一次项、二次项衰减求光源的影响半径：
+//亮度最大的分量乘以衰减等于LIGHT_CUTOFF时的距离，即解 q*d^2 + l*d + (c - Imax/cutoff) = 0
+inline float ComputeLightRadius(const ClusterLight &light){
+    float maxIntensity = max(light.color.r, max(light.color.g, light.color.b));
+    float c = light.constant - maxIntensity / LIGHT_CUTOFF;
+    if(c >= 0.0f)
+        return 0.0f;
+    if(light.quadratic <= 0.0f)
+        return light.linear > 0.0f ? -c / light.linear : 1e30f;
+    return (-light.linear + sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+}
+
+//分簇统计
+struct ClusterStats {
+    unsigned int lights = 0;//参与分配的光源
+    unsigned int visibleLights = 0;//至少落入一个簇的光源
+    unsigned int indices = 0;//光源索引总数
+    unsigned int maxPerCluster = 0;//单个簇中最多的光源数量
+    double assignMs = 0.0;//CPU分配耗时
+};
+
+//分簇前向渲染
+//CPU每帧把光源的包围球分配到视图空间中的簇（froxel），结果与光源数据一起写入缓冲纹理，
+//片段着色器根据gl_FragCoord与视图空间深度找到自己的簇，只遍历这个簇中的光源
+//数据布局：
+//  clusterTexture（RG32UI）：每个簇一个texel，x为索引偏移，y为光源数量
+//  indexTexture（R16UI）：所有簇的光源索引依次排列
+//  lightTexture（RGBA32F）：每个光源LIGHT_TEXELS个texel，见writeLight
+class ClusteredLights {
+public:
+    ClusterStats stats;
+
+    //生成缓冲与缓冲纹理，投影参数变化时需要调用SetProjection
+    void Init(){
+        glGenBuffers(1, &clusterBuffer);
+        glGenBuffers(1, &indexBuffer);
+        glGenBuffers(1, &lightBuffer);
+        glGenTextures(1, &clusterTexture);
+        glGenTextures(1, &indexTexture);
+        glGenTextures(1, &lightTexture);
+        //先分配一次，保证缓冲纹理在第一次上传之前也有存储
+        glBindBuffer(GL_TEXTURE_BUFFER, clusterBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, CLUSTER_COUNT * 2 * sizeof(unsigned int), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(unsigned short), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, LIGHT_TEXELS * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        attachTexture(clusterTexture, GL_RG32UI, clusterBuffer);
+        attachTexture(indexTexture, GL_R16UI, indexBuffer);
+        attachTexture(lightTexture, GL_RGBA32F, lightBuffer);
+        offsets.resize(CLUSTER_COUNT * 2);
+        counts.resize(CLUSTER_COUNT);
+    }
+
+    //根据投影参数计算每个簇在视图空间中的包围盒
+    void SetProjection(float fovY, float aspect, float nearPlane, float farPlane, unsigned int width, unsigned int height){
+        if(fovY == this->fovY && aspect == this->aspect && nearPlane == this->nearPlane && farPlane == this->farPlane
+            && width == this->width && height == this->height)
+            return;
+        this->fovY = fovY;
+        this->aspect = aspect;
+        this->nearPlane = nearPlane;
+        this->farPlane = farPlane;
+        this->width = width;
+        this->height = height;
+        float tanY = tan(fovY * 0.5f);
+        float tanX = tanY * aspect;
+        sliceDepths.resize(CLUSTER_Z + 1);
+        for(int z = 0; z <= CLUSTER_Z; z++)
+            sliceDepths[z] = nearPlane * pow(farPlane / nearPlane, (float)z / CLUSTER_Z);
+        clusterMin.resize(CLUSTER_COUNT);
+        clusterMax.resize(CLUSTER_COUNT);
+        for(int z = 0; z < CLUSTER_Z; z++){
+            float sliceNear = sliceDepths[z];
+            float sliceFar = sliceDepths[z + 1];
+            for(int y = 0; y < CLUSTER_Y; y++){
+                for(int x = 0; x < CLUSTER_X; x++){
+                    //分块在NDC中的范围，乘以深度得到视图空间的坐标
+                    float ndcX0 = 2.0f * x / CLUSTER_X - 1.0f, ndcX1 = 2.0f * (x + 1) / CLUSTER_X - 1.0f;
+                    float ndcY0 = 2.0f * y / CLUSTER_Y - 1.0f, ndcY1 = 2.0f * (y + 1) / CLUSTER_Y - 1.0f;
+                    glm::vec3 minCorner(1e30f), maxCorner(-1e30f);
+                    float depths[2] = {sliceNear, sliceFar};
+                    for(int d = 0; d < 2; d++){
+                        float ndcXs[2] = {ndcX0, ndcX1}, ndcYs[2] = {ndcY0, ndcY1};
+                        for(int i = 0; i < 4; i++){
+                            glm::vec3 p(ndcXs[i & 1] * tanX * depths[d], ndcYs[i >> 1] * tanY * depths[d], -depths[d]);
+                            minCorner = glm::min(minCorner, p);
+                            maxCorner = glm::max(maxCorner, p);
+                        }
+                    }
+                    unsigned int index = clusterIndex(x, y, z);
+                    clusterMin[index] = minCorner;
+                    clusterMax[index] = maxCorner;
+                }
+            }
+        }
+    }
+
+    //把光源分配到簇中并上传，lights中的位置与方向都在世界空间
+    void Update(const vector<ClusterLight> &lights, const glm::mat4 &view){
+        auto start = chrono::high_resolution_clock::now();
+        stats = ClusterStats();
+        stats.lights = static_cast<unsigned int>(lights.size());
+        float tanY = tan(fovY * 0.5f);
+        float tanX = tanY * aspect;
+        float logRatio = log(farPlane / nearPlane);
+
+        //第一步：收集(簇, 光源)对
+        pairs.clear();
+        lightData.resize(lights.size() * LIGHT_TEXELS);
+        for(unsigned int i = 0; i < lights.size(); i++){
+            float radius = ComputeLightRadius(lights[i]);
+            writeLight(lights[i], radius, &lightData[i * LIGHT_TEXELS]);
+            glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+            float depth = -center.z;
+            if(radius <= 0.0f || depth + radius < nearPlane || depth - radius > farPlane)
+                continue;
+            //深度切片范围
+            int z0 = sliceIndex(max(depth - radius, nearPlane), logRatio);
+            int z1 = sliceIndex(min(depth + radius, farPlane), logRatio);
+            bool touched = false;
+            for(int z = z0; z <= z1; z++){
+                //包围球与切片相交部分的深度范围，以及该范围内最大的截面半径
+                float sliceNear = max(sliceDepths[z], depth - radius);
+                float sliceFar = min(sliceDepths[z + 1], depth + radius);
+                float closest = max(sliceNear, min(depth, sliceFar));
+                float sectionRadius = sqrt(max(radius * radius - (closest - depth) * (closest - depth), 0.0f));
+                //屏幕分块范围：相交部分跨过近平面时无法投影，直接使用整个屏幕
+                int x0 = 0, x1 = CLUSTER_X - 1, y0 = 0, y1 = CLUSTER_Y - 1;
+                if(sliceNear > nearPlane){
+                    float minX, maxX, minY, maxY;
+                    projectRange(center.x, sectionRadius, sliceNear, sliceFar, tanX, minX, maxX);
+                    projectRange(center.y, sectionRadius, sliceNear, sliceFar, tanY, minY, maxY);
+                    if(maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f)
+                        continue;
+                    x0 = tileIndex(minX, CLUSTER_X);
+                    x1 = tileIndex(maxX, CLUSTER_X);
+                    y0 = tileIndex(minY, CLUSTER_Y);
+                    y1 = tileIndex(maxY, CLUSTER_Y);
+                }
+                for(int y = y0; y <= y1; y++){
+                    for(int x = x0; x <= x1; x++){
+                        unsigned int index = clusterIndex(x, y, z);
+                        //包围球与簇包围盒的精确测试
+                        glm::vec3 nearestPoint = glm::clamp(center, clusterMin[index], clusterMax[index]);
+                        glm::vec3 delta = nearestPoint - center;
+                        if(glm::dot(delta, delta) <= radius * radius){
+                            pairs.push_back(make_pair(index, i));
+                            touched = true;
+                        }
+                    }
+                }
+            }
+            if(touched)
+                stats.visibleLights++;
+        }
+
+        //第二步：计数排序，得到每个簇的偏移与数量
+        fill(counts.begin(), counts.end(), 0u);
+        for(unsigned int i = 0; i < pairs.size(); i++)
+            counts[pairs[i].first]++;
+        unsigned int offset = 0;
+        for(unsigned int c = 0; c < CLUSTER_COUNT; c++){
+            offsets[c * 2] = offset;
+            offsets[c * 2 + 1] = 0;
+            offset += counts[c];
+            stats.maxPerCluster = max(stats.maxPerCluster, counts[c]);
+        }
+        indices.resize(max(offset, 1u));
+        for(unsigned int i = 0; i < pairs.size(); i++){
+            unsigned int c = pairs[i].first;
+            indices[offsets[c * 2] + offsets[c * 2 + 1]++] = static_cast<unsigned short>(pairs[i].second);
+        }
+        stats.indices = offset;
+
+        //第三步：上传，每帧重新分配缓冲（孤立）以避免等待GPU读完上一帧的数据
+        upload(clusterBuffer, offsets.size() * sizeof(unsigned int), offsets.data());
+        upload(indexBuffer, indices.size() * sizeof(unsigned short), indices.data());
+        if(!lightData.empty())
+            upload(lightBuffer, lightData.size() * sizeof(glm::vec4), lightData.data());
+        stats.assignMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    }
+
+    //绑定缓冲纹理并设置着色器中的分簇参数，firstUnit起连续使用3个纹理单元
+    void Bind(CustomShader &shader, unsigned int firstUnit){
+        glActiveTexture(GL_TEXTURE0 + firstUnit);
+        glBindTexture(GL_TEXTURE_BUFFER, clusterTexture);
+        glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+        glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+        glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+        glBindTexture(GL_TEXTURE_BUFFER, lightTexture);
+        shader.setInt("clusters", firstUnit);
+        shader.setInt("lightIndices", firstUnit + 1);
+        shader.setInt("lightData", firstUnit + 2);
+        //slice = log(depth) * scale - bias
+        float logRatio = log(farPlane / nearPlane);
+        shader.setFloat("clusterScale", CLUSTER_Z / logRatio);
+        shader.setFloat("clusterBias", CLUSTER_Z * log(nearPlane) / logRatio);
+        shader.setVec2("clusterTileSize", (float)width / CLUSTER_X, (float)height / CLUSTER_Y);
+    }
+
+    void Release(){
+        glDeleteTextures(1, &clusterTexture);
+        glDeleteTextures(1, &indexTexture);
+        glDeleteTextures(1, &lightTexture);
+        glDeleteBuffers(1, &clusterBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+        glDeleteBuffers(1, &lightBuffer);
+    }
+
+private:
+    unsigned int clusterBuffer = 0, indexBuffer = 0, lightBuffer = 0;
+    unsigned int clusterTexture = 0, indexTexture = 0, lightTexture = 0;
+    float fovY = 0.0f, aspect = 0.0f, nearPlane = 0.0f, farPlane = 0.0f;
+    unsigned int width = 0, height = 0;
+    vector<float> sliceDepths;//每个切片的起始深度，按指数划分，每个簇在屏幕上与深度方向的比例大致相同
+    vector<glm::vec3> clusterMin, clusterMax;//视图空间中每个簇的包围盒
+    vector<pair<unsigned int, unsigned int> > pairs;
+    vector<unsigned int> counts;
+    vector<unsigned int> offsets;//每个簇两个uint：偏移与数量
+    vector<unsigned short> indices;
+    vector<glm::vec4> lightData;
+
+    static unsigned int clusterIndex(int x, int y, int z){
+        return (z * CLUSTER_Y + y) * CLUSTER_X + x;
+    }
+
+    int sliceIndex(float depth, float logRatio) const{
+        int k = (int)floor(log(depth / nearPlane) / logRatio * CLUSTER_Z);
+        return max(0, min(CLUSTER_Z - 1, k));
+    }
+
+    //视图空间中[c - r, c + r]在深度[nearDepth, farDepth]之间投影到NDC的范围
+    //x/depth的最小值与最大值分别在最近或最远的深度处取得
+    static void projectRange(float c, float r, float nearDepth, float farDepth, float tanHalf, float &minNdc, float &maxNdc){
+        minNdc = (c - r) / (c - r < 0.0f ? nearDepth : farDepth) / tanHalf;
+        maxNdc = (c + r) / (c + r > 0.0f ? nearDepth : farDepth) / tanHalf;
+    }
+
+    //NDC坐标所在的分块
+    static int tileIndex(float ndc, int count){
+        int i = (int)floor((ndc * 0.5f + 0.5f) * count);
+        return max(0, min(count - 1, i));
+    }
+
+    //光源数据布局，与着色器中的fetchLight一致：
+    //  0: position.xyz, radius
+    //  1: color.rgb, type
+    //  2: direction.xyz, outerCutOff
+    //  3: constant, linear, quadratic, cutOff
+    static void writeLight(const ClusterLight &light, float radius, glm::vec4 *texels){
+        texels[0] = glm::vec4(light.position, radius);
+        texels[1] = glm::vec4(light.color, (float)light.type);
+        texels[2] = glm::vec4(glm::normalize(light.direction), light.outerCutOff);
+        texels[3] = glm::vec4(light.constant, light.linear, light.quadratic, light.cutOff);
+    }
+
+    static void attachTexture(unsigned int texture, GLenum format, unsigned int buffer){
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    static void upload(unsigned int buffer, size_t size, const void *data){
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+};
+#endif
@@ -0,0 +1,90 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <glad/glad.h>
+#include <iostream>
+using namespace std;
+
+//G缓冲（G-buffer），每个像素只有12字节：
+//  albedoSpec（RGBA8）：rgb为漫反射颜色，a为镜面光强度
+//  normalShininess（RGB10_A2）：rg为八面体编码的法线，b为反光度/256
+//  depth（DEPTH24_STENCIL8）：位置不单独储存，光照阶段用深度与投影矩阵的逆重建
+//深度格式与默认帧缓冲一致，几何阶段结束后可以直接把深度复制到默认帧缓冲，供透明物体的前向渲染使用
+class GBuffer {
+public:
+    unsigned int FBO = 0;
+    unsigned int albedoSpec = 0;
+    unsigned int normalShininess = 0;
+    unsigned int depth = 0;
+    unsigned int width = 0, height = 0;
+
+    bool Init(unsigned int width, unsigned int height){
+        this->width = width;
+        this->height = height;
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        albedoSpec = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoSpec, 0);
+        normalShininess = createTexture(GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalShininess, 0);
+        depth = createTexture(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+        //告诉OpenGL片段着色器的两个输出分别写入哪个颜色附件
+        unsigned int attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, attachments);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if(!complete)
+            cout << "ERROR::GBUFFER::FRAMEBUFFER_NOT_COMPLETE" << endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return complete;
+    }
+
+    //几何阶段：绑定G缓冲并清空
+    void BeginGeometryPass(){
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    //光照阶段读取G缓冲，firstUnit起连续使用3个纹理单元
+    void BindTextures(unsigned int firstUnit){
+        glActiveTexture(GL_TEXTURE0 + firstUnit);
+        glBindTexture(GL_TEXTURE_2D, albedoSpec);
+        glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+        glBindTexture(GL_TEXTURE_2D, normalShininess);
+        glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+        glBindTexture(GL_TEXTURE_2D, depth);
+    }
+
+    //把G缓冲的深度复制到目标帧缓冲（0为默认帧缓冲），两者的深度格式必须一致
+    void BlitDepth(unsigned int target){
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+    }
+
+    void Release(){
+        glDeleteTextures(1, &albedoSpec);
+        glDeleteTextures(1, &normalShininess);
+        glDeleteTextures(1, &depth);
+        glDeleteFramebuffers(1, &FBO);
+        FBO = albedoSpec = normalShininess = depth = 0;
+    }
+
+private:
+    //光照阶段按像素读取，不需要过滤
+    unsigned int createTexture(GLenum internalFormat, GLenum format, GLenum type){
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+};
+#endif
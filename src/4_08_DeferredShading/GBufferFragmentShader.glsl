@@ -0,0 +1,35 @@
+#version 330 core
+layout (location = 0) out vec4 gAlbedoSpec;
+layout (location = 1) out vec4 gNormalShininess;
+
+in vec3 Normal;
+in vec2 TexCoords;
+
+struct Material{
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+uniform Material material;
+
+//八面体编码：把单位法线投影到八面体上再展开到[-1,1]^2的正方形，两个分量即可表示任意方向
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return n.xy * 0.5 + 0.5;
+}
+
+void main()
+{
+    gAlbedoSpec.rgb = texture(material.diffuse, TexCoords).rgb;
+    //镜面光贴图是灰度的，只保存强度
+    gAlbedoSpec.a = dot(texture(material.specular, TexCoords).rgb, vec3(1.0 / 3.0));
+    gNormalShininess = vec4(EncodeNormal(normalize(Normal)), material.shininess / 256.0, 0.0);
+}
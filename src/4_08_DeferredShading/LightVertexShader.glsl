@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+//每个光源方块的模型矩阵与颜色
+layout (location = 7) in mat4 aInstanceMatrix;
+layout (location = 11) in vec4 aInstanceData;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 LightColor;
+
+void main()
+{
+	gl_Position = projection * view * aInstanceMatrix * vec4(aPos, 1.0);
+	LightColor = aInstanceData.rgb;
+}
@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+//每个箱子的模型矩阵（实例化数组）
+layout (location = 7) in mat4 aInstanceMatrix;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TexCoords;//纹理坐标
+out float ViewDepth;//视图空间深度，用来确定所在的深度切片
+
+void main()
+{
+    vec4 worldPos = aInstanceMatrix * vec4(aPos, 1.0);
+    vec4 viewPos = view * worldPos;
+    gl_Position = projection * viewPos;
+    Normal = mat3(transpose(inverse(aInstanceMatrix))) * aNormal;
+    FragPos = worldPos.xyz;
+    TexCoords = aTexCoords;
+    ViewDepth = -viewPos.z;
+}
@@ -0,0 +1,231 @@
+#ifndef CASCADEDSHADOWMAP_H
+#define CASCADEDSHADOWMAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <string>
+#include <cmath>
+#include <iostream>
+#include "CustomShader.h"
+#include "Frustum.h"
+using namespace std;
+
+#define CASCADE_COUNT 4
+//缓存的级联按更大的范围渲染，相机在这个余量内移动时不需要重新渲染
+#define CASCADE_CACHE_MARGIN 1.5f
+
+//一个级联的状态，lightSpace等参数是最后一次渲染时的值，着色器始终使用它们采样
+struct Cascade {
+    glm::mat4 lightSpace = glm::mat4(1.0f);
+    float splitFar = 0.0f;//级联覆盖的最远视图深度
+    glm::vec3 center = glm::vec3(0.0f);//渲染时覆盖的包围球
+    float radius = 0.0f;
+    glm::vec3 lightDir = glm::vec3(0.0f);//渲染时的光照方向
+    unsigned int staticVersion = 0;//渲染时静态物体的版本
+    unsigned int lastRendered = 0;//最后一次渲染的帧序号
+    bool valid = false;
+    bool cached = false;//是否为缓存级联：只包含静态投影物体，按需或轮流刷新
+    bool pending = false;//本帧需要渲染
+};
+
+struct ShadowStats {
+    unsigned int refreshed = 0;//本帧渲染的级联数量
+    unsigned int casters = 0;//本帧绘制的投影物体数量
+};
+
+//级联阴影贴图（CSM）
+//视锥体按对数与均匀混合的方式切分为CASCADE_COUNT段，每段用一张正交阴影贴图覆盖（深度纹理数组的一层）
+//  稳定：每段用切片角点的包围球拟合，半径只和投影参数有关；光源空间的原点对齐到纹素网格，相机移动与旋转时阴影边缘不闪烁
+//  剔除：每个级联用自己的正交体剔除投影物体，近平面不参与剔除，靠GL_DEPTH_CLAMP把光源与切片之间的物体压到近平面上
+//  缓存：cacheStart之后的远级联只渲染静态物体，只在覆盖范围不够时立即刷新，光照方向或静态物体变化后每帧最多轮流刷新一个
+//投影物体的剔除与绘制由调用者完成：对NeedsRender的级联调用BeginCascade，用CasterFrustum剔除后绘制
+class CascadedShadowMap {
+public:
+    unsigned int FBO = 0;
+    unsigned int depthArray = 0;
+    unsigned int resolution = 0;
+    Cascade cascades[CASCADE_COUNT];
+    ShadowStats stats;
+    float splitLambda = 0.75f;//1为纯对数划分，0为均匀划分
+    unsigned int cacheStart = 2;//从第几个级联开始缓存
+    bool cachingEnabled = true;
+
+    bool Init(unsigned int resolution){
+        this->resolution = resolution;
+        glGenTextures(1, &depthArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, CASCADE_COUNT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+        //硬件深度比较，配合线性过滤每次采样得到2x2的PCF结果
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if(!complete)
+            cout << "ERROR::SHADOWMAP::FRAMEBUFFER_NOT_COMPLETE" << endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return complete;
+    }
+
+    //每帧调用一次：计算切分与每个级联的光源矩阵，决定哪些级联需要渲染
+    //lightDir为光线传播方向，staticVersion在静态投影物体变化时递增
+    void Update(const glm::mat4 &view, float fovY, float aspect, float nearPlane, float farPlane,
+        const glm::vec3 &lightDir, unsigned int staticVersion){
+        frame++;
+        stats = ShadowStats();
+        glm::mat4 inverseView = glm::inverse(view);
+        float tanY = tan(fovY * 0.5f), tanX = tanY * aspect;
+        float splitNear = nearPlane;
+        bool cachedPending = false;
+        for(int i = 0; i < CASCADE_COUNT; i++){
+            Cascade &cascade = cascades[i];
+            //实用切分方案：对数划分与均匀划分的插值
+            float t = (float)(i + 1) / CASCADE_COUNT;
+            float logSplit = nearPlane * pow(farPlane / nearPlane, t);
+            float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+            float splitFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+            cascade.splitFar = splitFar;
+            cascade.cached = cachingEnabled && i >= (int)cacheStart;
+
+            //切片8个角点的包围球，半径在刚体变换下不变，向上取整以消除浮点误差
+            glm::vec3 corners[8];
+            glm::vec3 center(0.0f);
+            for(int c = 0; c < 8; c++){
+                float depth = (c & 4) ? splitFar : splitNear;
+                glm::vec4 p((c & 1 ? 1.0f : -1.0f) * tanX * depth, (c & 2 ? 1.0f : -1.0f) * tanY * depth, -depth, 1.0f);
+                corners[c] = glm::vec3(inverseView * p);
+                center += corners[c] / 8.0f;
+            }
+            float radius = 0.0f;
+            for(int c = 0; c < 8; c++)
+                radius = max(radius, glm::length(corners[c] - center));
+            radius = ceil(radius * 16.0f) / 16.0f;
+            splitNear = splitFar;
+
+            if(!cascade.cached){
+                cascade.pending = true;
+                fit(cascade, center, radius, lightDir, staticVersion);
+                continue;
+            }
+            //缓存级联的覆盖范围不够时必须立即刷新
+            bool covered = cascade.valid && glm::length(center - cascade.center) + radius <= cascade.radius
+                && cascade.radius <= radius * CASCADE_CACHE_MARGIN * 1.01f;
+            cascade.pending = !covered;
+            if(cascade.pending){
+                fit(cascade, center, radius * CASCADE_CACHE_MARGIN, lightDir, staticVersion);
+                cachedPending = true;
+            }else{
+                //记录当前需要的范围，轮流刷新时使用
+                wantedCenter[i] = center;
+                wantedRadius[i] = radius;
+            }
+        }
+        //没有必须刷新的缓存级联时，从过期的级联中挑最久没有渲染的一个刷新
+        if(!cachedPending){
+            int oldest = -1;
+            for(int i = 0; i < CASCADE_COUNT; i++){
+                const Cascade &cascade = cascades[i];
+                bool stale = cascade.lightDir != lightDir || cascade.staticVersion != staticVersion;
+                if(cascade.cached && !cascade.pending && stale && (oldest < 0 || cascade.lastRendered < cascades[oldest].lastRendered))
+                    oldest = i;
+            }
+            if(oldest >= 0){
+                cascades[oldest].pending = true;
+                fit(cascades[oldest], wantedCenter[oldest], wantedRadius[oldest] * CASCADE_CACHE_MARGIN, lightDir, staticVersion);
+            }
+        }
+    }
+
+    bool NeedsRender(int i) const{
+        return cascades[i].pending;
+    }
+
+    //级联i的投影物体剔除体：正交体去掉近平面
+    Frustum CasterFrustum(int i) const{
+        Frustum frustum = Frustum::FromMatrix(cascades[i].lightSpace);
+        frustum.planes[4] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        return frustum;
+    }
+
+    //开始渲染级联i，绑定深度纹理数组的对应层
+    void BeginCascade(int i){
+        if(stats.refreshed == 0){
+            glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+            glViewport(0, 0, resolution, resolution);
+            glEnable(GL_DEPTH_CLAMP);
+            //按斜率缩放的深度偏移，配合着色器中的法线偏移消除阴影失真（shadow acne）
+            glEnable(GL_POLYGON_OFFSET_FILL);
+            glPolygonOffset(2.0f, 4.0f);
+        }
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, i);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        cascades[i].lastRendered = frame;
+        cascades[i].valid = true;
+        stats.refreshed++;
+    }
+
+    //所有级联渲染结束，恢复默认帧缓冲
+    void EndCascades(unsigned int width, unsigned int height){
+        if(stats.refreshed > 0){
+            glDisable(GL_POLYGON_OFFSET_FILL);
+            glDisable(GL_DEPTH_CLAMP);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, width, height);
+        }
+    }
+
+    //设置着色器中的级联参数并绑定阴影贴图
+    void Bind(CustomShader &shader, unsigned int unit){
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+        shader.setInt("shadowMap", unit);
+        for(int i = 0; i < CASCADE_COUNT; i++){
+            string index = "[" + to_string(i) + "]";
+            shader.setMat4("lightSpaceMatrices" + index, cascades[i].lightSpace);
+            shader.setFloat("cascadeSplits" + index, cascades[i].splitFar);
+            //一个纹素在世界空间中的大小，用于法线偏移
+            shader.setFloat("cascadeTexelSizes" + index, 2.0f * cascades[i].radius / resolution);
+        }
+    }
+
+    void Release(){
+        glDeleteTextures(1, &depthArray);
+        glDeleteFramebuffers(1, &FBO);
+        depthArray = FBO = 0;
+    }
+
+private:
+    unsigned int frame = 0;
+    glm::vec3 wantedCenter[CASCADE_COUNT];
+    float wantedRadius[CASCADE_COUNT] = {};
+
+    //用包围球拟合正交投影，并把光源空间的原点对齐到纹素网格
+    void fit(Cascade &cascade, const glm::vec3 &center, float radius, const glm::vec3 &lightDir, unsigned int staticVersion){
+        glm::vec3 up = fabs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 lightView = glm::lookAt(center - lightDir * radius, center, up);
+        glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius);
+        //世界原点在阴影贴图中的位置取整到纹素，之后整个投影只会按整数个纹素平移
+        glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        origin *= resolution * 0.5f;
+        glm::vec4 offset = (glm::round(origin) - origin) * (2.0f / resolution);
+        lightProjection[3][0] += offset.x;
+        lightProjection[3][1] += offset.y;
+        cascade.lightSpace = lightProjection * lightView;
+        cascade.center = center;
+        cascade.radius = radius;
+        cascade.lightDir = lightDir;
+        cascade.staticVersion = staticVersion;
+    }
+};
+#endif
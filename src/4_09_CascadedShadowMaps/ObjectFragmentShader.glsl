@@ -0,0 +1,93 @@
+#version 330 core
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+in float ViewDepth;
+out vec4 FragColor;
+
+struct Material{
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+//定向光
+struct DirLight{
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+#define CASCADE_COUNT 4
+
+uniform vec3 viewPos;
+uniform Material material;
+uniform DirLight dirLight;//定向光
+
+//级联阴影，参数见CascadedShadowMap.h
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 lightSpaceMatrices[CASCADE_COUNT];
+uniform float cascadeSplits[CASCADE_COUNT];//每个级联覆盖的最远视图深度
+uniform float cascadeTexelSizes[CASCADE_COUNT];//纹素在世界空间中的大小
+uniform bool showCascades;//用颜色区分级联
+
+//计算阴影，返回0为完全在阴影中，1为完全受光
+float ShadowFactor(int cascade, vec3 normal, vec3 lightDir)
+{
+    //沿法线偏移一个多纹素，远级联纹素更大，偏移也随之变大
+    float slope = 1.0 - max(dot(normal, lightDir), 0.0);
+    vec3 offsetPos = FragPos + normal * cascadeTexelSizes[cascade] * (1.0 + 2.0 * slope);
+    vec4 lightSpacePos = lightSpaceMatrices[cascade] * vec4(offsetPos, 1.0);
+    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+    if(projCoords.z > 1.0)
+        return 1.0;
+    //3x3 PCF，每次硬件比较本身已经是2x2的双线性过滤
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++){
+        for(int y = -1; y <= 1; y++)
+            lit += texture(shadowMap, vec4(projCoords.xy + vec2(x, y) * texelSize, float(cascade), projCoords.z));
+    }
+    return lit / 9.0;
+}
+
+//计算定向光分量
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, float shadow){
+    vec3 lightDir = normalize(-light.direction);
+    // 漫反射着色
+    float diff = max(dot(normal, lightDir), 0.0);
+    // 镜面光着色
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // 合并结果，环境光不受阴影影响
+    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
+    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
+    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    return (ambient + shadow * (diffuse + specular));
+}
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPos);
+
+    //按视图深度选择级联
+    int cascade = CASCADE_COUNT - 1;
+    for(int i = 0; i < CASCADE_COUNT; i++){
+        if(ViewDepth < cascadeSplits[i]){
+            cascade = i;
+            break;
+        }
+    }
+    float shadow = ShadowFactor(cascade, norm, normalize(-dirLight.direction));
+    vec3 result = CalcDirLight(dirLight, norm, viewDir, shadow);
+
+    if(showCascades){
+        vec3 colors[CASCADE_COUNT] = vec3[](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+        result *= colors[cascade];
+    }
+
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+//投影物体的模型矩阵（实例化数组）
+layout (location = 7) in mat4 aInstanceMatrix;
+
+uniform mat4 lightSpaceMatrix;
+
+void main()
+{
+    gl_Position = lightSpaceMatrix * aInstanceMatrix * vec4(aPos, 1.0);
+}
@@ -0,0 +1,431 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "InstanceBuffer.h"
+#include "Frustum.h"
+#include "CascadedShadowMap.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_09_CascadedShadowMaps/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 150.0f;
+const unsigned int SHADOW_RESOLUTION = 2048;
+
+CustomCamera camera(glm::vec3(0.0f, 8.0f, 20.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -20.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//箱子铺满GRID_SIZE*GRID_SIZE个格子，它们是静态的投影物体；另有一些绕圈飞行的动态箱子
+const int GRID_SIZE = 64;
+const float CELL_SIZE = 2.0f;
+const unsigned int DYNAMIC_AMOUNT = 64;
+bool showCascades = false;
+bool animateSun = false;
+bool cascadesKeyDown = false;
+bool cacheKeyDown = false;
+bool sunKeyDown = false;
+bool cachingEnabled = true;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //V键用颜色区分级联，B键开关远级联缓存，L键让太阳转动
+    bool key = glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS;
+    if(key && !cascadesKeyDown)
+        showCascades = !showCascades;
+    cascadesKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+    if(key && !cacheKeyDown)
+        cachingEnabled = !cachingEnabled;
+    cacheKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+    if(key && !sunKeyDown)
+        animateSun = !animateSun;
+    sunKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+unsigned int loadTexture(char const * path)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    if (data)
+    {
+        GLenum format;
+        if (nrComponents == 1)
+            format = GL_RED;
+        else if (nrComponents == 3)
+            format = GL_RGB;
+        else if (nrComponents == 4)
+            format = GL_RGBA;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        stbi_image_free(data);
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        stbi_image_free(data);
+    }
+
+    return textureID;
+}
+
+//地面由扁平的箱子铺成，部分格子上再随机堆叠1~3个箱子
+void generateCrates(vector<glm::mat4> &matrices){
+    float half = GRID_SIZE * CELL_SIZE * 0.5f;
+    for(int x = 0; x < GRID_SIZE; x++){
+        for(int z = 0; z < GRID_SIZE; z++){
+            glm::vec3 cell(x * CELL_SIZE - half, 0.0f, z * CELL_SIZE - half);
+            glm::mat4 floor = glm::translate(glm::mat4(1.0f), cell + glm::vec3(0.0f, -0.05f, 0.0f));
+            matrices.push_back(glm::scale(floor, glm::vec3(CELL_SIZE, 0.1f, CELL_SIZE)));
+            if(rand() % 100 < 35){
+                int stack = 1 + rand() % 3;
+                for(int i = 0; i < stack; i++){
+                    glm::mat4 model = glm::translate(glm::mat4(1.0f), cell + glm::vec3(0.0f, 0.5f + i, 0.0f));
+                    matrices.push_back(glm::rotate(model, glm::radians((float)(rand() % 90)), glm::vec3(0.0f, 1.0f, 0.0f)));
+                }
+            }
+        }
+    }
+}
+
+//动态箱子绕圈飞行
+void updateDynamicCrates(float time, vector<glm::mat4> &matrices, vector<AABB> &bounds){
+    matrices.resize(DYNAMIC_AMOUNT);
+    bounds.resize(DYNAMIC_AMOUNT);
+    AABB unit;
+    unit.min = glm::vec3(-0.5f);
+    unit.max = glm::vec3(0.5f);
+    for(unsigned int i = 0; i < DYNAMIC_AMOUNT; i++){
+        float angle = time * 0.3f + (float)i / DYNAMIC_AMOUNT * glm::two_pi<float>();
+        float radius = 6.0f + (i % 8) * 4.0f;
+        glm::vec3 position(cos(angle) * radius, 4.0f + (i % 4) * 1.5f, sin(angle) * radius);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+        model = glm::rotate(model, time + i, glm::vec3(0.3f, 1.0f, 0.5f));
+        matrices[i] = model;
+        bounds[i] = unit.Transform(model);
+    }
+}
+
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glEnable(GL_DEPTH_TEST);
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 10.0f;
+
+    CustomShader objectShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+    CustomShader shadowShader((Path + "ShadowVertexShader.glsl").c_str(), (Path + "ShadowFragmentShader.glsl").c_str());
+
+    float vertices[] = {
+        // positions          // normals           // texture coords
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+        0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+    };
+
+    unsigned int VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    //静态箱子与动态箱子各用一个VAO绘制到屏幕，每个级联再用一个VAO绘制本级联剔除后的投影物体
+    srand(static_cast<unsigned int>(glfwGetTime()));
+    vector<glm::mat4> crateMatrices;
+    generateCrates(crateMatrices);
+    unsigned int crateCount = static_cast<unsigned int>(crateMatrices.size());
+    AABB unitCube;
+    unitCube.min = glm::vec3(-0.5f);
+    unitCube.max = glm::vec3(0.5f);
+    AABBSoA crateBounds;
+    crateBounds.Resize(crateCount);
+    for(unsigned int i = 0; i < crateCount; i++)
+        crateBounds.Set(i, unitCube.Transform(crateMatrices[i]));
+    vector<glm::mat4> dynamicMatrices;
+    vector<AABB> dynamicBounds;
+    updateDynamicCrates(0.0f, dynamicMatrices, dynamicBounds);
+
+    unsigned int sceneVAOs[2];
+    InstanceBuffer crates(crateMatrices.data(), crateCount);
+    InstanceBuffer dynamicCrates(dynamicMatrices.data(), DYNAMIC_AMOUNT, nullptr, GL_STREAM_DRAW);
+    InstanceBuffer *sceneInstances[2] = {&crates, &dynamicCrates};
+    glGenVertexArrays(2, sceneVAOs);
+    for(int i = 0; i < 2; i++){
+        glBindVertexArray(sceneVAOs[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        sceneInstances[i]->BindAttributes();
+    }
+
+    unsigned int shadowVAOs[CASCADE_COUNT];
+    InstanceBuffer cascadeCasters[CASCADE_COUNT];
+    glGenVertexArrays(CASCADE_COUNT, shadowVAOs);
+    for(int i = 0; i < CASCADE_COUNT; i++){
+        cascadeCasters[i] = InstanceBuffer(crateMatrices.data(), crateCount, nullptr, GL_STREAM_DRAW);
+        glBindVertexArray(shadowVAOs[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        cascadeCasters[i].BindAttributes();
+    }
+    glBindVertexArray(0);
+
+    unsigned int diffuseMap = loadTexture("./static/texture/container2.png");
+    unsigned int specularMap = loadTexture("./static/texture/container2_specular.png");
+
+    objectShader.use();
+    objectShader.setInt("material.diffuse", 0);
+    objectShader.setInt("material.specular", 1);
+
+    CascadedShadowMap shadowMap;
+    shadowMap.Init(SHADOW_RESOLUTION);
+    FrustumCuller culler;
+    vector<unsigned int> visible;
+    vector<glm::mat4> casters;
+    //静态箱子不会变化，版本号保持不变
+    unsigned int staticVersion = 1;
+    float sunAngle = 0.6f;
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    unsigned int refreshed = 0;
+    unsigned int casterCount = 0;
+    double shadowCpuMs = 0.0;
+    while (!glfwWindowShouldClose(window)){
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        //显示平均帧时间与阴影统计
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame - cache " + (cachingEnabled ? "on" : "off") + ", "
+                + to_string((float)refreshed / frameCount) + " cascades/frame, " + to_string(casterCount / frameCount)
+                + " casters/frame, cull " + to_string(shadowCpuMs / frameCount) + " ms";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+            refreshed = casterCount = 0;
+            shadowCpuMs = 0.0;
+        }
+
+        processInput(window);
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+        if(animateSun)
+            sunAngle += deltaTime * 0.1f;
+        glm::vec3 lightDir = glm::normalize(glm::vec3(cos(sunAngle), -1.2f, sin(sunAngle)));
+
+        updateDynamicCrates(currentFrame, dynamicMatrices, dynamicBounds);
+        dynamicCrates.Update(dynamicMatrices.data(), DYNAMIC_AMOUNT);
+
+        //阴影阶段：只渲染需要更新的级联，每个级联只绘制落在自己正交体中的投影物体
+        shadowMap.cachingEnabled = cachingEnabled;
+        shadowMap.Update(view, glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE, lightDir, staticVersion);
+        shadowShader.use();
+        for(int i = 0; i < CASCADE_COUNT; i++){
+            if(!shadowMap.NeedsRender(i))
+                continue;
+            auto start = chrono::high_resolution_clock::now();
+            Frustum frustum = shadowMap.CasterFrustum(i);
+            culler.CullAABBs(frustum, crateBounds, visible);
+            casters.resize(visible.size());
+            for(unsigned int k = 0; k < visible.size(); k++)
+                casters[k] = crateMatrices[visible[k]];
+            //缓存级联会保留多帧，动态物体只画进每帧刷新的近级联
+            if(!shadowMap.cascades[i].cached){
+                for(unsigned int k = 0; k < DYNAMIC_AMOUNT; k++){
+                    if(frustum.TestAABB(dynamicBounds[k]))
+                        casters.push_back(dynamicMatrices[k]);
+                }
+            }
+            unsigned int count = static_cast<unsigned int>(casters.size());
+            if(count > 0)
+                cascadeCasters[i].Update(casters.data(), count);
+            shadowCpuMs += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+            shadowMap.BeginCascade(i);
+            shadowShader.setMat4("lightSpaceMatrix", shadowMap.cascades[i].lightSpace);
+            glBindVertexArray(shadowVAOs[i]);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, count);
+            shadowMap.stats.casters += count;
+        }
+        shadowMap.EndCascades(SCR_WIDTH, SCR_HEIGHT);
+        refreshed += shadowMap.stats.refreshed;
+        casterCount += shadowMap.stats.casters;
+
+        glClearColor(0.55f, 0.65f, 0.8f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        
+        objectShader.use();
+        objectShader.setFloat("material.shininess", 32.0f);
+        objectShader.setVec3("viewPos", camera.Position);
+        objectShader.setBool("showCascades", showCascades);
+        objectShader.setVec3("dirLight.direction", lightDir);
+        objectShader.setVec3("dirLight.ambient", 0.2f, 0.2f, 0.2f);
+        objectShader.setVec3("dirLight.diffuse", 0.8f, 0.8f, 0.75f);
+        objectShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
+        objectShader.setMat4("view", view);
+        objectShader.setMat4("projection", projection);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, diffuseMap);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, specularMap);
+        shadowMap.Bind(objectShader, 2);
+
+        glBindVertexArray(sceneVAOs[0]);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, crateCount);
+        glBindVertexArray(sceneVAOs[1]);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, DYNAMIC_AMOUNT);
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+    glDeleteVertexArrays(2, sceneVAOs);
+    glDeleteVertexArrays(CASCADE_COUNT, shadowVAOs);
+    glDeleteBuffers(1, &VBO);
+    crates.Release();
+    dynamicCrates.Release();
+    for(int i = 0; i < CASCADE_COUNT; i++)
+        cascadeCasters[i].Release();
+    shadowMap.Release();
+    
+    glfwTerminate();
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+#ifndef INSTANCEBUFFER_H
+#define INSTANCEBUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+using namespace std;
+
+//实例化数组使用的顶点属性位置，0~6已被Mesh的顶点属性占用
+//mat4需要占用4个连续的属性位置（7、8、9、10）
+#define INSTANCE_MATRIX_LOCATION 7
+#define INSTANCE_DATA_LOCATION 11
+
+//实例缓冲：连续存放每个实例的模型矩阵，以及可选的每实例数据（vec4，例如颜色或自定义参数）
+//同一个InstanceBuffer可以绑定到多个Mesh上，一次glDrawElementsInstanced绘制全部实例
+class InstanceBuffer {
+public:
+    unsigned int matrixVBO = 0;//模型矩阵缓冲
+    unsigned int dataVBO = 0;//每实例数据缓冲，没有数据时为0
+    unsigned int count = 0;//实例数量
+
+    InstanceBuffer(){}
+    //usage为GL_STATIC_DRAW时适合静态场景，每帧更新的实例应使用GL_DYNAMIC_DRAW或GL_STREAM_DRAW
+    InstanceBuffer(const glm::mat4 *matrices, unsigned int count, const glm::vec4 *data = nullptr, GLenum usage = GL_STATIC_DRAW){
+        this->usage = usage;
+        glGenBuffers(1, &matrixVBO);
+        if(data != nullptr)
+            glGenBuffers(1, &dataVBO);
+        Update(matrices, count, data);
+    }
+
+    bool HasData() const{
+        return dataVBO != 0;
+    }
+
+    //重新上传实例数据，数量变大时重新分配缓冲，否则只更新子区域
+    void Update(const glm::mat4 *matrices, unsigned int count, const glm::vec4 *data = nullptr){
+        bool grow = count > capacity;
+        glBindBuffer(GL_ARRAY_BUFFER, matrixVBO);
+        if(grow)
+            glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::mat4), matrices, usage);
+        else
+            glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), matrices);
+        if(dataVBO != 0){
+            glBindBuffer(GL_ARRAY_BUFFER, dataVBO);
+            if(grow)
+                glBufferData(GL_ARRAY_BUFFER, count * sizeof(glm::vec4), data, usage);
+            else if(data != nullptr)
+                glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec4), data);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if(grow)
+            capacity = count;
+        this->count = count;
+    }
+
+    //把实例属性绑定到当前绑定的VAO上，调用前需要先glBindVertexArray
+    void BindAttributes() const{
+        BindInstanceAttributes(matrixVBO, 0, dataVBO, 0);
+    }
+
+    //实例属性的来源可以是任意缓冲中的任意位置，例如每帧写入的环形缓冲
+    //dataBuffer为0时不绑定每实例数据
+    static void BindInstanceAttributes(unsigned int matrixBuffer, GLintptr matrixOffset, unsigned int dataBuffer, GLintptr dataOffset){
+        glBindBuffer(GL_ARRAY_BUFFER, matrixBuffer);
+        //顶点属性最大只能是vec4，所以mat4拆成4个vec4
+        for(unsigned int i = 0; i < 4; i++){
+            glEnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + i);
+            glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(matrixOffset + i * sizeof(glm::vec4)));
+            //属性除数为1：每绘制一个实例才更新一次属性
+            glVertexAttribDivisor(INSTANCE_MATRIX_LOCATION + i, 1);
+        }
+        if(dataBuffer != 0){
+            glBindBuffer(GL_ARRAY_BUFFER, dataBuffer);
+            glEnableVertexAttribArray(INSTANCE_DATA_LOCATION);
+            glVertexAttribPointer(INSTANCE_DATA_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)dataOffset);
+            glVertexAttribDivisor(INSTANCE_DATA_LOCATION, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void Release(){
+        glDeleteBuffers(1, &matrixVBO);
+        if(dataVBO != 0)
+            glDeleteBuffers(1, &dataVBO);
+        matrixVBO = dataVBO = 0;
+        count = capacity = 0;
+    }
+
+private:
+    unsigned int capacity = 0;
+    GLenum usage = GL_STATIC_DRAW;
+};
+#endif
@@ -0,0 +1,397 @@
+#ifndef LOCALSHADOWS_H
+#define LOCALSHADOWS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "CustomShader.h"
+#include "Bounds.h"
+#include "Frustum.h"
+#include "ShadowAtlas.h"
+using namespace std;
+
+//每个光源与每个阴影分块在缓冲纹理中占用的texel数量
+#define LIGHT_TEXELS 5
+#define SLOT_TEXELS 5
+//衰减小于该值时认为光源已经没有贡献，用来推导光源半径
+#define LIGHT_CUTOFF (5.0f / 256.0f)
+//光源投影的近平面
+#define SHADOW_NEAR 0.05f
+//分块需要缩小时，要连续多少帧都要求更小的分块才真正缩小，避免在两个等级之间来回切换
+#define SHADOW_SHRINK_FRAMES 30
+
+enum LightType {
+    LIGHT_POINT = 0,
+    LIGHT_SPOT = 1
+};
+
+//CPU端的光源描述，点光源与聚光灯共用
+struct LocalLight {
+    glm::vec3 position;
+    glm::vec3 color;//漫反射与镜面光颜色
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);//聚光灯方向
+    float constant = 1.0f;
+    float linear = 0.09f;
+    float quadratic = 0.032f;
+    float cutOff = 1.0f;//聚光灯内切光角的余弦
+    float outerCutOff = 1.0f;//聚光灯外切光角的余弦
+    LightType type = LIGHT_POINT;
+    bool castShadows = true;
+};
+
+//由常数项、一次项、二次项衰减求光源的影响半径：
+//亮度最大的分量乘以衰减等于LIGHT_CUTOFF时的距离，即解 q*d^2 + l*d + (c - Imax/cutoff) = 0
+inline float ComputeLightRadius(const LocalLight &light){
+    float maxIntensity = max(light.color.r, max(light.color.g, light.color.b));
+    float c = light.constant - maxIntensity / LIGHT_CUTOFF;
+    if(c >= 0.0f)
+        return 0.0f;
+    if(light.quadratic <= 0.0f)
+        return light.linear > 0.0f ? -c / light.linear : 1e30f;
+    return (-light.linear + sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+}
+
+//光源的一个投影面：聚光灯只有1个，点光源有6个（立方体的6个方向）
+struct ShadowFace {
+    AtlasHandle tile;
+    glm::mat4 viewProjection = glm::mat4(1.0f);//分块当前内容渲染时使用的矩阵
+    glm::vec3 position = glm::vec3(0.0f);//渲染时光源的位置与方向
+    glm::vec3 direction = glm::vec3(0.0f);
+    unsigned int staticVersion = 0;//渲染时静态投影物体的版本号
+    bool dynamicCasters = false;//渲染时是否包含动态物体
+    bool rendered = false;//分块中是否已有这个面的内容
+};
+
+struct LightShadowState {
+    int level = -1;//当前分块等级，-1表示没有分块
+    int shrinkFrames = 0;
+    float importance = 0.0f;
+    bool shadowed = false;//本帧着色时是否使用阴影
+    ShadowFace faces[6];
+};
+
+//本帧需要渲染的一个分块
+struct ShadowJob {
+    unsigned int light;
+    int face;
+    AtlasHandle tile;
+    glm::mat4 viewProjection;
+    bool dynamicCasters;//投影范围内有动态物体
+};
+
+struct LocalShadowStats {
+    unsigned int visibleLights = 0;//与视锥体相交的光源
+    unsigned int shadowedLights = 0;//本帧有阴影的光源
+    unsigned int renderedTiles = 0;//本帧重新渲染的分块
+    unsigned int cachedTiles = 0;//内容直接沿用的分块
+    unsigned int deferredTiles = 0;//因为超出预算推迟到之后帧的分块
+};
+
+//局部光源的阴影：所有聚光灯与点光源共享一张阴影图集
+//每帧按光源在屏幕上的大小决定分块等级（越大越清晰），从图集中分配分块；
+//分块在帧之间保留，只有光源移动、静态投影物体变化、或有动态物体进入投影范围时才重新渲染，
+//每帧重新渲染的分块数量不超过renderBudget，看不见的光源的分块在空间不足时按LRU淘汰
+//数据布局：
+//  lightTexture（RGBA32F）：每个光源LIGHT_TEXELS个texel，见upload
+//  slotTexture（RGBA32F）：每个投影面SLOT_TEXELS个texel，前4个为合并了图集位置的矩阵，最后一个为分块的纹理坐标范围
+class LocalShadows {
+public:
+    ShadowAtlas atlas;
+    vector<ShadowJob> jobs;
+    LocalShadowStats stats;
+    unsigned int renderBudget = 24;
+    bool cachingEnabled = true;
+
+    bool Init(unsigned int atlasSize){
+        glGenBuffers(1, &lightBuffer);
+        glGenBuffers(1, &slotBuffer);
+        glGenTextures(1, &lightTexture);
+        glGenTextures(1, &slotTexture);
+        glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, LIGHT_TEXELS * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, slotBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, SLOT_TEXELS * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        attachTexture(lightTexture, lightBuffer);
+        attachTexture(slotTexture, slotBuffer);
+        return atlas.Init(atlasSize);
+    }
+
+    //决定本帧每个光源的分块并生成需要渲染的分块列表jobs
+    //cameraFrustum用于剔除看不见的光源，projectionScale为投影矩阵的[1][1]（1/tan(fovY/2)）
+    //staticVersion在静态投影物体变化时递增，dynamicBounds为本帧动态投影物体的包围盒
+    void Update(const vector<LocalLight> &lights, const Frustum &cameraFrustum, const glm::vec3 &cameraPos, float projectionScale,
+        unsigned int staticVersion, const vector<AABB> &dynamicBounds, unsigned int frame){
+        atlas.BeginFrame(frame);
+        stats = LocalShadowStats();
+        jobs.clear();
+        states.resize(lights.size());
+        radii.resize(lights.size());
+
+        //只有看得见的光源参与分配，按屏幕上的大小从大到小排序，重要的光源优先获得分块
+        order.clear();
+        for(unsigned int i = 0; i < lights.size(); i++){
+            radii[i] = ComputeLightRadius(lights[i]);
+            LightShadowState &state = states[i];
+            state.shadowed = false;
+            if(!lights[i].castShadows || !cameraFrustum.TestSphere(lights[i].position, radii[i]))
+                continue;
+            float distance = glm::length(lights[i].position - cameraPos);
+            //包围球在屏幕上的半径与屏幕高度一半的比值，光源覆盖整个屏幕时大于1
+            state.importance = distance > radii[i] ? radii[i] * projectionScale / distance : projectionScale;
+            order.push_back(i);
+        }
+        stats.visibleLights = static_cast<unsigned int>(order.size());
+        sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b){
+            return states[a].importance > states[b].importance;
+        });
+
+        //先分配分块，记录每个面是否需要重新渲染
+        candidates.clear();
+        for(unsigned int k = 0; k < order.size(); k++){
+            unsigned int i = order[k];
+            const LocalLight &light = lights[i];
+            LightShadowState &state = states[i];
+            int faceCount = light.type == LIGHT_POINT ? 6 : 1;
+            chooseLevel(state, desiredLevel(state.importance, light.type));
+            //图集放不下时退到更小的分块，最小的分块也放不下时本帧没有阴影
+            bool allocated = allocateFaces(state, faceCount);
+            while(!allocated && state.level < ATLAS_LEVELS - 1){
+                int level = state.level + 1;
+                freeFaces(state);
+                state.level = level;
+                allocated = allocateFaces(state, faceCount);
+            }
+            if(!allocated){
+                freeFaces(state);
+                continue;
+            }
+            state.shadowed = true;
+            for(int f = 0; f < faceCount; f++){
+                ShadowFace &face = state.faces[f];
+                atlas.Touch(face.tile);
+                glm::vec3 direction = faceDirection(light, f);
+                glm::mat4 viewProjection = faceMatrix(light, f, radii[i]);
+                //动态物体在投影范围内时每帧都要重新渲染，离开后还要再渲染一次，把它的影子清除
+                Frustum frustum = Frustum::FromMatrix(viewProjection);
+                bool dynamicCasters = false;
+                for(unsigned int d = 0; d < dynamicBounds.size() && !dynamicCasters; d++)
+                    dynamicCasters = frustum.TestAABB(dynamicBounds[d]);
+                bool dirty = !cachingEnabled || !face.rendered || face.staticVersion != staticVersion
+                    || face.position != light.position || face.direction != direction
+                    || dynamicCasters || face.dynamicCasters;
+                if(!dirty){
+                    stats.cachedTiles++;
+                    continue;
+                }
+                ShadowJob job;
+                job.light = i;
+                job.face = f;
+                job.tile = face.tile;
+                job.viewProjection = viewProjection;
+                job.dynamicCasters = dynamicCasters;
+                candidates.push_back(job);
+            }
+        }
+
+        //预算：先渲染还没有内容的分块（否则光源无法使用阴影），再按重要程度刷新过期的分块
+        hasContent.resize(candidates.size());
+        for(unsigned int k = 0; k < candidates.size(); k++)
+            hasContent[k] = states[candidates[k].light].faces[candidates[k].face].rendered;
+        for(int pass = 0; pass < 2; pass++){
+            for(unsigned int k = 0; k < candidates.size(); k++){
+                const ShadowJob &job = candidates[k];
+                LightShadowState &state = states[job.light];
+                ShadowFace &face = state.faces[job.face];
+                if(hasContent[k] != (pass == 1) || !state.shadowed)
+                    continue;
+                if(jobs.size() >= renderBudget){
+                    stats.deferredTiles++;
+                    //没有内容的面不能使用，整个光源本帧不投射阴影
+                    if(!face.rendered)
+                        state.shadowed = false;
+                    continue;
+                }
+                face.viewProjection = job.viewProjection;
+                face.position = lights[job.light].position;
+                face.direction = faceDirection(lights[job.light], job.face);
+                face.staticVersion = staticVersion;
+                face.dynamicCasters = job.dynamicCasters;
+                face.rendered = true;
+                jobs.push_back(job);
+            }
+        }
+        stats.renderedTiles = static_cast<unsigned int>(jobs.size());
+        for(unsigned int k = 0; k < order.size(); k++){
+            if(states[order[k]].shadowed)
+                stats.shadowedLights++;
+        }
+        upload(lights);
+    }
+
+    //渲染分块时使用的视锥体，用来剔除投影物体
+    static Frustum JobFrustum(const ShadowJob &job){
+        return Frustum::FromMatrix(job.viewProjection);
+    }
+
+    //绑定图集与缓冲纹理，firstUnit起连续使用3个纹理单元
+    void Bind(CustomShader &shader, unsigned int firstUnit){
+        glActiveTexture(GL_TEXTURE0 + firstUnit);
+        glBindTexture(GL_TEXTURE_2D, atlas.depthTexture);
+        glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+        glBindTexture(GL_TEXTURE_BUFFER, lightTexture);
+        glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+        glBindTexture(GL_TEXTURE_BUFFER, slotTexture);
+        shader.setInt("shadowAtlas", firstUnit);
+        shader.setInt("lightData", firstUnit + 1);
+        shader.setInt("shadowSlots", firstUnit + 2);
+        shader.setInt("lightCount", static_cast<int>(states.size()));
+    }
+
+    void Release(){
+        atlas.Release();
+        glDeleteTextures(1, &lightTexture);
+        glDeleteTextures(1, &slotTexture);
+        glDeleteBuffers(1, &lightBuffer);
+        glDeleteBuffers(1, &slotBuffer);
+    }
+
+private:
+    unsigned int lightBuffer = 0, slotBuffer = 0;
+    unsigned int lightTexture = 0, slotTexture = 0;
+    vector<LightShadowState> states;
+    vector<float> radii;
+    vector<unsigned int> order;
+    vector<ShadowJob> candidates;
+    vector<bool> hasContent;
+    vector<glm::vec4> lightData;
+    vector<glm::vec4> slotData;
+
+    //屏幕上越大分块越大；点光源有6个面，每个面再小一级
+    static int desiredLevel(float importance, LightType type){
+        int level = importance > 4.0f ? 0 : importance > 2.0f ? 1 : importance > 1.0f ? 2 : 3;
+        if(type == LIGHT_POINT)
+            level++;
+        return min(level, ATLAS_LEVELS - 1);
+    }
+
+    //变大立即生效，变小需要持续SHADOW_SHRINK_FRAMES帧
+    static void chooseLevel(LightShadowState &state, int desired){
+        if(state.level < 0 || desired < state.level){
+            state.level = desired;
+            state.shrinkFrames = 0;
+        }
+        else if(desired > state.level){
+            if(++state.shrinkFrames >= SHADOW_SHRINK_FRAMES){
+                state.level = desired;
+                state.shrinkFrames = 0;
+            }
+        }
+        else
+            state.shrinkFrames = 0;
+    }
+
+    //等级变化或分块已被淘汰时重新分配，新分配的分块没有内容
+    bool allocateFaces(LightShadowState &state, int faceCount){
+        for(int f = 0; f < faceCount; f++){
+            ShadowFace &face = state.faces[f];
+            if(atlas.IsValid(face.tile) && atlas.Node(face.tile).level == state.level){
+                //先标记使用，避免为同一光源的其他面分配时被淘汰
+                atlas.Touch(face.tile);
+                continue;
+            }
+            atlas.Free(face.tile);
+            face.tile = atlas.Allocate(state.level);
+            face.rendered = false;
+            if(face.tile.node < 0)
+                return false;
+        }
+        return true;
+    }
+
+    void freeFaces(LightShadowState &state){
+        for(int f = 0; f < 6; f++){
+            atlas.Free(state.faces[f].tile);
+            state.faces[f].tile = AtlasHandle();
+            state.faces[f].rendered = false;
+        }
+        state.level = -1;
+    }
+
+    //点光源6个面的朝向依次为+X、-X、+Y、-Y、+Z、-Z，与着色器中选择面的顺序一致
+    static glm::vec3 faceDirection(const LocalLight &light, int face){
+        if(light.type == LIGHT_SPOT)
+            return glm::normalize(light.direction);
+        glm::vec3 direction(0.0f);
+        direction[face / 2] = face % 2 == 0 ? 1.0f : -1.0f;
+        return direction;
+    }
+
+    static glm::mat4 faceMatrix(const LocalLight &light, int face, float radius){
+        glm::vec3 direction = faceDirection(light, face);
+        glm::vec3 up = fabs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 view = glm::lookAt(light.position, light.position + direction, up);
+        return glm::perspective(faceFov(light), 1.0f, SHADOW_NEAR, radius) * view;
+    }
+
+    //点光源每个面90度；聚光灯的视野略大于外切光角，PCF在边缘也有内容可采样
+    static float faceFov(const LocalLight &light){
+        if(light.type == LIGHT_SPOT)
+            return min(2.0f * acos(light.outerCutOff) + glm::radians(4.0f), glm::radians(170.0f));
+        return glm::radians(90.0f);
+    }
+
+    //光源数据布局，与着色器一致：
+    //  0: position.xyz, radius
+    //  1: color.rgb, type
+    //  2: direction.xyz, outerCutOff
+    //  3: constant, linear, quadratic, cutOff
+    //  4: 第一个投影面的序号（没有阴影时为-1）, 单位距离上一个阴影纹素的世界大小, 0, 0
+    void upload(const vector<LocalLight> &lights){
+        lightData.resize(max<size_t>(lights.size(), 1) * LIGHT_TEXELS);
+        slotData.clear();
+        for(unsigned int i = 0; i < lights.size(); i++){
+            const LocalLight &light = lights[i];
+            const LightShadowState &state = states[i];
+            glm::vec4 *texels = &lightData[i * LIGHT_TEXELS];
+            texels[0] = glm::vec4(light.position, radii[i]);
+            texels[1] = glm::vec4(light.color, (float)light.type);
+            texels[2] = glm::vec4(glm::normalize(light.direction), light.outerCutOff);
+            texels[3] = glm::vec4(light.constant, light.linear, light.quadratic, light.cutOff);
+            texels[4] = glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f);
+            if(!state.shadowed)
+                continue;
+            float texelScale = 2.0f * tan(faceFov(light) * 0.5f) / atlas.TileSize(state.level);
+            texels[4] = glm::vec4((float)(slotData.size() / SLOT_TEXELS), texelScale, 0.0f, 0.0f);
+            int faceCount = light.type == LIGHT_POINT ? 6 : 1;
+            for(int f = 0; f < faceCount; f++){
+                const ShadowFace &face = state.faces[f];
+                glm::mat4 m = atlas.TileMatrix(face.tile, face.viewProjection);
+                for(int c = 0; c < 4; c++)
+                    slotData.push_back(m[c]);
+                slotData.push_back(atlas.TileRect(face.tile));
+            }
+        }
+        if(slotData.empty())
+            slotData.resize(SLOT_TEXELS);
+        writeBuffer(lightBuffer, lightData.size() * sizeof(glm::vec4), lightData.data());
+        writeBuffer(slotBuffer, slotData.size() * sizeof(glm::vec4), slotData.data());
+    }
+
+    static void attachTexture(unsigned int texture, unsigned int buffer){
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    static void writeBuffer(unsigned int buffer, size_t size, const void *data){
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+};
+#endif
@@ -0,0 +1,118 @@
+#version 330 core
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+out vec4 FragColor;
+
+struct Material{
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+//光源与阴影数据，布局见LocalShadows.h
+uniform samplerBuffer lightData;//每个光源5个texel
+uniform samplerBuffer shadowSlots;//每个投影面5个texel：合并了图集位置的矩阵与分块范围
+uniform sampler2DShadow shadowAtlas;
+uniform int lightCount;
+
+uniform vec3 viewPos;
+uniform vec3 ambient;
+uniform Material material;
+uniform bool showShadowTiles;//用颜色区分片段使用的分块大小
+
+//计算阴影，返回0为完全在阴影中，1为完全受光
+//shadowInfo.x为光源第一个投影面的序号，点光源按片段相对光源的主轴方向选择6个面之一
+float ShadowFactor(vec4 shadowInfo, vec3 lightPos, vec3 normal, vec3 lightDir, float lightType, out float tileTexels){
+    vec3 fromLight = FragPos - lightPos;
+    int slot = int(shadowInfo.x);
+    if(lightType < 0.5){
+        vec3 a = abs(fromLight);
+        if(a.x >= a.y && a.x >= a.z)
+            slot += fromLight.x >= 0.0 ? 0 : 1;
+        else if(a.y >= a.z)
+            slot += fromLight.y >= 0.0 ? 2 : 3;
+        else
+            slot += fromLight.z >= 0.0 ? 4 : 5;
+    }
+    //沿法线偏移约一个纹素，纹素的世界大小随到光源的距离线性增大
+    float slope = 1.0 - max(dot(normal, lightDir), 0.0);
+    vec3 offsetPos = FragPos + normal * length(fromLight) * shadowInfo.y * (1.0 + 2.0 * slope);
+    mat4 tileMatrix = mat4(texelFetch(shadowSlots, slot * 5), texelFetch(shadowSlots, slot * 5 + 1),
+        texelFetch(shadowSlots, slot * 5 + 2), texelFetch(shadowSlots, slot * 5 + 3));
+    vec4 rect = texelFetch(shadowSlots, slot * 5 + 4);
+    vec4 atlasPos = tileMatrix * vec4(offsetPos, 1.0);
+    vec3 projCoords = atlasPos.xyz / atlasPos.w;
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    tileTexels = (rect.z - rect.x) / texelSize.x;
+    if(atlasPos.w <= 0.0 || projCoords.z > 1.0)
+        return 1.0;
+    //3x3 PCF，采样点限制在分块内部，不会读到图集中相邻的分块
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++){
+        for(int y = -1; y <= 1; y++){
+            vec2 uv = clamp(projCoords.xy + vec2(x, y) * texelSize, rect.xy, rect.zw);
+            lit += texture(shadowAtlas, vec3(uv, projCoords.z));
+        }
+    }
+    return lit / 9.0;
+}
+
+//计算一个点光源或聚光灯的分量
+vec3 CalcLocalLight(int index, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor, inout float tileTexels){
+    vec4 positionRadius = texelFetch(lightData, index * 5);
+    vec3 toLight = positionRadius.xyz - FragPos;
+    float distance = length(toLight);
+    //超出推导出的半径时贡献已可以忽略
+    if(distance > positionRadius.w)
+        return vec3(0.0);
+    vec4 colorType = texelFetch(lightData, index * 5 + 1);
+    vec4 attenuationTerms = texelFetch(lightData, index * 5 + 3);
+    vec3 lightDir = toLight / distance;
+    // 漫反射着色
+    float diff = max(dot(normal, lightDir), 0.0);
+    // 镜面光着色
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // 衰减
+    float attenuation = 1.0 / (attenuationTerms.x + attenuationTerms.y * distance + attenuationTerms.z * (distance * distance));
+    //聚光灯的平滑边缘
+    if(colorType.w > 0.5){
+        vec4 directionCutOff = texelFetch(lightData, index * 5 + 2);
+        float theta = dot(lightDir, -directionCutOff.xyz);
+        float epsilon = attenuationTerms.w - directionCutOff.w;
+        attenuation *= clamp((theta - directionCutOff.w) / epsilon, 0.0, 1.0);
+    }
+    if(attenuation * diff <= 0.0)
+        return vec3(0.0);
+    //没有分到分块的光源不投射阴影
+    vec4 shadowInfo = texelFetch(lightData, index * 5 + 4);
+    if(shadowInfo.x >= 0.0){
+        float texels;
+        attenuation *= ShadowFactor(shadowInfo, positionRadius.xyz, normal, lightDir, colorType.w, texels);
+        tileTexels = max(tileTexels, texels);
+    }
+    return colorType.rgb * (diff * diffuseColor + spec * specularColor) * attenuation;
+}
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 diffuseColor = texture(material.diffuse, TexCoords).rgb;
+    vec3 specularColor = texture(material.specular, TexCoords).rgb;
+
+    vec3 result = ambient * diffuseColor;
+    float tileTexels = 0.0;
+    for(int i = 0; i < lightCount; i++)
+        result += CalcLocalLight(i, norm, viewDir, diffuseColor, specularColor, tileTexels);
+
+    if(showShadowTiles && tileTexels > 0.0){
+        //1024的分块为红色，依次经过黄色、绿色，128的分块为蓝色
+        float t = clamp(log2(1024.0 / tileTexels) / 3.0, 0.0, 1.0);
+        vec3 color = t < 0.5 ? mix(vec3(1.0, 0.2, 0.2), vec3(1.0, 1.0, 0.2), t * 2.0) : mix(vec3(0.2, 1.0, 0.2), vec3(0.2, 0.4, 1.0), t * 2.0 - 1.0);
+        result = mix(result, color * max(dot(result, vec3(0.333)), 0.2), 0.7);
+    }
+
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,291 @@
+#ifndef SHADOWATLAS_H
+#define SHADOWATLAS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+//分块等级：等级0的边长为图集的1/4，每升一级边长减半
+#define ATLAS_LEVELS 4
+
+//图集中的一个节点，四叉树的叶子可以被分配
+struct AtlasNode {
+    int x = 0, y = 0, size = 0;
+    int level = 0;
+    int parent = -1;
+    int children[4] = {-1, -1, -1, -1};
+    bool split = false;
+    bool used = false;
+    unsigned int generation = 0;//每次分配递增，用于判断旧的句柄是否失效
+    unsigned int lastUsed = 0;//最近一次使用的帧序号，用于LRU淘汰
+};
+
+//分配得到的分块句柄，节点被淘汰或重新分配后generation不再匹配
+struct AtlasHandle {
+    int node = -1;
+    unsigned int generation = 0;
+};
+
+struct ShadowAtlasStats {
+    unsigned int allocated = 0;//本帧新分配的分块
+    unsigned int evicted = 0;//本帧因空间不足淘汰的分块
+    unsigned int failed = 0;//本帧分配失败的次数
+};
+
+//阴影图集：一张大的深度纹理，按四叉树划分为不同大小的分块，多个光源的阴影贴图都渲染到各自的分块中
+//分块在帧之间保留，内容是否需要重新渲染由调用者判断；空间不足时淘汰最久没有使用的分块
+class ShadowAtlas {
+public:
+    unsigned int FBO = 0;
+    unsigned int depthTexture = 0;
+    unsigned int size = 0;
+    ShadowAtlasStats stats;
+
+    bool Init(unsigned int size){
+        this->size = size;
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if(!complete)
+            cout << "ERROR::SHADOWATLAS::FRAMEBUFFER_NOT_COMPLETE" << endl;
+        //清空整张图集，未渲染的区域视为没有遮挡
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        //根节点下固定划分为16个等级0的分块
+        nodes.clear();
+        for(int i = 0; i < ATLAS_LEVELS; i++)
+            freeLists[i].clear();
+        int rootSize = size / 4;
+        for(int y = 0; y < 4; y++){
+            for(int x = 0; x < 4; x++){
+                AtlasNode node;
+                node.x = x * rootSize;
+                node.y = y * rootSize;
+                node.size = rootSize;
+                nodes.push_back(node);
+                freeLists[0].push_back(static_cast<int>(nodes.size()) - 1);
+            }
+        }
+        return complete;
+    }
+
+    //每帧开始时调用，frame用于LRU
+    void BeginFrame(unsigned int frame){
+        this->frame = frame;
+        stats = ShadowAtlasStats();
+    }
+
+    unsigned int TileSize(int level) const{
+        return (size / 4) >> level;
+    }
+
+    //分配一个指定等级的分块，空间不足时淘汰本帧没有使用过的、最久未使用的分块
+    AtlasHandle Allocate(int level){
+        while(true){
+            int node = findFree(level);
+            if(node >= 0){
+                AtlasNode &n = nodes[node];
+                n.used = true;
+                n.generation++;
+                n.lastUsed = frame;
+                stats.allocated++;
+                AtlasHandle handle;
+                handle.node = node;
+                handle.generation = n.generation;
+                return handle;
+            }
+            if(!evictLeastRecentlyUsed()){
+                stats.failed++;
+                return AtlasHandle();
+            }
+        }
+    }
+
+    void Free(const AtlasHandle &handle){
+        if(IsValid(handle))
+            release(handle.node);
+    }
+
+    bool IsValid(const AtlasHandle &handle) const{
+        return handle.node >= 0 && nodes[handle.node].used && nodes[handle.node].generation == handle.generation;
+    }
+
+    //标记分块在本帧被使用，避免被淘汰
+    void Touch(const AtlasHandle &handle){
+        if(IsValid(handle))
+            nodes[handle.node].lastUsed = frame;
+    }
+
+    const AtlasNode &Node(const AtlasHandle &handle) const{
+        return nodes[handle.node];
+    }
+
+    //把光源的投影矩阵与分块在图集中的位置合并：
+    //结果乘以世界坐标并透视除法后，xy直接是图集纹理坐标，z是[0,1]的深度
+    glm::mat4 TileMatrix(const AtlasHandle &handle, const glm::mat4 &viewProjection) const{
+        const AtlasNode &n = nodes[handle.node];
+        float scale = (float)n.size / size;
+        glm::mat4 bias(1.0f);
+        bias[0][0] = 0.5f * scale;
+        bias[1][1] = 0.5f * scale;
+        bias[2][2] = 0.5f;
+        bias[3][0] = (float)n.x / size + 0.5f * scale;
+        bias[3][1] = (float)n.y / size + 0.5f * scale;
+        bias[3][2] = 0.5f;
+        return bias * viewProjection;
+    }
+
+    //分块的纹理坐标范围（内缩半个纹素），PCF采样时限制在分块内部
+    glm::vec4 TileRect(const AtlasHandle &handle) const{
+        const AtlasNode &n = nodes[handle.node];
+        float inset = 0.5f / size;
+        return glm::vec4((float)n.x / size + inset, (float)n.y / size + inset,
+            (float)(n.x + n.size) / size - inset, (float)(n.y + n.size) / size - inset);
+    }
+
+    //开始向图集渲染
+    void BeginRender(){
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glEnable(GL_SCISSOR_TEST);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2.0f, 4.0f);
+    }
+
+    //把视口与裁剪矩形设置到分块并清空分块的深度
+    void BeginTile(const AtlasHandle &handle){
+        const AtlasNode &n = nodes[handle.node];
+        glViewport(n.x, n.y, n.size, n.size);
+        glScissor(n.x, n.y, n.size, n.size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void EndRender(unsigned int width, unsigned int height){
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, width, height);
+    }
+
+    //已分配的分块占图集面积的比例
+    float Occupancy() const{
+        double area = 0.0;
+        for(unsigned int i = 0; i < nodes.size(); i++){
+            if(nodes[i].used)
+                area += (double)nodes[i].size * nodes[i].size;
+        }
+        return static_cast<float>(area / ((double)size * size));
+    }
+
+    void Release(){
+        glDeleteTextures(1, &depthTexture);
+        glDeleteFramebuffers(1, &FBO);
+        depthTexture = FBO = 0;
+    }
+
+private:
+    vector<AtlasNode> nodes;
+    vector<int> freeLists[ATLAS_LEVELS];//每个等级空闲的叶子
+    unsigned int frame = 0;
+
+    //找一个空闲的叶子，没有时把更大的空闲分块一分为四
+    int findFree(int level){
+        if(!freeLists[level].empty()){
+            int node = freeLists[level].back();
+            freeLists[level].pop_back();
+            return node;
+        }
+        if(level == 0)
+            return -1;
+        int parent = findFree(level - 1);
+        if(parent < 0)
+            return -1;
+        splitNode(parent);
+        //保留第一个子节点，其余三个进入空闲列表
+        for(int i = 1; i < 4; i++)
+            freeLists[level].push_back(nodes[parent].children[i]);
+        return nodes[parent].children[0];
+    }
+
+    void splitNode(int index){
+        if(nodes[index].children[0] < 0){
+            //第一次划分时创建子节点，之后重复使用
+            for(int i = 0; i < 4; i++){
+                AtlasNode child;
+                int half = nodes[index].size / 2;
+                child.x = nodes[index].x + (i & 1) * half;
+                child.y = nodes[index].y + (i >> 1) * half;
+                child.size = half;
+                child.level = nodes[index].level + 1;
+                child.parent = index;
+                nodes.push_back(child);
+                nodes[index].children[i] = static_cast<int>(nodes.size()) - 1;
+            }
+        }
+        nodes[index].split = true;
+    }
+
+    //释放叶子，四个兄弟都空闲时合并回父节点
+    void release(int index){
+        nodes[index].used = false;
+        nodes[index].generation++;
+        int parent = nodes[index].parent;
+        if(parent >= 0){
+            bool allFree = true;
+            for(int i = 0; i < 4; i++){
+                const AtlasNode &sibling = nodes[nodes[parent].children[i]];
+                if(sibling.used || sibling.split)
+                    allFree = false;
+            }
+            if(allFree){
+                //兄弟节点从空闲列表中移除，父节点作为整体释放
+                vector<int> &list = freeLists[nodes[index].level];
+                for(int i = 0; i < 4; i++){
+                    int child = nodes[parent].children[i];
+                    for(unsigned int k = 0; k < list.size(); k++){
+                        if(list[k] == child){
+                            list[k] = list.back();
+                            list.pop_back();
+                            break;
+                        }
+                    }
+                }
+                nodes[parent].split = false;
+                release(parent);
+                return;
+            }
+        }
+        freeLists[nodes[index].level].push_back(index);
+    }
+
+    //淘汰本帧没有使用过的、最久未使用的分块
+    bool evictLeastRecentlyUsed(){
+        int oldest = -1;
+        for(unsigned int i = 0; i < nodes.size(); i++){
+            const AtlasNode &n = nodes[i];
+            if(n.used && n.lastUsed != frame && (oldest < 0 || n.lastUsed < nodes[oldest].lastUsed))
+                oldest = i;
+        }
+        if(oldest < 0)
+            return false;
+        release(oldest);
+        stats.evicted++;
+        return true;
+    }
+};
+#endif
@@ -0,0 +1,534 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "InstanceBuffer.h"
+#include "Frustum.h"
+#include "LocalShadows.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_10_ShadowAtlas/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+const unsigned int ATLAS_SIZE = 4096;
+
+CustomCamera camera(glm::vec3(0.0f, 6.0f, 24.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -15.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//箱子铺满GRID_SIZE*GRID_SIZE个格子，它们是静态的投影物体；另有一些绕圈飞行的动态箱子
+//聚光灯挂在格子上方，点光源贴近地面，每种光源中有一部分会移动
+const int GRID_SIZE = 32;
+const float CELL_SIZE = 2.0f;
+const unsigned int DYNAMIC_AMOUNT = 24;
+const unsigned int SPOT_AMOUNT = 48;
+const unsigned int POINT_AMOUNT = 16;
+bool showShadowTiles = false;
+bool animateLights = true;
+bool cachingEnabled = true;
+bool tilesKeyDown = false;
+bool cacheKeyDown = false;
+bool pauseKeyDown = false;
+
+//光源的运动参数，speed为0的光源是静态的
+struct LightMotion {
+    glm::vec3 center;
+    float radius;
+    float speed;
+    float phase;
+};
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //T键用颜色区分分块大小，C键开关分块缓存，P键暂停光源运动
+    bool key = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+    if(key && !tilesKeyDown)
+        showShadowTiles = !showShadowTiles;
+    tilesKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    if(key && !cacheKeyDown)
+        cachingEnabled = !cachingEnabled;
+    cacheKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+    if(key && !pauseKeyDown)
+        animateLights = !animateLights;
+    pauseKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+unsigned int loadTexture(char const * path)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    if (data)
+    {
+        GLenum format;
+        if (nrComponents == 1)
+            format = GL_RED;
+        else if (nrComponents == 3)
+            format = GL_RGB;
+        else if (nrComponents == 4)
+            format = GL_RGBA;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        stbi_image_free(data);
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        stbi_image_free(data);
+    }
+
+    return textureID;
+}
+
+//地面由扁平的箱子铺成，部分格子上再随机堆叠1~3个箱子
+void generateCrates(vector<glm::mat4> &matrices){
+    float half = GRID_SIZE * CELL_SIZE * 0.5f;
+    for(int x = 0; x < GRID_SIZE; x++){
+        for(int z = 0; z < GRID_SIZE; z++){
+            glm::vec3 cell(x * CELL_SIZE - half, 0.0f, z * CELL_SIZE - half);
+            glm::mat4 floor = glm::translate(glm::mat4(1.0f), cell + glm::vec3(0.0f, -0.05f, 0.0f));
+            matrices.push_back(glm::scale(floor, glm::vec3(CELL_SIZE, 0.1f, CELL_SIZE)));
+            if(rand() % 100 < 25){
+                int stack = 1 + rand() % 3;
+                for(int i = 0; i < stack; i++){
+                    glm::mat4 model = glm::translate(glm::mat4(1.0f), cell + glm::vec3(0.0f, 0.5f + i, 0.0f));
+                    matrices.push_back(glm::rotate(model, glm::radians((float)(rand() % 90)), glm::vec3(0.0f, 1.0f, 0.0f)));
+                }
+            }
+        }
+    }
+}
+
+//动态箱子贴近地面绕圈飞行
+void updateDynamicCrates(float time, vector<glm::mat4> &matrices, vector<AABB> &bounds){
+    matrices.resize(DYNAMIC_AMOUNT);
+    bounds.resize(DYNAMIC_AMOUNT);
+    AABB unit;
+    unit.min = glm::vec3(-0.5f);
+    unit.max = glm::vec3(0.5f);
+    for(unsigned int i = 0; i < DYNAMIC_AMOUNT; i++){
+        float angle = time * 0.3f + (float)i / DYNAMIC_AMOUNT * glm::two_pi<float>();
+        float radius = 4.0f + (i % 6) * 4.0f;
+        glm::vec3 position(cos(angle) * radius, 2.5f + (i % 3) * 0.8f, sin(angle) * radius);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+        model = glm::rotate(model, time + i, glm::vec3(0.3f, 1.0f, 0.5f));
+        matrices[i] = model;
+        bounds[i] = unit.Transform(model);
+    }
+}
+
+//聚光灯排成网格挂在高处朝下照射，每4个中有1个来回摆动；点光源一半静止，一半绕圈移动
+//衰减系数取自常用的距离表（13、20），半径由ComputeLightRadius推导
+void generateLights(vector<LocalLight> &lights, vector<LightMotion> &motions){
+    float half = GRID_SIZE * CELL_SIZE * 0.5f;
+    lights.resize(SPOT_AMOUNT + POINT_AMOUNT);
+    motions.resize(SPOT_AMOUNT + POINT_AMOUNT);
+    int columns = 8;
+    for(unsigned int i = 0; i < SPOT_AMOUNT; i++){
+        LocalLight &light = lights[i];
+        light.type = LIGHT_SPOT;
+        light.linear = 0.22f;
+        light.quadratic = 0.20f;
+        light.cutOff = glm::cos(glm::radians(25.0f));
+        light.outerCutOff = glm::cos(glm::radians(35.0f));
+        light.color = glm::vec3(0.6f + (rand() % 40) / 100.0f, 0.6f + (rand() % 40) / 100.0f, 0.6f + (rand() % 40) / 100.0f);
+        LightMotion &motion = motions[i];
+        float spacing = 2.0f * half / columns;
+        motion.center = glm::vec3((i % columns + 0.5f) * spacing - half, 7.0f, (i / columns + 0.5f) * spacing - half * 0.75f);
+        motion.radius = 0.0f;
+        motion.speed = i % 4 == 3 ? 0.5f + (rand() % 100) / 100.0f : 0.0f;
+        motion.phase = (rand() % 628) / 100.0f;
+    }
+    for(unsigned int i = SPOT_AMOUNT; i < SPOT_AMOUNT + POINT_AMOUNT; i++){
+        LocalLight &light = lights[i];
+        light.type = LIGHT_POINT;
+        light.linear = 0.35f;
+        light.quadratic = 0.44f;
+        light.color = glm::vec3(0.4f + (rand() % 60) / 100.0f, 0.4f + (rand() % 60) / 100.0f, 0.4f + (rand() % 60) / 100.0f);
+        LightMotion &motion = motions[i];
+        motion.center = glm::vec3((rand() % 10000) / 10000.0f * 1.6f * half - 0.8f * half, 1.5f + (rand() % 150) / 100.0f,
+            (rand() % 10000) / 10000.0f * 1.6f * half - 0.8f * half);
+        motion.radius = 2.0f + (rand() % 300) / 100.0f;
+        motion.speed = i % 2 == 0 ? 0.3f + (rand() % 70) / 100.0f : 0.0f;
+        motion.phase = (rand() % 628) / 100.0f;
+    }
+}
+
+//移动的点光源绕中心转圈，摆动的聚光灯位置不变、方向来回摆动
+void updateLights(vector<LocalLight> &lights, const vector<LightMotion> &motions, float time,
+    vector<glm::mat4> &markers, vector<glm::vec4> &markerColors){
+    markers.resize(lights.size());
+    markerColors.resize(lights.size());
+    for(unsigned int i = 0; i < lights.size(); i++){
+        const LightMotion &motion = motions[i];
+        float angle = motion.phase + motion.speed * time;
+        if(lights[i].type == LIGHT_SPOT){
+            lights[i].position = motion.center;
+            float swing = motion.speed > 0.0f ? 0.6f * sin(angle) : 0.15f * sin(motion.phase);
+            lights[i].direction = glm::normalize(glm::vec3(swing, -1.0f, 0.15f * cos(motion.phase)));
+        }
+        else
+            lights[i].position = motion.center + glm::vec3(cos(angle), 0.0f, sin(angle)) * motion.radius;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), lights[i].position);
+        markers[i] = glm::scale(model, glm::vec3(0.2f));
+        markerColors[i] = glm::vec4(lights[i].color, 1.0f);
+    }
+}
+
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glEnable(GL_DEPTH_TEST);
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 8.0f;
+
+    CustomShader objectShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+    CustomShader shadowShader((Path + "ShadowVertexShader.glsl").c_str(), (Path + "ShadowFragmentShader.glsl").c_str());
+    CustomShader lightShader((Path + "LightVertexShader.glsl").c_str(), (Path + "LightFragmentShader.glsl").c_str());
+
+    float vertices[] = {
+        // positions          // normals           // texture coords
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+        0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+    };
+
+    unsigned int VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    srand(static_cast<unsigned int>(glfwGetTime()));
+    vector<glm::mat4> crateMatrices;
+    generateCrates(crateMatrices);
+    unsigned int crateCount = static_cast<unsigned int>(crateMatrices.size());
+    AABB unitCube;
+    unitCube.min = glm::vec3(-0.5f);
+    unitCube.max = glm::vec3(0.5f);
+    AABBSoA crateBounds;
+    crateBounds.Resize(crateCount);
+    for(unsigned int i = 0; i < crateCount; i++)
+        crateBounds.Set(i, unitCube.Transform(crateMatrices[i]));
+    vector<glm::mat4> dynamicMatrices;
+    vector<AABB> dynamicBounds;
+    updateDynamicCrates(0.0f, dynamicMatrices, dynamicBounds);
+
+    vector<LocalLight> lights;
+    vector<LightMotion> motions;
+    vector<glm::mat4> markers;
+    vector<glm::vec4> markerColors;
+    generateLights(lights, motions);
+    updateLights(lights, motions, 0.0f, markers, markerColors);
+    unsigned int lightCount = static_cast<unsigned int>(lights.size());
+
+    //静态箱子与动态箱子各用一个VAO绘制到屏幕
+    unsigned int sceneVAOs[2];
+    InstanceBuffer crates(crateMatrices.data(), crateCount);
+    InstanceBuffer dynamicCrates(dynamicMatrices.data(), DYNAMIC_AMOUNT, nullptr, GL_STREAM_DRAW);
+    InstanceBuffer *sceneInstances[2] = {&crates, &dynamicCrates};
+    glGenVertexArrays(2, sceneVAOs);
+    for(int i = 0; i < 2; i++){
+        glBindVertexArray(sceneVAOs[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        sceneInstances[i]->BindAttributes();
+    }
+
+    //所有分块的投影物体依次写入同一个实例缓冲，绘制每个分块前把实例属性指向它的那一段
+    unsigned int shadowVAO;
+    InstanceBuffer casterBuffer(crateMatrices.data(), crateCount, nullptr, GL_STREAM_DRAW);
+    glGenVertexArrays(1, &shadowVAO);
+    glBindVertexArray(shadowVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    unsigned int lightVAO;
+    InstanceBuffer lightMarkers(markers.data(), lightCount, markerColors.data(), GL_STREAM_DRAW);
+    glGenVertexArrays(1, &lightVAO);
+    glBindVertexArray(lightVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    lightMarkers.BindAttributes();
+    glBindVertexArray(0);
+
+    unsigned int diffuseMap = loadTexture("./static/texture/container2.png");
+    unsigned int specularMap = loadTexture("./static/texture/container2_specular.png");
+
+    objectShader.use();
+    objectShader.setInt("material.diffuse", 0);
+    objectShader.setInt("material.specular", 1);
+
+    LocalShadows shadows;
+    shadows.Init(ATLAS_SIZE);
+    FrustumCuller culler;
+    vector<unsigned int> visible;
+    vector<glm::mat4> casters;
+    vector<unsigned int> casterOffsets;
+    //静态箱子不会变化，版本号保持不变
+    unsigned int staticVersion = 1;
+    unsigned int frameIndex = 0;
+    float lightTime = 0.0f;
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    unsigned int renderedTiles = 0, cachedTiles = 0, evictedTiles = 0;
+    unsigned int shadowedLights = 0, visibleLights = 0;
+    double shadowCpuMs = 0.0;
+    while (!glfwWindowShouldClose(window)){
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        //显示平均帧时间与图集统计
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame - cache " + (cachingEnabled ? "on" : "off") + ", "
+                + to_string(shadowedLights / frameCount) + "/" + to_string(visibleLights / frameCount) + " lights shadowed, "
+                + to_string((float)renderedTiles / frameCount) + " tiles rendered, " + to_string((float)cachedTiles / frameCount)
+                + " cached, " + to_string(evictedTiles) + " evicted, atlas " + to_string((int)(shadows.atlas.Occupancy() * 100.0f))
+                + "%, cpu " + to_string(shadowCpuMs / frameCount) + " ms";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+            renderedTiles = cachedTiles = evictedTiles = 0;
+            shadowedLights = visibleLights = 0;
+            shadowCpuMs = 0.0;
+        }
+
+        processInput(window);
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        if(animateLights)
+            lightTime += deltaTime;
+        updateLights(lights, motions, lightTime, markers, markerColors);
+        lightMarkers.Update(markers.data(), lightCount, markerColors.data());
+        updateDynamicCrates(currentFrame, dynamicMatrices, dynamicBounds);
+        dynamicCrates.Update(dynamicMatrices.data(), DYNAMIC_AMOUNT);
+
+        //为看得见的光源分配分块，只有内容过期的分块需要重新渲染
+        auto start = chrono::high_resolution_clock::now();
+        shadows.cachingEnabled = cachingEnabled;
+        shadows.Update(lights, Frustum::FromMatrix(projection * view), camera.Position, projection[1][1], staticVersion, dynamicBounds, ++frameIndex);
+        casters.clear();
+        casterOffsets.clear();
+        for(unsigned int j = 0; j < shadows.jobs.size(); j++){
+            const ShadowJob &job = shadows.jobs[j];
+            Frustum frustum = LocalShadows::JobFrustum(job);
+            casterOffsets.push_back(static_cast<unsigned int>(casters.size()));
+            culler.CullAABBs(frustum, crateBounds, visible);
+            for(unsigned int k = 0; k < visible.size(); k++)
+                casters.push_back(crateMatrices[visible[k]]);
+            if(job.dynamicCasters){
+                for(unsigned int k = 0; k < DYNAMIC_AMOUNT; k++){
+                    if(frustum.TestAABB(dynamicBounds[k]))
+                        casters.push_back(dynamicMatrices[k]);
+                }
+            }
+        }
+        casterOffsets.push_back(static_cast<unsigned int>(casters.size()));
+        if(!casters.empty())
+            casterBuffer.Update(casters.data(), static_cast<unsigned int>(casters.size()));
+        shadowCpuMs += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+        //阴影阶段：每个分块设置自己的视口，清空后绘制投影物体
+        if(!shadows.jobs.empty()){
+            shadows.atlas.BeginRender();
+            shadowShader.use();
+            glBindVertexArray(shadowVAO);
+            for(unsigned int j = 0; j < shadows.jobs.size(); j++){
+                unsigned int count = casterOffsets[j + 1] - casterOffsets[j];
+                shadows.atlas.BeginTile(shadows.jobs[j].tile);
+                if(count == 0)
+                    continue;
+                InstanceBuffer::BindInstanceAttributes(casterBuffer.matrixVBO, casterOffsets[j] * sizeof(glm::mat4), 0, 0);
+                shadowShader.setMat4("lightSpaceMatrix", shadows.jobs[j].viewProjection);
+                glDrawArraysInstanced(GL_TRIANGLES, 0, 36, count);
+            }
+            shadows.atlas.EndRender(SCR_WIDTH, SCR_HEIGHT);
+        }
+        renderedTiles += shadows.stats.renderedTiles;
+        cachedTiles += shadows.stats.cachedTiles;
+        evictedTiles += shadows.atlas.stats.evicted;
+        shadowedLights += shadows.stats.shadowedLights;
+        visibleLights += shadows.stats.visibleLights;
+
+        glClearColor(0.05f, 0.05f, 0.08f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        objectShader.use();
+        objectShader.setFloat("material.shininess", 32.0f);
+        objectShader.setVec3("viewPos", camera.Position);
+        objectShader.setVec3("ambient", 0.04f, 0.04f, 0.05f);
+        objectShader.setBool("showShadowTiles", showShadowTiles);
+        objectShader.setMat4("view", view);
+        objectShader.setMat4("projection", projection);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, diffuseMap);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, specularMap);
+        shadows.Bind(objectShader, 2);
+
+        glBindVertexArray(sceneVAOs[0]);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, crateCount);
+        glBindVertexArray(sceneVAOs[1]);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, DYNAMIC_AMOUNT);
+
+        lightShader.use();
+        lightShader.setMat4("projection", projection);
+        lightShader.setMat4("view", view);
+        glBindVertexArray(lightVAO);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, lightCount);
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+    glDeleteVertexArrays(2, sceneVAOs);
+    glDeleteVertexArrays(1, &shadowVAO);
+    glDeleteVertexArrays(1, &lightVAO);
+    glDeleteBuffers(1, &VBO);
+    crates.Release();
+    dynamicCrates.Release();
+    casterBuffer.Release();
+    lightMarkers.Release();
+    shadows.Release();
+
+    glfwTerminate();
+
+    return 0;
+}
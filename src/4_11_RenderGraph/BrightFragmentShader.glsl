@@ -0,0 +1,15 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D hdrBuffer;
+uniform float threshold;//亮度超过阈值的部分才会泛光
+
+void main()
+{
+    vec3 color = texture(hdrBuffer, TexCoords).rgb;
+    float brightness = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    //平滑地保留超出阈值的部分，避免在阈值附近出现硬边
+    float weight = max(brightness - threshold, 0.0) / max(brightness, 0.0001);
+    FragColor = vec4(color * weight, 1.0);
+}
@@ -0,0 +1,472 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <glad/glad.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include <map>
+#include <algorithm>
+#include <iostream>
+using namespace std;
+
+//物理纹理在池中连续多少帧没有被使用就释放
+#define RG_POOL_KEEP_FRAMES 60
+
+//渲染目标的描述，描述完全相同的两个资源才可以共用同一张纹理
+struct TextureDesc {
+    unsigned int width = 0, height = 0;
+    GLenum internalFormat = GL_RGBA8;
+    GLenum format = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+
+    TextureDesc(){}
+    TextureDesc(unsigned int width, unsigned int height, GLenum internalFormat, GLenum format, GLenum type)
+        : width(width), height(height), internalFormat(internalFormat), format(format), type(type){}
+
+    bool operator==(const TextureDesc &other) const{
+        return width == other.width && height == other.height && internalFormat == other.internalFormat
+            && format == other.format && type == other.type;
+    }
+
+    bool IsDepth() const{
+        return format == GL_DEPTH_COMPONENT || format == GL_DEPTH_STENCIL;
+    }
+
+    //估算的显存占用，只用于统计
+    size_t Bytes() const{
+        size_t texel = 4;
+        switch(internalFormat){
+            case GL_R8: texel = 1; break;
+            case GL_RG8: case GL_R16F: texel = 2; break;
+            case GL_RGBA16F: texel = 8; break;
+            case GL_RGBA32F: texel = 16; break;
+            case GL_DEPTH_COMPONENT24: case GL_DEPTH24_STENCIL8: texel = 4; break;
+            default: texel = 4; break;
+        }
+        return (size_t)width * height * texel;
+    }
+};
+
+//图中资源的句柄，-1表示无效
+typedef int RGResource;
+
+struct RenderGraphStats {
+    unsigned int passes = 0;//声明的pass
+    unsigned int culledPasses = 0;//输出没有被使用而被剔除的pass
+    unsigned int transientResources = 0;//本帧实际使用的临时资源
+    unsigned int textures = 0;//这些资源实际占用的物理纹理
+    size_t requestedBytes = 0;//每个临时资源各用一张纹理时的显存
+    size_t allocatedBytes = 0;//本帧实际使用的物理纹理的显存
+    size_t poolBytes = 0;//纹理池中全部纹理的显存（包括本帧没有使用的）
+};
+
+class RenderGraph;
+
+//pass声明阶段使用：声明本pass读取与写入的资源
+class RenderPassBuilder {
+public:
+    RenderPassBuilder(RenderGraph *graph, unsigned int pass) : graph(graph), pass(pass){}
+
+    //作为纹理读取
+    RGResource Read(RGResource resource);
+    //作为附件写入，深度格式自动作为深度附件；clear为true时在执行前清空
+    RGResource Write(RGResource resource, bool clear = false);
+    //即使输出没有被任何pass读取也必须执行（例如只修改了GL状态或读回数据的pass）
+    void SideEffect();
+
+private:
+    RenderGraph *graph;
+    unsigned int pass;
+};
+
+//pass执行阶段使用：查询读取的资源对应的纹理
+class RenderPassContext {
+public:
+    RenderPassContext(const RenderGraph *graph, unsigned int width, unsigned int height) : width(width), height(height), graph(graph){}
+    unsigned int Texture(RGResource resource) const;
+    unsigned int width, height;//本pass附件的尺寸，没有附件时为0
+
+private:
+    const RenderGraph *graph;
+};
+
+//渲染图：每帧先创建资源、声明所有pass以及它们读写的资源，Compile时
+//  1. 从有副作用的pass与导入资源（例如默认帧缓冲）出发，反向剔除输出没有被使用的pass
+//  2. 按声明顺序排列剩下的pass，计算每个临时资源第一次与最后一次被使用的pass
+//  3. 从纹理池中为临时资源分配纹理：生命周期不重叠、描述相同的资源共用同一张纹理
+//OpenGL 3.3不能让不同格式的纹理共享同一块显存，所以这里的"别名"是描述相同的资源复用同一个纹理对象；
+//多个pass增加的临时目标只要生命周期错开，就不会线性增加显存
+//Execute按顺序绑定每个pass的帧缓冲（由附件组合缓存）、设置视口、按需清空，再调用pass的执行函数
+class RenderGraph {
+public:
+    RenderGraphStats stats;
+    bool aliasingEnabled = true;//关闭时每个临时资源都使用单独的纹理，用于对比显存
+
+    //每帧开始时调用，清空上一帧的pass与资源，纹理池与帧缓冲缓存保留
+    void Reset(){
+        passes.clear();
+        resources.clear();
+        order.clear();
+        frame++;
+    }
+
+    //导入外部的纹理，texture为0表示默认帧缓冲
+    //导入的资源在图之外还会被使用，写入它的pass不会被剔除
+    RGResource Import(const string &name, unsigned int texture, const TextureDesc &desc){
+        Resource resource;
+        resource.name = name;
+        resource.desc = desc;
+        resource.imported = true;
+        resource.texture = texture;
+        resources.push_back(resource);
+        return static_cast<RGResource>(resources.size()) - 1;
+    }
+
+    //创建一个临时资源，它的纹理由图在Compile时分配，只在声明它的这一帧有效
+    RGResource CreateTexture(const string &name, const TextureDesc &desc){
+        Resource resource;
+        resource.name = name;
+        resource.desc = desc;
+        resources.push_back(resource);
+        return static_cast<RGResource>(resources.size()) - 1;
+    }
+
+    RGResource ImportBackbuffer(unsigned int width, unsigned int height){
+        return Import("Backbuffer", 0, TextureDesc(width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE));
+    }
+
+    //声明一个pass：setup立即执行，用来声明读写的资源；execute在Execute时按顺序执行
+    void AddPass(const string &name, const function<void(RenderPassBuilder &)> &setup, const function<void(const RenderPassContext &)> &execute){
+        Pass pass;
+        pass.name = name;
+        pass.execute = execute;
+        passes.push_back(pass);
+        RenderPassBuilder builder(this, static_cast<unsigned int>(passes.size()) - 1);
+        setup(builder);
+    }
+
+    void Compile(){
+        stats = RenderGraphStats();
+        stats.passes = static_cast<unsigned int>(passes.size());
+        cullPasses();
+        for(unsigned int i = 0; i < passes.size(); i++){
+            if(!passes[i].culled)
+                order.push_back(i);
+            else
+                stats.culledPasses++;
+        }
+        computeLifetimes();
+        allocateTextures();
+    }
+
+    void Execute(){
+        for(unsigned int k = 0; k < order.size(); k++){
+            Pass &pass = passes[order[k]];
+            unsigned int width = 0, height = 0;
+            if(!pass.writes.empty()){
+                const Resource &first = resources[pass.writes[0].resource];
+                width = first.desc.width;
+                height = first.desc.height;
+                glBindFramebuffer(GL_FRAMEBUFFER, framebufferFor(pass));
+                glViewport(0, 0, width, height);
+                clearAttachments(pass);
+            }
+            pass.execute(RenderPassContext(this, width, height));
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        releaseUnusedTextures();
+    }
+
+    //按声明顺序输出每个pass读写的资源与分配到的纹理（#后为纹理池中的序号），用于调试
+    string Describe() const{
+        string text;
+        for(unsigned int i = 0; i < passes.size(); i++){
+            const Pass &pass = passes[i];
+            text += (pass.culled ? "  (culled) " : "  ") + pass.name + ":";
+            for(unsigned int k = 0; k < pass.reads.size(); k++)
+                text += " r:" + describeResource(pass.reads[k]);
+            for(unsigned int k = 0; k < pass.writes.size(); k++)
+                text += " w:" + describeResource(pass.writes[k].resource);
+            text += "\n";
+        }
+        return text;
+    }
+
+    void Release(){
+        for(map<vector<unsigned int>, unsigned int>::iterator it = framebuffers.begin(); it != framebuffers.end(); ++it)
+            glDeleteFramebuffers(1, &it->second);
+        framebuffers.clear();
+        for(unsigned int i = 0; i < pool.size(); i++)
+            glDeleteTextures(1, &pool[i].texture);
+        pool.clear();
+    }
+
+private:
+    friend class RenderPassBuilder;
+    friend class RenderPassContext;
+
+    struct Resource {
+        string name;
+        TextureDesc desc;
+        bool imported = false;
+        unsigned int texture = 0;//分配到的纹理，导入资源为外部纹理
+        int physical = -1;//纹理池中的序号
+        int refCount = 0;//剔除时使用：读取它的pass数量
+        int firstPass = -1, lastPass = -1;//在执行顺序中的生命周期
+        vector<unsigned int> writers;
+    };
+
+    struct Attachment {
+        RGResource resource;
+        bool clear;
+    };
+
+    struct Pass {
+        string name;
+        function<void(const RenderPassContext &)> execute;
+        vector<RGResource> reads;
+        vector<Attachment> writes;
+        bool sideEffect = false;
+        bool culled = false;
+        int refCount = 0;
+    };
+
+    //池中的物理纹理
+    struct PooledTexture {
+        unsigned int texture = 0;
+        TextureDesc desc;
+        unsigned int lastFrame = 0;//最近一次被使用的帧
+        int busyUntil = -1;//本帧被占用到哪个pass（执行顺序中的序号）
+    };
+
+    vector<Pass> passes;
+    vector<Resource> resources;
+    vector<unsigned int> order;
+    vector<PooledTexture> pool;
+    map<vector<unsigned int>, unsigned int> framebuffers;//附件纹理组合 -> 帧缓冲
+    unsigned int frame = 0;
+
+    //引用计数剔除：读取者数量为0的临时资源不需要，写入它的pass引用计数减一，
+    //pass的所有输出都不需要且没有副作用时被剔除，它读取的资源的引用计数再减一
+    void cullPasses(){
+        for(unsigned int i = 0; i < resources.size(); i++)
+            resources[i].refCount = resources[i].imported ? 1 : 0;
+        for(unsigned int i = 0; i < passes.size(); i++){
+            passes[i].refCount = static_cast<int>(passes[i].writes.size());
+            for(unsigned int k = 0; k < passes[i].reads.size(); k++)
+                resources[passes[i].reads[k]].refCount++;
+        }
+        vector<RGResource> unused;
+        for(unsigned int i = 0; i < resources.size(); i++){
+            if(resources[i].refCount == 0)
+                unused.push_back(i);
+        }
+        while(!unused.empty()){
+            RGResource resource = unused.back();
+            unused.pop_back();
+            const vector<unsigned int> &writers = resources[resource].writers;
+            for(unsigned int w = 0; w < writers.size(); w++){
+                Pass &pass = passes[writers[w]];
+                if(pass.sideEffect || --pass.refCount > 0)
+                    continue;
+                pass.culled = true;
+                for(unsigned int k = 0; k < pass.reads.size(); k++){
+                    if(--resources[pass.reads[k]].refCount == 0)
+                        unused.push_back(pass.reads[k]);
+                }
+            }
+        }
+    }
+
+    void computeLifetimes(){
+        for(unsigned int k = 0; k < order.size(); k++){
+            const Pass &pass = passes[order[k]];
+            for(unsigned int i = 0; i < pass.reads.size(); i++)
+                touch(pass.reads[i], k);
+            for(unsigned int i = 0; i < pass.writes.size(); i++)
+                touch(pass.writes[i].resource, k);
+        }
+        for(unsigned int i = 0; i < resources.size(); i++){
+            const Resource &resource = resources[i];
+            if(resource.imported || resource.firstPass < 0)
+                continue;
+            if(resource.writers.empty())
+                cout << "WARNING::RENDERGRAPH::RESOURCE_READ_BEFORE_WRITE: " << resource.name << endl;
+            stats.transientResources++;
+            stats.requestedBytes += resource.desc.Bytes();
+        }
+    }
+
+    void touch(RGResource resource, unsigned int k){
+        Resource &r = resources[resource];
+        if(r.firstPass < 0)
+            r.firstPass = k;
+        r.lastPass = k;
+    }
+
+    //按生命周期开始的先后分配：池中描述相同、且上一个使用者已经结束的纹理直接复用
+    void allocateTextures(){
+        for(unsigned int i = 0; i < pool.size(); i++)
+            pool[i].busyUntil = -1;
+        vector<unsigned int> sorted;
+        for(unsigned int i = 0; i < resources.size(); i++){
+            if(!resources[i].imported && resources[i].firstPass >= 0)
+                sorted.push_back(i);
+        }
+        stable_sort(sorted.begin(), sorted.end(), [this](unsigned int a, unsigned int b){
+            return resources[a].firstPass < resources[b].firstPass;
+        });
+        for(unsigned int k = 0; k < sorted.size(); k++){
+            Resource &resource = resources[sorted[k]];
+            int chosen = -1;
+            for(unsigned int i = 0; i < pool.size() && chosen < 0; i++){
+                PooledTexture &texture = pool[i];
+                //关闭别名时每张纹理本帧只能分配一次
+                bool free = aliasingEnabled ? texture.busyUntil < resource.firstPass : texture.busyUntil < 0;
+                if(free && texture.desc == resource.desc)
+                    chosen = i;
+            }
+            if(chosen < 0){
+                pool.push_back(createTexture(resource.desc));
+                chosen = static_cast<int>(pool.size()) - 1;
+            }
+            if(pool[chosen].busyUntil < 0){
+                stats.textures++;
+                stats.allocatedBytes += resource.desc.Bytes();
+            }
+            pool[chosen].busyUntil = resource.lastPass;
+            pool[chosen].lastFrame = frame;
+            resource.physical = chosen;
+            resource.texture = pool[chosen].texture;
+        }
+    }
+
+    PooledTexture createTexture(const TextureDesc &desc){
+        PooledTexture pooled;
+        pooled.desc = desc;
+        glGenTextures(1, &pooled.texture);
+        glBindTexture(GL_TEXTURE_2D, pooled.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, desc.format, desc.type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return pooled;
+    }
+
+    //释放连续RG_POOL_KEEP_FRAMES帧没有使用的纹理，以及引用了它们的帧缓冲
+    void releaseUnusedTextures(){
+        stats.poolBytes = 0;
+        for(unsigned int i = 0; i < pool.size(); ){
+            if(frame - pool[i].lastFrame <= RG_POOL_KEEP_FRAMES){
+                stats.poolBytes += pool[i].desc.Bytes();
+                i++;
+                continue;
+            }
+            unsigned int texture = pool[i].texture;
+            for(map<vector<unsigned int>, unsigned int>::iterator it = framebuffers.begin(); it != framebuffers.end(); ){
+                if(find(it->first.begin(), it->first.end(), texture) != it->first.end()){
+                    glDeleteFramebuffers(1, &it->second);
+                    it = framebuffers.erase(it);
+                }
+                else
+                    ++it;
+            }
+            glDeleteTextures(1, &texture);
+            pool.erase(pool.begin() + i);
+        }
+    }
+
+    //附件组合相同的pass共用一个帧缓冲；写入默认帧缓冲的pass使用0
+    unsigned int framebufferFor(const Pass &pass){
+        vector<unsigned int> key;
+        for(unsigned int i = 0; i < pass.writes.size(); i++){
+            const Resource &resource = resources[pass.writes[i].resource];
+            if(resource.imported && resource.texture == 0)
+                return 0;
+            key.push_back(resource.texture);
+        }
+        map<vector<unsigned int>, unsigned int>::iterator it = framebuffers.find(key);
+        if(it != framebuffers.end())
+            return it->second;
+
+        unsigned int FBO;
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        vector<GLenum> drawBuffers;
+        for(unsigned int i = 0; i < pass.writes.size(); i++){
+            const Resource &resource = resources[pass.writes[i].resource];
+            GLenum attachment;
+            if(resource.desc.IsDepth())
+                attachment = resource.desc.format == GL_DEPTH_STENCIL ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+            else{
+                attachment = GL_COLOR_ATTACHMENT0 + static_cast<unsigned int>(drawBuffers.size());
+                drawBuffers.push_back(attachment);
+            }
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, resource.texture, 0);
+        }
+        if(drawBuffers.empty()){
+            //只有深度附件，例如阴影贴图
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        else
+            glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            cout << "ERROR::RENDERGRAPH::FRAMEBUFFER_NOT_COMPLETE: " << pass.name << endl;
+        framebuffers[key] = FBO;
+        return FBO;
+    }
+
+    void clearAttachments(const Pass &pass){
+        const float black[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        const float one = 1.0f;
+        int color = 0;
+        for(unsigned int i = 0; i < pass.writes.size(); i++){
+            const Attachment &attachment = pass.writes[i];
+            bool depth = resources[attachment.resource].desc.IsDepth();
+            if(attachment.clear){
+                if(depth){
+                    glDepthMask(GL_TRUE);
+                    glClearBufferfv(GL_DEPTH, 0, &one);
+                }
+                else
+                    glClearBufferfv(GL_COLOR, color, black);
+            }
+            if(!depth)
+                color++;
+        }
+    }
+
+    string describeResource(RGResource resource) const{
+        const Resource &r = resources[resource];
+        if(r.imported)
+            return r.name;
+        return r.name + (r.physical >= 0 ? "#" + to_string(r.physical) : "");
+    }
+};
+
+inline RGResource RenderPassBuilder::Read(RGResource resource){
+    graph->passes[pass].reads.push_back(resource);
+    return resource;
+}
+
+inline RGResource RenderPassBuilder::Write(RGResource resource, bool clear){
+    RenderGraph::Attachment attachment;
+    attachment.resource = resource;
+    attachment.clear = clear;
+    graph->passes[pass].writes.push_back(attachment);
+    graph->resources[resource].writers.push_back(pass);
+    return resource;
+}
+
+inline void RenderPassBuilder::SideEffect(){
+    graph->passes[pass].sideEffect = true;
+}
+
+inline unsigned int RenderPassContext::Texture(RGResource resource) const{
+    return graph->resources[resource].texture;
+}
+#endif
@@ -0,0 +1,6 @@
+#version 330 core
+
+void main()
+{
+    //只写入深度
+}
@@ -0,0 +1,552 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "InstanceBuffer.h"
+#include "RenderGraph.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_11_RenderGraph/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
+const unsigned int SHADOW_RESOLUTION = 2048;
+
+CustomCamera camera(glm::vec3(0.0f, 8.0f, 20.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -20.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//箱子铺满GRID_SIZE*GRID_SIZE个格子，另有一些发光的方块在上方飞行
+const int GRID_SIZE = 32;
+const float CELL_SIZE = 2.0f;
+const unsigned int GLOW_AMOUNT = 24;
+bool bloomEnabled = true;
+bool showDepth = false;
+bool aliasingEnabled = true;
+int blurIterations = 4;
+bool bloomKeyDown = false;
+bool depthKeyDown = false;
+bool aliasingKeyDown = false;
+bool moreKeyDown = false;
+bool lessKeyDown = false;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //B键开关泛光，V键在右上角显示深度，K键开关纹理复用，=与-键增减模糊次数
+    bool key = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+    if(key && !bloomKeyDown)
+        bloomEnabled = !bloomEnabled;
+    bloomKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS;
+    if(key && !depthKeyDown)
+        showDepth = !showDepth;
+    depthKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS;
+    if(key && !aliasingKeyDown)
+        aliasingEnabled = !aliasingEnabled;
+    aliasingKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS;
+    if(key && !moreKeyDown && blurIterations < 8)
+        blurIterations++;
+    moreKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS;
+    if(key && !lessKeyDown && blurIterations > 1)
+        blurIterations--;
+    lessKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+unsigned int loadTexture(char const * path)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    if (data)
+    {
+        GLenum format;
+        if (nrComponents == 1)
+            format = GL_RED;
+        else if (nrComponents == 3)
+            format = GL_RGB;
+        else if (nrComponents == 4)
+            format = GL_RGBA;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        stbi_image_free(data);
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        stbi_image_free(data);
+    }
+
+    return textureID;
+}
+
+//地面由扁平的箱子铺成，部分格子上再随机堆叠1~3个箱子
+void generateCrates(vector<glm::mat4> &matrices){
+    float half = GRID_SIZE * CELL_SIZE * 0.5f;
+    for(int x = 0; x < GRID_SIZE; x++){
+        for(int z = 0; z < GRID_SIZE; z++){
+            glm::vec3 cell(x * CELL_SIZE - half, 0.0f, z * CELL_SIZE - half);
+            glm::mat4 floor = glm::translate(glm::mat4(1.0f), cell + glm::vec3(0.0f, -0.05f, 0.0f));
+            matrices.push_back(glm::scale(floor, glm::vec3(CELL_SIZE, 0.1f, CELL_SIZE)));
+            if(rand() % 100 < 30){
+                int stack = 1 + rand() % 3;
+                for(int i = 0; i < stack; i++){
+                    glm::mat4 model = glm::translate(glm::mat4(1.0f), cell + glm::vec3(0.0f, 0.5f + i, 0.0f));
+                    matrices.push_back(glm::rotate(model, glm::radians((float)(rand() % 90)), glm::vec3(0.0f, 1.0f, 0.0f)));
+                }
+            }
+        }
+    }
+}
+
+//发光方块绕圈飞行，颜色远大于1，经过泛光后形成光晕
+void updateGlowCubes(float time, vector<glm::mat4> &matrices, vector<glm::vec4> &colors){
+    matrices.resize(GLOW_AMOUNT);
+    colors.resize(GLOW_AMOUNT);
+    for(unsigned int i = 0; i < GLOW_AMOUNT; i++){
+        float angle = time * 0.4f + (float)i / GLOW_AMOUNT * glm::two_pi<float>();
+        float radius = 5.0f + (i % 4) * 5.0f;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(cos(angle) * radius, 3.0f + (i % 3), sin(angle) * radius));
+        matrices[i] = glm::scale(model, glm::vec3(0.4f));
+        const glm::vec3 palette[6] = {glm::vec3(1.0f, 0.3f, 0.2f), glm::vec3(1.0f, 0.8f, 0.2f), glm::vec3(0.3f, 1.0f, 0.3f),
+            glm::vec3(0.2f, 0.8f, 1.0f), glm::vec3(0.4f, 0.3f, 1.0f), glm::vec3(1.0f, 0.3f, 0.9f)};
+        glm::vec3 color = palette[i % 6];
+        colors[i] = glm::vec4(color * 6.0f, 1.0f);
+    }
+}
+
+int main(int argc, char **argv){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 8.0f;
+
+    CustomShader objectShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+    CustomShader shadowShader((Path + "ShadowVertexShader.glsl").c_str(), (Path + "ShadowFragmentShader.glsl").c_str());
+    CustomShader glowShader((Path + "LightVertexShader.glsl").c_str(), (Path + "LightFragmentShader.glsl").c_str());
+    CustomShader brightShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "BrightFragmentShader.glsl").c_str());
+    CustomShader blurShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "BlurFragmentShader.glsl").c_str());
+    CustomShader compositeShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "CompositeFragmentShader.glsl").c_str());
+    CustomShader depthViewShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "DepthViewFragmentShader.glsl").c_str());
+    CustomShader postShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "PostFragmentShader.glsl").c_str());
+
+    float vertices[] = {
+        // positions          // normals           // texture coords
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+        0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+    };
+
+    unsigned int VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    srand(static_cast<unsigned int>(glfwGetTime()));
+    vector<glm::mat4> crateMatrices;
+    generateCrates(crateMatrices);
+    unsigned int crateCount = static_cast<unsigned int>(crateMatrices.size());
+    vector<glm::mat4> glowMatrices;
+    vector<glm::vec4> glowColors;
+    updateGlowCubes(0.0f, glowMatrices, glowColors);
+
+    unsigned int crateVAO, glowVAO;
+    InstanceBuffer crates(crateMatrices.data(), crateCount);
+    glGenVertexArrays(1, &crateVAO);
+    glBindVertexArray(crateVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    crates.BindAttributes();
+
+    InstanceBuffer glowCubes(glowMatrices.data(), GLOW_AMOUNT, glowColors.data(), GL_STREAM_DRAW);
+    glGenVertexArrays(1, &glowVAO);
+    glBindVertexArray(glowVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glowCubes.BindAttributes();
+
+    //后处理pass共用的全屏四边形
+    float quadVertices[] = {-1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f};
+    unsigned int quadVAO, quadVBO;
+    glGenVertexArrays(1, &quadVAO);
+    glGenBuffers(1, &quadVBO);
+    glBindVertexArray(quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    unsigned int diffuseMap = loadTexture("./static/texture/container2.png");
+    unsigned int specularMap = loadTexture("./static/texture/container2_specular.png");
+
+    objectShader.use();
+    objectShader.setInt("material.diffuse", 0);
+    objectShader.setInt("material.specular", 1);
+    objectShader.setInt("shadowMap", 2);
+
+    //渲染图中用到的渲染目标描述
+    const TextureDesc shadowDesc(SHADOW_RESOLUTION, SHADOW_RESOLUTION, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+    const TextureDesc hdrDesc(SCR_WIDTH, SCR_HEIGHT, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    const TextureDesc depthDesc(SCR_WIDTH, SCR_HEIGHT, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+    const TextureDesc bloomDesc(SCR_WIDTH / 2, SCR_HEIGHT / 2, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    const TextureDesc ldrDesc(SCR_WIDTH, SCR_HEIGHT, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    glm::vec3 lightDir = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+    glm::mat4 lightProjection = glm::ortho(-40.0f, 40.0f, -40.0f, 40.0f, 1.0f, 120.0f);
+    glm::mat4 lightView = glm::lookAt(-lightDir * 60.0f, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 lightSpaceMatrix = lightProjection * lightView;
+
+    RenderGraph graph;
+    int lastConfig = -1;
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    while (!glfwWindowShouldClose(window)){
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        //显示平均帧时间与渲染图统计
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            const RenderGraphStats &stats = graph.stats;
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame - " + to_string(stats.passes - stats.culledPasses) + "/"
+                + to_string(stats.passes) + " passes, " + to_string(stats.transientResources) + " targets in " + to_string(stats.textures)
+                + " textures, " + to_string(stats.allocatedBytes / 1048576.0) + " MB (" + to_string(stats.requestedBytes / 1048576.0)
+                + " MB without aliasing), pool " + to_string(stats.poolBytes / 1048576.0) + " MB";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+        }
+
+        processInput(window);
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+        updateGlowCubes(currentFrame, glowMatrices, glowColors);
+        glowCubes.Update(glowMatrices.data(), GLOW_AMOUNT, glowColors.data());
+
+        //每帧重新声明渲染图：阴影 -> 场景 -> 泛光（提取亮部与多次模糊）-> 合成 -> 输出
+        //深度可视化pass每帧都声明，只有开启调试叠加时它的输出才会被读取，否则被图剔除
+        graph.Reset();
+        graph.aliasingEnabled = aliasingEnabled;
+        RGResource backbuffer = graph.ImportBackbuffer(SCR_WIDTH, SCR_HEIGHT);
+
+        RGResource shadowMap = graph.CreateTexture("ShadowMap", shadowDesc);
+        graph.AddPass("Shadow", [&](RenderPassBuilder &builder){
+            builder.Write(shadowMap, true);
+        }, [&](const RenderPassContext &){
+            glEnable(GL_DEPTH_TEST);
+            glEnable(GL_POLYGON_OFFSET_FILL);
+            glPolygonOffset(2.0f, 4.0f);
+            shadowShader.use();
+            shadowShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+            glBindVertexArray(crateVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, crateCount);
+            glDisable(GL_POLYGON_OFFSET_FILL);
+        });
+
+        RGResource sceneColor = graph.CreateTexture("SceneColor", hdrDesc);
+        RGResource sceneDepth = graph.CreateTexture("SceneDepth", depthDesc);
+        graph.AddPass("Scene", [&](RenderPassBuilder &builder){
+            builder.Read(shadowMap);
+            builder.Write(sceneColor, true);
+            builder.Write(sceneDepth, true);
+        }, [&](const RenderPassContext &context){
+            glEnable(GL_DEPTH_TEST);
+            objectShader.use();
+            objectShader.setFloat("material.shininess", 32.0f);
+            objectShader.setVec3("viewPos", camera.Position);
+            objectShader.setVec3("dirLight.direction", lightDir);
+            objectShader.setVec3("dirLight.ambient", 0.15f, 0.15f, 0.18f);
+            objectShader.setVec3("dirLight.diffuse", 0.9f, 0.85f, 0.8f);
+            objectShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
+            objectShader.setMat4("view", view);
+            objectShader.setMat4("projection", projection);
+            objectShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, diffuseMap);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, specularMap);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(shadowMap));
+            glBindVertexArray(crateVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, crateCount);
+
+            glowShader.use();
+            glowShader.setMat4("projection", projection);
+            glowShader.setMat4("view", view);
+            glBindVertexArray(glowVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, GLOW_AMOUNT);
+        });
+
+        //泛光：每次模糊都写入一个新的临时目标，生命周期错开的目标由图复用同一张纹理
+        RGResource bloomResult = -1;
+        if(bloomEnabled){
+            RGResource bright = graph.CreateTexture("Bright", bloomDesc);
+            graph.AddPass("BrightPass", [&](RenderPassBuilder &builder){
+                builder.Read(sceneColor);
+                builder.Write(bright);
+            }, [&](const RenderPassContext &context){
+                glDisable(GL_DEPTH_TEST);
+                brightShader.use();
+                brightShader.setInt("hdrBuffer", 0);
+                brightShader.setFloat("threshold", 1.0f);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.Texture(sceneColor));
+                glBindVertexArray(quadVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            });
+            RGResource current = bright;
+            for(int i = 0; i < blurIterations * 2; i++){
+                RGResource input = current;
+                RGResource output = graph.CreateTexture("Blur" + to_string(i), bloomDesc);
+                bool horizontal = i % 2 == 0;
+                graph.AddPass(horizontal ? "BlurH" : "BlurV", [input, output](RenderPassBuilder &builder){
+                    builder.Read(input);
+                    builder.Write(output);
+                }, [&, input, horizontal](const RenderPassContext &context){
+                    glDisable(GL_DEPTH_TEST);
+                    blurShader.use();
+                    blurShader.setInt("image", 0);
+                    blurShader.setBool("horizontal", horizontal);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, context.Texture(input));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                });
+                current = output;
+            }
+            bloomResult = current;
+        }
+
+        RGResource ldr = graph.CreateTexture("LDR", ldrDesc);
+        graph.AddPass("Composite", [&](RenderPassBuilder &builder){
+            builder.Read(sceneColor);
+            if(bloomResult >= 0)
+                builder.Read(bloomResult);
+            builder.Write(ldr);
+        }, [&](const RenderPassContext &context){
+            glDisable(GL_DEPTH_TEST);
+            compositeShader.use();
+            compositeShader.setInt("hdrBuffer", 0);
+            compositeShader.setInt("bloomBuffer", 1);
+            compositeShader.setBool("bloom", bloomResult >= 0);
+            compositeShader.setFloat("bloomStrength", 0.6f);
+            compositeShader.setFloat("exposure", 1.2f);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(sceneColor));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, bloomResult >= 0 ? context.Texture(bloomResult) : 0);
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        });
+
+        RGResource depthView = graph.CreateTexture("DepthView", ldrDesc);
+        graph.AddPass("DepthView", [&](RenderPassBuilder &builder){
+            builder.Read(sceneDepth);
+            builder.Write(depthView);
+        }, [&](const RenderPassContext &context){
+            glDisable(GL_DEPTH_TEST);
+            depthViewShader.use();
+            depthViewShader.setInt("depthBuffer", 0);
+            depthViewShader.setFloat("nearPlane", NEAR_PLANE);
+            depthViewShader.setFloat("farPlane", FAR_PLANE);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(sceneDepth));
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        });
+
+        graph.AddPass("Output", [&](RenderPassBuilder &builder){
+            builder.Read(ldr);
+            builder.Write(backbuffer);
+        }, [&](const RenderPassContext &context){
+            glDisable(GL_DEPTH_TEST);
+            postShader.use();
+            postShader.setInt("image", 0);
+            postShader.setFloat("vignette", 0.8f);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(ldr));
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        });
+
+        if(showDepth){
+            graph.AddPass("DepthOverlay", [&](RenderPassBuilder &builder){
+                builder.Read(depthView);
+                builder.Write(backbuffer);
+            }, [&](const RenderPassContext &context){
+                //画在屏幕右上角
+                glViewport(context.width * 2 / 3, context.height * 2 / 3, context.width / 3, context.height / 3);
+                postShader.use();
+                postShader.setInt("image", 0);
+                postShader.setFloat("vignette", 0.0f);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.Texture(depthView));
+                glBindVertexArray(quadVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                glViewport(0, 0, context.width, context.height);
+            });
+        }
+
+        graph.Compile();
+        graph.Execute();
+
+        //图的结构变化时在控制台输出pass顺序与纹理分配
+        int config = (bloomEnabled ? 1 : 0) | (showDepth ? 2 : 0) | (aliasingEnabled ? 4 : 0) | (blurIterations << 3);
+        if(config != lastConfig){
+            cout << "Render graph:" << endl << graph.Describe();
+            lastConfig = config;
+        }
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+    glDeleteVertexArrays(1, &crateVAO);
+    glDeleteVertexArrays(1, &glowVAO);
+    glDeleteVertexArrays(1, &quadVAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &quadVBO);
+    crates.Release();
+    glowCubes.Release();
+    graph.Release();
+
+    glfwTerminate();
+
+    return 0;
+}
@@ -0,0 +1,19 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D hdrBuffer;
+uniform sampler2D bloomBuffer;
+uniform bool bloom;
+uniform float bloomStrength;
+uniform float exposure;
+
+void main()
+{
+    vec3 color = texture(hdrBuffer, TexCoords).rgb;
+    if(bloom)
+        color += texture(bloomBuffer, TexCoords).rgb * bloomStrength;
+    //曝光色调映射后做伽马校正
+    vec3 mapped = vec3(1.0) - exp(-color * exposure);
+    FragColor = vec4(pow(mapped, vec3(1.0 / 2.2)), 1.0);
+}
@@ -0,0 +1,226 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+using namespace std;
+
+//更新线程需要的输入：按键状态每帧整体替换，鼠标移动与滚轮在两次读取之间累加
+//GLFW要求在主线程处理窗口事件，所以由主线程采样后交给更新线程
+#define INPUT_KEY_COUNT 8
+
+enum InputKey {
+    INPUT_FORWARD = 0,
+    INPUT_BACKWARD,
+    INPUT_LEFT,
+    INPUT_RIGHT,
+    INPUT_UP,
+    INPUT_DOWN
+};
+
+struct InputState {
+    bool keys[INPUT_KEY_COUNT] = {};
+    float mouseX = 0.0f, mouseY = 0.0f;//累计的鼠标移动
+    float scroll = 0.0f;//累计的滚轮
+    chrono::steady_clock::time_point sampleTime;//最早一次未被读取的采样时间，用于统计输入到显示的延迟
+};
+
+class InputMailbox {
+public:
+    //主线程：写入本帧的按键状态
+    void SetKeys(const bool keys[INPUT_KEY_COUNT]){
+        lock_guard<mutex> lock(inputMutex);
+        for(int i = 0; i < INPUT_KEY_COUNT; i++)
+            state.keys[i] = keys[i];
+        markSampled();
+    }
+
+    //主线程（鼠标回调）：累加鼠标移动
+    void AddMouse(float x, float y){
+        lock_guard<mutex> lock(inputMutex);
+        state.mouseX += x;
+        state.mouseY += y;
+        markSampled();
+    }
+
+    void AddScroll(float y){
+        lock_guard<mutex> lock(inputMutex);
+        state.scroll += y;
+        markSampled();
+    }
+
+    //更新线程：取出当前输入并清空累加量，按键状态保留
+    InputState Take(){
+        lock_guard<mutex> lock(inputMutex);
+        InputState result = state;
+        if(!pending)
+            result.sampleTime = chrono::steady_clock::now();
+        state.mouseX = state.mouseY = state.scroll = 0.0f;
+        pending = false;
+        return result;
+    }
+
+private:
+    mutex inputMutex;
+    InputState state;
+    bool pending = false;
+
+    void markSampled(){
+        if(!pending)
+            state.sampleTime = chrono::steady_clock::now();
+        pending = true;
+    }
+};
+
+//延迟控制
+struct PipelineSettings {
+    //更新线程最多领先渲染线程几帧：1为双缓冲（更新第N+1帧时渲染第N帧），2为三缓冲
+    //领先越多越不容易因为某一帧变慢而停顿，但输入到显示的延迟也越大
+    unsigned int maxFramesAhead = 1;
+    //为true时渲染线程总是取最新的快照，更新线程写满时覆盖最旧的未渲染快照而不是等待
+    //用于更新比渲染快的情况：延迟最低，但会丢弃一部分更新结果
+    bool latestOnly = false;
+};
+
+//快照队列：更新线程写入、渲染线程读取的环形缓冲，槽位数为maxFramesAhead + 1
+//每个槽位依次处于 空闲 -> 写入中 -> 就绪 -> 读取中 -> 空闲，写入与读取的槽位永远不同，
+//所以快照本身不需要加锁，只有切换状态时加锁；快照在就绪之后不再修改
+template<typename T>
+class FrameQueue {
+public:
+    unsigned int droppedFrames = 0;//latestOnly模式下被覆盖的快照数
+
+    void Init(const PipelineSettings &settings){
+        lock_guard<mutex> lock(queueMutex);
+        this->settings = settings;
+        slots.resize(settings.maxFramesAhead + 1);
+        for(unsigned int i = 0; i < slots.size(); i++){
+            slots[i].state = SLOT_FREE;
+            slots[i].sequence = 0;
+        }
+        stopped = false;
+        nextSequence = 1;
+    }
+
+    //更新线程：取得一个可以写入的槽位，已经领先maxFramesAhead帧时等待渲染线程取走快照
+    //（latestOnly模式下不等待，没有空闲槽位时覆盖最旧的就绪快照）；队列停止后返回nullptr
+    //渲染线程归还快照的时间早于帧结束，所以只看空闲槽位是不够的，还要限制就绪快照的数量
+    T *BeginWrite(){
+        unique_lock<mutex> lock(queueMutex);
+        int slot = -1;
+        writeReady.wait(lock, [&](){
+            slot = settings.latestOnly || countSlots(SLOT_READY) < settings.maxFramesAhead ? findSlot(SLOT_FREE, false) : -1;
+            if(slot < 0 && settings.latestOnly){
+                slot = findSlot(SLOT_READY, false);
+                if(slot >= 0)
+                    droppedFrames++;
+            }
+            return stopped || slot >= 0;
+        });
+        if(stopped)
+            return nullptr;
+        slots[slot].state = SLOT_WRITING;
+        return &slots[slot].data;
+    }
+
+    void EndWrite(T *data){
+        {
+            lock_guard<mutex> lock(queueMutex);
+            Slot &slot = slotOf(data);
+            slot.state = SLOT_READY;
+            slot.sequence = nextSequence++;
+        }
+        readReady.notify_one();
+    }
+
+    //渲染线程：取得下一份就绪的快照，普通模式按顺序读取，latestOnly模式读取最新的并丢弃更旧的
+    //队列停止后返回nullptr
+    T *BeginRead(){
+        unique_lock<mutex> lock(queueMutex);
+        int slot = -1;
+        readReady.wait(lock, [&](){
+            slot = findSlot(SLOT_READY, settings.latestOnly);
+            return stopped || slot >= 0;
+        });
+        if(stopped)
+            return nullptr;
+        if(settings.latestOnly){
+            for(unsigned int i = 0; i < slots.size(); i++){
+                if(slots[i].state == SLOT_READY && (int)i != slot){
+                    slots[i].state = SLOT_FREE;
+                    droppedFrames++;
+                }
+            }
+        }
+        slots[slot].state = SLOT_READING;
+        lock.unlock();
+        //取走一份就绪快照后更新线程可能可以继续写入
+        writeReady.notify_one();
+        return &slots[slot].data;
+    }
+
+    //渲染线程把快照中的数据上传之后就可以归还，不必等到帧结束
+    void EndRead(T *data){
+        {
+            lock_guard<mutex> lock(queueMutex);
+            slotOf(data).state = SLOT_FREE;
+        }
+        writeReady.notify_one();
+    }
+
+    //唤醒并结束两边的等待
+    void Stop(){
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopped = true;
+        }
+        writeReady.notify_all();
+        readReady.notify_all();
+    }
+
+private:
+    enum SlotState { SLOT_FREE, SLOT_WRITING, SLOT_READY, SLOT_READING };
+    struct Slot {
+        T data;
+        SlotState state = SLOT_FREE;
+        unsigned long long sequence = 0;
+    };
+
+    vector<Slot> slots;
+    PipelineSettings settings;
+    mutex queueMutex;
+    condition_variable writeReady, readReady;
+    unsigned long long nextSequence = 1;
+    bool stopped = false;
+
+    //在指定状态的槽位中找序号最小（newest为true时最大）的一个
+    int findSlot(SlotState state, bool newest) const{
+        int found = -1;
+        for(unsigned int i = 0; i < slots.size(); i++){
+            if(slots[i].state != state)
+                continue;
+            if(found < 0 || (newest ? slots[i].sequence > slots[found].sequence : slots[i].sequence < slots[found].sequence))
+                found = static_cast<int>(i);
+        }
+        return found;
+    }
+
+    unsigned int countSlots(SlotState state) const{
+        unsigned int count = 0;
+        for(unsigned int i = 0; i < slots.size(); i++)
+            count += slots[i].state == state ? 1 : 0;
+        return count;
+    }
+
+    Slot &slotOf(T *data){
+        for(unsigned int i = 0; i < slots.size(); i++){
+            if(&slots[i].data == data)
+                return slots[i];
+        }
+        return slots[0];
+    }
+};
+
+#endif
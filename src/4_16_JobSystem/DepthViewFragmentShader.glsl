@@ -0,0 +1,15 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D depthBuffer;
+uniform float nearPlane;
+uniform float farPlane;
+
+void main()
+{
+    //把非线性深度还原为线性深度再归一化，便于观察
+    float z = texture(depthBuffer, TexCoords).r * 2.0 - 1.0;
+    float linearDepth = (2.0 * nearPlane * farPlane) / (farPlane + nearPlane - z * (farPlane - nearPlane));
+    FragColor = vec4(vec3(linearDepth / farPlane), 1.0);
+}
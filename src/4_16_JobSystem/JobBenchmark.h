@@ -0,0 +1,146 @@
+#ifndef JOBBENCHMARK_H
+#define JOBBENCHMARK_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include "JobSystem.h"
+using namespace std;
+
+//任务系统的微基准测试：调度开销与不同线程数下的扩展性
+//  make jobbench dir=4_16_JobSystem            测试1、2、4……直到硬件线程数
+//  make jobbench dir=4_16_JobSystem threads=64 线程数测到64（超过硬件线程数时结果只反映超额订阅的开销）
+struct JobBenchmarkOptions {
+    bool enabled = false;
+    unsigned int maxThreads = 0;//0表示硬件线程数，不测试时作为场景使用的线程数
+    unsigned int repeats = 5;//每项测试重复的次数，取最快的一次
+};
+
+//解析 --jobbench、--threads N、--repeats N，其余参数忽略
+JobBenchmarkOptions ParseJobBenchmarkArgs(int argc, char *argv[]){
+    JobBenchmarkOptions options;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--jobbench")
+            options.enabled = true;
+        else if(arg == "--threads" && i + 1 < argc)
+            options.maxThreads = static_cast<unsigned int>(atoi(argv[++i]));
+        else if(arg == "--repeats" && i + 1 < argc)
+            options.repeats = static_cast<unsigned int>(max(1, atoi(argv[++i])));
+    }
+    if(options.maxThreads == 0)
+        options.maxThreads = max(1u, thread::hardware_concurrency());
+    return options;
+}
+
+class JobBenchmark {
+public:
+    JobBenchmark(const JobBenchmarkOptions &options) : options(options){}
+
+    void Run(){
+        vector<unsigned int> threadCounts;
+        for(unsigned int n = 1; n < options.maxThreads; n *= 2)
+            threadCounts.push_back(n);
+        threadCounts.push_back(options.maxThreads);
+        cout << "Job system benchmark: " << thread::hardware_concurrency() << " hardware threads, best of " << options.repeats << " runs" << endl;
+        cout << left << setw(10) << "threads" << right << setw(14) << "empty ns/job" << setw(14) << "chain ns/hop"
+            << setw(16) << "transforms ms" << setw(10) << "speedup" << setw(14) << "compute ms" << setw(10) << "speedup"
+            << setw(12) << "efficiency" << setw(10) << "steals" << endl;
+        cout << fixed;
+        double baseTransforms = 0.0, baseCompute = 0.0;
+        for(unsigned int i = 0; i < threadCounts.size(); i++){
+            unsigned int threads = threadCounts[i];
+            JobSystem::Get().Init(static_cast<int>(threads) - 1);
+            JobSystem::Get().TakeStats();
+            double empty = emptyJobs() * 1e6 / EMPTY_JOBS;
+            double chain = dependencyChain() * 1e6 / CHAIN_LENGTH;
+            double transforms = parallelTransforms();
+            double compute = parallelCompute();
+            JobSystemStats stats = JobSystem::Get().TakeStats();
+            if(i == 0){
+                baseTransforms = transforms;
+                baseCompute = compute;
+            }
+            double computeSpeedup = baseCompute / compute;
+            cout << left << setw(10) << threads << right << setprecision(1) << setw(14) << empty << setw(14) << chain
+                << setprecision(3) << setw(16) << transforms << setprecision(2) << setw(10) << baseTransforms / transforms
+                << setprecision(3) << setw(14) << compute << setprecision(2) << setw(10) << computeSpeedup
+                << setprecision(0) << setw(11) << computeSpeedup / threads * 100.0 << "%" << setw(10) << stats.steals << endl;
+        }
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+        JobSystem::Get().Shutdown();
+    }
+
+private:
+    static const unsigned int EMPTY_JOBS = 100000;
+    static const unsigned int CHAIN_LENGTH = 10000;
+    static const unsigned int TRANSFORM_COUNT = 1 << 20;
+    static const unsigned int COMPUTE_COUNT = 1 << 16;
+    JobBenchmarkOptions options;
+
+    //重复执行取最快的一次，单位毫秒
+    double best(const function<void()> &func){
+        double result = 1e30;
+        for(unsigned int i = 0; i < options.repeats; i++){
+            auto start = chrono::steady_clock::now();
+            func();
+            result = min(result, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        }
+        return result;
+    }
+
+    //调度开销：主线程提交大量空任务并等待，工作线程从主线程的队列中偷取
+    double emptyJobs(){
+        return best([](){
+            JobCounter counter;
+            for(unsigned int i = 0; i < EMPTY_JOBS; i++)
+                JobSystem::Get().Run([](){}, &counter);
+            JobSystem::Get().Wait(counter);
+        });
+    }
+
+    //依赖链：每个任务都依赖前一个任务的计数器，测量一个任务完成到下一个任务开始的延迟
+    double dependencyChain(){
+        return best([](){
+            vector<JobCounter> counters(CHAIN_LENGTH);
+            for(unsigned int i = 0; i < CHAIN_LENGTH; i++)
+                JobSystem::Get().Run([](){}, &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+            JobSystem::Get().Wait(counters[CHAIN_LENGTH - 1]);
+        });
+    }
+
+    //访存为主的轻量任务：与场景中的箱子动画相同，每个元素一次矩阵旋转
+    double parallelTransforms(){
+        vector<glm::mat4> base(TRANSFORM_COUNT, glm::mat4(1.0f)), result(TRANSFORM_COUNT);
+        return best([&](){
+            JobSystem::Get().ParallelFor(TRANSFORM_COUNT, 1024, [&](unsigned int begin, unsigned int end){
+                for(unsigned int i = begin; i < end; i++)
+                    result[i] = glm::rotate(base[i], i * 0.001f, glm::vec3(0.0f, 1.0f, 0.0f));
+            });
+        });
+    }
+
+    //计算为主的任务：每个元素做一段不访问内存的迭代，反映调度本身的扩展性
+    double parallelCompute(){
+        vector<float> result(COMPUTE_COUNT);
+        return best([&](){
+            JobSystem::Get().ParallelFor(COMPUTE_COUNT, 64, [&](unsigned int begin, unsigned int end){
+                for(unsigned int i = begin; i < end; i++){
+                    float x = i * 0.0001f;
+                    for(int k = 0; k < 256; k++)
+                        x = sin(x) * 0.5f + cos(x * 1.3f);
+                    result[i] = x;
+                }
+            });
+        });
+    }
+};
+
+#endif
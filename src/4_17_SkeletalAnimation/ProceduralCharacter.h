@@ -0,0 +1,201 @@
+#ifndef PROCEDURALCHARACTER_H
+#define PROCEDURALCHARACTER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <string>
+#include <cmath>
+#include "SkinnedModel.h"
+using namespace std;
+
+//没有指定蒙皮模型时使用的程序化角色：由方块拼成的人形，13个关节，带走路与跑步两个循环片段
+//顶点、骨骼与片段都按导入模型的格式生成，运行时走完全相同的采样、混合与蒙皮流程
+//角色面朝+z，站在原点，身高约2
+
+enum CharacterJoint {
+    JOINT_ROOT = 0,
+    JOINT_HIPS,
+    JOINT_SPINE,
+    JOINT_CHEST,
+    JOINT_HEAD,
+    JOINT_LEFT_UPPER_ARM,
+    JOINT_LEFT_FOREARM,
+    JOINT_RIGHT_UPPER_ARM,
+    JOINT_RIGHT_FOREARM,
+    JOINT_LEFT_THIGH,
+    JOINT_LEFT_SHIN,
+    JOINT_RIGHT_THIGH,
+    JOINT_RIGHT_SHIN
+};
+
+//身体的一段：沿from到to的方块，跟随joint运动，靠近from的一端与父关节平滑过渡
+struct BodyPart {
+    int joint;
+    glm::vec3 from, to;
+    float width, depth;
+    bool blendParent;
+};
+
+//方块沿长度方向分成几段，关节附近的顶点才能有不同的权重，弯曲时不会整块折断
+const int BODY_PART_SEGMENTS = 4;
+//靠近from的这一段长度内与父关节混合
+const float BODY_PART_BLEND = 0.3f;
+
+//生成一段身体的顶点与索引，四个侧面沿长度细分，两端封口
+void appendBodyPart(const BodyPart &part, int parent, vector<Vertex> &vertices, vector<unsigned int> &indices){
+    glm::vec3 axis = part.to - part.from;
+    glm::vec3 forward = glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec3 along = glm::normalize(axis);
+    glm::vec3 side = glm::normalize(glm::cross(fabs(along.z) > 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : forward, along));
+    glm::vec3 front = glm::cross(along, side);
+    glm::vec3 halfSide = side * part.width * 0.5f;
+    glm::vec3 halfFront = front * part.depth * 0.5f;
+    auto makeVertex = [&](const glm::vec3 &position, const glm::vec3 &normal, float t){
+        Vertex vertex;
+        vertex.Position = position;
+        vertex.Normal = normal;
+        vertex.TexCoords = glm::vec2(0.0f);
+        vertex.Tangent = glm::vec3(0.0f);
+        vertex.Bitangent = glm::vec3(0.0f);
+        for(int k = 0; k < MAX_BONE_INFLUENCE; k++){
+            vertex.m_BoneIDs[k] = 0;
+            vertex.m_Weights[k] = 0.0f;
+        }
+        float parentWeight = part.blendParent ? 0.5f * max(0.0f, 1.0f - t / BODY_PART_BLEND) : 0.0f;
+        vertex.m_BoneIDs[0] = part.joint;
+        vertex.m_Weights[0] = 1.0f - parentWeight;
+        vertex.m_BoneIDs[1] = parent;
+        vertex.m_Weights[1] = parentWeight;
+        return vertex;
+    };
+    //四个侧面：每个侧面由两条边与一条法线描述
+    glm::vec3 corners[4] = {-halfSide - halfFront, halfSide - halfFront, halfSide + halfFront, -halfSide + halfFront};
+    for(int face = 0; face < 4; face++){
+        glm::vec3 a = corners[face], b = corners[(face + 1) % 4];
+        glm::vec3 normal = glm::normalize(a + b);
+        unsigned int base = static_cast<unsigned int>(vertices.size());
+        for(int s = 0; s <= BODY_PART_SEGMENTS; s++){
+            float t = static_cast<float>(s) / BODY_PART_SEGMENTS;
+            glm::vec3 center = part.from + axis * t;
+            vertices.push_back(makeVertex(center + a, normal, t));
+            vertices.push_back(makeVertex(center + b, normal, t));
+        }
+        for(int s = 0; s < BODY_PART_SEGMENTS; s++){
+            unsigned int i = base + s * 2;
+            indices.insert(indices.end(), {i, i + 2, i + 1, i + 1, i + 2, i + 3});
+        }
+    }
+    //两端封口
+    for(int end = 0; end < 2; end++){
+        glm::vec3 center = end == 0 ? part.from : part.to;
+        glm::vec3 normal = end == 0 ? -along : along;
+        unsigned int base = static_cast<unsigned int>(vertices.size());
+        for(int c = 0; c < 4; c++)
+            vertices.push_back(makeVertex(center + corners[c], normal, static_cast<float>(end)));
+        if(end == 0)
+            indices.insert(indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+        else
+            indices.insert(indices.end(), {base, base + 2, base + 1, base, base + 3, base + 2});
+    }
+}
+
+//关节在绑定姿势下的模型空间位置，绑定姿势没有旋转，局部变换就是相对父关节的平移
+void buildCharacterSkeleton(Skeleton &skeleton, vector<glm::vec3> &positions){
+    struct JointDesc { const char *name; int parent; glm::vec3 position; };
+    const JointDesc joints[] = {
+        {"Root", -1, glm::vec3(0.0f)},
+        {"Hips", JOINT_ROOT, glm::vec3(0.0f, 1.0f, 0.0f)},
+        {"Spine", JOINT_HIPS, glm::vec3(0.0f, 1.15f, 0.0f)},
+        {"Chest", JOINT_SPINE, glm::vec3(0.0f, 1.4f, 0.0f)},
+        {"Head", JOINT_CHEST, glm::vec3(0.0f, 1.72f, 0.0f)},
+        {"LeftUpperArm", JOINT_CHEST, glm::vec3(0.27f, 1.66f, 0.0f)},
+        {"LeftForeArm", JOINT_LEFT_UPPER_ARM, glm::vec3(0.27f, 1.36f, 0.0f)},
+        {"RightUpperArm", JOINT_CHEST, glm::vec3(-0.27f, 1.66f, 0.0f)},
+        {"RightForeArm", JOINT_RIGHT_UPPER_ARM, glm::vec3(-0.27f, 1.36f, 0.0f)},
+        {"LeftThigh", JOINT_HIPS, glm::vec3(0.1f, 0.95f, 0.0f)},
+        {"LeftShin", JOINT_LEFT_THIGH, glm::vec3(0.1f, 0.52f, 0.0f)},
+        {"RightThigh", JOINT_HIPS, glm::vec3(-0.1f, 0.95f, 0.0f)},
+        {"RightShin", JOINT_RIGHT_THIGH, glm::vec3(-0.1f, 0.52f, 0.0f)}
+    };
+    for(const JointDesc &joint : joints){
+        glm::vec3 parentPosition = joint.parent < 0 ? glm::vec3(0.0f) : positions[joint.parent];
+        int index = skeleton.AddJoint(joint.name, joint.parent, glm::translate(glm::mat4(1.0f), joint.position - parentPosition));
+        skeleton.inverseBind[index] = glm::translate(glm::mat4(1.0f), -joint.position);
+        positions.push_back(joint.position);
+    }
+}
+
+//生成一个循环片段：按采样帧率逐帧计算各关节的局部变换写成关键帧，再像导入的片段一样重新采样
+//stride为步幅（腿与手臂摆动的弧度），knee为膝盖最大弯曲，elbow为手肘弯曲，lean为上身前倾，bob为髋部上下起伏
+AnimationClip buildLocomotionClip(const Skeleton &skeleton, const string &name, float duration,
+    float stride, float knee, float elbow, float lean, float bob){
+    AnimationClip clip;
+    clip.name = name;
+    clip.duration = duration;
+    clip.tracks.resize(skeleton.Size());
+    unsigned int frames = static_cast<unsigned int>(ceil(duration * ANIMATION_SAMPLE_RATE));
+    const glm::vec3 axisX(1.0f, 0.0f, 0.0f), axisY(0.0f, 1.0f, 0.0f);
+    glm::vec3 hips = glm::vec3(skeleton.bindLocal[JOINT_HIPS][3]);
+    for(unsigned int f = 0; f <= frames; f++){
+        float time = min(duration, f / ANIMATION_SAMPLE_RATE);
+        float phase = time / duration * glm::two_pi<float>();
+        float swing = sin(phase);
+        //绕x轴正向旋转时向下的肢体向后摆，所以向前迈腿是负角度，膝盖向后弯是正角度
+        //腿向前迈出的后半程膝盖弯曲，两条腿相差半个周期
+        float leftKnee = knee * max(0.0f, sin(phase + glm::half_pi<float>()));
+        float rightKnee = knee * max(0.0f, sin(phase - glm::half_pi<float>()));
+        auto key = [&](int joint, const glm::quat &rotation){
+            clip.tracks[joint].rotations.push_back({time, rotation});
+        };
+        key(JOINT_LEFT_THIGH, glm::angleAxis(-stride * swing, axisX));
+        key(JOINT_RIGHT_THIGH, glm::angleAxis(stride * swing, axisX));
+        key(JOINT_LEFT_SHIN, glm::angleAxis(leftKnee, axisX));
+        key(JOINT_RIGHT_SHIN, glm::angleAxis(rightKnee, axisX));
+        //手臂与同侧的腿反向摆动
+        key(JOINT_LEFT_UPPER_ARM, glm::angleAxis(stride * 0.8f * swing, axisX));
+        key(JOINT_RIGHT_UPPER_ARM, glm::angleAxis(-stride * 0.8f * swing, axisX));
+        key(JOINT_LEFT_FOREARM, glm::angleAxis(-elbow, axisX));
+        key(JOINT_RIGHT_FOREARM, glm::angleAxis(-elbow, axisX));
+        key(JOINT_SPINE, glm::angleAxis(lean, axisX) * glm::angleAxis(0.15f * stride * swing, axisY));
+        key(JOINT_HEAD, glm::angleAxis(-lean * 0.5f, axisX));
+        //每迈一步髋部起伏一次
+        clip.tracks[JOINT_HIPS].positions.push_back({time, hips + glm::vec3(0.0f, bob * cos(phase * 2.0f), 0.0f)});
+    }
+    clip.Resample(skeleton);
+    return clip;
+}
+
+//生成程序化角色，网格只准备CPU数据，之后与导入的模型一样调用Upload
+void BuildProceduralCharacter(SkinnedModel &model){
+    vector<glm::vec3> positions;
+    buildCharacterSkeleton(model.skeleton, positions);
+    const BodyPart parts[] = {
+        {JOINT_HIPS, glm::vec3(0.0f, 0.88f, 0.0f), glm::vec3(0.0f, 1.15f, 0.0f), 0.34f, 0.2f, false},
+        {JOINT_SPINE, glm::vec3(0.0f, 1.15f, 0.0f), glm::vec3(0.0f, 1.4f, 0.0f), 0.3f, 0.18f, true},
+        {JOINT_CHEST, glm::vec3(0.0f, 1.4f, 0.0f), glm::vec3(0.0f, 1.7f, 0.0f), 0.42f, 0.22f, true},
+        {JOINT_HEAD, glm::vec3(0.0f, 1.72f, 0.0f), glm::vec3(0.0f, 2.0f, 0.0f), 0.2f, 0.22f, false},
+        {JOINT_LEFT_UPPER_ARM, positions[JOINT_LEFT_UPPER_ARM], positions[JOINT_LEFT_FOREARM], 0.1f, 0.1f, true},
+        {JOINT_LEFT_FOREARM, positions[JOINT_LEFT_FOREARM], positions[JOINT_LEFT_FOREARM] - glm::vec3(0.0f, 0.3f, 0.0f), 0.09f, 0.09f, true},
+        {JOINT_RIGHT_UPPER_ARM, positions[JOINT_RIGHT_UPPER_ARM], positions[JOINT_RIGHT_FOREARM], 0.1f, 0.1f, true},
+        {JOINT_RIGHT_FOREARM, positions[JOINT_RIGHT_FOREARM], positions[JOINT_RIGHT_FOREARM] - glm::vec3(0.0f, 0.3f, 0.0f), 0.09f, 0.09f, true},
+        {JOINT_LEFT_THIGH, positions[JOINT_LEFT_THIGH], positions[JOINT_LEFT_SHIN], 0.15f, 0.16f, true},
+        {JOINT_LEFT_SHIN, positions[JOINT_LEFT_SHIN], positions[JOINT_LEFT_SHIN] - glm::vec3(0.0f, 0.48f, 0.0f), 0.12f, 0.13f, true},
+        {JOINT_RIGHT_THIGH, positions[JOINT_RIGHT_THIGH], positions[JOINT_RIGHT_SHIN], 0.15f, 0.16f, true},
+        {JOINT_RIGHT_SHIN, positions[JOINT_RIGHT_SHIN], positions[JOINT_RIGHT_SHIN] - glm::vec3(0.0f, 0.48f, 0.0f), 0.12f, 0.13f, true}
+    };
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    for(const BodyPart &part : parts)
+        appendBodyPart(part, max(0, model.skeleton.parents[part.joint]), vertices, indices);
+    model.meshes.clear();
+    model.meshes.push_back(Mesh(move(vertices), move(indices), vector<Texture>(), false));
+    model.aabb = model.meshes[0].aabb;
+
+    model.clips.clear();
+    model.clips.push_back(buildLocomotionClip(model.skeleton, "Walk", 1.0f, 0.5f, 0.7f, 0.25f, 0.05f, 0.03f));
+    model.clips.push_back(buildLocomotionClip(model.skeleton, "Run", 0.6f, 0.9f, 1.4f, 1.3f, 0.3f, 0.07f));
+}
+
+#endif
@@ -0,0 +1,317 @@
+#ifndef SKINNEDMODEL_H
+#define SKINNEDMODEL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "Mesh.h"
+#include "Animation.h"
+#include "CustomShader.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <cstring>
+using namespace std;
+
+//解码后还没有上传的图片
+struct DecodedImage {
+    unsigned char *data = nullptr;
+    int width = 0, height = 0, nrComponents = 0;
+};
+
+//从文件中解码图片，不涉及OpenGL，可以在工作线程上调用
+DecodedImage DecodeImage(const string &filename){
+    DecodedImage image;
+    image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.nrComponents, 0);
+    return image;
+}
+
+//把解码后的图片上传为纹理并释放图片内存，必须在OpenGL线程调用
+unsigned int UploadImage(DecodedImage &image, const string &path){
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    if (image.data)
+    {
+        GLenum format;
+        if (image.nrComponents == 1)
+            format = GL_RED;
+        else if (image.nrComponents == 3)
+            format = GL_RGB;
+        else
+            format = GL_RGBA;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+    }
+    stbi_image_free(image.data);
+    image.data = nullptr;
+    return textureID;
+}
+
+//aiMatrix4x4是行主序，glm是列主序，需要转置
+glm::mat4 ConvertMatrix(const aiMatrix4x4 &from){
+    glm::mat4 to;
+    to[0][0] = from.a1; to[1][0] = from.a2; to[2][0] = from.a3; to[3][0] = from.a4;
+    to[0][1] = from.b1; to[1][1] = from.b2; to[2][1] = from.b3; to[3][1] = from.b4;
+    to[0][2] = from.c1; to[1][2] = from.c2; to[2][2] = from.c3; to[3][2] = from.c4;
+    to[0][3] = from.d1; to[1][3] = from.d2; to[2][3] = from.d3; to[3][3] = from.d4;
+    return to;
+}
+
+//把一个骨骼影响加入顶点，影响已满时替换权重最小的一个（权重更小时丢弃）
+void AddBoneInfluence(Vertex &vertex, int joint, float weight){
+    int smallest = 0;
+    for(int i = 0; i < MAX_BONE_INFLUENCE; i++){
+        if(vertex.m_Weights[i] < vertex.m_Weights[smallest])
+            smallest = i;
+    }
+    if(weight > vertex.m_Weights[smallest]){
+        vertex.m_BoneIDs[smallest] = joint;
+        vertex.m_Weights[smallest] = weight;
+    }
+}
+
+//权重归一化，丢弃超出MAX_BONE_INFLUENCE的影响后剩余权重之和可能小于1
+void NormalizeBoneWeights(Vertex &vertex){
+    float sum = 0.0f;
+    for(int i = 0; i < MAX_BONE_INFLUENCE; i++)
+        sum += vertex.m_Weights[i];
+    if(sum <= 0.0f)
+        return;
+    for(int i = 0; i < MAX_BONE_INFLUENCE; i++)
+        vertex.m_Weights[i] /= sum;
+}
+
+//蒙皮模型：骨骼、蒙皮网格与动画片段
+//网格顶点保持在绑定姿势的模型空间，骨骼ID是关节在skeleton中的下标，由顶点着色器按蒙皮矩阵变换
+class SkinnedModel {
+public:
+    Skeleton skeleton;
+    vector<Mesh> meshes;
+    vector<AnimationClip> clips;
+    vector<Texture> textures_loaded;
+    AABB aabb;//绑定姿势下所有网格的包围盒
+
+    //导入模型的CPU部分：节点层级作为骨骼，网格的aiBone写入顶点的骨骼ID与权重，aiAnimation作为动画片段
+    //网格转换、纹理解码与片段重新采样作为任务并行执行，返回false表示读取失败
+    bool Import(const string &path){
+        PROFILE_SCOPE("Import " + path.substr(path.find_last_of('/') + 1));
+        Assimp::Importer importer;
+        //aiProcess_LimitBoneWeights把每个顶点的骨骼影响限制为4个，与MAX_BONE_INFLUENCE一致
+        const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_LimitBoneWeights);
+        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode){
+            cout << "ERROR::ASSIMP::" << importer.GetErrorString() << endl;
+            return false;
+        }
+        directory = path.substr(0, path.find_last_of('/'));
+        processNode(scene->mRootNode, -1);
+        skeleton.globalInverse = glm::inverse(skeleton.bindLocal[0]);
+
+        //骨骼的inverseBind来自aiBone，同名骨骼在不同网格中的偏移矩阵相同
+        for(unsigned int m = 0; m < scene->mNumMeshes; m++){
+            const aiMesh *mesh = scene->mMeshes[m];
+            for(unsigned int b = 0; b < mesh->mNumBones; b++){
+                int joint = skeleton.Find(mesh->mBones[b]->mName.C_Str());
+                if(joint >= 0)
+                    skeleton.inverseBind[joint] = ConvertMatrix(mesh->mBones[b]->mOffsetMatrix);
+            }
+        }
+
+        vector<vector<Texture>> meshTextures(scene->mNumMeshes);
+        for(unsigned int i = 0; i < scene->mNumMeshes; i++)
+            meshTextures[i] = processMaterial(scene->mMeshes[i], scene);
+
+        JobCounter counter;
+        images.assign(textures_loaded.size(), DecodedImage());
+        for(unsigned int i = 0; i < textures_loaded.size(); i++){
+            JobSystem::Get().Run([this, i](){
+                PROFILE_SCOPE("Decode " + textures_loaded[i].path);
+                images[i] = DecodeImage(directory + '/' + textures_loaded[i].path);
+            }, &counter);
+        }
+        meshes.resize(scene->mNumMeshes);
+        for(unsigned int i = 0; i < scene->mNumMeshes; i++){
+            JobSystem::Get().Run([&, i](){
+                PROFILE_SCOPE(string("Mesh ") + scene->mMeshes[i]->mName.C_Str());
+                meshes[i] = processMesh(scene->mMeshes[i], meshTextures[i]);
+            }, &counter);
+        }
+        clips.resize(scene->mNumAnimations);
+        for(unsigned int i = 0; i < scene->mNumAnimations; i++){
+            JobSystem::Get().Run([&, i](){
+                PROFILE_SCOPE(string("Clip ") + scene->mAnimations[i]->mName.C_Str());
+                processAnimation(scene->mAnimations[i], clips[i]);
+            }, &counter);
+        }
+        JobSystem::Get().Wait(counter);
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            aabb.Expand(meshes[i].aabb);
+        return true;
+    }
+
+    //创建网格缓冲并上传解码好的纹理，必须在OpenGL线程调用
+    void Upload(){
+        PROFILE_FUNCTION();
+        for(unsigned int i = 0; i < textures_loaded.size() && i < images.size(); i++)
+            textures_loaded[i].id = UploadImage(images[i], textures_loaded[i].path);
+        images.clear();
+        for(unsigned int i = 0; i < meshes.size(); i++){
+            for(unsigned int t = 0; t < meshes[i].textures.size(); t++){
+                for(unsigned int j = 0; j < textures_loaded.size(); j++){
+                    if(meshes[i].textures[t].path == textures_loaded[j].path){
+                        meshes[i].textures[t].id = textures_loaded[j].id;
+                        break;
+                    }
+                }
+            }
+            meshes[i].Upload();
+        }
+    }
+
+    void SetInstanceBuffer(const InstanceBuffer &instances){
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].SetInstanceBuffer(instances);
+    }
+
+    //实例化绘制，没有纹理的网格使用实例颜色
+    void DrawInstanced(CustomShader &shader, unsigned int instanceCount){
+        for(unsigned int i = 0; i < meshes.size(); i++){
+            shader.setBool("useTexture", !meshes[i].textures.empty());
+            meshes[i].DrawInstanced(shader, instanceCount);
+        }
+    }
+
+private:
+    string directory;
+    vector<DecodedImage> images;
+
+    //每个节点都成为一个关节，深度优先，父关节总在子关节之前
+    //没有蒙皮顶点的节点（例如骨骼的父节点）也要参与层级变换，只是不会被顶点引用
+    void processNode(const aiNode *node, int parent){
+        int index = skeleton.AddJoint(node->mName.C_Str(), parent, ConvertMatrix(node->mTransformation));
+        for(unsigned int i = 0; i < node->mNumChildren; i++)
+            processNode(node->mChildren[i], index);
+    }
+
+    Mesh processMesh(const aiMesh *mesh, const vector<Texture> &textures){
+        vector<Vertex> vertices(mesh->mNumVertices);
+        vector<unsigned int> indices;
+        indices.reserve(mesh->mNumFaces * 3);
+        for(unsigned int i = 0; i < mesh->mNumVertices; i++){
+            Vertex &vertex = vertices[i];
+            vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+            vertex.Normal = mesh->HasNormals() ? glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z) : glm::vec3(0.0f, 1.0f, 0.0f);
+            vertex.TexCoords = mesh->mTextureCoords[0] ? glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y) : glm::vec2(0.0f);
+            vertex.Tangent = glm::vec3(0.0f);
+            vertex.Bitangent = glm::vec3(0.0f);
+            //没有骨骼影响的顶点权重全为0，着色器中不做变换
+            for(int k = 0; k < MAX_BONE_INFLUENCE; k++){
+                vertex.m_BoneIDs[k] = 0;
+                vertex.m_Weights[k] = 0.0f;
+            }
+        }
+        //aiBone按骨骼记录它影响的顶点与权重，这里反过来写入每个顶点
+        for(unsigned int b = 0; b < mesh->mNumBones; b++){
+            const aiBone *bone = mesh->mBones[b];
+            int joint = skeleton.Find(bone->mName.C_Str());
+            if(joint < 0)
+                continue;
+            for(unsigned int w = 0; w < bone->mNumWeights; w++){
+                unsigned int vertexId = bone->mWeights[w].mVertexId;
+                if(vertexId < vertices.size())
+                    AddBoneInfluence(vertices[vertexId], joint, bone->mWeights[w].mWeight);
+            }
+        }
+        for(unsigned int i = 0; i < vertices.size(); i++)
+            NormalizeBoneWeights(vertices[i]);
+        for(unsigned int i = 0; i < mesh->mNumFaces; i++){
+            const aiFace &face = mesh->mFaces[i];
+            for(unsigned int j = 0; j < face.mNumIndices; j++)
+                indices.push_back(face.mIndices[j]);
+        }
+        return Mesh(move(vertices), move(indices), textures, false);
+    }
+
+    //把aiAnimation的通道按节点名对应到关节，时间从tick换算为秒，然后重新采样
+    void processAnimation(const aiAnimation *animation, AnimationClip &clip){
+        float ticksPerSecond = animation->mTicksPerSecond > 0.0 ? static_cast<float>(animation->mTicksPerSecond) : 25.0f;
+        clip.name = animation->mName.C_Str();
+        clip.duration = static_cast<float>(animation->mDuration) / ticksPerSecond;
+        clip.tracks.resize(skeleton.Size());
+        for(unsigned int c = 0; c < animation->mNumChannels; c++){
+            const aiNodeAnim *channel = animation->mChannels[c];
+            int joint = skeleton.Find(channel->mNodeName.C_Str());
+            if(joint < 0)
+                continue;
+            JointTrack &track = clip.tracks[joint];
+            for(unsigned int k = 0; k < channel->mNumPositionKeys; k++){
+                const aiVectorKey &key = channel->mPositionKeys[k];
+                track.positions.push_back({static_cast<float>(key.mTime) / ticksPerSecond, glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z)});
+            }
+            for(unsigned int k = 0; k < channel->mNumRotationKeys; k++){
+                const aiQuatKey &key = channel->mRotationKeys[k];
+                track.rotations.push_back({static_cast<float>(key.mTime) / ticksPerSecond, glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z)});
+            }
+            for(unsigned int k = 0; k < channel->mNumScalingKeys; k++){
+                const aiVectorKey &key = channel->mScalingKeys[k];
+                track.scales.push_back({static_cast<float>(key.mTime) / ticksPerSecond, glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z)});
+            }
+        }
+        clip.Resample(skeleton);
+    }
+
+    vector<Texture> processMaterial(const aiMesh *mesh, const aiScene *scene){
+        vector<Texture> textures;
+        aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
+        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        return textures;
+    }
+
+    //只登记纹理，解码在Import中并行进行，纹理id在Upload时才会填入
+    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName){
+        vector<Texture> textures;
+        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++){
+            aiString str;
+            mat->GetTexture(type, i, &str);
+            bool skip = false;
+            for(unsigned int j = 0; j < textures_loaded.size(); j++){
+                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0){
+                    textures.push_back(textures_loaded[j]);
+                    skip = true;
+                    break;
+                }
+            }
+            if(!skip){
+                Texture texture;
+                texture.id = 0;
+                texture.type = typeName;
+                texture.path = str.C_Str();
+                textures.push_back(texture);
+                textures_loaded.push_back(texture);
+            }
+        }
+        return textures;
+    }
+};
+
+#endif
@@ -0,0 +1,276 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+//SIMD指令集选择：采样与混合都是对连续的vec4做线性插值，SSE一次处理一个vec4
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANIMATION_USE_SSE
+#include <emmintrin.h>
+#endif
+
+//每个关节的局部变换在姿势中占3个vec4：平移(xyz, 0)、旋转四元数(xyzw)、缩放(xyz, 0)
+#define JOINT_STRIDE 3
+//动画片段导入后重新采样的帧率
+#define ANIMATION_SAMPLE_RATE 30.0f
+
+//骨骼：关节按深度优先顺序存放，父关节总在子关节之前，于是从前往后一次遍历就能算出所有关节的模型空间变换
+struct Skeleton {
+    vector<string> names;
+    vector<int> parents;//父关节下标，根关节为-1
+    vector<glm::mat4> bindLocal;//绑定姿势下相对父关节的变换
+    vector<glm::mat4> inverseBind;//模型空间到关节空间的变换（aiBone::mOffsetMatrix），没有蒙皮顶点的关节为单位矩阵
+    glm::mat4 globalInverse = glm::mat4(1.0f);//根节点变换的逆，抵消导入时根节点上的坐标系转换
+
+    unsigned int Size() const{
+        return static_cast<unsigned int>(parents.size());
+    }
+
+    int Find(const string &name) const{
+        for(unsigned int i = 0; i < names.size(); i++){
+            if(names[i] == name)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    int AddJoint(const string &name, int parent, const glm::mat4 &local){
+        names.push_back(name);
+        parents.push_back(parent);
+        bindLocal.push_back(local);
+        inverseBind.push_back(glm::mat4(1.0f));
+        return static_cast<int>(parents.size()) - 1;
+    }
+};
+
+//关键帧
+struct VectorKey {
+    float time;//秒
+    glm::vec3 value;
+};
+struct QuatKey {
+    float time;
+    glm::quat value;
+};
+
+//单个关节的动画轨道，关键帧的时间间隔可以不均匀
+struct JointTrack {
+    vector<VectorKey> positions;
+    vector<QuatKey> rotations;
+    vector<VectorKey> scales;
+
+    bool Empty() const{
+        return positions.empty() && rotations.empty() && scales.empty();
+    }
+};
+
+//姿势：所有关节的局部变换，按关节顺序连续存放，每个关节JOINT_STRIDE个vec4
+struct Pose {
+    vector<glm::vec4> data;
+
+    void Resize(unsigned int jointCount){
+        data.resize(jointCount * JOINT_STRIDE);
+    }
+    unsigned int JointCount() const{
+        return static_cast<unsigned int>(data.size() / JOINT_STRIDE);
+    }
+};
+
+//把矩阵分解为平移、旋转、缩放（假设没有切变）
+inline void DecomposeTRS(const glm::mat4 &m, glm::vec3 &translation, glm::quat &rotation, glm::vec3 &scale){
+    translation = glm::vec3(m[3]);
+    scale = glm::vec3(glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2])));
+    glm::mat3 rotationMatrix(glm::vec3(m[0]) / scale.x, glm::vec3(m[1]) / scale.y, glm::vec3(m[2]) / scale.z);
+    rotation = glm::normalize(glm::quat_cast(rotationMatrix));
+}
+
+//由平移、旋转、缩放构建变换矩阵：T * R * S
+inline glm::mat4 ComposeTRS(const glm::vec4 &translation, const glm::vec4 &rotation, const glm::vec4 &scale){
+    glm::quat q(rotation.w, rotation.x, rotation.y, rotation.z);
+    glm::mat3 r = glm::mat3_cast(q);
+    glm::mat4 m(1.0f);
+    m[0] = glm::vec4(r[0] * scale.x, 0.0f);
+    m[1] = glm::vec4(r[1] * scale.y, 0.0f);
+    m[2] = glm::vec4(r[2] * scale.z, 0.0f);
+    m[3] = glm::vec4(glm::vec3(translation), 1.0f);
+    return m;
+}
+
+//动画片段：导入时保留原始关键帧，然后按固定帧率重新采样成所有关节连续存放的帧
+//运行时采样只需要找到相邻的两帧，对整帧数据做一次线性插值，不再为每个关节查找关键帧
+class AnimationClip {
+public:
+    string name;
+    float duration = 0.0f;//秒
+    bool looping = true;
+    vector<JointTrack> tracks;//与骨骼的关节一一对应，没有轨道的关节保持绑定姿势
+    unsigned int frameCount = 0;
+    vector<glm::vec4> frames;//frameCount * 关节数 * JOINT_STRIDE
+
+    //按ANIMATION_SAMPLE_RATE重新采样，相邻帧的四元数调整到同一半球，保证线性插值走最短路径
+    void Resample(const Skeleton &skeleton){
+        unsigned int jointCount = skeleton.Size();
+        tracks.resize(jointCount);
+        frameCount = max(2u, static_cast<unsigned int>(ceil(duration * ANIMATION_SAMPLE_RATE)) + 1);
+        frames.resize(frameCount * jointCount * JOINT_STRIDE);
+        for(unsigned int j = 0; j < jointCount; j++){
+            glm::vec3 bindTranslation, bindScale;
+            glm::quat bindRotation;
+            DecomposeTRS(skeleton.bindLocal[j], bindTranslation, bindRotation, bindScale);
+            glm::quat previous = bindRotation;
+            for(unsigned int f = 0; f < frameCount; f++){
+                float time = min(duration, f / ANIMATION_SAMPLE_RATE);
+                const JointTrack &track = tracks[j];
+                glm::vec3 t = track.positions.empty() ? bindTranslation : sampleVector(track.positions, time);
+                glm::quat r = track.rotations.empty() ? bindRotation : sampleQuat(track.rotations, time);
+                glm::vec3 s = track.scales.empty() ? bindScale : sampleVector(track.scales, time);
+                if(glm::dot(r, previous) < 0.0f)
+                    r = -r;
+                previous = r;
+                glm::vec4 *out = &frames[(f * jointCount + j) * JOINT_STRIDE];
+                out[0] = glm::vec4(t, 0.0f);
+                out[1] = glm::vec4(r.x, r.y, r.z, r.w);
+                out[2] = glm::vec4(s, 0.0f);
+            }
+        }
+    }
+
+    unsigned int JointCount() const{
+        return frameCount == 0 ? 0 : static_cast<unsigned int>(frames.size() / (frameCount * JOINT_STRIDE));
+    }
+
+private:
+    static glm::vec3 sampleVector(const vector<VectorKey> &keys, float time){
+        if(keys.size() == 1 || time <= keys.front().time)
+            return keys.front().value;
+        if(time >= keys.back().time)
+            return keys.back().value;
+        unsigned int i = static_cast<unsigned int>(upper_bound(keys.begin(), keys.end(), time, [](float t, const VectorKey &key){ return t < key.time; }) - keys.begin());
+        const VectorKey &a = keys[i - 1], &b = keys[i];
+        return glm::mix(a.value, b.value, (time - a.time) / max(b.time - a.time, 1e-6f));
+    }
+
+    static glm::quat sampleQuat(const vector<QuatKey> &keys, float time){
+        if(keys.size() == 1 || time <= keys.front().time)
+            return keys.front().value;
+        if(time >= keys.back().time)
+            return keys.back().value;
+        unsigned int i = static_cast<unsigned int>(upper_bound(keys.begin(), keys.end(), time, [](float t, const QuatKey &key){ return t < key.time; }) - keys.begin());
+        const QuatKey &a = keys[i - 1], &b = keys[i];
+        return glm::normalize(glm::slerp(a.value, b.value, (time - a.time) / max(b.time - a.time, 1e-6f)));
+    }
+};
+
+#if defined(ANIMATION_USE_SSE)
+//四元数归一化，四个分量的平方和通过两次洗牌求出并广播到所有通道
+inline __m128 normalizeQuatSSE(__m128 q){
+    __m128 sq = _mm_mul_ps(q, q);
+    sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+    sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_div_ps(q, _mm_sqrt_ps(sq));
+}
+#endif
+
+//在time秒处采样片段，time超出范围时循环片段取模，否则夹到首尾帧
+//相邻两帧整段线性插值，再把旋转归一化（nlerp）
+inline void SampleClip(const AnimationClip &clip, float time, Pose &pose){
+    unsigned int jointCount = clip.JointCount();
+    pose.Resize(jointCount);
+    if(jointCount == 0)
+        return;
+    if(clip.looping && clip.duration > 0.0f){
+        time = fmod(time, clip.duration);
+        if(time < 0.0f)
+            time += clip.duration;
+    }
+    float position = glm::clamp(time, 0.0f, clip.duration) * ANIMATION_SAMPLE_RATE;
+    unsigned int frame = min(static_cast<unsigned int>(position), clip.frameCount - 2);
+    float alpha = min(position - frame, 1.0f);
+    unsigned int count = jointCount * JOINT_STRIDE;
+    const glm::vec4 *a = &clip.frames[frame * count];
+    const glm::vec4 *b = a + count;
+    glm::vec4 *out = pose.data.data();
+#if defined(ANIMATION_USE_SSE)
+    __m128 weight = _mm_set1_ps(alpha);
+    for(unsigned int i = 0; i < count; i++){
+        __m128 va = _mm_loadu_ps(&a[i].x);
+        __m128 vb = _mm_loadu_ps(&b[i].x);
+        _mm_storeu_ps(&out[i].x, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), weight)));
+    }
+    for(unsigned int j = 0; j < jointCount; j++){
+        float *rotation = &out[j * JOINT_STRIDE + 1].x;
+        _mm_storeu_ps(rotation, normalizeQuatSSE(_mm_loadu_ps(rotation)));
+    }
+#else
+    for(unsigned int i = 0; i < count; i++)
+        out[i] = glm::mix(a[i], b[i], alpha);
+    for(unsigned int j = 0; j < jointCount; j++){
+        glm::vec4 &rotation = out[j * JOINT_STRIDE + 1];
+        rotation /= glm::length(rotation);
+    }
+#endif
+}
+
+//混合两个姿势：out = a * (1 - weight) + b * weight
+//旋转先把b调整到与a同一半球，线性插值后归一化；out可以与a或b是同一个姿势
+inline void BlendPoses(const Pose &a, const Pose &b, float weight, Pose &out){
+    unsigned int jointCount = min(a.JointCount(), b.JointCount());
+    out.Resize(jointCount);
+    const glm::vec4 *pa = a.data.data();
+    const glm::vec4 *pb = b.data.data();
+    glm::vec4 *po = out.data.data();
+#if defined(ANIMATION_USE_SSE)
+    __m128 w = _mm_set1_ps(weight);
+    __m128 signMask = _mm_set1_ps(-0.0f);
+    for(unsigned int j = 0; j < jointCount; j++){
+        unsigned int i = j * JOINT_STRIDE;
+        __m128 ta = _mm_loadu_ps(&pa[i].x), tb = _mm_loadu_ps(&pb[i].x);
+        __m128 ra = _mm_loadu_ps(&pa[i + 1].x), rb = _mm_loadu_ps(&pb[i + 1].x);
+        __m128 sa = _mm_loadu_ps(&pa[i + 2].x), sb = _mm_loadu_ps(&pb[i + 2].x);
+        //点积的符号位广播到所有通道，与rb异或即可在点积为负时取反
+        __m128 dot = _mm_mul_ps(ra, rb);
+        dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(2, 3, 0, 1)));
+        dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(1, 0, 3, 2)));
+        rb = _mm_xor_ps(rb, _mm_and_ps(dot, signMask));
+        _mm_storeu_ps(&po[i].x, _mm_add_ps(ta, _mm_mul_ps(_mm_sub_ps(tb, ta), w)));
+        _mm_storeu_ps(&po[i + 1].x, normalizeQuatSSE(_mm_add_ps(ra, _mm_mul_ps(_mm_sub_ps(rb, ra), w))));
+        _mm_storeu_ps(&po[i + 2].x, _mm_add_ps(sa, _mm_mul_ps(_mm_sub_ps(sb, sa), w)));
+    }
+#else
+    for(unsigned int j = 0; j < jointCount; j++){
+        unsigned int i = j * JOINT_STRIDE;
+        glm::vec4 rb = glm::dot(pa[i + 1], pb[i + 1]) < 0.0f ? -pb[i + 1] : pb[i + 1];
+        glm::vec4 rotation = glm::mix(pa[i + 1], rb, weight);
+        po[i] = glm::mix(pa[i], pb[i], weight);
+        po[i + 1] = rotation / glm::length(rotation);
+        po[i + 2] = glm::mix(pa[i + 2], pb[i + 2], weight);
+    }
+#endif
+}
+
+//由局部姿势计算蒙皮矩阵：关节的模型空间变换 = 父关节模型空间变换 * 局部变换，
+//蒙皮矩阵 = globalInverse * 模型空间变换 * inverseBind
+//输出为每个关节3个vec4，即蒙皮矩阵转置后的前三行（最后一行总是0 0 0 1），直接写入缓冲纹理
+inline void BuildSkinningPalette(const Skeleton &skeleton, const Pose &pose, vector<glm::mat4> &modelSpace, glm::vec4 *palette){
+    unsigned int jointCount = min(skeleton.Size(), pose.JointCount());
+    modelSpace.resize(jointCount);
+    const glm::vec4 *local = pose.data.data();
+    for(unsigned int j = 0; j < jointCount; j++){
+        glm::mat4 m = ComposeTRS(local[j * JOINT_STRIDE], local[j * JOINT_STRIDE + 1], local[j * JOINT_STRIDE + 2]);
+        int parent = skeleton.parents[j];
+        modelSpace[j] = parent < 0 ? m : modelSpace[parent] * m;
+        glm::mat4 skin = skeleton.globalInverse * modelSpace[j] * skeleton.inverseBind[j];
+        //glm按列存放，第r行为(skin[0][r], skin[1][r], skin[2][r], skin[3][r])
+        for(int r = 0; r < 3; r++)
+            palette[j * 3 + r] = glm::vec4(skin[0][r], skin[1][r], skin[2][r], skin[3][r]);
+    }
+}
+
+#endif
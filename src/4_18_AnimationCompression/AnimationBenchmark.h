@@ -0,0 +1,143 @@
+#ifndef ANIMATIONBENCHMARK_H
+#define ANIMATIONBENCHMARK_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include "Animation.h"
+#include "AnimationCompression.h"
+using namespace std;
+
+//动画压缩的基准测试：每个片段的内存、压缩误差与每个关节的采样耗时
+//  make animbench dir=4_18_AnimationCompression
+//不创建窗口，使用程序化角色或--model指定的模型中的片段
+struct AnimationBenchmarkOptions {
+    bool enabled = false;
+    unsigned int repeats = 5;//每项测试重复的次数，取最快的一次
+};
+
+//解析 --animbench、--repeats N，其余参数忽略
+AnimationBenchmarkOptions ParseAnimationBenchmarkArgs(int argc, char *argv[]){
+    AnimationBenchmarkOptions options;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--animbench")
+            options.enabled = true;
+        else if(arg == "--repeats" && i + 1 < argc)
+            options.repeats = static_cast<unsigned int>(max(1, atoi(argv[++i])));
+    }
+    return options;
+}
+
+class AnimationBenchmark {
+public:
+    AnimationBenchmark(const AnimationBenchmarkOptions &options) : options(options){}
+
+    void Run(const Skeleton &skeleton, const vector<AnimationClip> &clips, const vector<CompressedClip> &compressed){
+        cout << "Animation compression benchmark: " << skeleton.Size() << " joints, best of " << options.repeats << " runs" << endl;
+        cout << left << setw(16) << "clip" << right << setw(8) << "frames" << setw(12) << "source KB" << setw(14) << "resampled KB"
+            << setw(15) << "compressed KB" << setw(8) << "ratio" << setw(12) << "keys kept" << setw(12) << "max error"
+            << setw(14) << "uniform ns" << setw(14) << "stream ns" << setw(14) << "seek ns" << endl;
+        cout << fixed;
+        for(unsigned int i = 0; i < clips.size() && i < compressed.size(); i++){
+            const AnimationClip &clip = clips[i];
+            const CompressedClip &packed = compressed[i];
+            unsigned int jointCount = clip.JointCount();
+            if(jointCount == 0 || packed.jointCount == 0)
+                continue;
+            size_t resampled = ResampledBytes(clip);
+            size_t bytes = packed.MemoryBytes();
+            size_t totalKeys = static_cast<size_t>(clip.frameCount) * packed.TrackCount();
+            double uniform = sampleUniform(clip) * 1e6 / (SAMPLE_COUNT * jointCount);
+            double stream = sampleStream(packed) * 1e6 / (SAMPLE_COUNT * jointCount);
+            double seek = sampleSeek(packed) * 1e6 / (SAMPLE_COUNT * jointCount);
+            cout << left << setw(16) << clip.name.substr(0, 15) << right << setw(8) << clip.frameCount
+                << setprecision(1) << setw(12) << SourceKeyBytes(clip) / 1024.0 << setw(14) << resampled / 1024.0
+                << setw(15) << bytes / 1024.0 << setw(7) << static_cast<double>(resampled) / bytes << "x"
+                << setw(11) << 100.0 * packed.keys.size() / totalKeys << "%"
+                << setprecision(5) << setw(12) << maxError(skeleton, clip, packed)
+                << setprecision(2) << setw(14) << uniform << setw(14) << stream << setw(14) << seek << endl;
+        }
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+        cout << "max error: largest model-space joint position difference from the resampled clip" << endl;
+        cout << "uniform: resampled clip, stream: compressed clip played forward at 60 Hz, seek: compressed clip at random times (ns per joint)" << endl;
+    }
+
+private:
+    static const unsigned int SAMPLE_COUNT = 20000;
+    AnimationBenchmarkOptions options;
+    Pose pose, reference;
+    vector<glm::mat4> modelSpace, referenceSpace;
+    vector<glm::vec4> palette;
+
+    //重复执行取最快的一次，单位毫秒
+    double best(const function<void()> &func){
+        double result = 1e30;
+        for(unsigned int i = 0; i < options.repeats; i++){
+            auto start = chrono::steady_clock::now();
+            func();
+            result = min(result, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        }
+        return result;
+    }
+
+    //按60Hz向前播放，超过片段时长后循环
+    static float playbackTime(unsigned int i){
+        return i / 60.0f;
+    }
+
+    double sampleUniform(const AnimationClip &clip){
+        return best([&](){
+            for(unsigned int i = 0; i < SAMPLE_COUNT; i++)
+                SampleClip(clip, playbackTime(i), pose);
+        });
+    }
+
+    double sampleStream(const CompressedClip &clip){
+        ClipCursor cursor;
+        return best([&](){
+            for(unsigned int i = 0; i < SAMPLE_COUNT; i++)
+                SampleCompressedClip(clip, playbackTime(i), cursor, pose);
+        });
+    }
+
+    //随机时间采样，大约一半需要从头读取流，是游标最差的情况
+    double sampleSeek(const CompressedClip &clip){
+        vector<float> times(SAMPLE_COUNT);
+        srand(7);
+        for(unsigned int i = 0; i < SAMPLE_COUNT; i++)
+            times[i] = (rand() % 10000) / 10000.0f * clip.duration;
+        ClipCursor cursor;
+        return best([&](){
+            for(unsigned int i = 0; i < SAMPLE_COUNT; i++)
+                SampleCompressedClip(clip, times[i], cursor, pose);
+        });
+    }
+
+    //在四倍于重新采样帧率的时间点上比较两者计算出的关节模型空间位置
+    float maxError(const Skeleton &skeleton, const AnimationClip &clip, const CompressedClip &packed){
+        palette.resize(skeleton.Size() * 3);
+        ClipCursor cursor;
+        float error = 0.0f;
+        unsigned int steps = static_cast<unsigned int>(clip.duration * ANIMATION_SAMPLE_RATE * 4.0f) + 1;
+        for(unsigned int i = 0; i <= steps; i++){
+            float time = min(clip.duration, i / (ANIMATION_SAMPLE_RATE * 4.0f));
+            SampleClip(clip, time, reference);
+            SampleCompressedClip(packed, time, cursor, pose);
+            BuildSkinningPalette(skeleton, reference, referenceSpace, palette.data());
+            BuildSkinningPalette(skeleton, pose, modelSpace, palette.data());
+            for(unsigned int j = 0; j < modelSpace.size(); j++)
+                error = max(error, glm::length(glm::vec3(modelSpace[j][3] - referenceSpace[j][3])));
+        }
+        return error;
+    }
+};
+
+#endif
@@ -0,0 +1,315 @@
+#ifndef ANIMATIONCOMPRESSION_H
+#define ANIMATIONCOMPRESSION_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#include "Animation.h"
+using namespace std;
+
+//动画压缩：把重新采样后的片段编译成紧凑的关键帧流
+//  1. 每条轨道（关节的平移、旋转、缩放各一条）去掉可以由相邻关键帧插值得到的关键帧，误差不超过容差
+//  2. 旋转用smallest-three打包：丢掉绝对值最大的分量（由单位长度恢复），其余三个各15位，共48位
+//     平移与缩放按轨道自己的范围量化为16位
+//  3. 所有轨道的关键帧按"什么时候会被用到"排序成一条流，播放时游标只向前线性读取，不需要查找
+
+//去除关键帧时允许的误差，平移与缩放为模型空间的单位，旋转为弧度
+//旋转误差在骨骼末端造成的位移约为 误差 * 骨骼长度，模型单位是厘米时平移容差也要相应放大
+struct CompressionSettings {
+    float translationTolerance = 0.001f;
+    float rotationTolerance = 0.001f;
+    float scaleTolerance = 0.001f;
+};
+
+//轨道编号 = 关节 * JOINT_STRIDE + 通道，通道顺序与Pose中vec4的顺序一致
+enum TrackChannel {
+    CHANNEL_TRANSLATION = 0,
+    CHANNEL_ROTATION,
+    CHANNEL_SCALE
+};
+
+//压缩后的关键帧，10字节
+struct CompressedKey {
+    uint16_t track;
+    uint16_t frame;//重新采样后的帧号
+    uint16_t data[3];//旋转为smallest-three，平移与缩放为量化后的xyz
+};
+
+//平移与缩放轨道的量化范围：值 = min + extent * 量化值 / 65535
+struct QuantizeRange {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 extent = glm::vec3(0.0f);
+};
+
+//smallest-three：第一、二个分量的最高位存放被丢掉的分量下标，三个分量各15位
+//丢掉的分量取正（q与-q表示同一个旋转），其余分量的绝对值不超过1/sqrt(2)
+inline void PackQuat(const glm::vec4 &q, uint16_t out[3]){
+    int largest = 0;
+    for(int i = 1; i < 4; i++){
+        if(fabs(q[i]) > fabs(q[largest]))
+            largest = i;
+    }
+    glm::vec4 v = q[largest] < 0.0f ? -q : q;
+    uint16_t packed[3];
+    for(int i = 0, k = 0; i < 4; i++){
+        if(i == largest)
+            continue;
+        float normalized = glm::clamp(v[i] * glm::root_two<float>() * 0.5f + 0.5f, 0.0f, 1.0f);
+        packed[k++] = static_cast<uint16_t>(normalized * 32767.0f + 0.5f);
+    }
+    out[0] = static_cast<uint16_t>(packed[0] | ((largest & 1) << 15));
+    out[1] = static_cast<uint16_t>(packed[1] | ((largest >> 1) << 15));
+    out[2] = packed[2];
+}
+
+inline glm::vec4 UnpackQuat(const uint16_t data[3]){
+    int largest = (data[0] >> 15) | ((data[1] >> 15) << 1);
+    float values[3];
+    for(int k = 0; k < 3; k++)
+        values[k] = ((data[k] & 0x7FFF) / 32767.0f - 0.5f) * glm::root_two<float>();
+    glm::vec4 q;
+    float sum = 0.0f;
+    for(int i = 0, k = 0; i < 4; i++){
+        if(i == largest)
+            continue;
+        q[i] = values[k];
+        sum += values[k] * values[k];
+        k++;
+    }
+    q[largest] = sqrt(max(0.0f, 1.0f - sum));
+    return q;
+}
+
+inline void QuantizeVector(const glm::vec4 &value, const QuantizeRange &range, uint16_t out[3]){
+    for(int i = 0; i < 3; i++){
+        float normalized = range.extent[i] > 0.0f ? (value[i] - range.min[i]) / range.extent[i] : 0.0f;
+        out[i] = static_cast<uint16_t>(glm::clamp(normalized, 0.0f, 1.0f) * 65535.0f + 0.5f);
+    }
+}
+
+inline glm::vec4 DequantizeVector(const uint16_t data[3], const QuantizeRange &range){
+    return glm::vec4(range.min + range.extent * glm::vec3(data[0], data[1], data[2]) * (1.0f / 65535.0f), 0.0f);
+}
+
+//压缩后的片段，只读，可以被任意多个游标同时采样
+class CompressedClip {
+public:
+    string name;
+    float duration = 0.0f;
+    bool looping = true;
+    unsigned int frameCount = 0;
+    unsigned int jointCount = 0;
+    vector<QuantizeRange> ranges;//每条轨道一个，旋转轨道不使用
+    vector<CompressedKey> keys;//所有轨道的关键帧，按被用到的先后排序
+
+    unsigned int TrackCount() const{
+        return jointCount * JOINT_STRIDE;
+    }
+
+    glm::vec4 Decode(const CompressedKey &key) const{
+        if(key.track % JOINT_STRIDE == CHANNEL_ROTATION)
+            return UnpackQuat(key.data);
+        return DequantizeVector(key.data, ranges[key.track]);
+    }
+
+    size_t MemoryBytes() const{
+        return sizeof(CompressedClip) + name.size() + ranges.size() * sizeof(QuantizeRange) + keys.size() * sizeof(CompressedKey);
+    }
+};
+
+//原始片段的内存：导入时的关键帧与重新采样后的帧
+inline size_t SourceKeyBytes(const AnimationClip &clip){
+    size_t bytes = 0;
+    for(unsigned int i = 0; i < clip.tracks.size(); i++)
+        bytes += clip.tracks[i].positions.size() * sizeof(VectorKey) + clip.tracks[i].rotations.size() * sizeof(QuatKey) + clip.tracks[i].scales.size() * sizeof(VectorKey);
+    return bytes;
+}
+
+inline size_t ResampledBytes(const AnimationClip &clip){
+    return clip.frames.size() * sizeof(glm::vec4);
+}
+
+//在first与last两帧之间插值得到frame帧的值，与采样时的插值方式相同（旋转为nlerp）
+inline glm::vec4 interpolateTrackValue(const glm::vec4 &first, const glm::vec4 &last, float alpha, bool rotation){
+    glm::vec4 value = first + (last - first) * alpha;
+    return rotation ? value / glm::length(value) : value;
+}
+
+inline float trackValueError(const glm::vec4 &a, const glm::vec4 &b, bool rotation){
+    if(rotation)
+        return 2.0f * acos(min(1.0f, fabs(glm::dot(a, b))));
+    return glm::length(glm::vec3(a - b));
+}
+
+//从第一帧开始，尽量延长当前段，直到段内某一帧的插值误差超过容差，上一个可以延长到的帧成为关键帧
+//首尾两帧总是保留，所以每条轨道至少两个关键帧，值不变的轨道正好两个
+inline vector<unsigned int> reduceTrackKeys(const vector<glm::vec4> &values, bool rotation, float tolerance){
+    vector<unsigned int> kept;
+    unsigned int count = static_cast<unsigned int>(values.size());
+    kept.push_back(0);
+    unsigned int start = 0;
+    while(start < count - 1){
+        unsigned int end = start + 1;
+        for(unsigned int candidate = start + 2; candidate < count; candidate++){
+            bool fits = true;
+            for(unsigned int k = start + 1; k < candidate && fits; k++){
+                float alpha = static_cast<float>(k - start) / (candidate - start);
+                fits = trackValueError(interpolateTrackValue(values[start], values[candidate], alpha, rotation), values[k], rotation) <= tolerance;
+            }
+            if(!fits)
+                break;
+            end = candidate;
+        }
+        kept.push_back(end);
+        start = end;
+    }
+    return kept;
+}
+
+//把重新采样后的片段编译为压缩片段
+inline CompressedClip CompressClip(const AnimationClip &clip, const CompressionSettings &settings = CompressionSettings()){
+    CompressedClip result;
+    result.name = clip.name;
+    result.duration = clip.duration;
+    result.looping = clip.looping;
+    result.frameCount = clip.frameCount;
+    result.jointCount = clip.JointCount();
+    unsigned int trackCount = result.TrackCount();
+    if(result.frameCount > 65535 || trackCount > 65535){
+        cout << "ERROR::ANIMATION::CLIP_TOO_LARGE: " << clip.name << " (" << result.frameCount << " frames, " << trackCount << " tracks)" << endl;
+        result.frameCount = 0;
+        result.jointCount = 0;
+        return result;
+    }
+    result.ranges.resize(trackCount);
+    //key与它被用到的帧：轨道的第k个关键帧在游标越过第k-1个关键帧时才需要，前两个关键帧一开始就需要
+    struct PendingKey {
+        int needFrame;
+        CompressedKey key;
+    };
+    vector<PendingKey> pending;
+    vector<glm::vec4> values(result.frameCount);
+    for(unsigned int track = 0; track < trackCount; track++){
+        unsigned int joint = track / JOINT_STRIDE;
+        unsigned int channel = track % JOINT_STRIDE;
+        bool rotation = channel == CHANNEL_ROTATION;
+        float tolerance = rotation ? settings.rotationTolerance : (channel == CHANNEL_TRANSLATION ? settings.translationTolerance : settings.scaleTolerance);
+        for(unsigned int f = 0; f < result.frameCount; f++)
+            values[f] = clip.frames[(f * result.jointCount + joint) * JOINT_STRIDE + channel];
+        vector<unsigned int> kept = reduceTrackKeys(values, rotation, tolerance);
+        QuantizeRange &range = result.ranges[track];
+        if(!rotation){
+            glm::vec3 minValue(values[kept[0]]), maxValue(values[kept[0]]);
+            for(unsigned int i = 1; i < kept.size(); i++){
+                minValue = glm::min(minValue, glm::vec3(values[kept[i]]));
+                maxValue = glm::max(maxValue, glm::vec3(values[kept[i]]));
+            }
+            range.min = minValue;
+            range.extent = maxValue - minValue;
+        }
+        for(unsigned int i = 0; i < kept.size(); i++){
+            PendingKey key;
+            key.needFrame = i < 2 ? static_cast<int>(i) - 1 : static_cast<int>(kept[i - 1]);
+            key.key.track = static_cast<uint16_t>(track);
+            key.key.frame = static_cast<uint16_t>(kept[i]);
+            if(rotation)
+                PackQuat(values[kept[i]], key.key.data);
+            else
+                QuantizeVector(values[kept[i]], range, key.key.data);
+            pending.push_back(key);
+        }
+    }
+    stable_sort(pending.begin(), pending.end(), [](const PendingKey &a, const PendingKey &b){
+        return a.needFrame < b.needFrame;
+    });
+    result.keys.resize(pending.size());
+    for(unsigned int i = 0; i < pending.size(); i++)
+        result.keys[i] = pending[i].key;
+    return result;
+}
+
+//播放游标：每条轨道当前所在区间的两个关键帧（已解码），以及在关键帧流中读到的位置
+//时间向前推进时只需要继续读取流，时间倒退（例如循环回到开头）时从头重新读取
+//每个播放中的片段实例需要自己的游标
+struct ClipCursor {
+    struct TrackState {
+        glm::vec4 previous, next;
+        float previousFrame, nextFrame;
+    };
+    vector<TrackState> tracks;
+    unsigned int position = 0;
+    float frame = -1.0f;
+
+    void Reset(const CompressedClip &clip){
+        tracks.resize(clip.TrackCount());
+        for(unsigned int i = 0; i < tracks.size(); i++){
+            tracks[i].previous = tracks[i].next = glm::vec4(0.0f);
+            tracks[i].previousFrame = tracks[i].nextFrame = -1.0f;
+        }
+        position = 0;
+        frame = -1.0f;
+    }
+};
+
+//在time秒处采样压缩片段，循环与夹取的规则与SampleClip相同
+inline void SampleCompressedClip(const CompressedClip &clip, float time, ClipCursor &cursor, Pose &pose){
+    unsigned int jointCount = clip.jointCount;
+    pose.Resize(jointCount);
+    if(jointCount == 0)
+        return;
+    if(clip.looping && clip.duration > 0.0f){
+        time = fmod(time, clip.duration);
+        if(time < 0.0f)
+            time += clip.duration;
+    }
+    float frame = min(glm::clamp(time, 0.0f, clip.duration) * ANIMATION_SAMPLE_RATE, static_cast<float>(clip.frameCount - 1));
+    if(frame < cursor.frame || cursor.tracks.size() != clip.TrackCount())
+        cursor.Reset(clip);
+    cursor.frame = frame;
+    //流按被用到的帧排序：遇到第一个还不需要的关键帧，之后的关键帧也都不需要
+    const CompressedKey *keys = clip.keys.data();
+    unsigned int keyCount = static_cast<unsigned int>(clip.keys.size());
+    while(cursor.position < keyCount){
+        const CompressedKey &key = keys[cursor.position];
+        ClipCursor::TrackState &state = cursor.tracks[key.track];
+        if(frame < state.nextFrame)
+            break;
+        state.previous = state.next;
+        state.previousFrame = state.nextFrame;
+        state.next = clip.Decode(key);
+        state.nextFrame = key.frame;
+        //smallest-three会改变符号，解码后重新调整到与前一个关键帧同一半球
+        if(key.track % JOINT_STRIDE == CHANNEL_ROTATION && glm::dot(state.previous, state.next) < 0.0f)
+            state.next = -state.next;
+        cursor.position++;
+    }
+    const ClipCursor::TrackState *states = cursor.tracks.data();
+    glm::vec4 *out = pose.data.data();
+    unsigned int trackCount = clip.TrackCount();
+#if defined(ANIMATION_USE_SSE)
+    for(unsigned int i = 0; i < trackCount; i++){
+        const ClipCursor::TrackState &state = states[i];
+        float span = state.nextFrame - state.previousFrame;
+        __m128 alpha = _mm_set1_ps(span > 0.0f ? glm::clamp((frame - state.previousFrame) / span, 0.0f, 1.0f) : 0.0f);
+        __m128 a = _mm_loadu_ps(&state.previous.x);
+        __m128 b = _mm_loadu_ps(&state.next.x);
+        __m128 value = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), alpha));
+        if(i % JOINT_STRIDE == CHANNEL_ROTATION)
+            value = normalizeQuatSSE(value);
+        _mm_storeu_ps(&out[i].x, value);
+    }
+#else
+    for(unsigned int i = 0; i < trackCount; i++){
+        const ClipCursor::TrackState &state = states[i];
+        float span = state.nextFrame - state.previousFrame;
+        float alpha = span > 0.0f ? glm::clamp((frame - state.previousFrame) / span, 0.0f, 1.0f) : 0.0f;
+        out[i] = interpolateTrackValue(state.previous, state.next, alpha, i % JOINT_STRIDE == CHANNEL_ROTATION);
+    }
+#endif
+}
+
+#endif
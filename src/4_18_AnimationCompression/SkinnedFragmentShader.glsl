@@ -0,0 +1,33 @@
+#version 330 core
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+in vec3 Tint;
+out vec4 FragColor;
+
+struct Material{
+    sampler2D texture_diffuse1;
+};
+
+//定向光
+struct DirLight{
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+};
+
+uniform Material material;
+uniform DirLight dirLight;
+uniform bool useTexture;//导入的模型有漫反射贴图时使用贴图，否则使用实例颜色
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(-dirLight.direction);
+    vec3 albedo = useTexture ? texture(material.texture_diffuse1, TexCoords).rgb : Tint;
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 color = dirLight.ambient * albedo + dirLight.diffuse * diff * albedo;
+    //简单的gamma校正
+    FragColor = vec4(pow(color, vec3(1.0 / 2.2)), 1.0);
+}
@@ -0,0 +1,51 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in ivec4 aBoneIDs;
+layout (location = 6) in vec4 aWeights;
+//每个角色的模型矩阵与颜色（实例化数组）
+layout (location = 7) in mat4 aInstanceMatrix;
+layout (location = 11) in vec4 aInstanceColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+//所有角色的蒙皮矩阵，每个角色boneCount个矩阵，每个矩阵3个texel（转置后的前三行）
+uniform samplerBuffer bonePalette;
+uniform int boneCount;
+
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TexCoords;
+out vec3 Tint;
+
+mat4 BoneMatrix(int bone)
+{
+    int base = (gl_InstanceID * boneCount + bone) * 3;
+    vec4 row0 = texelFetch(bonePalette, base);
+    vec4 row1 = texelFetch(bonePalette, base + 1);
+    vec4 row2 = texelFetch(bonePalette, base + 2);
+    //mat4的构造参数是列，转置后三个texel成为前三行
+    return transpose(mat4(row0, row1, row2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main()
+{
+    //没有骨骼影响的顶点（例如地面）权重全为0，保持不变
+    mat4 skin = mat4(1.0);
+    float total = aWeights.x + aWeights.y + aWeights.z + aWeights.w;
+    if(total > 0.0){
+        skin = BoneMatrix(aBoneIDs.x) * aWeights.x;
+        skin += BoneMatrix(aBoneIDs.y) * aWeights.y;
+        skin += BoneMatrix(aBoneIDs.z) * aWeights.z;
+        skin += BoneMatrix(aBoneIDs.w) * aWeights.w;
+    }
+    mat4 model = aInstanceMatrix * skin;
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    gl_Position = projection * view * worldPos;
+    //蒙皮矩阵只有旋转与平移（缩放一致），直接用它变换法线
+    Normal = mat3(model) * aNormal;
+    FragPos = worldPos.xyz;
+    TexCoords = aTexCoords;
+    Tint = aInstanceColor.rgb;
+}
@@ -0,0 +1,466 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "InstanceBuffer.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "Animation.h"
+#include "SkinnedModel.h"
+#include "ProceduralCharacter.h"
+#include "AnimationCompression.h"
+#include "AnimationBenchmark.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_18_AnimationCompression/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+CustomCamera camera(glm::vec3(0.0f, 14.0f, 48.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -18.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//角色数量上限，实际上限还受缓冲纹理大小限制（GL_MAX_TEXTURE_BUFFER_SIZE，OpenGL 3.3至少65536个texel）
+const unsigned int MAX_CHARACTERS = 4000;
+const unsigned int CHARACTER_STEP = 100;
+//每个角色绕自己的圆圈走动，圆心排成网格
+const float CELL_SIZE = 3.0f;
+const float CHARACTER_HEIGHT = 1.8f;
+const float WALK_SPEED = 1.4f;
+const float RUN_SPEED = 3.6f;
+//每个任务处理的角色数，一个角色的采样、混合与蒙皮矩阵大约几微秒
+const unsigned int CHARACTER_GRAIN = 8;
+//蒙皮矩阵缓冲纹理使用的纹理单元，0号开始留给模型的贴图
+const int PALETTE_TEXTURE_UNIT = 8;
+
+unsigned int characterCount = 400;
+unsigned int maxCharacters = MAX_CHARACTERS;
+bool blendEnabled = true;
+bool jobsEnabled = true;
+bool compressionEnabled = true;
+bool blendKeyDown = false;
+bool compressionKeyDown = false;
+bool jobsKeyDown = false;
+bool moreKeyDown = false;
+bool lessKeyDown = false;
+bool traceKeyDown = false;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //B键开关走跑混合（关闭时只采样第一个片段），J键在任务系统与单线程之间切换，=与-键增减角色数量
+    bool key = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+    if(key && !blendKeyDown)
+        blendEnabled = !blendEnabled;
+    blendKeyDown = key;
+    //C键在压缩片段与重新采样的片段之间切换
+    key = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    if(key && !compressionKeyDown)
+        compressionEnabled = !compressionEnabled;
+    compressionKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS;
+    if(key && !jobsKeyDown)
+        jobsEnabled = !jobsEnabled;
+    jobsKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS;
+    if(key && !moreKeyDown)
+        characterCount = min(characterCount + CHARACTER_STEP, maxCharacters);
+    moreKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS;
+    if(key && !lessKeyDown)
+        characterCount = characterCount > CHARACTER_STEP ? characterCount - CHARACTER_STEP : 1;
+    lessKeyDown = key;
+    //T键导出最近的帧为Chrome trace，并在控制台输出各作用域的平均耗时
+    key = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+    if(key && !traceKeyDown){
+        Profiler::Get().ExportChromeTrace("./output/profile_trace.json");
+        vector<ProfileSummary> summary = Profiler::Get().Summarize();
+        cout << left << setw(28) << "scope" << right << setw(10) << "cpu ms" << setw(10) << "gpu ms" << setw(8) << "calls" << endl;
+        cout << fixed << setprecision(3);
+        for(unsigned int i = 0; i < summary.size(); i++)
+            cout << left << setw(28) << summary[i].name << right << setw(10) << summary[i].cpuMs << setw(10) << summary[i].gpuMs << setw(8) << summary[i].calls << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+    }
+    traceKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+//把[0, count)交给任务系统并行处理，关闭任务系统时在当前线程上一次处理完
+void parallelFor(unsigned int count, unsigned int grainSize, const function<void(unsigned int, unsigned int)> &func){
+    if(jobsEnabled)
+        JobSystem::Get().ParallelFor(count, grainSize, func);
+    else if(count > 0)
+        func(0, count);
+}
+
+//角色状态：沿圆圈行走，phase为步态周期中的位置（0~1），两个片段按同一个phase采样，混合时脚步保持同步
+struct Character {
+    glm::vec3 center;
+    float radius;
+    float angle;
+    float phase;
+    float blendOffset;//走跑混合权重随时间变化的相位，让每个角色在不同时刻加速
+    glm::vec4 color;
+    ClipCursor walkCursor, runCursor;//采样压缩片段的游标，每个角色各自播放
+};
+
+//命令行参数：--model 蒙皮模型路径，--threads 线程数，--characters 初始角色数，其余参数忽略
+struct AppOptions {
+    string modelPath;
+    int threads = 0;
+    unsigned int characters = 400;
+};
+
+AppOptions parseArgs(int argc, char *argv[]){
+    AppOptions options;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--model" && i + 1 < argc)
+            options.modelPath = argv[++i];
+        else if(arg == "--threads" && i + 1 < argc)
+            options.threads = atoi(argv[++i]);
+        else if(arg == "--characters" && i + 1 < argc)
+            options.characters = static_cast<unsigned int>(max(1, atoi(argv[++i])));
+    }
+    return options;
+}
+
+void generateCharacters(vector<Character> &characters){
+    const glm::vec3 palette[6] = {glm::vec3(0.8f, 0.3f, 0.25f), glm::vec3(0.9f, 0.75f, 0.3f), glm::vec3(0.35f, 0.7f, 0.35f),
+        glm::vec3(0.3f, 0.6f, 0.9f), glm::vec3(0.55f, 0.4f, 0.85f), glm::vec3(0.85f, 0.85f, 0.85f)};
+    unsigned int side = static_cast<unsigned int>(ceil(sqrt(static_cast<float>(MAX_CHARACTERS))));
+    characters.resize(MAX_CHARACTERS);
+    //按离中心的距离从近到远排列，减少角色时留下的是中间的一块
+    vector<glm::vec3> cells;
+    float half = (side - 1) * CELL_SIZE * 0.5f;
+    for(unsigned int x = 0; x < side; x++){
+        for(unsigned int z = 0; z < side; z++)
+            cells.push_back(glm::vec3(x * CELL_SIZE - half, 0.0f, z * CELL_SIZE - half));
+    }
+    sort(cells.begin(), cells.end(), [](const glm::vec3 &a, const glm::vec3 &b){
+        return glm::dot(a, a) < glm::dot(b, b);
+    });
+    for(unsigned int i = 0; i < MAX_CHARACTERS; i++){
+        Character &c = characters[i];
+        c.center = cells[i];
+        c.radius = 0.6f + (rand() % 100) / 100.0f * 0.6f;
+        c.angle = (rand() % 360) / 360.0f * glm::two_pi<float>();
+        c.phase = (rand() % 100) / 100.0f;
+        c.blendOffset = (rand() % 360) / 360.0f * glm::two_pi<float>();
+        c.color = glm::vec4(palette[i % 6], 1.0f);
+    }
+}
+
+//更新所有角色：移动、采样两个片段并混合、计算蒙皮矩阵写入palette
+//每个角色互不依赖，按区间并行；每个区间用自己的临时姿势，不需要加锁
+void updateCharacters(float time, float dt, vector<Character> &characters, const SkinnedModel &model, const vector<CompressedClip> &compressed,
+    const glm::mat4 &modelFix, vector<glm::mat4> &matrices, vector<glm::vec4> &colors, vector<glm::vec4> &palette){
+    PROFILE_FUNCTION();
+    unsigned int runIndex = min(1u, static_cast<unsigned int>(model.clips.size()) - 1);
+    const AnimationClip &walk = model.clips[0];
+    const AnimationClip &run = model.clips[runIndex];
+    const CompressedClip &packedWalk = compressed[0];
+    const CompressedClip &packedRun = compressed[runIndex];
+    unsigned int boneCount = model.skeleton.Size();
+    parallelFor(characterCount, CHARACTER_GRAIN, [&](unsigned int begin, unsigned int end){
+        Pose walkPose, runPose;
+        vector<glm::mat4> modelSpace;
+        for(unsigned int i = begin; i < end; i++){
+            Character &c = characters[i];
+            float weight = blendEnabled ? 0.5f + 0.5f * sin(time * 0.25f + c.blendOffset) : 0.0f;
+            //步态周期的长度按权重在两个片段之间插值，片段时长不同时两者仍然落在同一相位
+            float cycle = glm::mix(walk.duration, run.duration, weight);
+            c.phase = fmod(c.phase + dt / max(cycle, 1e-3f), 1.0f);
+            c.angle += glm::mix(WALK_SPEED, RUN_SPEED, weight) * dt / c.radius;
+            glm::vec3 position = c.center + glm::vec3(cos(c.angle), 0.0f, sin(c.angle)) * c.radius;
+            //沿圆圈的切线方向前进，角色面朝+z
+            glm::vec3 direction(-sin(c.angle), 0.0f, cos(c.angle));
+            glm::mat4 matrix = glm::translate(glm::mat4(1.0f), position);
+            matrix = glm::rotate(matrix, atan2(direction.x, direction.z), glm::vec3(0.0f, 1.0f, 0.0f));
+            matrices[i] = matrix * modelFix;
+            colors[i] = c.color;
+
+            if(compressionEnabled)
+                SampleCompressedClip(packedWalk, c.phase * walk.duration, c.walkCursor, walkPose);
+            else
+                SampleClip(walk, c.phase * walk.duration, walkPose);
+            if(weight > 0.0f){
+                if(compressionEnabled)
+                    SampleCompressedClip(packedRun, c.phase * run.duration, c.runCursor, runPose);
+                else
+                    SampleClip(run, c.phase * run.duration, runPose);
+                BlendPoses(walkPose, runPose, weight, walkPose);
+            }
+            BuildSkinningPalette(model.skeleton, walkPose, modelSpace, &palette[i * boneCount * 3]);
+        }
+    });
+}
+
+int main(int argc, char *argv[]){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    AppOptions options = parseArgs(argc, argv);
+    AnimationBenchmarkOptions benchmarkOptions = ParseAnimationBenchmarkArgs(argc, argv);
+    JobSystem::Get().Init(options.threads > 0 ? options.threads - 1 : -1);
+    cout << "Job system: " << JobSystem::Get().ThreadCount() << " threads" << endl;
+
+    //用--model指定带骨骼动画的模型（例如.dae或.fbx）时从文件导入，没有指定或导入失败时使用程序化生成的角色
+    SkinnedModel model;
+    bool imported = false;
+    if(!options.modelPath.empty()){
+        imported = model.Import(options.modelPath);
+        if(imported && model.clips.empty()){
+            cout << "ERROR::ANIMATION::NO_CLIPS: " << options.modelPath << endl;
+            imported = false;
+        }
+        if(!imported)
+            model = SkinnedModel();
+    }
+    if(!imported)
+        BuildProceduralCharacter(model);
+    //导入后把每个片段编译为压缩片段，运行时默认采样压缩片段
+    vector<CompressedClip> compressedClips;
+    size_t resampledBytes = 0, compressedBytes = 0;
+    for(unsigned int i = 0; i < model.clips.size(); i++){
+        compressedClips.push_back(CompressClip(model.clips[i]));
+        resampledBytes += ResampledBytes(model.clips[i]);
+        compressedBytes += compressedClips[i].MemoryBytes();
+    }
+    cout << "clips: " << resampledBytes / 1024 << " KB resampled, " << compressedBytes / 1024 << " KB compressed" << endl;
+    //--animbench只运行动画压缩的基准测试，不创建窗口
+    if(benchmarkOptions.enabled){
+        AnimationBenchmark benchmark(benchmarkOptions);
+        benchmark.Run(model.skeleton, model.clips, compressedClips);
+        JobSystem::Get().Shutdown();
+        return 0;
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 10.0f;
+    Profiler::Get().InitGPU();
+    glEnable(GL_DEPTH_TEST);
+
+    CustomShader skinnedShader((Path + "SkinnedVertexShader.glsl").c_str(), (Path + "SkinnedFragmentShader.glsl").c_str());
+
+    model.Upload();
+    unsigned int boneCount = model.skeleton.Size();
+    cout << (imported ? options.modelPath : string("procedural character")) << ": " << boneCount << " joints, " << model.meshes.size() << " meshes, clips:";
+    for(unsigned int i = 0; i < model.clips.size(); i++)
+        cout << " " << model.clips[i].name << " (" << model.clips[i].duration << " s, " << model.clips[i].frameCount << " frames)";
+    cout << endl;
+
+    //把模型缩放到统一的身高并让脚落在地面上
+    float height = model.aabb.IsValid() ? model.aabb.max.y - model.aabb.min.y : CHARACTER_HEIGHT;
+    float scale = CHARACTER_HEIGHT / max(height, 1e-3f);
+    glm::mat4 modelFix = glm::scale(glm::mat4(1.0f), glm::vec3(scale));
+    modelFix = glm::translate(modelFix, glm::vec3(0.0f, model.aabb.IsValid() ? -model.aabb.min.y : 0.0f, 0.0f));
+
+    //缓冲纹理的大小有限制，角色数量上限由骨骼数决定
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    maxCharacters = min(MAX_CHARACTERS, static_cast<unsigned int>(maxTexels) / max(1u, boneCount * 3));
+    if(maxCharacters == 0){
+        cout << "ERROR::ANIMATION::PALETTE_TOO_LARGE: " << boneCount << " joints" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    characterCount = min(options.characters, maxCharacters);
+
+    srand(1);
+    vector<Character> characters;
+    generateCharacters(characters);
+    vector<glm::mat4> characterMatrices(MAX_CHARACTERS, glm::mat4(1.0f));
+    vector<glm::vec4> characterColors(MAX_CHARACTERS, glm::vec4(1.0f));
+    vector<glm::vec4> palette(static_cast<size_t>(maxCharacters) * boneCount * 3);
+    InstanceBuffer instances(characterMatrices.data(), maxCharacters, characterColors.data(), GL_STREAM_DRAW);
+    model.SetInstanceBuffer(instances);
+
+    //蒙皮矩阵缓冲纹理：每帧整体重新上传，先用glBufferData(NULL)丢弃旧的存储，避免等待上一帧的绘制读完
+    unsigned int paletteBuffer, paletteTexture;
+    glGenBuffers(1, &paletteBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, paletteBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, palette.size() * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glGenTextures(1, &paletteTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, paletteTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, paletteBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    //地面：没有骨骼权重的网格，同一个着色器绘制时蒙皮矩阵为单位矩阵
+    vector<Vertex> groundVertices(4);
+    const float groundSize = 200.0f;
+    const glm::vec2 groundCorners[4] = {glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f), glm::vec2(1.0f, 1.0f), glm::vec2(-1.0f, 1.0f)};
+    for(unsigned int i = 0; i < 4; i++){
+        Vertex &vertex = groundVertices[i];
+        vertex.Position = glm::vec3(groundCorners[i].x * groundSize, 0.0f, groundCorners[i].y * groundSize);
+        vertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        vertex.TexCoords = groundCorners[i];
+        vertex.Tangent = glm::vec3(0.0f);
+        vertex.Bitangent = glm::vec3(0.0f);
+        for(int k = 0; k < MAX_BONE_INFLUENCE; k++){
+            vertex.m_BoneIDs[k] = 0;
+            vertex.m_Weights[k] = 0.0f;
+        }
+    }
+    Mesh ground(groundVertices, vector<unsigned int>{0, 2, 1, 0, 3, 2}, vector<Texture>());
+    glm::mat4 groundMatrix(1.0f);
+    glm::vec4 groundColor(0.35f, 0.37f, 0.35f, 1.0f);
+    InstanceBuffer groundInstance(&groundMatrix, 1, &groundColor);
+    ground.SetInstanceBuffer(groundInstance);
+
+    skinnedShader.use();
+    skinnedShader.setInt("bonePalette", PALETTE_TEXTURE_UNIT);
+    skinnedShader.setInt("boneCount", static_cast<int>(boneCount));
+    glm::vec3 lightDir = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    double animationMs = 0.0;
+    while (!glfwWindowShouldClose(window)){
+        Profiler::Get().BeginFrame();
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        //显示平均帧时间、动画耗时与角色数量
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame, animation " + to_string(animationMs / frameCount) + " ms ("
+                + (jobsEnabled ? to_string(JobSystem::Get().ThreadCount()) + " threads" : string("single thread")) + ") - "
+                + to_string(characterCount) + " characters x " + to_string(boneCount) + " joints, blend " + (blendEnabled ? "on" : "off")
+                + ", " + (compressionEnabled ? to_string(compressedBytes / 1024) + " KB compressed" : to_string(resampledBytes / 1024) + " KB resampled")
+                + " clips - B: blend, C: compression, J: jobs, +/-: characters, T: export trace";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+            animationMs = 0.0;
+        }
+
+        processInput(window);
+
+        //第一帧的deltaTime是启动耗时，不能用来推进动画
+        float dt = min(deltaTime, 0.1f);
+        auto animationStart = chrono::steady_clock::now();
+        updateCharacters(currentFrame, dt, characters, model, compressedClips, modelFix, characterMatrices, characterColors, palette);
+        animationMs += chrono::duration<double, milli>(chrono::steady_clock::now() - animationStart).count();
+        {
+            PROFILE_SCOPE("UploadPalette");
+            glBindBuffer(GL_TEXTURE_BUFFER, paletteBuffer);
+            glBufferData(GL_TEXTURE_BUFFER, palette.size() * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<size_t>(characterCount) * boneCount * 3 * sizeof(glm::vec4), palette.data());
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+            instances.Update(characterMatrices.data(), characterCount, characterColors.data());
+        }
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 300.0f);
+        {
+            PROFILE_PASS("Scene");
+            glClearColor(0.55f, 0.65f, 0.75f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            skinnedShader.use();
+            skinnedShader.setMat4("view", view);
+            skinnedShader.setMat4("projection", projection);
+            skinnedShader.setVec3("dirLight.direction", lightDir);
+            skinnedShader.setVec3("dirLight.ambient", 0.3f, 0.3f, 0.35f);
+            skinnedShader.setVec3("dirLight.diffuse", 0.8f, 0.78f, 0.72f);
+            glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT);
+            glBindTexture(GL_TEXTURE_BUFFER, paletteTexture);
+            glActiveTexture(GL_TEXTURE0);
+            //所有角色一次实例化绘制（每个网格一次），顶点着色器按gl_InstanceID取各自的蒙皮矩阵
+            model.DrawInstanced(skinnedShader, characterCount);
+            skinnedShader.setBool("useTexture", false);
+            ground.DrawInstanced(skinnedShader, 1);
+        }
+
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+    }
+    glDeleteBuffers(1, &paletteBuffer);
+    glDeleteTextures(1, &paletteTexture);
+    instances.Release();
+    groundInstance.Release();
+    Profiler::Get().Release();
+    JobSystem::Get().Shutdown();
+
+    glfwTerminate();
+
+    return 0;
+}
@@ -0,0 +1,361 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "Mesh.h"
+#include "CustomShader.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <cstring>
+using namespace std;
+
+//解码后还没有上传的图片
+struct DecodedImage {
+    unsigned char *data = nullptr;
+    int width = 0, height = 0, nrComponents = 0;
+};
+
+//从文件中解码图片，不涉及OpenGL，可以在工作线程上调用
+DecodedImage DecodeImage(const string &filename){
+    DecodedImage image;
+    image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.nrComponents, 0);
+    return image;
+}
+
+//把解码后的图片上传为纹理并释放图片内存，必须在OpenGL线程调用
+unsigned int UploadImage(DecodedImage &image, const string &path){
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    if (image.data)
+    {
+        GLenum format;
+        if (image.nrComponents == 1)
+            format = GL_RED;
+        else if (image.nrComponents == 3)
+            format = GL_RGB;
+        else
+            format = GL_RGBA;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+    }
+    stbi_image_free(image.data);
+    image.data = nullptr;
+    return textureID;
+}
+
+//aiMatrix4x4是行主序，glm是列主序，需要转置
+glm::mat4 ConvertMatrix(const aiMatrix4x4 &from){
+    glm::mat4 to;
+    to[0][0] = from.a1; to[1][0] = from.a2; to[2][0] = from.a3; to[3][0] = from.a4;
+    to[0][1] = from.b1; to[1][1] = from.b2; to[2][1] = from.b3; to[3][1] = from.b4;
+    to[0][2] = from.c1; to[1][2] = from.c2; to[2][2] = from.c3; to[3][2] = from.c4;
+    to[0][3] = from.d1; to[1][3] = from.d2; to[2][3] = from.d3; to[3][3] = from.d4;
+    return to;
+}
+
+//模型中的节点，保留aiNode的层级与mTransformation
+//nodes按深度优先顺序存放，父节点总在子节点之前
+struct ModelNode {
+    string name;
+    int parent;//父节点在nodes中的下标，根节点为-1
+    glm::mat4 transform;//相对父节点的变换
+    vector<unsigned int> meshes;//节点引用的网格在meshes中的下标
+};
+
+class Model{
+public:
+    //即便同样的纹理已经被加载过很多遍了，对每个网格仍会加载并生成一个新的纹理，因此将所有加载过的纹理全局储存
+    //每当想加载一个纹理的时候，首先去检查它有没有被加载过。如果有的话，我们会直接使用那个纹理，并跳过整个加载流程
+    vector<Texture> textures_loaded;
+    bool gammaCorrection;
+    vector<Mesh> meshes;//网格
+    vector<ModelNode> nodes;//节点层级
+    AABB aabb;//所有网格包围盒的并集
+    BoundingSphere sphere;//包含所有网格包围球的包围球
+
+    Model(bool gamma = false) : gammaCorrection(gamma){}
+    Model(const string &path, bool gamma = false) : gammaCorrection(gamma){
+        Import(path);
+        Upload();
+    }
+
+    //导入模型的CPU部分：读取文件、转换网格、解码纹理，不涉及OpenGL，可以作为任务在工作线程上执行
+    //网格转换与纹理解码再拆成更小的任务交给任务系统
+    //返回false表示读取失败
+    bool Import(const string &path){
+        PROFILE_SCOPE("Import " + path.substr(path.find_last_of('/') + 1));
+        //读取文件
+        Assimp::Importer importer;
+        //第二个参数是一些后期处理(Post-processing)的选项
+        //aiProcess_Triangulate表示如果模型不是（全部）由三角形组成，它需要将模型所有的图元形状变换为三角形
+        //aiProcess_FlipUVs将在处理的时候翻转y轴的纹理坐标，因为在OpenGL中大部分的图像的y轴都是反的
+        const aiScene *scene = nullptr;
+        {
+            PROFILE_SCOPE("ReadFile");
+            scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
+        }
+        //检查场景和其根节点不为null，并且检查标记(Flag)来查看返回的数据是不是不完整的
+        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode){
+            cout << "ERROR::ASSIMP::" << importer.GetErrorString() << endl;
+            return false;
+        }
+        directory = path.substr(0, path.find_last_of('/'));
+        //材质纹理的查重会修改textures_loaded，先在当前线程收集每个网格用到的纹理
+        vector<vector<Texture>> meshTextures(scene->mNumMeshes);
+        for(unsigned int i = 0; i < scene->mNumMeshes; i++)
+            meshTextures[i] = processMaterial(scene->mMeshes[i], scene);
+        //纹理解码与网格转换互不依赖，放在同一组任务中
+        JobCounter counter;
+        images.assign(textures_loaded.size(), DecodedImage());
+        for(unsigned int i = 0; i < textures_loaded.size(); i++){
+            JobSystem::Get().Run([this, i](){
+                PROFILE_SCOPE("Decode " + textures_loaded[i].path);
+                images[i] = DecodeImage(directory + '/' + textures_loaded[i].path);
+            }, &counter);
+        }
+        vector<Mesh> converted(scene->mNumMeshes);
+        for(unsigned int i = 0; i < scene->mNumMeshes; i++){
+            JobSystem::Get().Run([&, i](){
+                PROFILE_SCOPE(string("Mesh ") + scene->mMeshes[i]->mName.C_Str());
+                converted[i] = processMesh(scene->mMeshes[i], meshTextures[i]);
+            }, &counter);
+        }
+        JobSystem::Get().Wait(counter);
+        //递归处理子节点
+        processNode(scene->mRootNode, converted, -1);
+        computeBounds();
+        return true;
+    }
+
+    //创建网格缓冲并上传解码好的纹理，必须在OpenGL线程调用
+    void Upload(){
+        PROFILE_FUNCTION();
+        for(unsigned int i = 0; i < textures_loaded.size() && i < images.size(); i++)
+            textures_loaded[i].id = UploadImage(images[i], textures_loaded[i].path);
+        images.clear();
+        for(unsigned int i = 0; i < meshes.size(); i++){
+            //网格中的纹理导入时还没有id，按路径从已加载的纹理中查找
+            for(unsigned int t = 0; t < meshes[i].textures.size(); t++){
+                for(unsigned int j = 0; j < textures_loaded.size(); j++){
+                    if(meshes[i].textures[t].path == textures_loaded[j].path){
+                        meshes[i].textures[t].id = textures_loaded[j].id;
+                        break;
+                    }
+                }
+            }
+            meshes[i].Upload();
+        }
+    }
+
+    //遍历网格并绘制
+    void Draw(CustomShader shader){
+        for(unsigned int i = 0; i < meshes.size(); i++){
+            meshes[i].Draw(shader);
+        }
+    }
+    //把实例缓冲绑定到模型的所有网格
+    void SetInstanceBuffer(const InstanceBuffer &instances){
+        for(unsigned int i = 0; i < meshes.size(); i++){
+            meshes[i].SetInstanceBuffer(instances);
+        }
+    }
+    void SetInstanceSource(unsigned int matrixBuffer, GLintptr matrixOffset, unsigned int dataBuffer = 0, GLintptr dataOffset = 0){
+        for(unsigned int i = 0; i < meshes.size(); i++){
+            meshes[i].SetInstanceSource(matrixBuffer, matrixOffset, dataBuffer, dataOffset);
+        }
+    }
+    //实例化绘制，每个网格只产生一次glDrawElementsInstanced
+    void DrawInstanced(CustomShader &shader, unsigned int instanceCount){
+        for(unsigned int i = 0; i < meshes.size(); i++){
+            meshes[i].DrawInstanced(shader, instanceCount);
+        }
+    }
+
+private:
+    string directory;
+    vector<DecodedImage> images;//与textures_loaded一一对应，Upload之前保存解码结果
+
+    //合并所有网格的包围体，网格包围盒先经过节点变换到模型空间
+    void computeBounds(){
+        vector<glm::mat4> world(nodes.size());
+        for(unsigned int i = 0; i < nodes.size(); i++){
+            world[i] = nodes[i].parent < 0 ? nodes[i].transform : world[nodes[i].parent] * nodes[i].transform;
+            for(unsigned int m = 0; m < nodes[i].meshes.size(); m++)
+                aabb.Expand(meshes[nodes[i].meshes[m]].aabb.Transform(world[i]));
+        }
+        if(!aabb.IsValid())
+            return;
+        sphere.center = aabb.Center();
+        sphere.radius = glm::length(aabb.Extents());
+    }
+
+    //递归处理子节点，同时记录节点层级与相对父节点的变换
+    //converted是按aiScene中网格顺序转换好的网格，节点引用的网格从中复制
+    void processNode(aiNode *node, const vector<Mesh> &converted, int parent){
+        ModelNode modelNode;
+        modelNode.name = node->mName.C_Str();
+        modelNode.parent = parent;
+        modelNode.transform = ConvertMatrix(node->mTransformation);
+        //处理节点所有的网格，每个节点包含了一系列的网格索引，每个索引指向场景对象中的那个特定网格
+        for(unsigned int i = 0; i < node->mNumMeshes; i++){
+            modelNode.meshes.push_back(static_cast<unsigned int>(meshes.size()));
+            meshes.push_back(converted[node->mMeshes[i]]);
+        }
+        int index = static_cast<int>(nodes.size());
+        nodes.push_back(modelNode);
+        //递归处理子节点，深度优先，子节点总在父节点之后
+        for(unsigned int i = 0; i < node->mNumChildren; i++){
+            processNode(node->mChildren[i], converted, index);
+        }
+    }
+
+    //处理网格，访问网格的相关属性并将它们储存到我们自己的对象中
+    //只读取aiMesh，不修改模型的成员，不同网格可以同时处理
+    Mesh processMesh(aiMesh *mesh, const vector<Texture> &textures){
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
+
+        //处理顶点位置、法线和纹理坐标，使用所有的相关数据填充Mesh中的结构体
+        for(unsigned int i = 0; i < mesh->mNumVertices; i++){
+            Vertex vertex;
+            glm::vec3 vector;
+            // 位置
+            vector.x = mesh->mVertices[i].x;
+            vector.y = mesh->mVertices[i].y;
+            vector.z = mesh->mVertices[i].z;
+            vertex.Position = vector;
+            // 法线
+            if (mesh->HasNormals())
+            {
+                vector.x = mesh->mNormals[i].x;
+                vector.y = mesh->mNormals[i].y;
+                vector.z = mesh->mNormals[i].z;
+                vertex.Normal = vector;
+            }
+            // 纹理坐标
+            // Assimp允许一个模型在一个顶点上有最多8个不同的纹理坐标
+            // 不会用到那么多，只关心第一组纹理坐标
+            if(mesh->mTextureCoords[0])
+            {
+                glm::vec2 vec;
+                
+                vec.x = mesh->mTextureCoords[0][i].x; 
+                vec.y = mesh->mTextureCoords[0][i].y;
+                vertex.TexCoords = vec;
+                // 切线
+                vector.x = mesh->mTangents[i].x;
+                vector.y = mesh->mTangents[i].y;
+                vector.z = mesh->mTangents[i].z;
+                vertex.Tangent = vector;
+                // bitangent
+                vector.x = mesh->mBitangents[i].x;
+                vector.y = mesh->mBitangents[i].y;
+                vector.z = mesh->mBitangents[i].z;
+                vertex.Bitangent = vector;
+            }else{
+                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+            }
+            vertices.push_back(vertex);
+        }
+
+        //处理索引
+        //Assimp的接口定义了每个网格都有一个面(Face)数组，每个面代表了一个图元，由于使用了aiProcess_Triangulate选项，它总是三角形
+        //一个面包含了多个索引，它们定义了在每个图元中，我们应该绘制哪个顶点，并以什么顺序绘制。
+        //所以如果我们遍历了所有的面，并储存了面的索引到indices这个vector中就可以了
+        for(unsigned int i = 0; i < mesh->mNumFaces; i++){
+            const aiFace &face = mesh->mFaces[i];
+            for(unsigned int j = 0; j < face.mNumIndices; j++){
+                indices.push_back(face.mIndices[j]);
+            }
+        }
+        return Mesh(move(vertices), move(indices), textures, false);
+    }
+
+    //处理材质
+    //一个网格只包含了一个指向材质对象的索引
+    //如果想要获取网格真正的材质，需要索引场景的mMaterials数组
+    vector<Texture> processMaterial(aiMesh *mesh, const aiScene *scene){
+        vector<Texture> textures;
+        //从场景的mMaterials数组中获取aiMaterial对象
+        aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
+        //加载网格的漫反射贴图
+        //不同的纹理类型都以aiTextureType_为前缀
+        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        //加载网格的镜面光贴图
+        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        //加载网格的法线贴图
+        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        //加载网格的高度贴图
+        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        return textures;
+    }
+
+    //从材质中获取纹理
+    //一个材质对象的内部对每种纹理类型都存储了一个纹理位置数组
+    //这里只登记纹理，解码在Import中并行进行，纹理id在Upload时才会填入
+    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName){
+        vector<Texture> textures;
+        //遍历给定纹理类型的所有纹理位置
+        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++){
+            //获取了纹理的文件位置
+            aiString str;
+            mat->GetTexture(type, i, &str);
+            bool skip = false;
+            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            {
+                //如果纹理已经被加载过，就跳过它，直接使用之前加载过的纹理
+                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                {
+                    textures.push_back(textures_loaded[j]);
+                    skip = true; 
+                    break;
+                }
+            }
+            //如果纹理还没有被加载过，就登记它
+            if(!skip){
+                Texture texture;
+                texture.id = 0;
+                texture.type = typeName;
+                texture.path = str.C_Str();
+                textures.push_back(texture);
+                textures_loaded.push_back(texture); // 同时添加到已加载的纹理中
+            }
+            
+        }
+        return textures;
+    }
+};
+
+#endif
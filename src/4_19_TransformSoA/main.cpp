@@ -0,0 +1,778 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "InstanceBuffer.h"
+#include "RenderGraph.h"
+#include "Profiler.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "Transform.h"
+#include "Model.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_19_TransformSoA/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 150.0f;
+const unsigned int SHADOW_RESOLUTION = 4096;
+
+CustomCamera camera(glm::vec3(0.0f, 8.0f, 20.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -20.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//箱子铺满GRID_SIZE*GRID_SIZE个格子，另有一些发光的方块在上方飞行，场景中间有一圈纳米装甲模型
+const int GRID_SIZE = 96;
+const float CELL_SIZE = 2.0f;
+const unsigned int GLOW_AMOUNT = 24;
+const unsigned int NANOSUIT_AMOUNT = 8;
+//并行任务的粒度：每个任务至少处理这么多个元素，太小时调度开销会超过任务本身
+const unsigned int TRANSFORM_GRAIN = 512;
+const unsigned int CULL_GRAIN = 1024;
+bool jobsEnabled = true;
+bool jobsKeyDown = false;
+bool soaEnabled = true;
+bool soaKeyDown = false;
+bool bloomEnabled = true;
+bool showDepth = false;
+bool aliasingEnabled = true;
+int blurIterations = 4;
+bool bloomKeyDown = false;
+bool depthKeyDown = false;
+bool aliasingKeyDown = false;
+bool moreKeyDown = false;
+bool lessKeyDown = false;
+bool traceKeyDown = false;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //B键开关泛光，V键在右上角显示深度，K键开关纹理复用，=与-键增减模糊次数
+    bool key = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+    if(key && !bloomKeyDown)
+        bloomEnabled = !bloomEnabled;
+    bloomKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS;
+    if(key && !depthKeyDown)
+        showDepth = !showDepth;
+    depthKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS;
+    if(key && !aliasingKeyDown)
+        aliasingEnabled = !aliasingEnabled;
+    aliasingKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS;
+    if(key && !moreKeyDown && blurIterations < 8)
+        blurIterations++;
+    moreKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS;
+    if(key && !lessKeyDown && blurIterations > 1)
+        blurIterations--;
+    lessKeyDown = key;
+    //T键导出最近的帧为Chrome trace，并在控制台输出各作用域的平均耗时
+    key = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+    if(key && !traceKeyDown){
+        Profiler::Get().ExportChromeTrace("./output/profile_trace.json");
+        vector<ProfileSummary> summary = Profiler::Get().Summarize();
+        cout << left << setw(28) << "scope" << right << setw(10) << "cpu ms" << setw(10) << "gpu ms" << setw(8) << "calls" << endl;
+        cout << fixed << setprecision(3);
+        for(unsigned int i = 0; i < summary.size(); i++)
+            cout << left << setw(28) << summary[i].name << right << setw(10) << summary[i].cpuMs << setw(10) << summary[i].gpuMs << setw(8) << summary[i].calls << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+    }
+    traceKeyDown = key;
+    //J键在任务系统与单线程之间切换，对比每帧更新的耗时
+    key = glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS;
+    if(key && !jobsKeyDown)
+        jobsEnabled = !jobsEnabled;
+    jobsKeyDown = key;
+    //M键在SoA批量组合与逐个glm::translate/rotate/scale之间切换，对比变换的耗时
+    key = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+    if(key && !soaKeyDown)
+        soaEnabled = !soaEnabled;
+    soaKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+//把[0, count)交给任务系统并行处理，关闭任务系统时在当前线程上一次处理完
+void parallelFor(unsigned int count, unsigned int grainSize, const function<void(unsigned int, unsigned int)> &func){
+    if(jobsEnabled)
+        JobSystem::Get().ParallelFor(count, grainSize, func);
+    else if(count > 0)
+        func(0, count);
+}
+
+//每张图片的解码作为一个任务提交，完成时counter减一，解码结果在Wait之后由uploadTextures上传
+void decodeTextures(const vector<string> &paths, vector<DecodedImage> &images, JobCounter &counter){
+    images.assign(paths.size(), DecodedImage());
+    for(unsigned int i = 0; i < paths.size(); i++){
+        JobSystem::Get().Run([&, i](){
+            PROFILE_SCOPE("Decode " + paths[i].substr(paths[i].find_last_of('/') + 1));
+            images[i] = DecodeImage(paths[i]);
+        }, &counter);
+    }
+}
+
+vector<unsigned int> uploadTextures(const vector<string> &paths, vector<DecodedImage> &images){
+    PROFILE_FUNCTION();
+    vector<unsigned int> textures(paths.size());
+    for(unsigned int i = 0; i < paths.size(); i++)
+        textures[i] = UploadImage(images[i], paths[i]);
+    return textures;
+}
+
+//箱子的动画参数：绕y轴的初始角度与转速（地面为0），与变换组件一样按数组存放
+struct CrateSpin {
+    vector<float> yaw;
+    vector<float> speed;
+};
+
+//地面由扁平的箱子铺成，部分格子上再随机堆叠1~3个箱子，堆叠的箱子每帧绕y轴旋转
+void generateCrates(TransformStore &transforms, CrateSpin &spin){
+    PROFILE_FUNCTION();
+    float half = GRID_SIZE * CELL_SIZE * 0.5f;
+    const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+    for(int x = 0; x < GRID_SIZE; x++){
+        for(int z = 0; z < GRID_SIZE; z++){
+            glm::vec3 cell(x * CELL_SIZE - half, 0.0f, z * CELL_SIZE - half);
+            transforms.Add(cell + glm::vec3(0.0f, -0.05f, 0.0f), identity, glm::vec3(CELL_SIZE, 0.1f, CELL_SIZE));
+            spin.yaw.push_back(0.0f);
+            spin.speed.push_back(0.0f);
+            if(rand() % 100 < 30){
+                int stack = 1 + rand() % 3;
+                for(int i = 0; i < stack; i++){
+                    float yaw = glm::radians((float)(rand() % 90));
+                    transforms.Add(cell + glm::vec3(0.0f, 0.5f + i, 0.0f), glm::angleAxis(yaw, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.0f));
+                    spin.yaw.push_back(yaw);
+                    spin.speed.push_back(((rand() % 2) * 2 - 1) * (0.2f + (rand() % 100) / 100.0f));
+                }
+            }
+        }
+    }
+}
+
+//发光方块绕圈飞行，颜色远大于1，经过泛光后形成光晕
+void updateGlowCubes(float time, vector<glm::mat4> &matrices, vector<glm::vec4> &colors){
+    PROFILE_FUNCTION();
+    matrices.resize(GLOW_AMOUNT);
+    colors.resize(GLOW_AMOUNT);
+    for(unsigned int i = 0; i < GLOW_AMOUNT; i++){
+        float angle = time * 0.4f + (float)i / GLOW_AMOUNT * glm::two_pi<float>();
+        float radius = 5.0f + (i % 4) * 5.0f;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(cos(angle) * radius, 3.0f + (i % 3), sin(angle) * radius));
+        matrices[i] = glm::scale(model, glm::vec3(0.4f));
+        const glm::vec3 palette[6] = {glm::vec3(1.0f, 0.3f, 0.2f), glm::vec3(1.0f, 0.8f, 0.2f), glm::vec3(0.3f, 1.0f, 0.3f),
+            glm::vec3(0.2f, 0.8f, 1.0f), glm::vec3(0.4f, 0.3f, 1.0f), glm::vec3(1.0f, 0.3f, 0.9f)};
+        glm::vec3 color = palette[i % 6];
+        colors[i] = glm::vec4(color * 6.0f, 1.0f);
+    }
+}
+
+//纳米装甲围成一圈，缓慢绕场景中心转动
+void updateNanosuits(float time, vector<glm::mat4> &matrices){
+    matrices.resize(NANOSUIT_AMOUNT);
+    for(unsigned int i = 0; i < NANOSUIT_AMOUNT; i++){
+        float angle = time * 0.1f + (float)i / NANOSUIT_AMOUNT * glm::two_pi<float>();
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(cos(angle) * 8.0f, 0.0f, sin(angle) * 8.0f));
+        model = glm::rotate(model, -angle - glm::half_pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f));
+        matrices[i] = glm::scale(model, glm::vec3(0.3f));
+    }
+}
+
+//转动堆叠的箱子，组合模型矩阵、光源空间的矩阵（阴影pass使用）与世界包围盒，每个元素互不依赖，按区间并行
+//soaEnabled时用TransformStore批量组合，否则逐个箱子用glm构建，作为对比；返回耗时（毫秒）
+double animateCrates(float time, const CrateSpin &spin, TransformStore &transforms, const glm::mat4 &lightSpaceMatrix,
+    vector<glm::mat4> &matrices, vector<glm::mat4> &lightMatrices, AABBSoA &bounds){
+    PROFILE_FUNCTION();
+    auto start = chrono::steady_clock::now();
+    AABB unitCube;
+    unitCube.min = glm::vec3(-0.5f);
+    unitCube.max = glm::vec3(0.5f);
+    parallelFor(transforms.Size(), TRANSFORM_GRAIN, [&](unsigned int begin, unsigned int end){
+        if(soaEnabled){
+            //绕y轴的四元数只有y与w分量
+            for(unsigned int i = begin; i < end; i++){
+                if(spin.speed[i] == 0.0f)
+                    continue;
+                float half = (spin.yaw[i] + time * spin.speed[i]) * 0.5f;
+                transforms.ry[i] = sin(half);
+                transforms.rw[i] = cos(half);
+            }
+            transforms.Compose(begin, end, matrices.data(), &lightSpaceMatrix, lightMatrices.data(), &bounds, unitCube);
+            return;
+        }
+        for(unsigned int i = begin; i < end; i++){
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(transforms.px[i], transforms.py[i], transforms.pz[i]));
+            model = glm::rotate(model, spin.yaw[i] + time * spin.speed[i], glm::vec3(0.0f, 1.0f, 0.0f));
+            matrices[i] = glm::scale(model, glm::vec3(transforms.sx[i], transforms.sy[i], transforms.sz[i]));
+            lightMatrices[i] = lightSpaceMatrix * matrices[i];
+            bounds.Set(i, unitCube.Transform(matrices[i]));
+        }
+    });
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+//分块并行剔除：每块把可见下标写到scratch中与自己对应的位置，再按块的顺序紧凑到visible中，结果与串行剔除相同
+void cullCrates(const Frustum &frustum, const AABBSoA &bounds, const vector<glm::mat4> &matrices, FrustumCuller &culler,
+    vector<unsigned int> &scratch, vector<unsigned int> &chunkCounts, vector<unsigned int> &visible, vector<glm::mat4> &visibleMatrices){
+    PROFILE_FUNCTION();
+    auto start = chrono::high_resolution_clock::now();
+    unsigned int count = bounds.Size();
+    unsigned int chunks = (count + CULL_GRAIN - 1) / CULL_GRAIN;
+    scratch.resize(count);
+    chunkCounts.resize(chunks);
+    parallelFor(chunks, 1, [&](unsigned int begin, unsigned int end){
+        for(unsigned int c = begin; c < end; c++){
+            unsigned int first = c * CULL_GRAIN;
+            unsigned int last = min(first + CULL_GRAIN, count);
+            chunkCounts[c] = FrustumCuller::CullAABBRange(frustum, bounds, first, last, &scratch[first]);
+        }
+    });
+    visible.clear();
+    for(unsigned int c = 0; c < chunks; c++)
+        visible.insert(visible.end(), scratch.begin() + c * CULL_GRAIN, scratch.begin() + c * CULL_GRAIN + chunkCounts[c]);
+    visibleMatrices.resize(visible.size());
+    parallelFor(static_cast<unsigned int>(visible.size()), TRANSFORM_GRAIN * 2, [&](unsigned int begin, unsigned int end){
+        for(unsigned int i = begin; i < end; i++)
+            visibleMatrices[i] = matrices[visible[i]];
+    });
+    culler.Record(count, static_cast<unsigned int>(visible.size()), chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count());
+}
+
+int main(int argc, char *argv[]){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    //--threads N指定参与执行任务的线程数，默认为硬件线程数
+    int threads = 0;
+    for(int i = 1; i + 1 < argc; i++){
+        if(string(argv[i]) == "--threads")
+            threads = atoi(argv[i + 1]);
+    }
+    JobSystem::Get().Init(threads > 0 ? threads - 1 : -1);
+    cout << "Job system: " << JobSystem::Get().ThreadCount() << " threads" << endl;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 8.0f;
+    Profiler::Get().InitGPU();
+
+    CustomShader objectShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+    CustomShader shadowShader((Path + "ShadowVertexShader.glsl").c_str(), (Path + "ShadowFragmentShader.glsl").c_str());
+    CustomShader glowShader((Path + "LightVertexShader.glsl").c_str(), (Path + "LightFragmentShader.glsl").c_str());
+    CustomShader brightShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "BrightFragmentShader.glsl").c_str());
+    CustomShader blurShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "BlurFragmentShader.glsl").c_str());
+    CustomShader compositeShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "CompositeFragmentShader.glsl").c_str());
+    CustomShader depthViewShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "DepthViewFragmentShader.glsl").c_str());
+    CustomShader postShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "PostFragmentShader.glsl").c_str());
+
+    float vertices[] = {
+        // positions          // normals           // texture coords
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+        0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+        0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+        0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+        0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+    };
+
+    unsigned int VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    //模型导入与箱子纹理解码作为任务在工作线程上进行，主线程同时生成箱子
+    //全部完成后再在OpenGL线程上传，trace中可以看到各个线程上的导入、网格转换与解码
+    JobCounter loading;
+    Model nanosuit;
+    bool nanosuitLoaded = false;
+    JobSystem::Get().Run([&](){
+        nanosuitLoaded = nanosuit.Import("static/model/nanosuit/nanosuit.obj");
+    }, &loading);
+    vector<string> texturePaths;
+    texturePaths.push_back("./static/texture/container2.png");
+    texturePaths.push_back("./static/texture/container2_specular.png");
+    vector<DecodedImage> images;
+    decodeTextures(texturePaths, images, loading);
+
+    srand(static_cast<unsigned int>(glfwGetTime()));
+    TransformStore crateTransforms;
+    CrateSpin crateSpin;
+    crateTransforms.Reserve(GRID_SIZE * GRID_SIZE * 2);
+    generateCrates(crateTransforms, crateSpin);
+    unsigned int crateCount = crateTransforms.Size();
+    vector<glm::mat4> crateMatrices(crateCount), crateLightMatrices(crateCount);
+    crateTransforms.Compose(0, crateCount, crateMatrices.data());
+    vector<glm::mat4> glowMatrices;
+    vector<glm::vec4> glowColors;
+    updateGlowCubes(0.0f, glowMatrices, glowColors);
+
+    //阴影pass绘制全部箱子，实例矩阵直接使用组合好的 lightSpaceMatrix * model
+    unsigned int crateVAO, glowVAO;
+    InstanceBuffer crates(crateLightMatrices.data(), crateCount, nullptr, GL_STREAM_DRAW);
+    glGenVertexArrays(1, &crateVAO);
+    glBindVertexArray(crateVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    crates.BindAttributes();
+
+    //场景pass只绘制视锥体内的箱子，阴影pass仍然绘制全部箱子
+    AABBSoA crateBounds;
+    crateBounds.Resize(crateCount);
+    FrustumCuller culler;
+    vector<unsigned int> visible, cullScratch, chunkCounts;
+    vector<glm::mat4> visibleMatrices;
+    unsigned int visibleVAO;
+    InstanceBuffer visibleCrates(crateMatrices.data(), crateCount, nullptr, GL_STREAM_DRAW);
+    glGenVertexArrays(1, &visibleVAO);
+    glBindVertexArray(visibleVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    visibleCrates.BindAttributes();
+
+    InstanceBuffer glowCubes(glowMatrices.data(), GLOW_AMOUNT, glowColors.data(), GL_STREAM_DRAW);
+    glGenVertexArrays(1, &glowVAO);
+    glBindVertexArray(glowVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glowCubes.BindAttributes();
+
+    //后处理pass共用的全屏四边形
+    float quadVertices[] = {-1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f};
+    unsigned int quadVAO, quadVBO;
+    glGenVertexArrays(1, &quadVAO);
+    glGenBuffers(1, &quadVBO);
+    glBindVertexArray(quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    {
+        PROFILE_SCOPE("WaitLoading");
+        JobSystem::Get().Wait(loading);
+    }
+    vector<unsigned int> textures = uploadTextures(texturePaths, images);
+    unsigned int diffuseMap = textures[0];
+    unsigned int specularMap = textures[1];
+    vector<glm::mat4> nanosuitMatrices;
+    updateNanosuits(0.0f, nanosuitMatrices);
+    InstanceBuffer nanosuits(nanosuitMatrices.data(), NANOSUIT_AMOUNT, nullptr, GL_STREAM_DRAW);
+    if(nanosuitLoaded){
+        nanosuit.Upload();
+        nanosuit.SetInstanceBuffer(nanosuits);
+        cout << "nanosuit: " << nanosuit.nodes.size() << " nodes, " << nanosuit.meshes.size() << " meshes" << endl;
+    }
+
+    //模型网格按 漫反射、镜面光、法线 的顺序占用0~2号纹理单元，阴影贴图放在4号
+    objectShader.use();
+    objectShader.setInt("material.diffuse", 0);
+    objectShader.setInt("material.specular", 1);
+    objectShader.setInt("shadowMap", 4);
+
+    //渲染图中用到的渲染目标描述
+    const TextureDesc shadowDesc(SHADOW_RESOLUTION, SHADOW_RESOLUTION, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+    const TextureDesc hdrDesc(SCR_WIDTH, SCR_HEIGHT, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    const TextureDesc depthDesc(SCR_WIDTH, SCR_HEIGHT, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+    const TextureDesc bloomDesc(SCR_WIDTH / 2, SCR_HEIGHT / 2, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    const TextureDesc ldrDesc(SCR_WIDTH, SCR_HEIGHT, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    glm::vec3 lightDir = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+    glm::mat4 lightProjection = glm::ortho(-100.0f, 100.0f, -100.0f, 100.0f, 1.0f, 260.0f);
+    glm::mat4 lightView = glm::lookAt(-lightDir * 120.0f, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 lightSpaceMatrix = lightProjection * lightView;
+
+    RenderGraph graph;
+    int lastConfig = -1;
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    double updateMs = 0.0;
+    double transformMs = 0.0;
+    while (!glfwWindowShouldClose(window)){
+        //分析器以这里为帧的分界，之前的事件都属于启动阶段
+        Profiler::Get().BeginFrame();
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        //显示平均帧时间与渲染图统计
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            JobSystemStats jobStats = JobSystem::Get().TakeStats();
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame, GPU " + to_string(Profiler::Get().LastGpuFrameMs())
+                + " ms, update " + to_string(updateMs / frameCount) + " ms, " + (soaEnabled ? "SoA" : "glm") + " transforms "
+                + to_string(transformMs / frameCount) + " ms - "
+                + (jobsEnabled ? to_string(JobSystem::Get().ThreadCount()) + " threads, " + to_string(jobStats.jobs / frameCount) + " jobs, "
+                    + to_string(jobStats.steals / frameCount) + " steals per frame" : string("single thread")) + " - "
+                + to_string(visible.size()) + "/" + to_string(crateCount) + " crates visible - J: toggle jobs, M: SoA/glm transforms, T: export trace";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+            updateMs = 0.0;
+            transformMs = 0.0;
+        }
+
+        processInput(window);
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+        Frustum frustum = Frustum::FromMatrix(projection * view);
+        auto updateStart = chrono::steady_clock::now();
+        if(jobsEnabled){
+            //箱子动画与剔除作为两个任务提交，剔除依赖动画的计数器，动画完成后才会开始
+            //两个任务内部再各自拆分成并行区间；主线程在等待之前更新发光方块与纳米装甲，之后也参与执行任务
+            JobCounter animated, culled;
+            JobSystem::Get().Run([&](){
+                transformMs += animateCrates(currentFrame, crateSpin, crateTransforms, lightSpaceMatrix, crateMatrices, crateLightMatrices, crateBounds);
+            }, &animated);
+            JobSystem::Get().Run([&](){
+                cullCrates(frustum, crateBounds, crateMatrices, culler, cullScratch, chunkCounts, visible, visibleMatrices);
+            }, &culled, &animated);
+            updateGlowCubes(currentFrame, glowMatrices, glowColors);
+            updateNanosuits(currentFrame, nanosuitMatrices);
+            PROFILE_SCOPE("WaitJobs");
+            JobSystem::Get().Wait(culled);
+        }else{
+            transformMs += animateCrates(currentFrame, crateSpin, crateTransforms, lightSpaceMatrix, crateMatrices, crateLightMatrices, crateBounds);
+            cullCrates(frustum, crateBounds, crateMatrices, culler, cullScratch, chunkCounts, visible, visibleMatrices);
+            updateGlowCubes(currentFrame, glowMatrices, glowColors);
+            updateNanosuits(currentFrame, nanosuitMatrices);
+        }
+        updateMs += chrono::duration<double, milli>(chrono::steady_clock::now() - updateStart).count();
+        {
+            PROFILE_SCOPE("UploadInstances");
+            crates.Update(crateLightMatrices.data(), crateCount);
+            glowCubes.Update(glowMatrices.data(), GLOW_AMOUNT, glowColors.data());
+            visibleCrates.Update(visibleMatrices.data(), static_cast<unsigned int>(visibleMatrices.size()));
+            nanosuits.Update(nanosuitMatrices.data(), NANOSUIT_AMOUNT);
+        }
+        unsigned int visibleCount = static_cast<unsigned int>(visible.size());
+
+        //每帧重新声明渲染图：阴影 -> 场景 -> 泛光（提取亮部与多次模糊）-> 合成 -> 输出
+        //深度可视化pass每帧都声明，只有开启调试叠加时它的输出才会被读取，否则被图剔除
+        graph.Reset();
+        graph.aliasingEnabled = aliasingEnabled;
+        RGResource backbuffer = graph.ImportBackbuffer(SCR_WIDTH, SCR_HEIGHT);
+
+        RGResource shadowMap = graph.CreateTexture("ShadowMap", shadowDesc);
+        graph.AddPass("Shadow", [&](RenderPassBuilder &builder){
+            builder.Write(shadowMap, true);
+        }, [&](const RenderPassContext &){
+            glEnable(GL_DEPTH_TEST);
+            glEnable(GL_POLYGON_OFFSET_FILL);
+            glPolygonOffset(2.0f, 4.0f);
+            shadowShader.use();
+            //箱子的实例矩阵已经乘过lightSpaceMatrix
+            shadowShader.setMat4("lightSpaceMatrix", glm::mat4(1.0f));
+            glBindVertexArray(crateVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, crateCount);
+            shadowShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+            if(nanosuitLoaded)
+                nanosuit.DrawInstanced(shadowShader, NANOSUIT_AMOUNT);
+            glDisable(GL_POLYGON_OFFSET_FILL);
+        });
+
+        RGResource sceneColor = graph.CreateTexture("SceneColor", hdrDesc);
+        RGResource sceneDepth = graph.CreateTexture("SceneDepth", depthDesc);
+        graph.AddPass("Scene", [&](RenderPassBuilder &builder){
+            builder.Read(shadowMap);
+            builder.Write(sceneColor, true);
+            builder.Write(sceneDepth, true);
+        }, [&](const RenderPassContext &context){
+            glEnable(GL_DEPTH_TEST);
+            objectShader.use();
+            objectShader.setFloat("material.shininess", 32.0f);
+            objectShader.setVec3("viewPos", camera.Position);
+            objectShader.setVec3("dirLight.direction", lightDir);
+            objectShader.setVec3("dirLight.ambient", 0.15f, 0.15f, 0.18f);
+            objectShader.setVec3("dirLight.diffuse", 0.9f, 0.85f, 0.8f);
+            objectShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
+            objectShader.setMat4("view", view);
+            objectShader.setMat4("projection", projection);
+            objectShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, diffuseMap);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, specularMap);
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(shadowMap));
+            glBindVertexArray(visibleVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, visibleCount);
+            if(nanosuitLoaded)
+                nanosuit.DrawInstanced(objectShader, NANOSUIT_AMOUNT);
+
+            glowShader.use();
+            glowShader.setMat4("projection", projection);
+            glowShader.setMat4("view", view);
+            glBindVertexArray(glowVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, GLOW_AMOUNT);
+        });
+
+        //泛光：每次模糊都写入一个新的临时目标，生命周期错开的目标由图复用同一张纹理
+        RGResource bloomResult = -1;
+        if(bloomEnabled){
+            RGResource bright = graph.CreateTexture("Bright", bloomDesc);
+            graph.AddPass("BrightPass", [&](RenderPassBuilder &builder){
+                builder.Read(sceneColor);
+                builder.Write(bright);
+            }, [&](const RenderPassContext &context){
+                glDisable(GL_DEPTH_TEST);
+                brightShader.use();
+                brightShader.setInt("hdrBuffer", 0);
+                brightShader.setFloat("threshold", 1.0f);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.Texture(sceneColor));
+                glBindVertexArray(quadVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            });
+            RGResource current = bright;
+            for(int i = 0; i < blurIterations * 2; i++){
+                RGResource input = current;
+                RGResource output = graph.CreateTexture("Blur" + to_string(i), bloomDesc);
+                bool horizontal = i % 2 == 0;
+                graph.AddPass(horizontal ? "BlurH" : "BlurV", [input, output](RenderPassBuilder &builder){
+                    builder.Read(input);
+                    builder.Write(output);
+                }, [&, input, horizontal](const RenderPassContext &context){
+                    glDisable(GL_DEPTH_TEST);
+                    blurShader.use();
+                    blurShader.setInt("image", 0);
+                    blurShader.setBool("horizontal", horizontal);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, context.Texture(input));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                });
+                current = output;
+            }
+            bloomResult = current;
+        }
+
+        RGResource ldr = graph.CreateTexture("LDR", ldrDesc);
+        graph.AddPass("Composite", [&](RenderPassBuilder &builder){
+            builder.Read(sceneColor);
+            if(bloomResult >= 0)
+                builder.Read(bloomResult);
+            builder.Write(ldr);
+        }, [&](const RenderPassContext &context){
+            glDisable(GL_DEPTH_TEST);
+            compositeShader.use();
+            compositeShader.setInt("hdrBuffer", 0);
+            compositeShader.setInt("bloomBuffer", 1);
+            compositeShader.setBool("bloom", bloomResult >= 0);
+            compositeShader.setFloat("bloomStrength", 0.6f);
+            compositeShader.setFloat("exposure", 1.2f);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(sceneColor));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, bloomResult >= 0 ? context.Texture(bloomResult) : 0);
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        });
+
+        RGResource depthView = graph.CreateTexture("DepthView", ldrDesc);
+        graph.AddPass("DepthView", [&](RenderPassBuilder &builder){
+            builder.Read(sceneDepth);
+            builder.Write(depthView);
+        }, [&](const RenderPassContext &context){
+            glDisable(GL_DEPTH_TEST);
+            depthViewShader.use();
+            depthViewShader.setInt("depthBuffer", 0);
+            depthViewShader.setFloat("nearPlane", NEAR_PLANE);
+            depthViewShader.setFloat("farPlane", FAR_PLANE);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(sceneDepth));
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        });
+
+        graph.AddPass("Output", [&](RenderPassBuilder &builder){
+            builder.Read(ldr);
+            builder.Write(backbuffer);
+        }, [&](const RenderPassContext &context){
+            glDisable(GL_DEPTH_TEST);
+            postShader.use();
+            postShader.setInt("image", 0);
+            postShader.setFloat("vignette", 0.8f);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(ldr));
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        });
+
+        if(showDepth){
+            graph.AddPass("DepthOverlay", [&](RenderPassBuilder &builder){
+                builder.Read(depthView);
+                builder.Write(backbuffer);
+            }, [&](const RenderPassContext &context){
+                //画在屏幕右上角
+                glViewport(context.width * 2 / 3, context.height * 2 / 3, context.width / 3, context.height / 3);
+                postShader.use();
+                postShader.setInt("image", 0);
+                postShader.setFloat("vignette", 0.0f);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.Texture(depthView));
+                glBindVertexArray(quadVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                glViewport(0, 0, context.width, context.height);
+            });
+        }
+
+        graph.Compile();
+        {
+            PROFILE_SCOPE("Execute");
+            graph.Execute();
+        }
+
+        //图的结构变化时在控制台输出pass顺序与纹理分配
+        int config = (bloomEnabled ? 1 : 0) | (showDepth ? 2 : 0) | (aliasingEnabled ? 4 : 0) | (blurIterations << 3);
+        if(config != lastConfig){
+            cout << "Render graph:" << endl << graph.Describe();
+            lastConfig = config;
+        }
+
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+    }
+    glDeleteVertexArrays(1, &crateVAO);
+    glDeleteVertexArrays(1, &glowVAO);
+    glDeleteVertexArrays(1, &visibleVAO);
+    glDeleteVertexArrays(1, &quadVAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &quadVBO);
+    crates.Release();
+    glowCubes.Release();
+    visibleCrates.Release();
+    nanosuits.Release();
+    glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    graph.Release();
+    Profiler::Get().Release();
+    JobSystem::Get().Shutdown();
+
+    glfwTerminate();
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#version 330 core
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+out vec4 FragColor;
+
+struct Material{
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+//定向光
+struct DirLight{
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+//点光源
+struct PointLight {
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+#define NR_POINT_LIGHTS 16//点光源的最大数量，实际数量由场景决定
+
+uniform vec3 viewPos;
+uniform Material material;
+uniform DirLight dirLight;//定向光
+uniform PointLight pointLights[NR_POINT_LIGHTS];//点光源
+uniform int pointLightCount;
+uniform sampler2D shadowMap;//渲染图分配的深度纹理，没有开启比较模式，在着色器中手动比较
+uniform mat4 lightSpaceMatrix;
+
+//计算阴影，返回0为完全在阴影中，1为完全受光
+float ShadowFactor(vec3 normal, vec3 lightDir)
+{
+    vec4 lightSpacePos = lightSpaceMatrix * vec4(FragPos, 1.0);
+    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+    if(projCoords.z > 1.0 || any(lessThan(projCoords.xy, vec2(0.0))) || any(greaterThan(projCoords.xy, vec2(1.0))))
+        return 1.0;
+    float bias = max(0.004 * (1.0 - dot(normal, lightDir)), 0.0008);
+    //3x3 PCF
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++){
+        for(int y = -1; y <= 1; y++){
+            float depth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
+            lit += projCoords.z - bias > depth ? 0.0 : 1.0;
+        }
+    }
+    return lit / 9.0;
+}
+
+//计算点光源分量，点光源不投射阴影
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // 漫反射着色
+    float diff = max(dot(normal, lightDir), 0.0);
+    // 镜面光着色
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // 衰减
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // 合并结果
+    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
+    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
+    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+    return (ambient + diffuse + specular) * attenuation;
+}
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 lightDir = normalize(-dirLight.direction);
+    // 漫反射着色
+    float diff = max(dot(norm, lightDir), 0.0);
+    // 镜面光着色
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // 合并结果，环境光不受阴影影响；输出到浮点颜色缓冲，亮度可以超过1
+    vec3 ambient = dirLight.ambient * vec3(texture(material.diffuse, TexCoords));
+    vec3 diffuse = dirLight.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
+    vec3 specular = dirLight.specular * spec * vec3(texture(material.specular, TexCoords));
+    float shadow = ShadowFactor(norm, lightDir);
+    vec3 result = ambient + shadow * (diffuse + specular);
+    for(int i = 0; i < pointLightCount; i++)
+        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,449 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+using namespace std;
+
+//为0时所有宏展开为空，不产生任何开销
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+//环形缓冲保存的帧数
+#define PROFILER_FRAMES 120
+//GPU计时至少等待多少帧再读取，避免读取结果时等待GPU
+#define PROFILER_GPU_LATENCY 3
+
+//一次CPU或GPU计时，时间都换算到分析器启动后的纳秒
+struct ProfileEvent {
+    string name;
+    long long start = 0, end = 0;
+    unsigned int depth = 0;//嵌套深度，0为最外层
+    unsigned int thread = 0;//CPU事件所在的线程序号，GPU事件为0
+    unsigned int queryBegin = 0, queryEnd = 0;//GPU事件在本帧查询池中的序号
+};
+
+//一帧的记录：CPU事件可以来自任意线程，GPU事件只来自OpenGL线程
+struct ProfileFrame {
+    unsigned long long index = 0;
+    long long start = 0, end = 0;
+    vector<ProfileEvent> cpuEvents;
+    vector<ProfileEvent> gpuEvents;
+    vector<unsigned int> queries;//本帧使用的时间戳查询，对象在环形缓冲中重复使用
+    unsigned int queryCount = 0;
+    long long gpuOffset = 0;//GPU时间戳换算到CPU时间轴的偏移
+    bool gpuResolved = false;
+    bool valid = false;
+};
+
+//按名字汇总环形缓冲中已读取完的帧，单位毫秒
+struct ProfileSummary {
+    string name;
+    float cpuMs = 0.0f;//每帧平均CPU时间，没有CPU事件时为0
+    float gpuMs = 0.0f;//每帧平均GPU时间，没有GPU事件时为0
+    float calls = 0.0f;//每帧平均调用次数
+};
+
+//帧分析器：
+//  CPU计时用RAII作用域记录开始与结束时间，每个线程单独记录嵌套深度，多个线程可以同时记录
+//  GPU计时在作用域两端各插入一个GL_TIMESTAMP时间戳查询（GL_TIME_ELAPSED不能嵌套，时间戳可以），
+//  至少PROFILER_GPU_LATENCY帧之后、查询结果可用时才读取，整个过程不会让CPU等待GPU
+//  最近PROFILER_FRAMES帧保存在环形缓冲中，可以导出为Chrome trace（chrome://tracing或ui.perfetto.dev打开）
+//BeginFrame之前记录的事件（例如加载资源）单独保存为启动阶段，一直保留并一起导出
+class Profiler {
+public:
+    static Profiler &Get(){
+        static Profiler instance;
+        return instance;
+    }
+
+    //创建OpenGL上下文之后调用，开始记录GPU时间；不调用时只记录CPU
+    void InitGPU(){
+        GLint bits = 0;
+        glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+        gpuEnabled = bits > 0;
+        if(!gpuEnabled)
+            cout << "Profiler: GL_TIMESTAMP queries not supported, GPU scopes disabled" << endl;
+    }
+
+    //结束上一帧并开始新的一帧，只在OpenGL线程调用
+    void BeginFrame(){
+        long long now = Now();
+        lock_guard<mutex> lock(eventMutex);
+        if(current != nullptr){
+            current->end = now;
+            if(gpuEnabled && !current->gpuEvents.empty())
+                current->gpuEvents[0].queryEnd = timestamp(*current);
+            current->valid = true;
+        }
+        else
+            startup.end = now;
+        resolveGPU(false);
+
+        ProfileFrame &frame = frames[frameIndex % PROFILER_FRAMES];
+        //环形缓冲覆盖到还没有读取的帧时丢弃它的GPU数据，而不是等待
+        if(frame.valid && !frame.gpuResolved)
+            droppedFrames++;
+        frame.index = frameIndex++;
+        frame.start = now;
+        frame.end = now;
+        frame.cpuEvents.clear();
+        frame.gpuEvents.clear();
+        frame.queryCount = 0;
+        frame.gpuResolved = !gpuEnabled;
+        frame.valid = false;
+        current = &frame;
+        if(gpuEnabled){
+            calibrate(frame);
+            ProfileEvent event;
+            event.name = "GPU Frame";
+            event.queryBegin = timestamp(frame);
+            frame.gpuEvents.push_back(event);
+        }
+    }
+
+    void SetThreadName(const string &name){
+        unsigned int id = threadId();
+        lock_guard<mutex> lock(eventMutex);
+        threadNames[id] = name;
+    }
+
+    //当前时间，分析器启动后的纳秒
+    long long Now() const{
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+    }
+
+    //CPU作用域，由ProfileScope调用
+    unsigned int BeginCpu(){
+        return threadDepth()++;
+    }
+
+    void EndCpu(const string &name, long long start, unsigned int depth){
+        long long end = Now();
+        threadDepth()--;
+        ProfileEvent event;
+        event.name = name;
+        event.start = start;
+        event.end = end;
+        event.depth = depth;
+        event.thread = threadId();
+        lock_guard<mutex> lock(eventMutex);
+        target().cpuEvents.push_back(event);
+    }
+
+    //GPU作用域，由GpuProfileScope调用，只能在OpenGL线程使用；返回事件序号，未启用时返回-1
+    int BeginGpu(const string &name){
+        if(!gpuEnabled || current == nullptr)
+            return -1;
+        ProfileEvent event;
+        event.name = name;
+        event.depth = gpuDepth++;
+        event.queryBegin = timestamp(*current);
+        current->gpuEvents.push_back(event);
+        return static_cast<int>(current->gpuEvents.size()) - 1;
+    }
+
+    void EndGpu(int event){
+        if(event < 0 || current == nullptr)
+            return;
+        gpuDepth--;
+        current->gpuEvents[event].queryEnd = timestamp(*current);
+    }
+
+    //最近一帧已读取的GPU帧时间（毫秒）
+    float LastGpuFrameMs() const{
+        const ProfileFrame *frame = latestResolved();
+        if(frame == nullptr || frame->gpuEvents.empty())
+            return 0.0f;
+        return (frame->gpuEvents[0].end - frame->gpuEvents[0].start) / 1.0e6f;
+    }
+
+    //按名字汇总所有已读取完的帧，按CPU与GPU时间中较大者从大到小排序
+    vector<ProfileSummary> Summarize() const{
+        map<string, ProfileSummary> byName;
+        map<string, float> gpuCalls;
+        unsigned int frameCount = 0;
+        for(unsigned int i = 0; i < PROFILER_FRAMES; i++){
+            const ProfileFrame &frame = frames[i];
+            if(!frame.valid || !frame.gpuResolved)
+                continue;
+            frameCount++;
+            for(unsigned int k = 0; k < frame.cpuEvents.size(); k++){
+                ProfileSummary &summary = byName[frame.cpuEvents[k].name];
+                summary.cpuMs += (frame.cpuEvents[k].end - frame.cpuEvents[k].start) / 1.0e6f;
+                summary.calls += 1.0f;
+            }
+            for(unsigned int k = 0; k < frame.gpuEvents.size(); k++){
+                byName[frame.gpuEvents[k].name].gpuMs += (frame.gpuEvents[k].end - frame.gpuEvents[k].start) / 1.0e6f;
+                gpuCalls[frame.gpuEvents[k].name] += 1.0f;
+            }
+        }
+        vector<ProfileSummary> result;
+        for(map<string, ProfileSummary>::iterator it = byName.begin(); it != byName.end(); ++it){
+            ProfileSummary summary = it->second;
+            summary.name = it->first;
+            //只有GPU计时的作用域按GPU事件计数
+            summary.calls = max(summary.calls, gpuCalls[it->first]);
+            if(frameCount > 0){
+                summary.cpuMs /= frameCount;
+                summary.gpuMs /= frameCount;
+                summary.calls /= frameCount;
+            }
+            result.push_back(summary);
+        }
+        sort(result.begin(), result.end(), [](const ProfileSummary &a, const ProfileSummary &b){
+            return max(a.cpuMs, a.gpuMs) > max(b.cpuMs, b.gpuMs);
+        });
+        return result;
+    }
+
+    //导出启动阶段与环形缓冲中已结束的帧，时间单位为微秒
+    //导出是一次性的操作，这里等待GPU读取最近几帧的结果
+    //CPU事件按线程分行，GPU事件单独一行，帧本身作为最外层的事件
+    bool ExportChromeTrace(const string &path){
+        lock_guard<mutex> lock(eventMutex);
+        resolveGPU(true);
+        ofstream file(path.c_str());
+        if(!file){
+            cout << "ERROR::PROFILER::CANNOT_WRITE: " << path << endl;
+            return false;
+        }
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        //线程名
+        writeMeta(file, first, GPU_TRACK, "GPU");
+        for(map<unsigned int, string>::iterator it = threadNames.begin(); it != threadNames.end(); ++it)
+            writeMeta(file, first, it->first, it->second);
+        writeFrame(file, first, startup, "Startup");
+        //按帧序号从旧到新输出
+        unsigned int exported = 0;
+        for(unsigned int i = 0; i < PROFILER_FRAMES; i++){
+            const ProfileFrame &frame = frames[(frameIndex + i) % PROFILER_FRAMES];
+            if(!frame.valid || !frame.gpuResolved)
+                continue;
+            writeFrame(file, first, frame, "Frame " + to_string(frame.index));
+            exported++;
+        }
+        file << "\n]}\n";
+        cout << "Profiler: exported startup and " << exported << " frames to " << path << endl;
+        return true;
+    }
+
+    void Release(){
+        for(unsigned int i = 0; i < PROFILER_FRAMES; i++){
+            if(!frames[i].queries.empty())
+                glDeleteQueries(static_cast<GLsizei>(frames[i].queries.size()), frames[i].queries.data());
+            frames[i].queries.clear();
+        }
+        gpuEnabled = false;
+    }
+
+    unsigned int DroppedFrames() const{
+        return droppedFrames;
+    }
+
+private:
+    //Chrome trace中GPU事件使用的线程号，CPU线程从1开始编号
+    static const unsigned int GPU_TRACK = 0;
+
+    chrono::steady_clock::time_point epoch;
+    ProfileFrame frames[PROFILER_FRAMES];
+    ProfileFrame startup;
+    ProfileFrame *current = nullptr;//BeginFrame之前为nullptr
+    unsigned long long frameIndex = 1;//0留给启动阶段
+    bool gpuEnabled = false;
+    unsigned int gpuDepth = 0;
+    unsigned int droppedFrames = 0;
+    mutex eventMutex;
+    map<thread::id, unsigned int> threadIds;
+    map<unsigned int, string> threadNames;
+
+    Profiler(){
+        epoch = chrono::steady_clock::now();
+        startup.valid = true;
+        startup.gpuResolved = true;
+        SetThreadName("Main");
+    }
+
+    ProfileFrame &target(){
+        return current != nullptr ? *current : startup;
+    }
+
+    unsigned int &threadDepth(){
+        thread_local unsigned int depth = 0;
+        return depth;
+    }
+
+    //线程按第一次记录事件的顺序编号
+    unsigned int threadId(){
+        thread_local unsigned int id = 0;
+        if(id == 0){
+            lock_guard<mutex> lock(eventMutex);
+            map<thread::id, unsigned int>::iterator it = threadIds.find(this_thread::get_id());
+            if(it == threadIds.end()){
+                unsigned int next = static_cast<unsigned int>(threadIds.size()) + 1;
+                it = threadIds.insert(make_pair(this_thread::get_id(), next)).first;
+                threadNames[next] = "Worker " + to_string(next - 1);
+            }
+            id = it->second;
+        }
+        return id;
+    }
+
+    //记录GPU当前时间与CPU当前时间的差，用来把时间戳换到CPU时间轴上
+    void calibrate(ProfileFrame &frame){
+        if(!gpuEnabled)
+            return;
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        frame.gpuOffset = Now() - gpuNow;
+    }
+
+    //插入一个时间戳查询，返回它在本帧查询池中的序号
+    unsigned int timestamp(ProfileFrame &frame){
+        if(frame.queryCount == frame.queries.size()){
+            unsigned int grow = max(16u, static_cast<unsigned int>(frame.queries.size()));
+            frame.queries.resize(frame.queries.size() + grow);
+            glGenQueries(grow, &frame.queries[frame.queryCount]);
+        }
+        glQueryCounter(frame.queries[frame.queryCount], GL_TIMESTAMP);
+        return frame.queryCount++;
+    }
+
+    //从最旧的帧开始读取GPU结果，遇到结果还不可用的帧就停下，下次再读
+    //时间戳按提交顺序完成，所以只需要检查一帧的最后一个查询；wait为true时读取所有已结束的帧
+    void resolveGPU(bool wait){
+        if(!gpuEnabled)
+            return;
+        for(unsigned int i = 0; i < PROFILER_FRAMES; i++){
+            ProfileFrame &frame = frames[(frameIndex + i) % PROFILER_FRAMES];
+            if(!frame.valid || frame.gpuResolved)
+                continue;
+            if(frame.queryCount == 0){
+                frame.gpuResolved = true;
+                continue;
+            }
+            if(!wait){
+                if(frame.index + PROFILER_GPU_LATENCY > frameIndex)
+                    return;
+                GLint available = 0;
+                glGetQueryObjectiv(frame.queries[frame.queryCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+                if(!available)
+                    return;
+            }
+            for(unsigned int k = 0; k < frame.gpuEvents.size(); k++){
+                ProfileEvent &event = frame.gpuEvents[k];
+                GLuint64 begin = 0, end = 0;
+                glGetQueryObjectui64v(frame.queries[event.queryBegin], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(frame.queries[event.queryEnd], GL_QUERY_RESULT, &end);
+                event.start = static_cast<long long>(begin) + frame.gpuOffset;
+                event.end = static_cast<long long>(end) + frame.gpuOffset;
+            }
+            frame.gpuResolved = true;
+        }
+    }
+
+    const ProfileFrame *latestResolved() const{
+        const ProfileFrame *latest = nullptr;
+        for(unsigned int i = 0; i < PROFILER_FRAMES; i++){
+            const ProfileFrame &frame = frames[i];
+            if(frame.valid && frame.gpuResolved && (latest == nullptr || frame.index > latest->index))
+                latest = &frame;
+        }
+        return latest;
+    }
+
+    static string escape(const string &text){
+        string result;
+        for(unsigned int i = 0; i < text.size(); i++){
+            if(text[i] == '"' || text[i] == '\\')
+                result += '\\';
+            result += text[i];
+        }
+        return result;
+    }
+
+    static void writeMeta(ofstream &file, bool &first, unsigned int tid, const string &name){
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+            << ",\"args\":{\"name\":\"" << escape(name) << "\"}}";
+        first = false;
+    }
+
+    static void writeEvent(ofstream &file, bool &first, const string &name, const char *category, unsigned int tid, long long start, long long end, unsigned long long frame){
+        file << (first ? "" : ",\n") << "{\"name\":\"" << escape(name) << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+            << ",\"ts\":" << start / 1000.0 << ",\"dur\":" << max(0LL, end - start) / 1000.0 << ",\"args\":{\"frame\":" << frame << "}}";
+        first = false;
+    }
+
+    static void writeFrame(ofstream &file, bool &first, const ProfileFrame &frame, const string &name){
+        file.precision(15);
+        writeEvent(file, first, name, "frame", 1, frame.start, frame.end, frame.index);
+        for(unsigned int k = 0; k < frame.cpuEvents.size(); k++){
+            const ProfileEvent &event = frame.cpuEvents[k];
+            writeEvent(file, first, event.name, "cpu", event.thread, event.start, event.end, frame.index);
+        }
+        for(unsigned int k = 0; k < frame.gpuEvents.size(); k++){
+            const ProfileEvent &event = frame.gpuEvents[k];
+            writeEvent(file, first, event.name, "gpu", GPU_TRACK, event.start, event.end, frame.index);
+        }
+    }
+};
+
+//CPU计时作用域，离开作用域时记录
+class ProfileScope {
+public:
+    ProfileScope(const string &name) : name(name){
+        depth = Profiler::Get().BeginCpu();
+        start = Profiler::Get().Now();
+    }
+    ~ProfileScope(){
+        Profiler::Get().EndCpu(name, start, depth);
+    }
+
+private:
+    string name;
+    long long start;
+    unsigned int depth;
+};
+
+//GPU计时作用域，两端各插入一个时间戳查询
+class GpuProfileScope {
+public:
+    GpuProfileScope(const string &name){
+        event = Profiler::Get().BeginGpu(name);
+    }
+    ~GpuProfileScope(){
+        Profiler::Get().EndGpu(event);
+    }
+
+private:
+    int event;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#if PROFILER_ENABLED
+//记录所在作用域的CPU时间
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+//记录所在函数的CPU时间
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+//记录所在作用域中提交的OpenGL命令的GPU时间，只能在OpenGL线程使用
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+//同时记录CPU与GPU时间
+#define PROFILE_PASS(name) PROFILE_SCOPE(name); PROFILE_GPU_SCOPE(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_GPU_SCOPE(name)
+#define PROFILE_PASS(name)
+#endif
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef SCENEBENCHMARK_H
+#define SCENEBENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include "Transform.h"
+#include "SceneFormat.h"
+#include "SceneConverter.h"
+using namespace std;
+
+//场景加载的基准测试：生成含N个实体的文本场景，对比解析文本与映射二进制文件的耗时
+//  make scenebench dir=4_20_SceneFormat entities=100000
+//不创建窗口，生成的文件写在./output/下；文件刚写过，测到的是文件已在系统缓存中的情况
+struct SceneBenchmarkOptions {
+    bool enabled = false;
+    unsigned int entities = 100000;
+    unsigned int repeats = 5;//每项测试重复的次数，取最快的一次
+};
+
+//解析 --scenebench、--entities N、--repeats N，其余参数忽略
+SceneBenchmarkOptions ParseSceneBenchmarkArgs(int argc, char *argv[]){
+    SceneBenchmarkOptions options;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--scenebench")
+            options.enabled = true;
+        else if(arg == "--entities" && i + 1 < argc)
+            options.entities = static_cast<unsigned int>(max(1, atoi(argv[++i])));
+        else if(arg == "--repeats" && i + 1 < argc)
+            options.repeats = static_cast<unsigned int>(max(1, atoi(argv[++i])));
+    }
+    return options;
+}
+
+class SceneBenchmark {
+public:
+    SceneBenchmark(const SceneBenchmarkOptions &options) : options(options){}
+
+    void Run(){
+        const string textPath = "./output/scenebench.txt";
+        const string binaryPath = "./output/scenebench.bin";
+        if(!writeText(textPath))
+            return;
+        cout << "Scene load benchmark: " << options.entities << " entities, best of " << options.repeats << " runs" << endl;
+        cout << left << setw(28) << "step" << right << setw(12) << "ms" << setw(12) << "MB" << endl;
+        cout << fixed << setprecision(3);
+
+        SceneDescription description;
+        double parse = best([&](){
+            description = SceneDescription();
+            SceneConverter::Parse(textPath, description);
+        });
+        printRow("parse text", parse, fileSize(textPath));
+        double write = best([&](){
+            SceneConverter::Write(description, binaryPath);
+        });
+        printRow("build + write binary", write, fileSize(binaryPath));
+
+        SceneFile scene;
+        double open = best([&](){
+            scene.Open(binaryPath);
+        });
+        printRow("map + validate", open, fileSize(binaryPath));
+        TransformStore transforms;
+        double load = best([&](){
+            scene.Open(binaryPath);
+            scene.LoadTransforms(transforms);
+        });
+        printRow("map + copy transforms", load, fileSize(binaryPath));
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+
+        //映射的内容与解析文本得到的结果应该一致
+        bool same = scene.EntityCount() == description.entities.size() && transforms.Size() == scene.EntityCount();
+        if(same){
+            vector<char> built;
+            SceneConverter::Build(description, built);
+            same = built.size() == scene.Size() && memcmp(built.data(), scene.Data(), built.size()) == 0;
+        }
+        cout << "binary scene " << (same ? "matches" : "DOES NOT match") << " the parsed text" << endl;
+    }
+
+private:
+    SceneBenchmarkOptions options;
+
+    //重复执行取最快的一次，单位毫秒
+    double best(const function<void()> &func){
+        double result = 1e30;
+        for(unsigned int i = 0; i < options.repeats; i++){
+            auto start = chrono::steady_clock::now();
+            func();
+            result = min(result, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        }
+        return result;
+    }
+
+    static double fileSize(const string &path){
+        ifstream file(path.c_str(), ios::binary | ios::ate);
+        return file.is_open() ? static_cast<double>(file.tellg()) / (1024.0 * 1024.0) : 0.0;
+    }
+
+    static void printRow(const string &name, double ms, double mb){
+        cout << left << setw(28) << name << right << setw(12) << ms << setw(12) << mb << endl;
+    }
+
+    //与课程场景相同的网格与材质，实体随机分布在地面上，每个实体都写成一行entity指令
+    bool writeText(const string &path){
+        ofstream file(path.c_str());
+        if(!file.is_open()){
+            cout << "ERROR::SCENE::FILE_NOT_SUCCESFULLY_WRITTEN " << path << endl;
+            return false;
+        }
+        file << "mesh cube cube" << endl << "mesh nanosuit static/model/nanosuit/nanosuit.obj" << endl;
+        file << "material crate ./static/texture/container2.png ./static/texture/container2_specular.png 32" << endl;
+        file << "material floor ./static/texture/wood.png - 16" << endl;
+        file << "pointlight 0 4 0  0.02 0.02 0.02  3 3 3  3 3 3  1 0.14 0.07" << endl;
+        SceneRandom random(11);
+        float extent = sqrt(static_cast<float>(options.entities)) * 2.0f;
+        file << fixed << setprecision(3);
+        for(unsigned int i = 0; i < options.entities; i++){
+            float roll = random.Next();
+            const char *reference = roll < 0.001f ? "nanosuit -" : (roll < 0.5f ? "cube floor" : "cube crate");
+            file << "entity " << reference << " " << (random.Next() - 0.5f) * extent << " " << random.Next() * 4.0f << " "
+                << (random.Next() - 0.5f) * extent << " " << random.Next() * 360.0f << " 0 0 1 1 1 " << (random.Next() - 0.5f) * 120.0f << "\n";
+        }
+        return file.good();
+    }
+};
+
+#endif
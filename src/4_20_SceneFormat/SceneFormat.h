@@ -0,0 +1,312 @@
+#ifndef SCENEFORMAT_H
+#define SCENEFORMAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "Transform.h"
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+//二进制场景格式：一个头部加若干数组，数组用相对文件开头的字节偏移引用，每个数组按16字节对齐
+//文件内容就是运行时使用的内存布局，映射（mmap）到内存后直接按偏移访问，没有逐个实体的解析步骤
+//  SceneHeader | 字符串 | 网格 | 材质 | 批次 | 点光源 | 实体的平移、旋转、缩放、转速（SoA，每个分量一个float数组）
+//实体按（网格，材质）排好序，同一批次的实体在数组中连续，一个批次对应一次实例化绘制
+//所有数值按小端序存放，由SceneConverter.h中的转换工具从文本场景生成
+#define SCENE_MAGIC 0x4E435347 //"GSCN"
+#define SCENE_VERSION 1
+#define SCENE_ALIGNMENT 16
+#define SCENE_NONE 0xFFFFFFFFu //不引用任何字符串或材质
+
+//文件中的数组：offset为相对文件开头的字节偏移，count为元素个数
+template<typename T>
+struct SceneArray {
+    uint32_t offset;
+    uint32_t count;
+};
+
+struct SceneMesh {
+    uint32_t name;//字符串偏移
+    uint32_t path;//模型文件路径的字符串偏移，SCENE_NONE表示内置的立方体
+};
+
+struct SceneMaterial {
+    uint32_t name;
+    uint32_t diffuse;//漫反射贴图路径，SCENE_NONE时为白色
+    uint32_t specular;//镜面光贴图路径，SCENE_NONE时没有镜面光
+    float shininess;
+};
+
+//批次：[first, first + count)范围内的实体使用同一个网格与材质
+struct SceneBatch {
+    uint32_t mesh;
+    uint32_t material;//SCENE_NONE表示使用模型自带的纹理
+    uint32_t first;
+    uint32_t count;
+};
+
+//与2_12_MultiLight中着色器的PointLight相同
+struct ScenePointLight {
+    float position[3];
+    float ambient[3];
+    float diffuse[3];
+    float specular[3];
+    float constant, linear, quadratic;
+};
+
+struct SceneDirLight {
+    float direction[3];
+    float ambient[3];
+    float diffuse[3];
+    float specular[3];
+};
+
+struct SceneCamera {
+    float position[3];
+    float yaw, pitch;
+};
+
+//实体的分量数组，前10个与TransformStore的成员一一对应
+enum SceneStream {
+    SCENE_PX, SCENE_PY, SCENE_PZ,
+    SCENE_RX, SCENE_RY, SCENE_RZ, SCENE_RW,
+    SCENE_SX, SCENE_SY, SCENE_SZ,
+    SCENE_SPIN,//绕自身y轴的转速（弧度/秒），0表示静止
+    SCENE_STREAM_COUNT
+};
+
+struct SceneHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t fileSize;
+    uint32_t entityCount;
+    SceneCamera camera;
+    SceneDirLight dirLight;
+    float boundsMin[3], boundsMax[3];//所有实体位置的范围
+    SceneArray<char> strings;//以'\0'结尾的字符串依次存放
+    SceneArray<SceneMesh> meshes;
+    SceneArray<SceneMaterial> materials;
+    SceneArray<SceneBatch> batches;
+    SceneArray<ScenePointLight> pointLights;
+    SceneArray<float> streams[SCENE_STREAM_COUNT];//每个数组都有entityCount个元素
+};
+
+static_assert(sizeof(ScenePointLight) == 15 * sizeof(float), "ScenePointLight must not have padding");
+static_assert(sizeof(SceneDirLight) == 12 * sizeof(float), "SceneDirLight must not have padding");
+
+//只读地映射一个二进制场景文件，打开时只检查头部与各数组的范围，之后的访问都是指针运算
+//映射在Close或析构之前一直有效，返回的指针都指向映射的内存
+class SceneFile {
+public:
+    SceneFile(){}
+    ~SceneFile(){
+        Close();
+    }
+    SceneFile(const SceneFile &) = delete;
+    SceneFile &operator=(const SceneFile &) = delete;
+
+    bool Open(const string &path){
+        Close();
+        if(!mapFile(path)){
+            cout << "ERROR::SCENE::FILE_NOT_SUCCESFULLY_READ " << path << endl;
+            return false;
+        }
+        string reason = validate();
+        if(!reason.empty()){
+            cout << "ERROR::SCENE::INVALID_FILE " << path << ": " << reason << endl;
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close(){
+        if(base == nullptr)
+            return;
+#if defined(_WIN32)
+        UnmapViewOfFile(base);
+        CloseHandle(mapping);
+        CloseHandle(file);
+        mapping = file = INVALID_HANDLE_VALUE;
+#else
+        munmap(const_cast<char*>(base), size);
+#endif
+        base = nullptr;
+        size = 0;
+    }
+
+    bool IsOpen() const{
+        return base != nullptr;
+    }
+    size_t Size() const{
+        return size;
+    }
+    const char *Data() const{
+        return base;
+    }
+    const SceneHeader &Header() const{
+        return *reinterpret_cast<const SceneHeader*>(base);
+    }
+    unsigned int EntityCount() const{
+        return Header().entityCount;
+    }
+    unsigned int MeshCount() const{
+        return Header().meshes.count;
+    }
+    unsigned int MaterialCount() const{
+        return Header().materials.count;
+    }
+    unsigned int BatchCount() const{
+        return Header().batches.count;
+    }
+    unsigned int PointLightCount() const{
+        return Header().pointLights.count;
+    }
+    const SceneMesh &Mesh(unsigned int i) const{
+        return Array(Header().meshes)[i];
+    }
+    const SceneMaterial &Material(unsigned int i) const{
+        return Array(Header().materials)[i];
+    }
+    const SceneBatch &Batch(unsigned int i) const{
+        return Array(Header().batches)[i];
+    }
+    const ScenePointLight &PointLight(unsigned int i) const{
+        return Array(Header().pointLights)[i];
+    }
+    const float *Stream(SceneStream stream) const{
+        return Array(Header().streams[stream]);
+    }
+    //SCENE_NONE返回空字符串
+    const char *String(uint32_t offset) const{
+        return offset == SCENE_NONE ? "" : Array(Header().strings) + offset;
+    }
+
+    template<typename T>
+    const T *Array(const SceneArray<T> &array) const{
+        return reinterpret_cast<const T*>(base + array.offset);
+    }
+
+    //把实体变换整块复制到TransformStore中，运行时会修改旋转，所以不能直接使用映射的只读内存
+    void LoadTransforms(TransformStore &transforms) const{
+        unsigned int count = EntityCount();
+        vector<float> *targets[10] = {&transforms.px, &transforms.py, &transforms.pz, &transforms.rx, &transforms.ry, &transforms.rz, &transforms.rw,
+            &transforms.sx, &transforms.sy, &transforms.sz};
+        for(int s = 0; s < 10; s++){
+            const float *source = Stream(static_cast<SceneStream>(s));
+            targets[s]->assign(source, source + count);
+        }
+    }
+
+private:
+    const char *base = nullptr;
+    size_t size = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = INVALID_HANDLE_VALUE;
+#endif
+
+    bool mapFile(const string &path){
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0){
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void *view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if(view == nullptr){
+            if(mapping != nullptr)
+                CloseHandle(mapping);
+            CloseHandle(file);
+            mapping = file = INVALID_HANDLE_VALUE;
+            return false;
+        }
+        base = static_cast<const char*>(view);
+        size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return false;
+        struct stat info;
+        if(fstat(fd, &info) != 0 || info.st_size == 0){
+            close(fd);
+            return false;
+        }
+        void *view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        //映射建立后文件描述符就不再需要
+        close(fd);
+        if(view == MAP_FAILED)
+            return false;
+        base = static_cast<const char*>(view);
+        size = static_cast<size_t>(info.st_size);
+#endif
+        return true;
+    }
+
+    template<typename T>
+    bool inRange(const SceneArray<T> &array) const{
+        return array.offset % SCENE_ALIGNMENT == 0 && static_cast<uint64_t>(array.offset) + static_cast<uint64_t>(array.count) * sizeof(T) <= size;
+    }
+
+    //只检查头部与数组的边界，以及批次、网格、材质中的引用，代价与实体数量无关；返回空字符串表示文件有效
+    string validate() const{
+        if(size < sizeof(SceneHeader))
+            return "file too small";
+        const SceneHeader &header = Header();
+        if(header.magic != SCENE_MAGIC)
+            return "not a scene file";
+        if(header.version != SCENE_VERSION)
+            return "version " + to_string(header.version) + ", expected " + to_string(SCENE_VERSION);
+        if(header.fileSize != size)
+            return "truncated file";
+        if(!inRange(header.strings) || !inRange(header.meshes) || !inRange(header.materials) || !inRange(header.batches) || !inRange(header.pointLights))
+            return "array out of range";
+        for(int s = 0; s < SCENE_STREAM_COUNT; s++){
+            if(header.streams[s].count != header.entityCount || !inRange(header.streams[s]))
+                return "entity stream out of range";
+        }
+        if(header.strings.count > 0 && Array(header.strings)[header.strings.count - 1] != '\0')
+            return "unterminated string table";
+        auto validString = [&](uint32_t offset){
+            return offset == SCENE_NONE || offset < header.strings.count;
+        };
+        for(unsigned int i = 0; i < header.meshes.count; i++){
+            if(!validString(Mesh(i).name) || !validString(Mesh(i).path))
+                return "bad mesh " + to_string(i);
+        }
+        for(unsigned int i = 0; i < header.materials.count; i++){
+            const SceneMaterial &material = Material(i);
+            if(!validString(material.name) || !validString(material.diffuse) || !validString(material.specular))
+                return "bad material " + to_string(i);
+        }
+        for(unsigned int i = 0; i < header.batches.count; i++){
+            const SceneBatch &batch = Batch(i);
+            if(batch.mesh >= header.meshes.count || (batch.material != SCENE_NONE && batch.material >= header.materials.count)
+                || static_cast<uint64_t>(batch.first) + batch.count > header.entityCount)
+                return "bad batch " + to_string(i);
+        }
+        return "";
+    }
+};
+
+#endif
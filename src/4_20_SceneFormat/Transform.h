@@ -0,0 +1,174 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+#include <cmath>
+#include "Bounds.h"
+#include "Frustum.h"
+using namespace std;
+
+//SIMD指令集选择：一次组合4个物体的矩阵，每个分量占一个4宽寄存器
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_USE_SSE
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+//变换组件：所有物体的平移、旋转（四元数）、缩放按分量分别连续存放（SoA）
+//组合矩阵时一个寄存器装入4个物体的同一个分量，四元数转矩阵、乘缩放、乘视图投影矩阵都是逐通道的运算，
+//不需要像glm::translate * glm::rotate * glm::scale那样逐个物体做三次4x4矩阵乘法
+class TransformStore {
+public:
+    vector<float> px, py, pz;//平移
+    vector<float> rx, ry, rz, rw;//旋转，单位四元数
+    vector<float> sx, sy, sz;//缩放
+
+    unsigned int Size() const{
+        return static_cast<unsigned int>(px.size());
+    }
+
+    void Reserve(unsigned int count){
+        px.reserve(count);
+        py.reserve(count);
+        pz.reserve(count);
+        rx.reserve(count);
+        ry.reserve(count);
+        rz.reserve(count);
+        rw.reserve(count);
+        sx.reserve(count);
+        sy.reserve(count);
+        sz.reserve(count);
+    }
+
+    unsigned int Add(const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale){
+        px.push_back(position.x);
+        py.push_back(position.y);
+        pz.push_back(position.z);
+        rx.push_back(rotation.x);
+        ry.push_back(rotation.y);
+        rz.push_back(rotation.z);
+        rw.push_back(rotation.w);
+        sx.push_back(scale.x);
+        sy.push_back(scale.y);
+        sz.push_back(scale.z);
+        return Size() - 1;
+    }
+
+    void SetRotation(unsigned int i, const glm::quat &rotation){
+        rx[i] = rotation.x;
+        ry[i] = rotation.y;
+        rz[i] = rotation.z;
+        rw[i] = rotation.w;
+    }
+
+    //单个物体的模型矩阵，与 translate * mat4_cast(rotation) * scale 相同
+    glm::mat4 World(unsigned int i) const{
+        glm::mat3 r = glm::mat3_cast(glm::quat(rw[i], rx[i], ry[i], rz[i]));
+        glm::mat4 m(1.0f);
+        m[0] = glm::vec4(r[0] * sx[i], 0.0f);
+        m[1] = glm::vec4(r[1] * sy[i], 0.0f);
+        m[2] = glm::vec4(r[2] * sz[i], 0.0f);
+        m[3] = glm::vec4(px[i], py[i], pz[i], 1.0f);
+        return m;
+    }
+
+    //批量组合[begin, end)范围内物体的矩阵，不同范围可以在多个线程上同时组合
+    //world：模型矩阵；viewProjection与wvp不为空时同时输出 viewProjection * world；
+    //bounds不为空时把局部包围盒localBox变换到世界空间，写入bounds的同一下标
+    void Compose(unsigned int begin, unsigned int end, glm::mat4 *world, const glm::mat4 *viewProjection = nullptr, glm::mat4 *wvp = nullptr,
+        AABBSoA *bounds = nullptr, const AABB &localBox = AABB()) const{
+        unsigned int i = begin;
+        glm::vec3 localCenter = bounds != nullptr ? localBox.Center() : glm::vec3(0.0f);
+        glm::vec3 localExtents = bounds != nullptr ? localBox.Extents() : glm::vec3(0.0f);
+#if defined(TRANSFORM_USE_SSE)
+        const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        for(; i + 4 <= end; i += 4){
+            __m128 qx = _mm_loadu_ps(&rx[i]), qy = _mm_loadu_ps(&ry[i]), qz = _mm_loadu_ps(&rz[i]), qw = _mm_loadu_ps(&rw[i]);
+            __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+            __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+            __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+            __m128 scaleX = _mm_loadu_ps(&sx[i]), scaleY = _mm_loadu_ps(&sy[i]), scaleZ = _mm_loadu_ps(&sz[i]);
+            //m[列][行]，每个寄存器是4个物体的同一个元素
+            __m128 m[4][4];
+            m[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX);
+            m[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX);
+            m[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX);
+            m[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY);
+            m[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY);
+            m[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY);
+            m[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ);
+            m[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ);
+            m[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ);
+            m[3][0] = _mm_loadu_ps(&px[i]);
+            m[3][1] = _mm_loadu_ps(&py[i]);
+            m[3][2] = _mm_loadu_ps(&pz[i]);
+            m[0][3] = m[1][3] = m[2][3] = _mm_setzero_ps();
+            m[3][3] = one;
+            storeMatrices(m, world + i);
+
+            if(wvp != nullptr && viewProjection != nullptr){
+                //(VP * M)[c][r] = VP[0][r] * M[c][0] + VP[1][r] * M[c][1] + VP[2][r] * M[c][2] + VP[3][r] * M[c][3]，前三列的M[c][3]为0
+                const glm::mat4 &vp = *viewProjection;
+                __m128 result[4][4];
+                for(int r = 0; r < 4; r++){
+                    __m128 vp0 = _mm_set1_ps(vp[0][r]), vp1 = _mm_set1_ps(vp[1][r]), vp2 = _mm_set1_ps(vp[2][r]);
+                    for(int c = 0; c < 4; c++){
+                        __m128 value = _mm_add_ps(_mm_mul_ps(vp0, m[c][0]), _mm_add_ps(_mm_mul_ps(vp1, m[c][1]), _mm_mul_ps(vp2, m[c][2])));
+                        result[c][r] = c == 3 ? _mm_add_ps(value, _mm_set1_ps(vp[3][r])) : value;
+                    }
+                }
+                storeMatrices(result, wvp + i);
+            }
+
+            if(bounds != nullptr){
+                //中心 = M * 局部中心，半长 = |M的3x3部分| * 局部半长，结果直接按SoA写入
+                float *centers[3] = {&bounds->cx[i], &bounds->cy[i], &bounds->cz[i]};
+                float *extents[3] = {&bounds->ex[i], &bounds->ey[i], &bounds->ez[i]};
+                __m128 lc[3] = {_mm_set1_ps(localCenter.x), _mm_set1_ps(localCenter.y), _mm_set1_ps(localCenter.z)};
+                __m128 le[3] = {_mm_set1_ps(localExtents.x), _mm_set1_ps(localExtents.y), _mm_set1_ps(localExtents.z)};
+                for(int r = 0; r < 3; r++){
+                    __m128 center = m[3][r];
+                    __m128 extent = _mm_setzero_ps();
+                    for(int c = 0; c < 3; c++){
+                        center = _mm_add_ps(center, _mm_mul_ps(m[c][r], lc[c]));
+                        extent = _mm_add_ps(extent, _mm_mul_ps(_mm_andnot_ps(signMask, m[c][r]), le[c]));
+                    }
+                    _mm_storeu_ps(centers[r], center);
+                    _mm_storeu_ps(extents[r], extent);
+                }
+            }
+        }
+#endif
+        for(; i < end; i++){
+            world[i] = World(i);
+            if(wvp != nullptr && viewProjection != nullptr)
+                wvp[i] = *viewProjection * world[i];
+            if(bounds != nullptr){
+                AABB box;
+                box.min = localCenter - localExtents;
+                box.max = localCenter + localExtents;
+                bounds->Set(i, box.Transform(world[i]));
+            }
+        }
+    }
+
+private:
+#if defined(TRANSFORM_USE_SSE)
+    //把SoA形式的4个矩阵转置回4个glm::mat4：每一列的4个元素寄存器转置后正好是4个物体各自的这一列
+    static void storeMatrices(__m128 m[4][4], glm::mat4 *out){
+        for(int c = 0; c < 4; c++){
+            __m128 r0 = m[c][0], r1 = m[c][1], r2 = m[c][2], r3 = m[c][3];
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(&out[0][c].x, r0);
+            _mm_storeu_ps(&out[1][c].x, r1);
+            _mm_storeu_ps(&out[2][c].x, r2);
+            _mm_storeu_ps(&out[3][c].x, r3);
+        }
+    }
+#endif
+};
+
+#endif
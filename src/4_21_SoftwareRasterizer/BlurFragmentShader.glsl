@@ -0,0 +1,22 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D image;
+uniform bool horizontal;//可分离的高斯模糊：水平与垂直方向各一次
+
+//9个采样的高斯权重，利用双线性过滤把相邻两个采样合并成一次
+const float offsets[3] = float[](0.0, 1.3846153846, 3.2307692308);
+const float weights[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
+
+void main()
+{
+    vec2 texelSize = 1.0 / vec2(textureSize(image, 0));
+    vec2 direction = horizontal ? vec2(texelSize.x, 0.0) : vec2(0.0, texelSize.y);
+    vec3 result = texture(image, TexCoords).rgb * weights[0];
+    for(int i = 1; i < 3; i++){
+        result += texture(image, TexCoords + direction * offsets[i]).rgb * weights[i];
+        result += texture(image, TexCoords - direction * offsets[i]).rgb * weights[i];
+    }
+    FragColor = vec4(result, 1.0);
+}
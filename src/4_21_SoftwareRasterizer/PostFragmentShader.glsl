@@ -0,0 +1,14 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D image;
+uniform float vignette;//暗角强度，0为直接复制
+
+void main()
+{
+    vec3 color = texture(image, TexCoords).rgb;
+    vec2 centered = TexCoords - 0.5;
+    color *= 1.0 - vignette * dot(centered, centered) * 2.0;
+    FragColor = vec4(color, 1.0);
+}
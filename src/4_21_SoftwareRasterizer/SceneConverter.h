@@ -0,0 +1,375 @@
+#ifndef SCENECONVERTER_H
+#define SCENECONVERTER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <sys/stat.h>
+#include "SceneFormat.h"
+using namespace std;
+
+//文本场景转二进制场景的工具，运行时只需要SceneFormat.h
+//文本格式每行一条指令，#开头为注释，名称中不能有空格，"-"表示不使用（贴图、材质）
+//  camera 位置xyz 偏航角 俯仰角
+//  dirlight 方向xyz 环境光rgb 漫反射rgb 镜面光rgb
+//  pointlight 位置xyz 环境光rgb 漫反射rgb 镜面光rgb 常数项 一次项 二次项
+//  mesh 名称 模型路径                               路径为cube时使用内置的立方体
+//  material 名称 漫反射贴图 镜面光贴图 反光度
+//  entity 网格 材质 位置xyz 偏航 俯仰 滚转 缩放xyz [转速]   角度单位为度，转速为度/秒
+//  grid 网格 材质 列数 行数 间距 高度 缩放xyz               以原点为中心铺满一块区域，例如地面
+//  scatter 网格 材质 列数 行数 间距 概率 最大层数 最小转速 最大转速 种子
+//                                                   每个格子按概率（百分比）随机堆叠1~最大层数个单位大小的实体
+//grid与scatter在转换时展开成普通实体，二进制文件中只有实体
+
+//转换时的中间表示
+struct SceneEntity {
+    unsigned int mesh;
+    unsigned int material;//SCENE_NONE表示没有材质
+    glm::vec3 position;
+    glm::quat rotation;
+    glm::vec3 scale;
+    float spin;//弧度/秒
+};
+
+struct SceneDescription {
+    SceneCamera camera = {{0.0f, 8.0f, 20.0f}, -90.0f, -20.0f};
+    SceneDirLight dirLight = {{-0.4f, -1.0f, -0.3f}, {0.15f, 0.15f, 0.15f}, {0.8f, 0.8f, 0.8f}, {0.5f, 0.5f, 0.5f}};
+    vector<string> meshNames, meshPaths;//路径为空表示内置的立方体
+    vector<string> materialNames, diffusePaths, specularPaths;//贴图路径为空表示不使用
+    vector<float> shininess;
+    vector<ScenePointLight> pointLights;
+    vector<SceneEntity> entities;
+};
+
+//可复现的随机数，转换结果不依赖平台的rand实现
+class SceneRandom {
+public:
+    SceneRandom(unsigned int seed) : state(seed * 2654435761u + 1u){}
+    //返回[0, 1)
+    float Next(){
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+
+private:
+    unsigned int state;
+};
+
+class SceneConverter {
+public:
+    //解析文本场景，出错时输出行号并返回false
+    static bool Parse(const string &path, SceneDescription &scene){
+        ifstream file(path.c_str());
+        if(!file.is_open()){
+            cout << "ERROR::SCENE::FILE_NOT_SUCCESFULLY_READ " << path << endl;
+            return false;
+        }
+        stringstream content;
+        content << file.rdbuf();
+        return ParseText(content.str(), scene, path);
+    }
+
+    static bool ParseText(const string &text, SceneDescription &scene, const string &name = "scene"){
+        istringstream lines(text);
+        string line;
+        unsigned int lineNumber = 0;
+        while(getline(lines, line)){
+            lineNumber++;
+            size_t start = line.find_first_not_of(" \t\r");
+            if(start == string::npos || line[start] == '#')
+                continue;
+            istringstream stream(line);
+            string command;
+            stream >> command;
+            string error = parseCommand(command, stream, scene);
+            if(!error.empty()){
+                cout << "ERROR::SCENE::PARSE_FAILED " << name << ":" << lineNumber << ": " << error << endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //按（网格，材质）排序实体、生成批次并写出二进制文件
+    static bool Write(const SceneDescription &scene, const string &path){
+        vector<char> data;
+        Build(scene, data);
+        ofstream file(path.c_str(), ios::binary);
+        if(!file.is_open()){
+            cout << "ERROR::SCENE::FILE_NOT_SUCCESFULLY_WRITTEN " << path << endl;
+            return false;
+        }
+        file.write(data.data(), data.size());
+        return file.good();
+    }
+
+    static bool Convert(const string &textPath, const string &binaryPath){
+        SceneDescription scene;
+        if(!Parse(textPath, scene) || !Write(scene, binaryPath))
+            return false;
+        cout << "Scene: " << textPath << " -> " << binaryPath << ", " << scene.entities.size() << " entities" << endl;
+        return true;
+    }
+
+    //二进制文件不存在或比文本旧时重新转换
+    static bool ConvertIfStale(const string &textPath, const string &binaryPath){
+        struct stat text, binary;
+        if(stat(textPath.c_str(), &text) != 0)
+            return stat(binaryPath.c_str(), &binary) == 0;
+        if(stat(binaryPath.c_str(), &binary) == 0 && binary.st_mtime >= text.st_mtime)
+            return true;
+        return Convert(textPath, binaryPath);
+    }
+
+    //生成二进制场景在内存中的内容，与映射文件后看到的完全相同
+    static void Build(const SceneDescription &scene, vector<char> &data){
+        //同一网格与材质的实体排在一起，稳定排序保持文本中的相对顺序
+        vector<unsigned int> order(scene.entities.size());
+        for(unsigned int i = 0; i < order.size(); i++)
+            order[i] = i;
+        stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b){
+            const SceneEntity &ea = scene.entities[a], &eb = scene.entities[b];
+            return ea.mesh != eb.mesh ? ea.mesh < eb.mesh : ea.material < eb.material;
+        });
+        vector<SceneBatch> batches;
+        for(unsigned int i = 0; i < order.size(); i++){
+            const SceneEntity &entity = scene.entities[order[i]];
+            if(batches.empty() || batches.back().mesh != entity.mesh || batches.back().material != entity.material)
+                batches.push_back({entity.mesh, entity.material, i, 0});
+            batches.back().count++;
+        }
+
+        //字符串表，相同的字符串只存一份
+        string strings;
+        map<string, uint32_t> stringOffsets;
+        auto addString = [&](const string &value) -> uint32_t{
+            if(value.empty())
+                return SCENE_NONE;
+            auto found = stringOffsets.find(value);
+            if(found != stringOffsets.end())
+                return found->second;
+            uint32_t offset = static_cast<uint32_t>(strings.size());
+            strings.append(value);
+            strings.push_back('\0');
+            stringOffsets[value] = offset;
+            return offset;
+        };
+        vector<SceneMesh> meshes(scene.meshNames.size());
+        for(unsigned int i = 0; i < meshes.size(); i++){
+            meshes[i].name = addString(scene.meshNames[i]);
+            meshes[i].path = addString(scene.meshPaths[i]);
+        }
+        vector<SceneMaterial> materials(scene.materialNames.size());
+        for(unsigned int i = 0; i < materials.size(); i++){
+            materials[i].name = addString(scene.materialNames[i]);
+            materials[i].diffuse = addString(scene.diffusePaths[i]);
+            materials[i].specular = addString(scene.specularPaths[i]);
+            materials[i].shininess = scene.shininess[i];
+        }
+
+        SceneHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = SCENE_MAGIC;
+        header.version = SCENE_VERSION;
+        header.entityCount = static_cast<uint32_t>(order.size());
+        header.camera = scene.camera;
+        header.dirLight = scene.dirLight;
+        size_t offset = align(sizeof(SceneHeader));
+        place(header.strings, strings.size(), offset);
+        place(header.meshes, meshes.size(), offset);
+        place(header.materials, materials.size(), offset);
+        place(header.batches, batches.size(), offset);
+        place(header.pointLights, scene.pointLights.size(), offset);
+        for(int s = 0; s < SCENE_STREAM_COUNT; s++)
+            place(header.streams[s], order.size(), offset);
+        header.fileSize = static_cast<uint32_t>(offset);
+
+        data.assign(offset, 0);
+        copyArray(data, header.strings, strings.data());
+        copyArray(data, header.meshes, meshes.data());
+        copyArray(data, header.materials, materials.data());
+        copyArray(data, header.batches, batches.data());
+        copyArray(data, header.pointLights, scene.pointLights.data());
+        float *streams[SCENE_STREAM_COUNT];
+        for(int s = 0; s < SCENE_STREAM_COUNT; s++)
+            streams[s] = reinterpret_cast<float*>(&data[header.streams[s].offset]);
+        glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+        for(unsigned int i = 0; i < order.size(); i++){
+            const SceneEntity &entity = scene.entities[order[i]];
+            float values[SCENE_STREAM_COUNT] = {entity.position.x, entity.position.y, entity.position.z,
+                entity.rotation.x, entity.rotation.y, entity.rotation.z, entity.rotation.w,
+                entity.scale.x, entity.scale.y, entity.scale.z, entity.spin};
+            for(int s = 0; s < SCENE_STREAM_COUNT; s++)
+                streams[s][i] = values[s];
+            boundsMin = i == 0 ? entity.position : glm::min(boundsMin, entity.position);
+            boundsMax = i == 0 ? entity.position : glm::max(boundsMax, entity.position);
+        }
+        for(int k = 0; k < 3; k++){
+            header.boundsMin[k] = boundsMin[k];
+            header.boundsMax[k] = boundsMax[k];
+        }
+        memcpy(data.data(), &header, sizeof(header));
+    }
+
+private:
+    static size_t align(size_t offset){
+        return (offset + SCENE_ALIGNMENT - 1) / SCENE_ALIGNMENT * SCENE_ALIGNMENT;
+    }
+
+    template<typename T>
+    static void place(SceneArray<T> &array, size_t count, size_t &offset){
+        array.offset = static_cast<uint32_t>(offset);
+        array.count = static_cast<uint32_t>(count);
+        offset = align(offset + count * sizeof(T));
+    }
+
+    template<typename T>
+    static void copyArray(vector<char> &data, const SceneArray<T> &array, const T *source){
+        if(array.count > 0)
+            memcpy(&data[array.offset], source, array.count * sizeof(T));
+    }
+
+    static bool readFloats(istringstream &stream, float *values, int count){
+        for(int i = 0; i < count; i++){
+            if(!(stream >> values[i]))
+                return false;
+        }
+        return true;
+    }
+
+    static bool findName(const vector<string> &names, const string &name, unsigned int &index){
+        for(unsigned int i = 0; i < names.size(); i++){
+            if(names[i] == name){
+                index = i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //读取"网格 材质"两个引用，材质可以是"-"
+    static string readReferences(istringstream &stream, const SceneDescription &scene, unsigned int &mesh, unsigned int &material){
+        string meshName, materialName;
+        if(!(stream >> meshName >> materialName))
+            return "expected mesh and material";
+        if(!findName(scene.meshNames, meshName, mesh))
+            return "unknown mesh " + meshName;
+        material = SCENE_NONE;
+        if(materialName != "-" && !findName(scene.materialNames, materialName, material))
+            return "unknown material " + materialName;
+        return "";
+    }
+
+    static glm::quat eulerRotation(float yaw, float pitch, float roll){
+        return glm::angleAxis(glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::angleAxis(glm::radians(pitch), glm::vec3(1.0f, 0.0f, 0.0f))
+            * glm::angleAxis(glm::radians(roll), glm::vec3(0.0f, 0.0f, 1.0f));
+    }
+
+    //返回空字符串表示成功
+    static string parseCommand(const string &command, istringstream &stream, SceneDescription &scene){
+        if(command == "camera"){
+            float v[5];
+            if(!readFloats(stream, v, 5))
+                return "camera expects x y z yaw pitch";
+            scene.camera = {{v[0], v[1], v[2]}, v[3], v[4]};
+        }else if(command == "dirlight"){
+            float v[12];
+            if(!readFloats(stream, v, 12))
+                return "dirlight expects direction, ambient, diffuse and specular";
+            memcpy(&scene.dirLight, v, sizeof(v));
+        }else if(command == "pointlight"){
+            float v[15];
+            if(!readFloats(stream, v, 15))
+                return "pointlight expects position, ambient, diffuse, specular and attenuation";
+            ScenePointLight light;
+            memcpy(&light, v, sizeof(v));
+            scene.pointLights.push_back(light);
+        }else if(command == "mesh"){
+            string name, path;
+            if(!(stream >> name >> path))
+                return "mesh expects name and path";
+            scene.meshNames.push_back(name);
+            scene.meshPaths.push_back(path == "cube" ? "" : path);
+        }else if(command == "material"){
+            string name, diffuse, specular;
+            float shininess;
+            if(!(stream >> name >> diffuse >> specular >> shininess))
+                return "material expects name, diffuse, specular and shininess";
+            scene.materialNames.push_back(name);
+            scene.diffusePaths.push_back(diffuse == "-" ? "" : diffuse);
+            scene.specularPaths.push_back(specular == "-" ? "" : specular);
+            scene.shininess.push_back(shininess);
+        }else if(command == "entity"){
+            SceneEntity entity;
+            string error = readReferences(stream, scene, entity.mesh, entity.material);
+            if(!error.empty())
+                return error;
+            float v[9];
+            if(!readFloats(stream, v, 9))
+                return "entity expects position, yaw pitch roll and scale";
+            float spin = 0.0f;
+            stream >> spin;
+            entity.position = glm::vec3(v[0], v[1], v[2]);
+            entity.rotation = eulerRotation(v[3], v[4], v[5]);
+            entity.scale = glm::vec3(v[6], v[7], v[8]);
+            entity.spin = glm::radians(spin);
+            scene.entities.push_back(entity);
+        }else if(command == "grid"){
+            SceneEntity entity;
+            string error = readReferences(stream, scene, entity.mesh, entity.material);
+            if(!error.empty())
+                return error;
+            int columns, rows;
+            float v[5];
+            if(!(stream >> columns >> rows) || !readFloats(stream, v, 5))
+                return "grid expects columns rows spacing height and scale";
+            entity.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+            entity.scale = glm::vec3(v[2], v[3], v[4]);
+            entity.spin = 0.0f;
+            for(int x = 0; x < columns; x++){
+                for(int z = 0; z < rows; z++){
+                    entity.position = glm::vec3(x * v[0] - columns * v[0] * 0.5f, v[1], z * v[0] - rows * v[0] * 0.5f);
+                    scene.entities.push_back(entity);
+                }
+            }
+        }else if(command == "scatter"){
+            SceneEntity entity;
+            string error = readReferences(stream, scene, entity.mesh, entity.material);
+            if(!error.empty())
+                return error;
+            int columns, rows, maxStack;
+            unsigned int seed;
+            float spacing, percent, minSpin, maxSpin;
+            if(!(stream >> columns >> rows >> spacing >> percent >> maxStack >> minSpin >> maxSpin >> seed) || maxStack < 1)
+                return "scatter expects columns rows spacing percent maxStack minSpin maxSpin seed";
+            SceneRandom random(seed);
+            entity.scale = glm::vec3(1.0f);
+            for(int x = 0; x < columns; x++){
+                for(int z = 0; z < rows; z++){
+                    if(random.Next() * 100.0f >= percent)
+                        continue;
+                    int stack = 1 + min(maxStack - 1, static_cast<int>(random.Next() * maxStack));
+                    for(int i = 0; i < stack; i++){
+                        float yaw = random.Next() * 90.0f;
+                        float speed = minSpin + random.Next() * (maxSpin - minSpin);
+                        entity.position = glm::vec3(x * spacing - columns * spacing * 0.5f, 0.5f + i, z * spacing - rows * spacing * 0.5f);
+                        entity.rotation = glm::angleAxis(glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+                        entity.spin = glm::radians(random.Next() < 0.5f ? -speed : speed);
+                        scene.entities.push_back(entity);
+                    }
+                }
+            }
+        }else{
+            return "unknown command " + command;
+        }
+        return "";
+    }
+};
+
+#endif
@@ -0,0 +1,699 @@
+#ifndef SOFTWARERASTERIZER_H
+#define SOFTWARERASTERIZER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include "Mesh.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+using namespace std;
+
+//SIMD指令集选择：一个寄存器的4个通道对应2x2的像素块
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTER_USE_SSE
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+//CPU参考光栅化器，实现课程中用到的固定子集：索引三角形、深度测试（GL_LESS）、透视校正插值、
+//与2_12_MultiLight相同的Phong着色（一个定向光加若干点光源）；不实现阴影与后处理，输出经过与合成pass相同的色调映射
+//流水线：几何（顶点变换、裁剪、三角形建立、分块）-> 逐块光栅化与着色 -> 色调映射
+//几何阶段按三角形数量分成固定的批，每批把三角形归到它覆盖的屏幕块中；光栅化阶段每个块一个任务，按批的顺序处理块中的三角形，
+//块之间没有共享的像素，不需要加锁，结果也与线程数无关
+//光栅化一次处理2x2的像素块，块内4个像素的插值结果同时给出纹理坐标的屏幕空间导数，用来选择mipmap层级
+#define RASTER_TILE_SIZE 64 //屏幕块的边长（像素），必须是偶数
+#define RASTER_GEOMETRY_GRAIN 2048 //几何阶段每批大约处理的三角形数量
+
+//CPU纹理：RGBA8，带完整的mipmap链，采样相当于GL_LINEAR_MIPMAP_NEAREST加GL_REPEAT
+//第0行是图片数据的第一行，与glTexImage2D上传后纹理坐标的对应关系相同
+class SoftwareTexture {
+public:
+    struct Level {
+        int width = 0, height = 0;
+        vector<unsigned char> texels;
+    };
+    vector<Level> levels;
+
+    bool IsValid() const{
+        return !levels.empty();
+    }
+
+    //从解码后的图片（1~4个分量）创建，逐级2x2平均生成mipmap
+    void Load(const unsigned char *data, int width, int height, int components){
+        levels.clear();
+        if(data == nullptr || width <= 0 || height <= 0)
+            return;
+        Level base;
+        base.width = width;
+        base.height = height;
+        base.texels.resize(static_cast<size_t>(width) * height * 4);
+        for(int i = 0; i < width * height; i++){
+            const unsigned char *src = data + static_cast<size_t>(i) * components;
+            unsigned char *dst = &base.texels[static_cast<size_t>(i) * 4];
+            dst[0] = src[0];
+            dst[1] = components >= 3 ? src[1] : src[0];
+            dst[2] = components >= 3 ? src[2] : src[0];
+            dst[3] = components == 4 ? src[3] : (components == 2 ? src[1] : 255);
+        }
+        levels.push_back(move(base));
+        while(levels.back().width > 1 || levels.back().height > 1){
+            Level next = downsample(levels.back());
+            levels.push_back(move(next));
+        }
+    }
+
+    //1x1的纯色纹理
+    void Solid(unsigned char r, unsigned char g, unsigned char b){
+        levels.assign(1, Level());
+        levels[0].width = levels[0].height = 1;
+        levels[0].texels = {r, g, b, 255};
+    }
+
+    //lod为log2(一个像素覆盖的纹素数)，选最近的一级做双线性过滤
+    glm::vec3 Sample(const glm::vec2 &uv, float lod) const{
+        int index = min(max(static_cast<int>(lod + 0.5f), 0), static_cast<int>(levels.size()) - 1);
+        const Level &level = levels[index];
+        float x = uv.x * level.width - 0.5f, y = uv.y * level.height - 0.5f;
+        float fx = floor(x), fy = floor(y);
+        float tx = x - fx, ty = y - fy;
+        int x0 = wrap(static_cast<int>(fx), level.width), x1 = wrap(static_cast<int>(fx) + 1, level.width);
+        int y0 = wrap(static_cast<int>(fy), level.height), y1 = wrap(static_cast<int>(fy) + 1, level.height);
+        const unsigned char *t00 = texel(level, x0, y0), *t10 = texel(level, x1, y0);
+        const unsigned char *t01 = texel(level, x0, y1), *t11 = texel(level, x1, y1);
+        glm::vec3 result;
+        for(int c = 0; c < 3; c++){
+            float top = t00[c] + (t10[c] - t00[c]) * tx;
+            float bottom = t01[c] + (t11[c] - t01[c]) * tx;
+            result[c] = (top + (bottom - top) * ty) * (1.0f / 255.0f);
+        }
+        return result;
+    }
+
+    //纹理坐标在屏幕x、y方向上的导数换算为mipmap层级
+    float Lod(const glm::vec2 &ddx, const glm::vec2 &ddy) const{
+        if(levels.size() <= 1)
+            return 0.0f;
+        glm::vec2 size(static_cast<float>(levels[0].width), static_cast<float>(levels[0].height));
+        float footprint = max(glm::dot(ddx * size, ddx * size), glm::dot(ddy * size, ddy * size));
+        return footprint > 1.0f ? 0.5f * log2(footprint) : 0.0f;
+    }
+
+private:
+    static int wrap(int i, int size){
+        i %= size;
+        return i < 0 ? i + size : i;
+    }
+
+    static const unsigned char *texel(const Level &level, int x, int y){
+        return &level.texels[(static_cast<size_t>(y) * level.width + x) * 4];
+    }
+
+    static Level downsample(const Level &source){
+        Level next;
+        next.width = max(1, source.width / 2);
+        next.height = max(1, source.height / 2);
+        next.texels.resize(static_cast<size_t>(next.width) * next.height * 4);
+        for(int y = 0; y < next.height; y++){
+            for(int x = 0; x < next.width; x++){
+                int sx0 = min(x * 2, source.width - 1), sx1 = min(x * 2 + 1, source.width - 1);
+                int sy0 = min(y * 2, source.height - 1), sy1 = min(y * 2 + 1, source.height - 1);
+                unsigned char *dst = &next.texels[(static_cast<size_t>(y) * next.width + x) * 4];
+                for(int c = 0; c < 4; c++){
+                    int sum = texel(source, sx0, sy0)[c] + texel(source, sx1, sy0)[c] + texel(source, sx0, sy1)[c] + texel(source, sx1, sy1)[c];
+                    dst[c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        return next;
+    }
+};
+
+//CPU网格：只保留光栅化需要的顶点属性
+struct SoftwareMesh {
+    vector<glm::vec3> positions;
+    vector<glm::vec3> normals;
+    vector<glm::vec2> texCoords;
+    vector<unsigned int> indices;
+
+    //使用Mesh中的顶点与索引
+    void FromMesh(const Mesh &mesh){
+        positions.resize(mesh.vertices.size());
+        normals.resize(mesh.vertices.size());
+        texCoords.resize(mesh.vertices.size());
+        for(unsigned int i = 0; i < mesh.vertices.size(); i++){
+            positions[i] = mesh.vertices[i].Position;
+            normals[i] = mesh.vertices[i].Normal;
+            texCoords[i] = mesh.vertices[i].TexCoords;
+        }
+        indices = mesh.indices;
+    }
+
+    //顶点格式为 位置3 法线3 纹理坐标2 的非索引数组（例如课程中的立方体），按顺序生成索引
+    void FromInterleaved(const float *data, unsigned int vertexCount){
+        positions.resize(vertexCount);
+        normals.resize(vertexCount);
+        texCoords.resize(vertexCount);
+        indices.resize(vertexCount);
+        for(unsigned int i = 0; i < vertexCount; i++){
+            const float *v = data + i * 8;
+            positions[i] = glm::vec3(v[0], v[1], v[2]);
+            normals[i] = glm::vec3(v[3], v[4], v[5]);
+            texCoords[i] = glm::vec2(v[6], v[7]);
+            indices[i] = i;
+        }
+    }
+
+    unsigned int TriangleCount() const{
+        return static_cast<unsigned int>(indices.size() / 3);
+    }
+};
+
+//贴图为空时漫反射为白色、没有镜面光
+struct SoftwareMaterial {
+    const SoftwareTexture *diffuse = nullptr;
+    const SoftwareTexture *specular = nullptr;
+    float shininess = 32.0f;
+};
+
+//与着色器中的DirLight、PointLight相同
+struct RasterDirLight {
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    glm::vec3 ambient = glm::vec3(0.0f);
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    glm::vec3 specular = glm::vec3(0.0f);
+};
+
+struct RasterPointLight {
+    glm::vec3 position;
+    glm::vec3 ambient, diffuse, specular;
+    float constant, linear, quadratic;
+};
+
+struct RasterStats {
+    unsigned int draws = 0;
+    unsigned int instances = 0;
+    unsigned int triangles = 0;//提交的三角形
+    unsigned int rasterTriangles = 0;//裁剪后进入光栅化的三角形
+    unsigned int binnedTriangles = 0;//三角形与屏幕块的配对数
+    unsigned int shadedPixels = 0;//通过深度测试并着色的像素
+    double geometryMs = 0.0, rasterMs = 0.0, resolveMs = 0.0;
+};
+
+class SoftwareRasterizer {
+public:
+    RasterDirLight dirLight;
+    vector<RasterPointLight> pointLights;
+    float exposure = 1.2f;//与合成pass相同的曝光色调映射
+    bool parallel = true;//false时全部在当前线程上执行
+
+    SoftwareRasterizer(unsigned int width, unsigned int height) : width(width), height(height){
+        //缓冲按2x2像素块对齐，多出的一行或一列不会输出
+        bufferWidth = (width + 1) & ~1u;
+        bufferHeight = (height + 1) & ~1u;
+        tilesX = (bufferWidth + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+        tilesY = (bufferHeight + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+        colorBuffer.resize(static_cast<size_t>(bufferWidth) * bufferHeight);
+        depthBuffer.resize(static_cast<size_t>(bufferWidth) * bufferHeight);
+        output.resize(static_cast<size_t>(width) * height * 4);
+        tilePixels.resize(tilesX * tilesY);
+    }
+
+    //开始新的一帧，之前提交的绘制全部丢弃
+    void Begin(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &viewPos){
+        draws.clear();
+        viewProjection = projection * view;
+        this->viewPos = viewPos;
+    }
+
+    //matrices在Execute之前必须保持有效
+    void DrawInstanced(const SoftwareMesh &mesh, const SoftwareMaterial &material, const glm::mat4 *matrices, unsigned int instanceCount){
+        if(instanceCount == 0 || mesh.TriangleCount() == 0)
+            return;
+        DrawCommand draw;
+        draw.mesh = &mesh;
+        draw.material = &material;
+        draw.matrices = matrices;
+        draw.instanceCount = instanceCount;
+        draws.push_back(draw);
+    }
+
+    void Execute(){
+        PROFILE_FUNCTION();
+        stats = RasterStats();
+        auto start = chrono::steady_clock::now();
+        {
+            PROFILE_SCOPE("RasterGeometry");
+            buildChunks();
+            run(static_cast<unsigned int>(chunks.size()), 1, [&](unsigned int begin, unsigned int end){
+                for(unsigned int c = begin; c < end; c++)
+                    processChunk(chunks[c]);
+            });
+        }
+        auto geometryEnd = chrono::steady_clock::now();
+        {
+            PROFILE_SCOPE("RasterTiles");
+            run(tilesX * tilesY, 1, [&](unsigned int begin, unsigned int end){
+                for(unsigned int t = begin; t < end; t++)
+                    rasterTile(t);
+            });
+        }
+        auto rasterEnd = chrono::steady_clock::now();
+        {
+            PROFILE_SCOPE("RasterResolve");
+            run(height, 16, [&](unsigned int begin, unsigned int end){
+                resolveRows(begin, end);
+            });
+        }
+        auto resolveEnd = chrono::steady_clock::now();
+        stats.draws = static_cast<unsigned int>(draws.size());
+        for(unsigned int i = 0; i < draws.size(); i++){
+            stats.instances += draws[i].instanceCount;
+            stats.triangles += draws[i].instanceCount * draws[i].mesh->TriangleCount();
+        }
+        for(unsigned int c = 0; c < chunkCount; c++){
+            stats.rasterTriangles += static_cast<unsigned int>(chunks[c].triangles.size());
+            stats.binnedTriangles += chunks[c].binned;
+        }
+        for(unsigned int t = 0; t < tilePixels.size(); t++)
+            stats.shadedPixels += tilePixels[t];
+        stats.geometryMs = chrono::duration<double, milli>(geometryEnd - start).count();
+        stats.rasterMs = chrono::duration<double, milli>(rasterEnd - geometryEnd).count();
+        stats.resolveMs = chrono::duration<double, milli>(resolveEnd - rasterEnd).count();
+    }
+
+    const RasterStats &Stats() const{
+        return stats;
+    }
+
+    //色调映射后的RGBA8图像，第0行是画面最下方，可以直接用glTexSubImage2D上传
+    const unsigned char *Pixels() const{
+        return output.data();
+    }
+
+    //保存为二进制PPM（P6），上下翻转为正常朝向
+    bool SavePPM(const string &path) const{
+        ofstream file(path.c_str(), ios::binary);
+        if(!file){
+            cout << "ERROR::RASTERIZER::CANNOT_WRITE: " << path << endl;
+            return false;
+        }
+        file << "P6\n" << width << " " << height << "\n255\n";
+        vector<unsigned char> row(width * 3);
+        for(int y = static_cast<int>(height) - 1; y >= 0; y--){
+            for(unsigned int x = 0; x < width; x++){
+                for(int c = 0; c < 3; c++)
+                    row[x * 3 + c] = output[(static_cast<size_t>(y) * width + x) * 4 + c];
+            }
+            file.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+        return true;
+    }
+
+private:
+    struct DrawCommand {
+        const SoftwareMesh *mesh;
+        const SoftwareMaterial *material;
+        const glm::mat4 *matrices;
+        unsigned int instanceCount;
+    };
+
+    //裁剪空间的顶点与需要插值的属性
+    struct ClipVertex {
+        glm::vec4 clip;
+        glm::vec3 world;
+        glm::vec3 normal;
+        glm::vec2 uv;
+    };
+
+    //建立好的三角形：屏幕坐标、边函数 E(x, y) = A * x + B * y + C 与三个顶点的属性
+    //顶点已调整为逆时针（y向上），三角形内部三条边函数都为正，第i条边是顶点i的对边
+    struct RasterTriangle {
+        float edgeA[3], edgeB[3], edgeC[3];
+        bool topLeft[3];
+        float invArea;
+        float z[3];//深度，[0, 1]
+        float invW[3];
+        glm::vec3 world[3];
+        glm::vec3 normal[3];
+        glm::vec2 uv[3];
+        const SoftwareMaterial *material;
+        int minX, minY, maxX, maxY;//覆盖的像素范围（包含两端）
+    };
+
+    //几何阶段的一批：若干段连续的实例，以及这批产生的三角形与每个屏幕块中的三角形下标
+    struct Segment {
+        unsigned int draw, begin, end;
+    };
+    struct Chunk {
+        vector<Segment> segments;
+        vector<RasterTriangle> triangles;
+        vector<vector<unsigned int>> bins;
+        unsigned int binned = 0;
+    };
+
+    unsigned int width, height, bufferWidth, bufferHeight, tilesX, tilesY;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec3 viewPos = glm::vec3(0.0f);
+    vector<DrawCommand> draws;
+    vector<Chunk> chunks;//跨帧复用，只增不减
+    unsigned int chunkCount = 0;
+    vector<glm::vec3> colorBuffer;//线性HDR颜色
+    vector<float> depthBuffer;
+    vector<unsigned char> output;
+    vector<unsigned int> tilePixels;
+    RasterStats stats;
+
+    void run(unsigned int count, unsigned int grainSize, const function<void(unsigned int, unsigned int)> &func){
+        if(parallel)
+            JobSystem::Get().ParallelFor(count, grainSize, func);
+        else if(count > 0)
+            func(0, count);
+    }
+
+    //把全部实例按三角形数量切成大小相近的批，只与绘制数量有关，与实例数量无关
+    void buildChunks(){
+        chunkCount = 0;
+        unsigned int filled = RASTER_GEOMETRY_GRAIN;
+        for(unsigned int d = 0; d < draws.size(); d++){
+            unsigned int perInstance = draws[d].mesh->TriangleCount();
+            unsigned int instance = 0;
+            while(instance < draws[d].instanceCount){
+                if(filled >= RASTER_GEOMETRY_GRAIN){
+                    if(chunkCount == chunks.size())
+                        chunks.push_back(Chunk());
+                    chunks[chunkCount].segments.clear();
+                    chunkCount++;
+                    filled = 0;
+                }
+                unsigned int take = max(1u, (RASTER_GEOMETRY_GRAIN - filled) / perInstance);
+                take = min(take, draws[d].instanceCount - instance);
+                chunks[chunkCount - 1].segments.push_back({d, instance, instance + take});
+                filled += take * perInstance;
+                instance += take;
+            }
+        }
+        //多余的批清空，避免光栅化阶段读到上一帧的三角形
+        for(unsigned int c = chunkCount; c < chunks.size(); c++){
+            chunks[c].segments.clear();
+            chunks[c].triangles.clear();
+            for(unsigned int t = 0; t < chunks[c].bins.size(); t++)
+                chunks[c].bins[t].clear();
+            chunks[c].binned = 0;
+        }
+    }
+
+    void processChunk(Chunk &chunk){
+        chunk.triangles.clear();
+        chunk.bins.resize(tilesX * tilesY);
+        for(unsigned int t = 0; t < chunk.bins.size(); t++)
+            chunk.bins[t].clear();
+        chunk.binned = 0;
+        vector<ClipVertex> &vertices = scratchVertices();
+        for(unsigned int s = 0; s < chunk.segments.size(); s++){
+            const Segment &segment = chunk.segments[s];
+            const DrawCommand &draw = draws[segment.draw];
+            const SoftwareMesh &mesh = *draw.mesh;
+            vertices.resize(mesh.positions.size());
+            for(unsigned int instance = segment.begin; instance < segment.end; instance++){
+                const glm::mat4 &model = draw.matrices[instance];
+                glm::mat4 mvp = viewProjection * model;
+                glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+                for(unsigned int v = 0; v < mesh.positions.size(); v++){
+                    glm::vec4 position(mesh.positions[v], 1.0f);
+                    vertices[v].clip = mvp * position;
+                    vertices[v].world = glm::vec3(model * position);
+                    vertices[v].normal = normalMatrix * mesh.normals[v];
+                    vertices[v].uv = mesh.texCoords[v];
+                }
+                for(unsigned int i = 0; i + 2 < mesh.indices.size(); i += 3)
+                    clipTriangle(chunk, vertices[mesh.indices[i]], vertices[mesh.indices[i + 1]], vertices[mesh.indices[i + 2]], draw.material);
+            }
+        }
+    }
+
+    //每个线程一份顶点变换的临时数组
+    static vector<ClipVertex> &scratchVertices(){
+        static thread_local vector<ClipVertex> vertices;
+        return vertices;
+    }
+
+    static ClipVertex lerp(const ClipVertex &a, const ClipVertex &b, float t){
+        ClipVertex result;
+        result.clip = a.clip + (b.clip - a.clip) * t;
+        result.world = a.world + (b.world - a.world) * t;
+        result.normal = a.normal + (b.normal - a.normal) * t;
+        result.uv = a.uv + (b.uv - a.uv) * t;
+        return result;
+    }
+
+    //完全在某个裁剪平面外的三角形直接丢弃；跨过近平面的三角形裁剪成1~2个三角形
+    //其余平面不裁剪，屏幕外的部分由包围矩形限制，远平面之外的像素由深度测试（深度清除为1）去掉
+    void clipTriangle(Chunk &chunk, const ClipVertex &a, const ClipVertex &b, const ClipVertex &c, const SoftwareMaterial *material){
+        const glm::vec4 &p0 = a.clip, &p1 = b.clip, &p2 = c.clip;
+        if((p0.x > p0.w && p1.x > p1.w && p2.x > p2.w) || (p0.x < -p0.w && p1.x < -p1.w && p2.x < -p2.w)
+            || (p0.y > p0.w && p1.y > p1.w && p2.y > p2.w) || (p0.y < -p0.w && p1.y < -p1.w && p2.y < -p2.w)
+            || (p0.z > p0.w && p1.z > p1.w && p2.z > p2.w) || (p0.z < -p0.w && p1.z < -p1.w && p2.z < -p2.w))
+            return;
+        if(p0.z >= -p0.w && p1.z >= -p1.w && p2.z >= -p2.w){
+            setupTriangle(chunk, a, b, c, material);
+            return;
+        }
+        //Sutherland-Hodgman：对 z + w >= 0 一个平面裁剪，结果最多4个顶点
+        const ClipVertex *input[3] = {&a, &b, &c};
+        ClipVertex polygon[4];
+        int count = 0;
+        for(int i = 0; i < 3; i++){
+            const ClipVertex &current = *input[i], &next = *input[(i + 1) % 3];
+            float dc = current.clip.z + current.clip.w, dn = next.clip.z + next.clip.w;
+            if(dc >= 0.0f)
+                polygon[count++] = current;
+            if((dc >= 0.0f) != (dn >= 0.0f))
+                polygon[count++] = lerp(current, next, dc / (dc - dn));
+        }
+        for(int i = 1; i + 1 < count; i++)
+            setupTriangle(chunk, polygon[0], polygon[i], polygon[i + 1], material);
+    }
+
+    void setupTriangle(Chunk &chunk, const ClipVertex &a, const ClipVertex &b, const ClipVertex &c, const SoftwareMaterial *material){
+        const ClipVertex *v[3] = {&a, &b, &c};
+        float sx[3], sy[3];
+        RasterTriangle tri;
+        for(int i = 0; i < 3; i++){
+            float invW = 1.0f / v[i]->clip.w;
+            sx[i] = (v[i]->clip.x * invW * 0.5f + 0.5f) * width;
+            sy[i] = (v[i]->clip.y * invW * 0.5f + 0.5f) * height;
+            tri.z[i] = v[i]->clip.z * invW * 0.5f + 0.5f;
+            tri.invW[i] = invW;
+        }
+        float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+        if(!(fabs(area) > 1e-8f))
+            return;
+        //不剔除背面（与课程中的OpenGL状态相同），顺时针的三角形交换两个顶点
+        int order[3] = {0, 1, 2};
+        if(area < 0.0f){
+            swap(order[1], order[2]);
+            area = -area;
+        }
+        float x[3], y[3];
+        float z[3], invW[3];
+        for(int i = 0; i < 3; i++){
+            x[i] = sx[order[i]];
+            y[i] = sy[order[i]];
+            z[i] = tri.z[order[i]];
+            invW[i] = tri.invW[order[i]];
+            tri.world[i] = v[order[i]]->world;
+            tri.normal[i] = v[order[i]]->normal;
+            tri.uv[i] = v[order[i]]->uv;
+        }
+        //像素中心在(x + 0.5, y + 0.5)，包围矩形取中心可能落在三角形内的像素
+        tri.minX = max(0, static_cast<int>(ceil(min(x[0], min(x[1], x[2])) - 0.5f)));
+        tri.minY = max(0, static_cast<int>(ceil(min(y[0], min(y[1], y[2])) - 0.5f)));
+        tri.maxX = min(static_cast<int>(width) - 1, static_cast<int>(floor(max(x[0], max(x[1], x[2])) - 0.5f)));
+        tri.maxY = min(static_cast<int>(height) - 1, static_cast<int>(floor(max(y[0], max(y[1], y[2])) - 0.5f)));
+        if(tri.minX > tri.maxX || tri.minY > tri.maxY)
+            return;
+        for(int i = 0; i < 3; i++){
+            //顶点i的对边从顶点j到顶点k
+            int j = (i + 1) % 3, k = (i + 2) % 3;
+            tri.edgeA[i] = y[j] - y[k];
+            tri.edgeB[i] = x[k] - x[j];
+            tri.edgeC[i] = -(tri.edgeA[i] * x[j] + tri.edgeB[i] * y[j]);
+            //左上规则（y向上、逆时针）：向下的边是左边，向左的水平边是上边；边上的像素只属于左边或上边所在的三角形
+            tri.topLeft[i] = y[k] < y[j] || (y[k] == y[j] && x[k] < x[j]);
+            tri.z[i] = z[i];
+            tri.invW[i] = invW[i];
+        }
+        tri.invArea = 1.0f / area;
+        tri.material = material;
+        unsigned int index = static_cast<unsigned int>(chunk.triangles.size());
+        chunk.triangles.push_back(tri);
+        for(int ty = tri.minY / RASTER_TILE_SIZE; ty <= tri.maxY / RASTER_TILE_SIZE; ty++){
+            for(int tx = tri.minX / RASTER_TILE_SIZE; tx <= tri.maxX / RASTER_TILE_SIZE; tx++){
+                chunk.bins[ty * tilesX + tx].push_back(index);
+                chunk.binned++;
+            }
+        }
+    }
+
+    void rasterTile(unsigned int tile){
+        int tileX0 = static_cast<int>(tile % tilesX) * RASTER_TILE_SIZE, tileY0 = static_cast<int>(tile / tilesX) * RASTER_TILE_SIZE;
+        int tileX1 = min(tileX0 + RASTER_TILE_SIZE, static_cast<int>(bufferWidth)) - 1;
+        int tileY1 = min(tileY0 + RASTER_TILE_SIZE, static_cast<int>(bufferHeight)) - 1;
+        //每个块清除自己的区域
+        for(int y = tileY0; y <= tileY1; y++){
+            fill(colorBuffer.begin() + y * bufferWidth + tileX0, colorBuffer.begin() + y * bufferWidth + tileX1 + 1, glm::vec3(0.0f));
+            fill(depthBuffer.begin() + y * bufferWidth + tileX0, depthBuffer.begin() + y * bufferWidth + tileX1 + 1, 1.0f);
+        }
+        unsigned int pixels = 0;
+        for(unsigned int c = 0; c < chunkCount; c++){
+            const Chunk &chunk = chunks[c];
+            const vector<unsigned int> &bin = chunk.bins[tile];
+            for(unsigned int i = 0; i < bin.size(); i++){
+                const RasterTriangle &tri = chunk.triangles[bin[i]];
+                //起点对齐到偶数，2x2块不会跨出屏幕块
+                int x0 = max(tri.minX, tileX0) & ~1, y0 = max(tri.minY, tileY0) & ~1;
+                int x1 = min(tri.maxX, tileX1), y1 = min(tri.maxY, tileY1);
+                for(int y = y0; y <= y1; y += 2){
+                    for(int x = x0; x <= x1; x += 2)
+                        pixels += rasterQuad(tri, x, y);
+                }
+            }
+        }
+        tilePixels[tile] = pixels;
+    }
+
+    //光栅化(x, y)开始的2x2像素块，通道顺序为 (x, y) (x + 1, y) (x, y + 1) (x + 1, y + 1)，返回着色的像素数
+    unsigned int rasterQuad(const RasterTriangle &tri, int x, int y){
+        float *depth0 = &depthBuffer[static_cast<size_t>(y) * bufferWidth + x];
+        float *depth1 = depth0 + bufferWidth;
+        float weights[3][4];
+        int mask;
+#if defined(RASTER_USE_SSE)
+        const __m128 zero = _mm_setzero_ps();
+        __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), _mm_setr_ps(0.5f, 1.5f, 0.5f, 1.5f));
+        __m128 py = _mm_add_ps(_mm_set1_ps(static_cast<float>(y)), _mm_setr_ps(0.5f, 0.5f, 1.5f, 1.5f));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        __m128 lambda[3];
+        for(int i = 0; i < 3; i++){
+            __m128 e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edgeA[i]), px), _mm_mul_ps(_mm_set1_ps(tri.edgeB[i]), py)), _mm_set1_ps(tri.edgeC[i]));
+            __m128 edgeInside = _mm_cmpgt_ps(e, zero);
+            if(tri.topLeft[i])
+                edgeInside = _mm_or_ps(edgeInside, _mm_cmpeq_ps(e, zero));
+            inside = _mm_and_ps(inside, edgeInside);
+            lambda[i] = _mm_mul_ps(e, _mm_set1_ps(tri.invArea));
+        }
+        if(_mm_movemask_ps(inside) == 0)
+            return 0;
+        __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lambda[0], _mm_set1_ps(tri.z[0])), _mm_mul_ps(lambda[1], _mm_set1_ps(tri.z[1]))),
+            _mm_mul_ps(lambda[2], _mm_set1_ps(tri.z[2])));
+        __m128 depth = _mm_loadh_pi(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(depth0)), reinterpret_cast<const __m64*>(depth1));
+        __m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(z, depth));
+        mask = _mm_movemask_ps(pass);
+        if(mask == 0)
+            return 0;
+        depth = _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, depth));
+        _mm_storel_pi(reinterpret_cast<__m64*>(depth0), depth);
+        _mm_storeh_pi(reinterpret_cast<__m64*>(depth1), depth);
+        for(int i = 0; i < 3; i++)
+            _mm_storeu_ps(weights[i], lambda[i]);
+#else
+        mask = 0;
+        for(int lane = 0; lane < 4; lane++){
+            float px = x + (lane & 1) + 0.5f, py = y + (lane >> 1) + 0.5f;
+            bool inside = true;
+            for(int i = 0; i < 3; i++){
+                float e = tri.edgeA[i] * px + tri.edgeB[i] * py + tri.edgeC[i];
+                inside = inside && (e > 0.0f || (e == 0.0f && tri.topLeft[i]));
+                weights[i][lane] = e * tri.invArea;
+            }
+            float *depth = (lane >> 1) == 0 ? &depth0[lane & 1] : &depth1[lane & 1];
+            float z = weights[0][lane] * tri.z[0] + weights[1][lane] * tri.z[1] + weights[2][lane] * tri.z[2];
+            if(inside && z < *depth){
+                *depth = z;
+                mask |= 1 << lane;
+            }
+        }
+        if(mask == 0)
+            return 0;
+#endif
+        return shadeQuad(tri, weights, mask, x, y);
+    }
+
+    //透视校正：屏幕空间的重心坐标除以w后重新归一化；没有覆盖的通道也参与计算，用来求纹理坐标的导数
+    unsigned int shadeQuad(const RasterTriangle &tri, const float weights[3][4], int mask, int x, int y){
+        float perspective[4][3];
+        glm::vec2 uv[4];
+        for(int lane = 0; lane < 4; lane++){
+            float w0 = weights[0][lane] * tri.invW[0], w1 = weights[1][lane] * tri.invW[1], w2 = weights[2][lane] * tri.invW[2];
+            float sum = w0 + w1 + w2;
+            float inv = sum > 1e-20f ? 1.0f / sum : 0.0f;
+            perspective[lane][0] = w0 * inv;
+            perspective[lane][1] = w1 * inv;
+            perspective[lane][2] = w2 * inv;
+            uv[lane] = tri.uv[0] * perspective[lane][0] + tri.uv[1] * perspective[lane][1] + tri.uv[2] * perspective[lane][2];
+        }
+        glm::vec2 ddx = uv[1] - uv[0], ddy = uv[2] - uv[0];
+        const SoftwareMaterial &material = *tri.material;
+        float diffuseLod = material.diffuse != nullptr ? material.diffuse->Lod(ddx, ddy) : 0.0f;
+        float specularLod = material.specular != nullptr ? material.specular->Lod(ddx, ddy) : 0.0f;
+        unsigned int shaded = 0;
+        for(int lane = 0; lane < 4; lane++){
+            if((mask & (1 << lane)) == 0)
+                continue;
+            const float *p = perspective[lane];
+            glm::vec3 world = tri.world[0] * p[0] + tri.world[1] * p[1] + tri.world[2] * p[2];
+            glm::vec3 normal = tri.normal[0] * p[0] + tri.normal[1] * p[1] + tri.normal[2] * p[2];
+            glm::vec3 albedo = material.diffuse != nullptr ? material.diffuse->Sample(uv[lane], diffuseLod) : glm::vec3(1.0f);
+            glm::vec3 specularColor = material.specular != nullptr ? material.specular->Sample(uv[lane], specularLod) : glm::vec3(0.0f);
+            colorBuffer[static_cast<size_t>(y + (lane >> 1)) * bufferWidth + x + (lane & 1)] = shade(world, normal, albedo, specularColor, material.shininess);
+            shaded++;
+        }
+        return shaded;
+    }
+
+    //与ObjectFragmentShader相同的Phong着色，没有阴影
+    glm::vec3 shade(const glm::vec3 &position, const glm::vec3 &normal, const glm::vec3 &albedo, const glm::vec3 &specularColor, float shininess) const{
+        float length = glm::length(normal);
+        glm::vec3 norm = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::vec3 viewDir = glm::normalize(viewPos - position);
+        glm::vec3 lightDir = glm::normalize(-dirLight.direction);
+        float diff = max(glm::dot(norm, lightDir), 0.0f);
+        float spec = pow(max(glm::dot(viewDir, glm::reflect(-lightDir, norm)), 0.0f), shininess);
+        glm::vec3 result = dirLight.ambient * albedo + dirLight.diffuse * diff * albedo + dirLight.specular * spec * specularColor;
+        for(unsigned int i = 0; i < pointLights.size(); i++){
+            const RasterPointLight &light = pointLights[i];
+            glm::vec3 toLight = light.position - position;
+            float distance = glm::length(toLight);
+            glm::vec3 pointDir = toLight / max(distance, 1e-6f);
+            float pointDiff = max(glm::dot(norm, pointDir), 0.0f);
+            float pointSpec = pow(max(glm::dot(viewDir, glm::reflect(-pointDir, norm)), 0.0f), shininess);
+            float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+            result += (light.ambient * albedo + light.diffuse * pointDiff * albedo + light.specular * pointSpec * specularColor) * attenuation;
+        }
+        return result;
+    }
+
+    //曝光色调映射与伽马校正，与CompositeFragmentShader相同（没有泛光）
+    void resolveRows(unsigned int begin, unsigned int end){
+        for(unsigned int y = begin; y < end; y++){
+            for(unsigned int x = 0; x < width; x++){
+                const glm::vec3 &color = colorBuffer[static_cast<size_t>(y) * bufferWidth + x];
+                unsigned char *dst = &output[(static_cast<size_t>(y) * width + x) * 4];
+                for(int c = 0; c < 3; c++){
+                    float mapped = pow(1.0f - exp(-color[c] * exposure), 1.0f / 2.2f);
+                    dst[c] = static_cast<unsigned char>(min(max(mapped, 0.0f), 1.0f) * 255.0f + 0.5f);
+                }
+                dst[3] = 255;
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,1103 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "InstanceBuffer.h"
+#include "RenderGraph.h"
+#include "Profiler.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "Transform.h"
+#include "SceneFormat.h"
+#include "SceneConverter.h"
+#include "SoftwareRasterizer.h"
+#include "Model.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_21_SoftwareRasterizer/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 150.0f;
+const unsigned int SHADOW_RESOLUTION = 4096;
+
+CustomCamera camera(glm::vec3(0.0f, 8.0f, 20.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -20.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//内置立方体，OpenGL与CPU光栅化器共用
+const float cubeVertices[] = {
+    // positions          // normals           // texture coords
+    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+    0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+    0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+    0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+    0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+    0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+    0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+    0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+    0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+    0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+    0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+    0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+    0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+    0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+};
+
+//场景内容全部来自场景文件（默认为课程目录下的Scene.txt），这里只有渲染相关的常量
+//点光源在场景中显示为发光的小方块，数量不超过着色器中的NR_POINT_LIGHTS
+const unsigned int MAX_POINT_LIGHTS = 16;
+const float LIGHT_CUBE_SIZE = 0.4f;
+//并行任务的粒度：每个任务至少处理这么多个元素，太小时调度开销会超过任务本身
+const unsigned int TRANSFORM_GRAIN = 512;
+const unsigned int CULL_GRAIN = 1024;
+bool jobsEnabled = true;
+bool jobsKeyDown = false;
+bool bloomEnabled = true;
+bool showDepth = false;
+bool aliasingEnabled = true;
+int blurIterations = 4;
+bool bloomKeyDown = false;
+bool depthKeyDown = false;
+bool aliasingKeyDown = false;
+bool moreKeyDown = false;
+bool lessKeyDown = false;
+bool traceKeyDown = false;
+//R键在OpenGL渲染与CPU参考光栅化器之间切换
+bool softwareEnabled = false;
+bool softwareKeyDown = false;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //B键开关泛光，V键在右上角显示深度，K键开关纹理复用，=与-键增减模糊次数
+    bool key = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+    if(key && !bloomKeyDown)
+        bloomEnabled = !bloomEnabled;
+    bloomKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS;
+    if(key && !depthKeyDown)
+        showDepth = !showDepth;
+    depthKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS;
+    if(key && !aliasingKeyDown)
+        aliasingEnabled = !aliasingEnabled;
+    aliasingKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS;
+    if(key && !moreKeyDown && blurIterations < 8)
+        blurIterations++;
+    moreKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS;
+    if(key && !lessKeyDown && blurIterations > 1)
+        blurIterations--;
+    lessKeyDown = key;
+    //T键导出最近的帧为Chrome trace，并在控制台输出各作用域的平均耗时
+    key = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+    if(key && !traceKeyDown){
+        Profiler::Get().ExportChromeTrace("./output/profile_trace.json");
+        vector<ProfileSummary> summary = Profiler::Get().Summarize();
+        cout << left << setw(28) << "scope" << right << setw(10) << "cpu ms" << setw(10) << "gpu ms" << setw(8) << "calls" << endl;
+        cout << fixed << setprecision(3);
+        for(unsigned int i = 0; i < summary.size(); i++)
+            cout << left << setw(28) << summary[i].name << right << setw(10) << summary[i].cpuMs << setw(10) << summary[i].gpuMs << setw(8) << summary[i].calls << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+    }
+    traceKeyDown = key;
+    //J键在任务系统与单线程之间切换，对比每帧更新的耗时
+    key = glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS;
+    if(key && !jobsKeyDown)
+        jobsEnabled = !jobsEnabled;
+    jobsKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+    if(key && !softwareKeyDown)
+        softwareEnabled = !softwareEnabled;
+    softwareKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false; 
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+//把[0, count)交给任务系统并行处理，关闭任务系统时在当前线程上一次处理完
+void parallelFor(unsigned int count, unsigned int grainSize, const function<void(unsigned int, unsigned int)> &func){
+    if(jobsEnabled)
+        JobSystem::Get().ParallelFor(count, grainSize, func);
+    else if(count > 0)
+        func(0, count);
+}
+
+//每张图片的解码作为一个任务提交，完成时counter减一，解码结果在Wait之后由uploadTextures上传
+void decodeTextures(const vector<string> &paths, vector<DecodedImage> &images, JobCounter &counter){
+    images.assign(paths.size(), DecodedImage());
+    for(unsigned int i = 0; i < paths.size(); i++){
+        JobSystem::Get().Run([&, i](){
+            PROFILE_SCOPE("Decode " + paths[i].substr(paths[i].find_last_of('/') + 1));
+            images[i] = DecodeImage(paths[i]);
+        }, &counter);
+    }
+}
+
+vector<unsigned int> uploadTextures(const vector<string> &paths, vector<DecodedImage> &images){
+    PROFILE_FUNCTION();
+    vector<unsigned int> textures(paths.size());
+    for(unsigned int i = 0; i < paths.size(); i++)
+        textures[i] = UploadImage(images[i], paths[i]);
+    return textures;
+}
+
+//场景材质在运行时对应的纹理
+struct MaterialTextures {
+    unsigned int diffuse = 0;
+    unsigned int specular = 0;
+    float shininess = 32.0f;
+};
+
+//1x1的纯色纹理，代替场景中没有指定的贴图
+unsigned int createSolidTexture(unsigned char r, unsigned char g, unsigned char b){
+    unsigned char pixel[3] = {r, g, b};
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, pixel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+}
+
+//打开场景：文本场景先转换为./output/下的同名.bin（二进制已是最新时跳过），再映射二进制文件
+bool openScene(const string &path, SceneFile &scene){
+    string binary = path;
+    if(path.size() > 4 && path.substr(path.size() - 4) == ".txt"){
+        string name = path.substr(path.find_last_of("/\\") + 1);
+        binary = "./output/" + name.substr(0, name.size() - 4) + ".bin";
+        if(!SceneConverter::ConvertIfStale(path, binary))
+            return false;
+    }
+    return scene.Open(binary);
+}
+
+//先按场景中的初始旋转摆放，再绕自身y轴转动有转速的实体；之后按批次组合模型矩阵、光源空间的矩阵（阴影pass使用）与世界包围盒
+//每个批次使用自己网格的局部包围盒，批次内按区间并行
+void animateEntities(float time, const SceneFile &scene, const vector<AABB> &meshBounds, TransformStore &transforms, const glm::mat4 &lightSpaceMatrix,
+    vector<glm::mat4> &matrices, vector<glm::mat4> &lightMatrices, AABBSoA &bounds){
+    PROFILE_FUNCTION();
+    const float *spin = scene.Stream(SCENE_SPIN);
+    const float *qx = scene.Stream(SCENE_RX), *qy = scene.Stream(SCENE_RY), *qz = scene.Stream(SCENE_RZ), *qw = scene.Stream(SCENE_RW);
+    for(unsigned int b = 0; b < scene.BatchCount(); b++){
+        const SceneBatch &batch = scene.Batch(b);
+        parallelFor(batch.count, TRANSFORM_GRAIN, [&](unsigned int begin, unsigned int end){
+            begin += batch.first;
+            end += batch.first;
+            //q * (cos(a/2), 0, sin(a/2), 0)，q是映射文件中的初始旋转
+            for(unsigned int i = begin; i < end; i++){
+                if(spin[i] == 0.0f)
+                    continue;
+                float half = time * spin[i] * 0.5f;
+                float c = cos(half), s = sin(half);
+                transforms.rx[i] = qx[i] * c - qz[i] * s;
+                transforms.ry[i] = qy[i] * c + qw[i] * s;
+                transforms.rz[i] = qz[i] * c + qx[i] * s;
+                transforms.rw[i] = qw[i] * c - qy[i] * s;
+            }
+            transforms.Compose(begin, end, matrices.data(), &lightSpaceMatrix, lightMatrices.data(), &bounds, meshBounds[batch.mesh]);
+        });
+    }
+}
+
+//分块并行剔除：每块把可见下标写到scratch中与自己对应的位置，再按块的顺序紧凑到visible中，结果与串行剔除相同
+//可见下标保持升序，同一批次的可见实体在visible中也是连续的，batchStart[b]~batchStart[b + 1]为批次b的范围
+void cullEntities(const Frustum &frustum, const SceneFile &scene, const AABBSoA &bounds, const vector<glm::mat4> &matrices, FrustumCuller &culler,
+    vector<unsigned int> &scratch, vector<unsigned int> &chunkCounts, vector<unsigned int> &visible, vector<glm::mat4> &visibleMatrices,
+    vector<unsigned int> &batchStart){
+    PROFILE_FUNCTION();
+    auto start = chrono::high_resolution_clock::now();
+    unsigned int count = bounds.Size();
+    unsigned int chunks = (count + CULL_GRAIN - 1) / CULL_GRAIN;
+    scratch.resize(count);
+    chunkCounts.resize(chunks);
+    parallelFor(chunks, 1, [&](unsigned int begin, unsigned int end){
+        for(unsigned int c = begin; c < end; c++){
+            unsigned int first = c * CULL_GRAIN;
+            unsigned int last = min(first + CULL_GRAIN, count);
+            chunkCounts[c] = FrustumCuller::CullAABBRange(frustum, bounds, first, last, &scratch[first]);
+        }
+    });
+    visible.clear();
+    for(unsigned int c = 0; c < chunks; c++)
+        visible.insert(visible.end(), scratch.begin() + c * CULL_GRAIN, scratch.begin() + c * CULL_GRAIN + chunkCounts[c]);
+    visibleMatrices.resize(visible.size());
+    parallelFor(static_cast<unsigned int>(visible.size()), TRANSFORM_GRAIN * 2, [&](unsigned int begin, unsigned int end){
+        for(unsigned int i = begin; i < end; i++)
+            visibleMatrices[i] = matrices[visible[i]];
+    });
+    batchStart.resize(scene.BatchCount() + 1);
+    for(unsigned int b = 0; b < scene.BatchCount(); b++)
+        batchStart[b] = static_cast<unsigned int>(lower_bound(visible.begin(), visible.end(), scene.Batch(b).first) - visible.begin());
+    batchStart[scene.BatchCount()] = static_cast<unsigned int>(visible.size());
+    culler.Record(count, static_cast<unsigned int>(visible.size()), chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count());
+}
+
+//逐批次实例化绘制，批次b的实例矩阵是matrixBuffer中batchStart[b]~batchStart[b + 1]的部分
+//bindMaterials为true时绑定批次的材质，模型的网格总是绑定自己的纹理；导入失败的模型跳过
+void drawBatches(const SceneFile &scene, CustomShader &shader, unsigned int cubeVAO, vector<Model> &models, const vector<int> &modelLoaded,
+    const vector<MaterialTextures> &materials, const MaterialTextures &defaultMaterial, unsigned int matrixBuffer, const vector<unsigned int> &batchStart,
+    bool bindMaterials){
+    for(unsigned int b = 0; b < scene.BatchCount(); b++){
+        const SceneBatch &batch = scene.Batch(b);
+        unsigned int count = batchStart[b + 1] - batchStart[b];
+        GLintptr offset = static_cast<GLintptr>(batchStart[b]) * sizeof(glm::mat4);
+        if(count == 0)
+            continue;
+        const MaterialTextures &material = batch.material == SCENE_NONE ? defaultMaterial : materials[batch.material];
+        if(bindMaterials)
+            shader.setFloat("material.shininess", material.shininess);
+        if(scene.Mesh(batch.mesh).path == SCENE_NONE){
+            if(bindMaterials){
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, material.diffuse);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, material.specular);
+            }
+            glBindVertexArray(cubeVAO);
+            InstanceBuffer::BindInstanceAttributes(matrixBuffer, offset, 0, 0);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, count);
+        }else if(modelLoaded[batch.mesh]){
+            models[batch.mesh].SetInstanceSource(matrixBuffer, offset);
+            models[batch.mesh].DrawInstanced(shader, count);
+        }
+    }
+}
+
+//开始加载场景用到的模型与材质贴图：模型导入与贴图解码作为任务在工作线程上进行，全部完成时loading归零
+//多个材质引用同一张贴图时只解码一次，diffuseIndex、specularIndex为材质贴图在texturePaths中的下标，没有贴图时为SCENE_NONE
+void loadSceneAssets(const SceneFile &scene, vector<Model> &models, vector<int> &modelLoaded, vector<string> &texturePaths,
+    vector<unsigned int> &diffuseIndex, vector<unsigned int> &specularIndex, vector<DecodedImage> &images, JobCounter &loading){
+    for(unsigned int m = 0; m < scene.MeshCount(); m++){
+        if(scene.Mesh(m).path == SCENE_NONE)
+            continue;
+        string modelPath = scene.String(scene.Mesh(m).path);
+        JobSystem::Get().Run([&, m, modelPath](){
+            modelLoaded[m] = models[m].Import(modelPath) ? 1 : 0;
+        }, &loading);
+    }
+    auto textureIndex = [&](uint32_t path) -> unsigned int{
+        if(path == SCENE_NONE)
+            return SCENE_NONE;
+        string value = scene.String(path);
+        for(unsigned int i = 0; i < texturePaths.size(); i++){
+            if(texturePaths[i] == value)
+                return i;
+        }
+        texturePaths.push_back(value);
+        return static_cast<unsigned int>(texturePaths.size() - 1);
+    };
+    diffuseIndex.resize(scene.MaterialCount());
+    specularIndex.resize(scene.MaterialCount());
+    for(unsigned int i = 0; i < scene.MaterialCount(); i++){
+        diffuseIndex[i] = textureIndex(scene.Material(i).diffuse);
+        specularIndex[i] = textureIndex(scene.Material(i).specular);
+    }
+    decodeTextures(texturePaths, images, loading);
+}
+
+//每个网格的局部包围盒，内置立方体与导入失败的模型为单位立方体
+vector<AABB> computeMeshBounds(const SceneFile &scene, const vector<Model> &models, const vector<int> &modelLoaded){
+    vector<AABB> meshBounds(scene.MeshCount());
+    for(unsigned int m = 0; m < scene.MeshCount(); m++){
+        meshBounds[m].min = glm::vec3(-0.5f);
+        meshBounds[m].max = glm::vec3(0.5f);
+        if(modelLoaded[m] && models[m].aabb.IsValid())
+            meshBounds[m] = models[m].aabb;
+    }
+    return meshBounds;
+}
+
+//场景中定向光的方向（单位向量）
+glm::vec3 sceneLightDirection(const SceneFile &scene){
+    const SceneDirLight &dirLight = scene.Header().dirLight;
+    return glm::normalize(glm::vec3(dirLight.direction[0], dirLight.direction[1], dirLight.direction[2]));
+}
+
+//定向光的光源空间矩阵：正交投影覆盖所有实体位置的包围球，再留出一些余量给实体自身的大小
+glm::mat4 computeLightSpaceMatrix(const SceneFile &scene){
+    const SceneHeader &header = scene.Header();
+    glm::vec3 sceneMin(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    glm::vec3 sceneMax(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    glm::vec3 sceneCenter = (sceneMin + sceneMax) * 0.5f;
+    float sceneRadius = glm::length(sceneMax - sceneMin) * 0.5f + 5.0f;
+    glm::mat4 lightProjection = glm::ortho(-sceneRadius, sceneRadius, -sceneRadius, sceneRadius, 1.0f, sceneRadius * 2.0f + 20.0f);
+    glm::mat4 lightView = glm::lookAt(sceneCenter - sceneLightDirection(scene) * (sceneRadius + 10.0f), sceneCenter, glm::vec3(0.0f, 1.0f, 0.0f));
+    return lightProjection * lightView;
+}
+
+//CPU光栅化器使用的场景资源，与OpenGL渲染来自同一份网格、材质贴图与光源
+//材质中的贴图指针指向textures与modelTextures中的元素，建立之后这些数组不能再改变大小
+struct SoftwareAssets {
+    SoftwareMesh cube;
+    vector<SoftwareTexture> textures;//与texturePaths一一对应
+    vector<SoftwareMaterial> materials;//与场景材质一一对应
+    SoftwareMaterial defaultMaterial;//没有指定材质的批次：白色，没有高光
+    vector<vector<SoftwareMesh>> modelMeshes;//每个场景网格对应模型的所有网格，内置立方体为空
+    vector<vector<SoftwareTexture>> modelTextures;//与模型的textures_loaded一一对应
+    vector<vector<SoftwareMaterial>> modelMaterials;//模型每个网格的材质，与OpenGL一样使用网格自己的贴图
+};
+
+//复制解码好的贴图与模型网格，必须在uploadTextures与Model::Upload释放解码结果之前调用
+//解码失败的贴图与OpenGL中没有数据的纹理一样采样为黑色
+void buildSoftwareAssets(const SceneFile &scene, const vector<Model> &models, const vector<int> &modelLoaded, const vector<DecodedImage> &images,
+    const vector<unsigned int> &diffuseIndex, const vector<unsigned int> &specularIndex, SoftwareAssets &assets){
+    PROFILE_FUNCTION();
+    auto loadTextures = [](const vector<DecodedImage> &source, vector<SoftwareTexture> &textures){
+        textures.resize(source.size());
+        parallelFor(static_cast<unsigned int>(source.size()), 1, [&](unsigned int begin, unsigned int end){
+            for(unsigned int i = begin; i < end; i++){
+                textures[i].Load(source[i].data, source[i].width, source[i].height, source[i].nrComponents);
+                if(!textures[i].IsValid())
+                    textures[i].Solid(0, 0, 0);
+            }
+        });
+    };
+    assets.cube.FromInterleaved(cubeVertices, 36);
+    loadTextures(images, assets.textures);
+    assets.materials.resize(scene.MaterialCount());
+    for(unsigned int i = 0; i < scene.MaterialCount(); i++){
+        assets.materials[i].diffuse = diffuseIndex[i] == SCENE_NONE ? nullptr : &assets.textures[diffuseIndex[i]];
+        assets.materials[i].specular = specularIndex[i] == SCENE_NONE ? nullptr : &assets.textures[specularIndex[i]];
+        assets.materials[i].shininess = scene.Material(i).shininess;
+    }
+    assets.modelMeshes.assign(scene.MeshCount(), vector<SoftwareMesh>());
+    assets.modelTextures.assign(scene.MeshCount(), vector<SoftwareTexture>());
+    assets.modelMaterials.assign(scene.MeshCount(), vector<SoftwareMaterial>());
+    for(unsigned int m = 0; m < scene.MeshCount(); m++){
+        if(!modelLoaded[m])
+            continue;
+        const Model &model = models[m];
+        loadTextures(model.Images(), assets.modelTextures[m]);
+        assets.modelMeshes[m].resize(model.meshes.size());
+        assets.modelMaterials[m].resize(model.meshes.size());
+        for(unsigned int i = 0; i < model.meshes.size(); i++){
+            const Mesh &mesh = model.meshes[i];
+            assets.modelMeshes[m][i].FromMesh(mesh);
+            //每种贴图取网格的第一张，对应着色器中的material.diffuse与material.specular
+            SoftwareMaterial &material = assets.modelMaterials[m][i];
+            for(unsigned int t = 0; t < mesh.textures.size(); t++){
+                for(unsigned int j = 0; j < model.textures_loaded.size() && j < assets.modelTextures[m].size(); j++){
+                    if(model.textures_loaded[j].path != mesh.textures[t].path)
+                        continue;
+                    if(mesh.textures[t].type == "texture_diffuse" && material.diffuse == nullptr)
+                        material.diffuse = &assets.modelTextures[m][j];
+                    else if(mesh.textures[t].type == "texture_specular" && material.specular == nullptr)
+                        material.specular = &assets.modelTextures[m][j];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+//场景中的光源不会变化，只需要设置一次
+void setupSoftwareLights(const SceneFile &scene, unsigned int pointLightCount, SoftwareRasterizer &rasterizer){
+    const SceneDirLight &dirLight = scene.Header().dirLight;
+    rasterizer.dirLight.direction = sceneLightDirection(scene);
+    rasterizer.dirLight.ambient = glm::vec3(dirLight.ambient[0], dirLight.ambient[1], dirLight.ambient[2]);
+    rasterizer.dirLight.diffuse = glm::vec3(dirLight.diffuse[0], dirLight.diffuse[1], dirLight.diffuse[2]);
+    rasterizer.dirLight.specular = glm::vec3(dirLight.specular[0], dirLight.specular[1], dirLight.specular[2]);
+    rasterizer.pointLights.resize(pointLightCount);
+    for(unsigned int i = 0; i < pointLightCount; i++){
+        const ScenePointLight &light = scene.PointLight(i);
+        RasterPointLight &target = rasterizer.pointLights[i];
+        target.position = glm::vec3(light.position[0], light.position[1], light.position[2]);
+        target.ambient = glm::vec3(light.ambient[0], light.ambient[1], light.ambient[2]);
+        target.diffuse = glm::vec3(light.diffuse[0], light.diffuse[1], light.diffuse[2]);
+        target.specular = glm::vec3(light.specular[0], light.specular[1], light.specular[2]);
+        target.constant = light.constant;
+        target.linear = light.linear;
+        target.quadratic = light.quadratic;
+    }
+}
+
+//与drawBatches相同的批次与实例范围，提交给CPU光栅化器；点光源的发光方块不属于参考渲染的子集
+void submitSoftwareBatches(const SceneFile &scene, const SoftwareAssets &assets, const vector<int> &modelLoaded, const vector<glm::mat4> &visibleMatrices,
+    const vector<unsigned int> &batchStart, SoftwareRasterizer &rasterizer){
+    for(unsigned int b = 0; b < scene.BatchCount(); b++){
+        const SceneBatch &batch = scene.Batch(b);
+        unsigned int count = batchStart[b + 1] - batchStart[b];
+        if(count == 0)
+            continue;
+        const glm::mat4 *instances = visibleMatrices.data() + batchStart[b];
+        if(scene.Mesh(batch.mesh).path == SCENE_NONE){
+            const SoftwareMaterial &material = batch.material == SCENE_NONE ? assets.defaultMaterial : assets.materials[batch.material];
+            rasterizer.DrawInstanced(assets.cube, material, instances, count);
+        }else if(modelLoaded[batch.mesh]){
+            for(unsigned int i = 0; i < assets.modelMeshes[batch.mesh].size(); i++)
+                rasterizer.DrawInstanced(assets.modelMeshes[batch.mesh][i], assets.modelMaterials[batch.mesh][i], instances, count);
+        }
+    }
+}
+
+//不创建窗口与OpenGL上下文，只用CPU光栅化器渲染frames帧（动画每帧推进1/60秒），输出各阶段的平均耗时，最后一帧保存为PPM
+//没有GPU的环境（例如CI）可以用它检查场景内容与着色结果
+int runSoftwareRender(const SceneFile &scene, TransformStore &transforms, unsigned int frames, const string &outputPath){
+    unsigned int entityCount = scene.EntityCount();
+    unsigned int pointLightCount = min(scene.PointLightCount(), MAX_POINT_LIGHTS);
+    JobCounter loading;
+    vector<Model> models(scene.MeshCount());
+    vector<int> modelLoaded(scene.MeshCount(), 0);
+    vector<string> texturePaths;
+    vector<unsigned int> diffuseIndex, specularIndex;
+    vector<DecodedImage> images;
+    loadSceneAssets(scene, models, modelLoaded, texturePaths, diffuseIndex, specularIndex, images, loading);
+    JobSystem::Get().Wait(loading);
+    SoftwareAssets assets;
+    buildSoftwareAssets(scene, models, modelLoaded, images, diffuseIndex, specularIndex, assets);
+    //没有OpenGL上传，解码结果在复制之后直接释放
+    for(unsigned int i = 0; i < images.size(); i++)
+        stbi_image_free(images[i].data);
+    for(unsigned int m = 0; m < models.size(); m++)
+        models[m].ReleaseImages();
+    vector<AABB> meshBounds = computeMeshBounds(scene, models, modelLoaded);
+    glm::mat4 lightSpaceMatrix = computeLightSpaceMatrix(scene);
+
+    vector<glm::mat4> matrices(entityCount), lightMatrices(entityCount), visibleMatrices;
+    AABBSoA bounds;
+    bounds.Resize(entityCount);
+    FrustumCuller culler;
+    vector<unsigned int> visible, cullScratch, chunkCounts, visibleBatchStart;
+    SoftwareRasterizer rasterizer(SCR_WIDTH, SCR_HEIGHT);
+    setupSoftwareLights(scene, pointLightCount, rasterizer);
+    glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+    Frustum frustum = Frustum::FromMatrix(projection * view);
+
+    double updateMs = 0.0, geometryMs = 0.0, rasterMs = 0.0, resolveMs = 0.0, frameMs = 0.0;
+    for(unsigned int frame = 0; frame < frames; frame++){
+        Profiler::Get().BeginFrame();
+        auto start = chrono::steady_clock::now();
+        animateEntities(frame / 60.0f, scene, meshBounds, transforms, lightSpaceMatrix, matrices, lightMatrices, bounds);
+        cullEntities(frustum, scene, bounds, matrices, culler, cullScratch, chunkCounts, visible, visibleMatrices, visibleBatchStart);
+        updateMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        rasterizer.Begin(view, projection, camera.Position);
+        submitSoftwareBatches(scene, assets, modelLoaded, visibleMatrices, visibleBatchStart, rasterizer);
+        rasterizer.Execute();
+        frameMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        geometryMs += rasterizer.Stats().geometryMs;
+        rasterMs += rasterizer.Stats().rasterMs;
+        resolveMs += rasterizer.Stats().resolveMs;
+    }
+    const RasterStats &stats = rasterizer.Stats();
+    cout << "Software render: " << SCR_WIDTH << "x" << SCR_HEIGHT << ", " << frames << " frames, " << JobSystem::Get().ThreadCount() << " threads" << endl;
+    cout << visible.size() << "/" << entityCount << " entities visible, " << stats.draws << " draws, " << stats.triangles << " triangles, "
+        << stats.rasterTriangles << " after clipping, " << stats.binnedTriangles << " tile bins, " << stats.shadedPixels << " pixels shaded" << endl;
+    if(frames > 0){
+        cout << left << setw(16) << "stage" << right << setw(12) << "avg ms" << endl;
+        cout << fixed << setprecision(3);
+        cout << left << setw(16) << "update" << right << setw(12) << updateMs / frames << endl;
+        cout << left << setw(16) << "geometry" << right << setw(12) << geometryMs / frames << endl;
+        cout << left << setw(16) << "raster" << right << setw(12) << rasterMs / frames << endl;
+        cout << left << setw(16) << "resolve" << right << setw(12) << resolveMs / frames << endl;
+        cout << left << setw(16) << "frame" << right << setw(12) << frameMs / frames << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+    }
+    if(!rasterizer.SavePPM(outputPath))
+        return -1;
+    cout << "Saved " << outputPath << endl;
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    //--threads N指定参与执行任务的线程数，默认为硬件线程数
+    //--scene 路径  文本场景（.txt）或转换好的二进制场景，默认为课程目录下的Scene.txt
+    //--convert 文本 二进制  只转换场景，不创建窗口
+    //--softrender [--frames N] [--output 文件]  不创建窗口，用CPU光栅化器渲染N帧，最后一帧保存为PPM
+    int threads = 0;
+    string scenePath = Path + "Scene.txt";
+    bool softRender = false;
+    unsigned int softFrames = 60;
+    string softOutput = "./output/software.ppm";
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--threads" && i + 1 < argc)
+            threads = atoi(argv[i + 1]);
+        else if(arg == "--scene" && i + 1 < argc)
+            scenePath = argv[i + 1];
+        else if(arg == "--convert" && i + 2 < argc)
+            return SceneConverter::Convert(argv[i + 1], argv[i + 2]) ? 0 : -1;
+        else if(arg == "--softrender")
+            softRender = true;
+        else if(arg == "--frames" && i + 1 < argc)
+            softFrames = static_cast<unsigned int>(max(1, atoi(argv[i + 1])));
+        else if(arg == "--output" && i + 1 < argc)
+            softOutput = argv[i + 1];
+    }
+    JobSystem::Get().Init(threads > 0 ? threads - 1 : -1);
+    cout << "Job system: " << JobSystem::Get().ThreadCount() << " threads" << endl;
+
+    //映射场景文件并把实体变换整块复制到变换组件中，没有逐个实体的解析
+    auto loadStart = chrono::steady_clock::now();
+    SceneFile scene;
+    if(!openScene(scenePath, scene)){
+        JobSystem::Get().Shutdown();
+        return -1;
+    }
+    TransformStore transforms;
+    scene.LoadTransforms(transforms);
+    double sceneLoadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count();
+    unsigned int entityCount = scene.EntityCount();
+    unsigned int pointLightCount = min(scene.PointLightCount(), MAX_POINT_LIGHTS);
+    cout << "Scene: " << entityCount << " entities, " << scene.BatchCount() << " batches, " << scene.MeshCount() << " meshes, "
+        << scene.MaterialCount() << " materials, " << scene.PointLightCount() << " point lights, " << scene.Size() / 1024 << " KB, loaded in "
+        << sceneLoadMs << " ms" << endl;
+    const SceneCamera &sceneCamera = scene.Header().camera;
+    camera = CustomCamera(glm::vec3(sceneCamera.position[0], sceneCamera.position[1], sceneCamera.position[2]), glm::vec3(0.0f, 1.0f, 0.0f),
+        sceneCamera.yaw, sceneCamera.pitch);
+    if(softRender){
+        int result = runSoftwareRender(scene, transforms, softFrames, softOutput);
+        JobSystem::Get().Shutdown();
+        return result;
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 8.0f;
+    Profiler::Get().InitGPU();
+
+    CustomShader objectShader((Path + "ObjectVertexShader.glsl").c_str(), (Path + "ObjectFragmentShader.glsl").c_str());
+    CustomShader shadowShader((Path + "ShadowVertexShader.glsl").c_str(), (Path + "ShadowFragmentShader.glsl").c_str());
+    CustomShader glowShader((Path + "LightVertexShader.glsl").c_str(), (Path + "LightFragmentShader.glsl").c_str());
+    CustomShader brightShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "BrightFragmentShader.glsl").c_str());
+    CustomShader blurShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "BlurFragmentShader.glsl").c_str());
+    CustomShader compositeShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "CompositeFragmentShader.glsl").c_str());
+    CustomShader depthViewShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "DepthViewFragmentShader.glsl").c_str());
+    CustomShader postShader((Path + "QuadVertexShader.glsl").c_str(), (Path + "PostFragmentShader.glsl").c_str());
+
+    unsigned int VBO;
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+
+    //场景中的模型导入与材质贴图解码作为任务在工作线程上进行，全部完成后再在OpenGL线程上传
+    JobCounter loading;
+    vector<Model> models(scene.MeshCount());
+    vector<int> modelLoaded(scene.MeshCount(), 0);
+    vector<string> texturePaths;
+    vector<unsigned int> diffuseIndex, specularIndex;
+    vector<DecodedImage> images;
+    loadSceneAssets(scene, models, modelLoaded, texturePaths, diffuseIndex, specularIndex, images, loading);
+
+    vector<glm::mat4> matrices(entityCount), lightMatrices(entityCount);
+    //阴影pass绘制全部实体，实例矩阵直接使用组合好的 lightSpaceMatrix * model，每个批次从自己的第一个实体开始
+    InstanceBuffer shadowInstances(lightMatrices.data(), entityCount, nullptr, GL_STREAM_DRAW);
+    vector<unsigned int> shadowBatchStart(scene.BatchCount() + 1, entityCount);
+    for(unsigned int b = 0; b < scene.BatchCount(); b++)
+        shadowBatchStart[b] = scene.Batch(b).first;
+
+    //内置立方体的VAO，实例属性在绘制每个批次前绑定到对应的偏移
+    unsigned int cubeVAO, lightCubeVAO;
+    glGenVertexArrays(1, &cubeVAO);
+    glBindVertexArray(cubeVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    //场景pass只绘制视锥体内的实体，阴影pass仍然绘制全部实体
+    AABBSoA bounds;
+    bounds.Resize(entityCount);
+    FrustumCuller culler;
+    vector<unsigned int> visible, cullScratch, chunkCounts, visibleBatchStart(scene.BatchCount() + 1, 0);
+    vector<glm::mat4> visibleMatrices;
+    InstanceBuffer visibleInstances(matrices.data(), entityCount, nullptr, GL_STREAM_DRAW);
+
+    //点光源位置上的发光方块，颜色使用点光源的漫反射颜色（可以大于1），经过泛光后形成光晕
+    vector<glm::mat4> lightCubeMatrices(pointLightCount);
+    vector<glm::vec4> lightCubeColors(pointLightCount);
+    for(unsigned int i = 0; i < pointLightCount; i++){
+        const ScenePointLight &light = scene.PointLight(i);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(light.position[0], light.position[1], light.position[2]));
+        lightCubeMatrices[i] = glm::scale(model, glm::vec3(LIGHT_CUBE_SIZE));
+        lightCubeColors[i] = glm::vec4(light.diffuse[0], light.diffuse[1], light.diffuse[2], 1.0f);
+    }
+    InstanceBuffer lightCubes(lightCubeMatrices.data(), pointLightCount, lightCubeColors.data(), GL_STATIC_DRAW);
+    glGenVertexArrays(1, &lightCubeVAO);
+    glBindVertexArray(lightCubeVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    lightCubes.BindAttributes();
+
+    //后处理pass共用的全屏四边形
+    float quadVertices[] = {-1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f};
+    unsigned int quadVAO, quadVBO;
+    glGenVertexArrays(1, &quadVAO);
+    glGenBuffers(1, &quadVBO);
+    glBindVertexArray(quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    {
+        PROFILE_SCOPE("WaitLoading");
+        JobSystem::Get().Wait(loading);
+    }
+    //CPU光栅化器复制一份解码结果，之后才上传并释放
+    SoftwareAssets softwareAssets;
+    buildSoftwareAssets(scene, models, modelLoaded, images, diffuseIndex, specularIndex, softwareAssets);
+    vector<unsigned int> textures = uploadTextures(texturePaths, images);
+    //没有指定漫反射贴图时为白色，没有镜面光贴图时为黑色（没有高光）
+    MaterialTextures defaultMaterial;
+    defaultMaterial.diffuse = createSolidTexture(255, 255, 255);
+    defaultMaterial.specular = createSolidTexture(0, 0, 0);
+    vector<MaterialTextures> materials(scene.MaterialCount());
+    for(unsigned int i = 0; i < scene.MaterialCount(); i++){
+        materials[i].diffuse = diffuseIndex[i] == SCENE_NONE ? defaultMaterial.diffuse : textures[diffuseIndex[i]];
+        materials[i].specular = specularIndex[i] == SCENE_NONE ? defaultMaterial.specular : textures[specularIndex[i]];
+        materials[i].shininess = scene.Material(i).shininess;
+    }
+    for(unsigned int m = 0; m < scene.MeshCount(); m++){
+        if(!modelLoaded[m])
+            continue;
+        models[m].Upload();
+        cout << scene.String(scene.Mesh(m).name) << ": " << models[m].nodes.size() << " nodes, " << models[m].meshes.size() << " meshes" << endl;
+    }
+    vector<AABB> meshBounds = computeMeshBounds(scene, models, modelLoaded);
+
+    //模型网格按 漫反射、镜面光、法线 的顺序占用0~2号纹理单元，阴影贴图放在4号
+    //场景中的光源不会变化，只需要设置一次
+    const SceneDirLight &dirLight = scene.Header().dirLight;
+    glm::vec3 lightDir = sceneLightDirection(scene);
+    objectShader.use();
+    objectShader.setInt("material.diffuse", 0);
+    objectShader.setInt("material.specular", 1);
+    objectShader.setInt("shadowMap", 4);
+    objectShader.setVec3("dirLight.direction", lightDir);
+    objectShader.setVec3("dirLight.ambient", dirLight.ambient[0], dirLight.ambient[1], dirLight.ambient[2]);
+    objectShader.setVec3("dirLight.diffuse", dirLight.diffuse[0], dirLight.diffuse[1], dirLight.diffuse[2]);
+    objectShader.setVec3("dirLight.specular", dirLight.specular[0], dirLight.specular[1], dirLight.specular[2]);
+    objectShader.setInt("pointLightCount", static_cast<int>(pointLightCount));
+    for(unsigned int i = 0; i < pointLightCount; i++){
+        const ScenePointLight &light = scene.PointLight(i);
+        string name = "pointLights[" + to_string(i) + "].";
+        objectShader.setVec3(name + "position", light.position[0], light.position[1], light.position[2]);
+        objectShader.setVec3(name + "ambient", light.ambient[0], light.ambient[1], light.ambient[2]);
+        objectShader.setVec3(name + "diffuse", light.diffuse[0], light.diffuse[1], light.diffuse[2]);
+        objectShader.setVec3(name + "specular", light.specular[0], light.specular[1], light.specular[2]);
+        objectShader.setFloat(name + "constant", light.constant);
+        objectShader.setFloat(name + "linear", light.linear);
+        objectShader.setFloat(name + "quadratic", light.quadratic);
+    }
+    //CPU光栅化器的结果每帧上传到softwareTexture，再经过与OpenGL渲染相同的输出pass显示
+    SoftwareRasterizer softwareRasterizer(SCR_WIDTH, SCR_HEIGHT);
+    setupSoftwareLights(scene, pointLightCount, softwareRasterizer);
+    unsigned int softwareTexture;
+    glGenTextures(1, &softwareTexture);
+    glBindTexture(GL_TEXTURE_2D, softwareTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    //渲染图中用到的渲染目标描述
+    const TextureDesc shadowDesc(SHADOW_RESOLUTION, SHADOW_RESOLUTION, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+    const TextureDesc hdrDesc(SCR_WIDTH, SCR_HEIGHT, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    const TextureDesc depthDesc(SCR_WIDTH, SCR_HEIGHT, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+    const TextureDesc bloomDesc(SCR_WIDTH / 2, SCR_HEIGHT / 2, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+    const TextureDesc ldrDesc(SCR_WIDTH, SCR_HEIGHT, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    glm::mat4 lightSpaceMatrix = computeLightSpaceMatrix(scene);
+
+    RenderGraph graph;
+    int lastConfig = -1;
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    double updateMs = 0.0;
+    double softwareMs[3] = {0.0, 0.0, 0.0};//CPU光栅化器 几何、光栅化、色调映射 的累计耗时
+    unsigned int softwareFrames = 0;
+    while (!glfwWindowShouldClose(window)){
+        //分析器以这里为帧的分界，之前的事件都属于启动阶段
+        Profiler::Get().BeginFrame();
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        //显示平均帧时间与渲染图统计
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            JobSystemStats jobStats = JobSystem::Get().TakeStats();
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame, GPU " + to_string(Profiler::Get().LastGpuFrameMs())
+                + " ms, update " + to_string(updateMs / frameCount) + " ms - "
+                + (jobsEnabled ? to_string(JobSystem::Get().ThreadCount()) + " threads, " + to_string(jobStats.jobs / frameCount) + " jobs per frame"
+                    : string("single thread")) + " - scene loaded in " + to_string(sceneLoadMs) + " ms, "
+                + to_string(visible.size()) + "/" + to_string(entityCount) + " entities visible in " + to_string(scene.BatchCount())
+                + " batches";
+            if(softwareEnabled && softwareFrames > 0){
+                const RasterStats &stats = softwareRasterizer.Stats();
+                title += " - CPU raster: geometry " + to_string(softwareMs[0] / softwareFrames) + " ms, raster " + to_string(softwareMs[1] / softwareFrames)
+                    + " ms, resolve " + to_string(softwareMs[2] / softwareFrames) + " ms, " + to_string(stats.rasterTriangles) + " triangles, "
+                    + to_string(stats.shadedPixels) + " pixels";
+            }
+            title += " - J: toggle jobs, T: export trace, R: toggle CPU raster";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+            updateMs = 0.0;
+            softwareMs[0] = softwareMs[1] = softwareMs[2] = 0.0;
+            softwareFrames = 0;
+        }
+
+        processInput(window);
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+        Frustum frustum = Frustum::FromMatrix(projection * view);
+        auto updateStart = chrono::steady_clock::now();
+        if(jobsEnabled){
+            //动画与剔除作为两个任务提交，剔除依赖动画的计数器，动画完成后才会开始，主线程等待时也参与执行任务
+            JobCounter animated, culled;
+            JobSystem::Get().Run([&](){
+                animateEntities(currentFrame, scene, meshBounds, transforms, lightSpaceMatrix, matrices, lightMatrices, bounds);
+            }, &animated);
+            JobSystem::Get().Run([&](){
+                cullEntities(frustum, scene, bounds, matrices, culler, cullScratch, chunkCounts, visible, visibleMatrices, visibleBatchStart);
+            }, &culled, &animated);
+            PROFILE_SCOPE("WaitJobs");
+            JobSystem::Get().Wait(culled);
+        }else{
+            animateEntities(currentFrame, scene, meshBounds, transforms, lightSpaceMatrix, matrices, lightMatrices, bounds);
+            cullEntities(frustum, scene, bounds, matrices, culler, cullScratch, chunkCounts, visible, visibleMatrices, visibleBatchStart);
+        }
+        updateMs += chrono::duration<double, milli>(chrono::steady_clock::now() - updateStart).count();
+        {
+            PROFILE_SCOPE("UploadInstances");
+            shadowInstances.Update(lightMatrices.data(), entityCount);
+            visibleInstances.Update(visibleMatrices.data(), static_cast<unsigned int>(visibleMatrices.size()));
+        }
+        if(softwareEnabled){
+            //CPU光栅化器与OpenGL使用同一份可见实例，关闭任务系统时也在单线程上执行
+            PROFILE_SCOPE("SoftwareRender");
+            softwareRasterizer.parallel = jobsEnabled;
+            softwareRasterizer.Begin(view, projection, camera.Position);
+            submitSoftwareBatches(scene, softwareAssets, modelLoaded, visibleMatrices, visibleBatchStart, softwareRasterizer);
+            softwareRasterizer.Execute();
+            glBindTexture(GL_TEXTURE_2D, softwareTexture);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, softwareRasterizer.Pixels());
+            softwareMs[0] += softwareRasterizer.Stats().geometryMs;
+            softwareMs[1] += softwareRasterizer.Stats().rasterMs;
+            softwareMs[2] += softwareRasterizer.Stats().resolveMs;
+            softwareFrames++;
+        }
+
+        //每帧重新声明渲染图：阴影 -> 场景 -> 泛光（提取亮部与多次模糊）-> 合成 -> 输出
+        //深度可视化pass每帧都声明，只有开启调试叠加时它的输出才会被读取，否则被图剔除
+        //使用CPU光栅化器时由SoftwareOutput代替输出pass，其余pass的结果没有被读取，全部被图剔除
+        graph.Reset();
+        graph.aliasingEnabled = aliasingEnabled;
+        RGResource backbuffer = graph.ImportBackbuffer(SCR_WIDTH, SCR_HEIGHT);
+
+        RGResource shadowMap = graph.CreateTexture("ShadowMap", shadowDesc);
+        graph.AddPass("Shadow", [&](RenderPassBuilder &builder){
+            builder.Write(shadowMap, true);
+        }, [&](const RenderPassContext &){
+            glEnable(GL_DEPTH_TEST);
+            glEnable(GL_POLYGON_OFFSET_FILL);
+            glPolygonOffset(2.0f, 4.0f);
+            shadowShader.use();
+            //实例矩阵已经乘过lightSpaceMatrix
+            shadowShader.setMat4("lightSpaceMatrix", glm::mat4(1.0f));
+            drawBatches(scene, shadowShader, cubeVAO, models, modelLoaded, materials, defaultMaterial, shadowInstances.matrixVBO, shadowBatchStart, false);
+            glDisable(GL_POLYGON_OFFSET_FILL);
+        });
+
+        RGResource sceneColor = graph.CreateTexture("SceneColor", hdrDesc);
+        RGResource sceneDepth = graph.CreateTexture("SceneDepth", depthDesc);
+        graph.AddPass("Scene", [&](RenderPassBuilder &builder){
+            builder.Read(shadowMap);
+            builder.Write(sceneColor, true);
+            builder.Write(sceneDepth, true);
+        }, [&](const RenderPassContext &context){
+            glEnable(GL_DEPTH_TEST);
+            objectShader.use();
+            objectShader.setVec3("viewPos", camera.Position);
+            objectShader.setMat4("view", view);
+            objectShader.setMat4("projection", projection);
+            objectShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(shadowMap));
+            drawBatches(scene, objectShader, cubeVAO, models, modelLoaded, materials, defaultMaterial, visibleInstances.matrixVBO, visibleBatchStart, true);
+
+            glowShader.use();
+            glowShader.setMat4("projection", projection);
+            glowShader.setMat4("view", view);
+            glBindVertexArray(lightCubeVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, pointLightCount);
+        });
+
+        //泛光：每次模糊都写入一个新的临时目标，生命周期错开的目标由图复用同一张纹理
+        RGResource bloomResult = -1;
+        if(bloomEnabled){
+            RGResource bright = graph.CreateTexture("Bright", bloomDesc);
+            graph.AddPass("BrightPass", [&](RenderPassBuilder &builder){
+                builder.Read(sceneColor);
+                builder.Write(bright);
+            }, [&](const RenderPassContext &context){
+                glDisable(GL_DEPTH_TEST);
+                brightShader.use();
+                brightShader.setInt("hdrBuffer", 0);
+                brightShader.setFloat("threshold", 1.0f);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.Texture(sceneColor));
+                glBindVertexArray(quadVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            });
+            RGResource current = bright;
+            for(int i = 0; i < blurIterations * 2; i++){
+                RGResource input = current;
+                RGResource output = graph.CreateTexture("Blur" + to_string(i), bloomDesc);
+                bool horizontal = i % 2 == 0;
+                graph.AddPass(horizontal ? "BlurH" : "BlurV", [input, output](RenderPassBuilder &builder){
+                    builder.Read(input);
+                    builder.Write(output);
+                }, [&, input, horizontal](const RenderPassContext &context){
+                    glDisable(GL_DEPTH_TEST);
+                    blurShader.use();
+                    blurShader.setInt("image", 0);
+                    blurShader.setBool("horizontal", horizontal);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, context.Texture(input));
+                    glBindVertexArray(quadVAO);
+                    glDrawArrays(GL_TRIANGLES, 0, 6);
+                });
+                current = output;
+            }
+            bloomResult = current;
+        }
+
+        RGResource ldr = graph.CreateTexture("LDR", ldrDesc);
+        graph.AddPass("Composite", [&](RenderPassBuilder &builder){
+            builder.Read(sceneColor);
+            if(bloomResult >= 0)
+                builder.Read(bloomResult);
+            builder.Write(ldr);
+        }, [&](const RenderPassContext &context){
+            glDisable(GL_DEPTH_TEST);
+            compositeShader.use();
+            compositeShader.setInt("hdrBuffer", 0);
+            compositeShader.setInt("bloomBuffer", 1);
+            compositeShader.setBool("bloom", bloomResult >= 0);
+            compositeShader.setFloat("bloomStrength", 0.6f);
+            compositeShader.setFloat("exposure", 1.2f);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(sceneColor));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, bloomResult >= 0 ? context.Texture(bloomResult) : 0);
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        });
+
+        RGResource depthView = graph.CreateTexture("DepthView", ldrDesc);
+        graph.AddPass("DepthView", [&](RenderPassBuilder &builder){
+            builder.Read(sceneDepth);
+            builder.Write(depthView);
+        }, [&](const RenderPassContext &context){
+            glDisable(GL_DEPTH_TEST);
+            depthViewShader.use();
+            depthViewShader.setInt("depthBuffer", 0);
+            depthViewShader.setFloat("nearPlane", NEAR_PLANE);
+            depthViewShader.setFloat("farPlane", FAR_PLANE);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, context.Texture(sceneDepth));
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        });
+
+        if(softwareEnabled){
+            graph.AddPass("SoftwareOutput", [&](RenderPassBuilder &builder){
+                builder.Write(backbuffer);
+            }, [&](const RenderPassContext &){
+                glDisable(GL_DEPTH_TEST);
+                postShader.use();
+                postShader.setInt("image", 0);
+                postShader.setFloat("vignette", 0.8f);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, softwareTexture);
+                glBindVertexArray(quadVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            });
+        }else{
+            graph.AddPass("Output", [&](RenderPassBuilder &builder){
+                builder.Read(ldr);
+                builder.Write(backbuffer);
+            }, [&](const RenderPassContext &context){
+                glDisable(GL_DEPTH_TEST);
+                postShader.use();
+                postShader.setInt("image", 0);
+                postShader.setFloat("vignette", 0.8f);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.Texture(ldr));
+                glBindVertexArray(quadVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            });
+        }
+
+        if(showDepth && !softwareEnabled){
+            graph.AddPass("DepthOverlay", [&](RenderPassBuilder &builder){
+                builder.Read(depthView);
+                builder.Write(backbuffer);
+            }, [&](const RenderPassContext &context){
+                //画在屏幕右上角
+                glViewport(context.width * 2 / 3, context.height * 2 / 3, context.width / 3, context.height / 3);
+                postShader.use();
+                postShader.setInt("image", 0);
+                postShader.setFloat("vignette", 0.0f);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, context.Texture(depthView));
+                glBindVertexArray(quadVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                glViewport(0, 0, context.width, context.height);
+            });
+        }
+
+        graph.Compile();
+        {
+            PROFILE_SCOPE("Execute");
+            graph.Execute();
+        }
+
+        //图的结构变化时在控制台输出pass顺序与纹理分配
+        int config = (bloomEnabled ? 1 : 0) | (showDepth ? 2 : 0) | (aliasingEnabled ? 4 : 0) | (softwareEnabled ? 8 : 0) | (blurIterations << 4);
+        if(config != lastConfig){
+            cout << "Render graph:" << endl << graph.Describe();
+            lastConfig = config;
+        }
+
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+    }
+    glDeleteVertexArrays(1, &cubeVAO);
+    glDeleteVertexArrays(1, &lightCubeVAO);
+    glDeleteVertexArrays(1, &quadVAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &quadVBO);
+    shadowInstances.Release();
+    visibleInstances.Release();
+    lightCubes.Release();
+    glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    glDeleteTextures(1, &defaultMaterial.diffuse);
+    glDeleteTextures(1, &defaultMaterial.specular);
+    glDeleteTextures(1, &softwareTexture);
+    graph.Release();
+    Profiler::Get().Release();
+    JobSystem::Get().Shutdown();
+
+    glfwTerminate();
+
+    return 0;
+}
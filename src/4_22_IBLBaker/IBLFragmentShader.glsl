@@ -0,0 +1,62 @@
+#version 330 core
+in vec3 WorldPos;
+in vec3 Normal;
+out vec4 FragColor;
+
+//金属度-粗糙度工作流的材质参数
+uniform vec3 albedo;
+uniform float metallic;
+uniform float roughness;
+
+//预计算的IBL：漫反射为9个球谐系数（辐照度除以π），镜面反射为预过滤的立方体贴图与BRDF积分表
+uniform vec3 sh[9];
+uniform samplerCube prefilterMap;
+uniform sampler2D brdfLUT;
+uniform float maxReflectionLod;
+
+uniform vec3 camPos;
+uniform float exposure;
+
+//与IBLBaker.h中evaluateSH的基函数顺序相同
+vec3 irradianceSH(vec3 n)
+{
+    vec3 result = sh[0] * 0.282095
+        + sh[1] * 0.488603 * n.y
+        + sh[2] * 0.488603 * n.z
+        + sh[3] * 0.488603 * n.x
+        + sh[4] * 1.092548 * n.x * n.y
+        + sh[5] * 1.092548 * n.y * n.z
+        + sh[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + sh[7] * 1.092548 * n.x * n.z
+        + sh[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
+vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
+{
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+void main()
+{
+    vec3 N = normalize(Normal);
+    vec3 V = normalize(camPos - WorldPos);
+    vec3 R = reflect(-V, N);
+    float NdotV = max(dot(N, V), 0.0);
+
+    //非金属的F0统一取0.04，金属的F0就是反照率
+    vec3 F0 = mix(vec3(0.04), albedo, metallic);
+    vec3 F = fresnelSchlickRoughness(NdotV, F0, roughness);
+    vec3 kD = (1.0 - F) * (1.0 - metallic);
+    vec3 diffuse = irradianceSH(N) * albedo;
+
+    //split-sum：预过滤的环境光乘以BRDF积分表给出的F0系数与偏移
+    vec3 prefiltered = textureLod(prefilterMap, R, roughness * maxReflectionLod).rgb;
+    vec2 brdf = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+    vec3 specular = prefiltered * (F * brdf.x + brdf.y);
+
+    vec3 color = kD * diffuse + specular;
+    //曝光色调映射后做伽马校正
+    vec3 mapped = vec3(1.0) - exp(-color * exposure);
+    FragColor = vec4(pow(mapped, vec3(1.0 / 2.2)), 1.0);
+}
@@ -0,0 +1,311 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <string>
+#include "Profiler.h"
+using namespace std;
+
+struct JobCounter;
+
+//任务：要执行的函数，以及执行完成后要减一的计数器
+struct Job {
+    function<void()> func;
+    JobCounter *counter = nullptr;
+};
+
+//任务计数器：每提交一个任务加一，任务完成后减一，归零表示这一组任务全部完成
+//也可以作为其它任务的依赖，依赖它的任务先挂在waiting中，计数归零时才被放入队列
+//计数器必须比关联的任务活得久，通常放在调用Wait的函数栈上
+struct JobCounter {
+    atomic<int> value{0};
+    mutex waitMutex;
+    vector<Job> waiting;
+
+    bool Done() const{
+        return value.load() == 0;
+    }
+};
+
+//任务系统统计，所有线程累加
+struct JobSystemStats {
+    unsigned long long jobs = 0;//执行的任务数
+    unsigned long long steals = 0;//从其它线程队列中偷到的任务数
+};
+
+//工作窃取任务系统：每个线程（主线程为0号，工作线程为1~N）有自己的双端队列
+//线程向自己队列的尾部提交任务并从尾部取出（后进先出，刚拆分出的数据还在缓存里），
+//自己的队列空了之后从其它线程队列的头部偷任务（先进先出，偷到的是最早拆分出的大块任务）
+//主线程在Wait中也会执行任务，而不是阻塞等待
+//每个队列用各自的锁保护：线程大部分时间只访问自己的队列，锁几乎没有竞争
+class JobSystem {
+public:
+    static JobSystem &Get(){
+        static JobSystem instance;
+        return instance;
+    }
+
+    //启动工作线程，workerCount为负数时使用 硬件线程数-1 个工作线程（主线程也参与执行），为0时只有主线程
+    //必须在主线程调用，可以先Shutdown再用不同的线程数重新Init
+    void Init(int workerCount = -1){
+        Shutdown();
+        if(workerCount < 0){
+            unsigned int hardware = thread::hardware_concurrency();
+            workerCount = hardware > 1 ? static_cast<int>(hardware) - 1 : 0;
+        }
+        queues.clear();
+        for(int i = 0; i < workerCount + 1; i++)
+            queues.push_back(unique_ptr<WorkQueue>(new WorkQueue()));
+        threadIndex() = 0;
+        //在启动工作线程之前先登记主线程，否则分析器可能由第一个工作线程创建，把它当作主线程
+        Profiler::Get().SetThreadName("Main");
+        running = true;
+        for(int i = 1; i <= workerCount; i++)
+            workers.push_back(thread(&JobSystem::workerMain, this, static_cast<unsigned int>(i)));
+    }
+
+    //等待已经提交的任务执行完之后结束工作线程
+    void Shutdown(){
+        if(workers.empty())
+            return;
+        while(pendingJobs.load() > 0){
+            Job job;
+            if(tryGetJob(0, job))
+                execute(0, job);
+            else
+                this_thread::yield();
+        }
+        {
+            lock_guard<mutex> lock(sleepMutex);
+            running = false;
+        }
+        wakeup.notify_all();
+        for(unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+        workers.clear();
+    }
+
+    //参与执行任务的线程数（工作线程 + 主线程）
+    unsigned int ThreadCount() const{
+        return static_cast<unsigned int>(queues.size());
+    }
+
+    //提交任务，counter不为空时任务完成后计数减一
+    //dependency不为空且还没有归零时，任务等到它归零后才会被执行
+    void Run(function<void()> func, JobCounter *counter = nullptr, JobCounter *dependency = nullptr){
+        Job job;
+        job.func = move(func);
+        job.counter = counter;
+        if(counter != nullptr)
+            counter->value.fetch_add(1);
+        //没有工作线程（或还没有Init）时直接在当前线程执行
+        if(queues.size() <= 1 && (dependency == nullptr || dependency->Done())){
+            execute(0, job);
+            return;
+        }
+        if(dependency != nullptr && !dependency->Done()){
+            lock_guard<mutex> lock(dependency->waitMutex);
+            //加锁后再检查一次，归零的一方会在加锁后取走waiting
+            if(!dependency->Done()){
+                dependency->waiting.push_back(move(job));
+                return;
+            }
+        }
+        push(move(job));
+    }
+
+    //等待计数器归零，等待期间当前线程也执行队列中的任务
+    void Wait(JobCounter &counter){
+        int index = currentIndex();
+        while(!counter.Done()){
+            Job job;
+            if(tryGetJob(index, job))
+                execute(index, job);
+            else
+                this_thread::yield();
+        }
+        //等最后一个完成的任务释放计数器的锁之后再返回，调用方返回后通常会销毁计数器
+        lock_guard<mutex> lock(counter.waitMutex);
+    }
+
+    //把[0, count)拆成不大于grainSize的连续区间并行执行func(begin, end)，返回时全部区间都已完成
+    //区间按二分递归拆分：拆出的后一半作为新任务提交，前一半继续拆分，最后剩下的一段由当前任务执行
+    //这样最早提交、最容易被偷走的是最大的区间，偷到的线程再接着拆分，任务数只有log级别的串行提交
+    void ParallelFor(unsigned int count, unsigned int grainSize, const function<void(unsigned int, unsigned int)> &func){
+        if(count == 0)
+            return;
+        grainSize = grainSize == 0 ? 1 : grainSize;
+        if(count <= grainSize || queues.size() <= 1){
+            func(0, count);
+            return;
+        }
+        JobCounter counter;
+        parallelRange(0, count, grainSize, func, counter);
+        Wait(counter);
+    }
+
+    //取出统计并清零
+    JobSystemStats TakeStats(){
+        JobSystemStats result;
+        for(unsigned int i = 0; i < queues.size(); i++){
+            result.jobs += queues[i]->executed.exchange(0);
+            result.steals += queues[i]->steals.exchange(0);
+        }
+        return result;
+    }
+
+    ~JobSystem(){
+        Shutdown();
+    }
+
+private:
+    //每个线程的任务队列，按缓存行对齐，避免不同线程的队列与统计落在同一缓存行上
+    struct alignas(64) WorkQueue {
+        mutex queueMutex;
+        deque<Job> jobs;
+        atomic<unsigned long long> executed{0};
+        atomic<unsigned long long> steals{0};
+    };
+
+    vector<unique_ptr<WorkQueue>> queues;
+    vector<thread> workers;
+    atomic<int> pendingJobs{0};//所有队列中的任务数
+    atomic<int> sleeping{0};//正在休眠的工作线程数
+    mutex sleepMutex;
+    condition_variable wakeup;
+    bool running = false;
+
+    //当前线程在queues中的下标，不属于任务系统的线程为-1
+    static int &threadIndex(){
+        static thread_local int index = -1;
+        return index;
+    }
+
+    int currentIndex() const{
+        int index = threadIndex();
+        return index >= 0 && index < static_cast<int>(queues.size()) ? index : 0;
+    }
+
+    void push(Job job){
+        WorkQueue &queue = *queues[currentIndex()];
+        {
+            lock_guard<mutex> lock(queue.queueMutex);
+            queue.jobs.push_back(move(job));
+        }
+        pendingJobs.fetch_add(1);
+        //有线程在休眠时才需要唤醒，加锁保证不会在对方检查条件之后、开始等待之前通知
+        if(sleeping.load() > 0){
+            { lock_guard<mutex> lock(sleepMutex); }
+            wakeup.notify_one();
+        }
+    }
+
+    //先从自己队列的尾部取，再从其它线程队列的头部偷
+    bool tryGetJob(int index, Job &job){
+        WorkQueue &own = *queues[index];
+        {
+            lock_guard<mutex> lock(own.queueMutex);
+            if(!own.jobs.empty()){
+                job = move(own.jobs.back());
+                own.jobs.pop_back();
+                pendingJobs.fetch_sub(1);
+                return true;
+            }
+        }
+        unsigned int count = static_cast<unsigned int>(queues.size());
+        //从随机的位置开始尝试，避免所有线程都去偷同一个队列
+        thread_local unsigned int seed = 0x9E3779B9u ^ static_cast<unsigned int>(index * 0x85EBCA6Bu);
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        for(unsigned int i = 0; i < count; i++){
+            unsigned int victim = (seed + i) % count;
+            if(victim == static_cast<unsigned int>(index))
+                continue;
+            WorkQueue &queue = *queues[victim];
+            lock_guard<mutex> lock(queue.queueMutex);
+            if(!queue.jobs.empty()){
+                job = move(queue.jobs.front());
+                queue.jobs.pop_front();
+                pendingJobs.fetch_sub(1);
+                own.steals.fetch_add(1, memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void execute(int index, Job &job){
+        job.func();
+        if(index < static_cast<int>(queues.size()))
+            queues[index]->executed.fetch_add(1, memory_order_relaxed);
+        if(job.counter != nullptr)
+            finish(*job.counter);
+    }
+
+    //任务完成，计数器减一
+    //不是最后一个任务时直接减一，之后不再访问计数器；可能是最后一个时加锁减一，
+    //归零的同时取走依赖它的任务，Wait返回前也会加一次锁，保证这里解锁之后计数器才可能被销毁
+    void finish(JobCounter &counter){
+        int value = counter.value.load();
+        while(value > 1){
+            if(counter.value.compare_exchange_weak(value, value - 1))
+                return;
+        }
+        vector<Job> released;
+        {
+            lock_guard<mutex> lock(counter.waitMutex);
+            if(counter.value.fetch_sub(1) == 1)
+                released.swap(counter.waiting);
+        }
+        for(unsigned int i = 0; i < released.size(); i++)
+            push(move(released[i]));
+    }
+
+    void parallelRange(unsigned int begin, unsigned int end, unsigned int grainSize, const function<void(unsigned int, unsigned int)> &func, JobCounter &counter){
+        while(end - begin > grainSize){
+            unsigned int middle = begin + (end - begin) / 2;
+            unsigned int last = end;
+            Run([this, middle, last, grainSize, &func, &counter](){
+                parallelRange(middle, last, grainSize, func, counter);
+            }, &counter);
+            end = middle;
+        }
+        func(begin, end);
+    }
+
+    void workerMain(unsigned int index){
+        threadIndex() = static_cast<int>(index);
+        Profiler::Get().SetThreadName("Worker " + to_string(index));
+        unsigned int idle = 0;
+        while(true){
+            Job job;
+            if(tryGetJob(static_cast<int>(index), job)){
+                execute(static_cast<int>(index), job);
+                idle = 0;
+                continue;
+            }
+            //短暂自旋后再休眠，连续的小任务之间不必每次都经过操作系统唤醒
+            if(++idle < 64){
+                this_thread::yield();
+                continue;
+            }
+            unique_lock<mutex> lock(sleepMutex);
+            sleeping.fetch_add(1);
+            wakeup.wait(lock, [this](){ return !running || pendingJobs.load() > 0; });
+            sleeping.fetch_sub(1);
+            if(!running)
+                break;
+            idle = 0;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,14 @@
+#version 330 core
+in vec3 TexCoords;
+out vec4 FragColor;
+
+uniform samplerCube environmentMap;
+uniform float lod;//大于0时显示预过滤贴图的某一级
+uniform float exposure;
+
+void main()
+{
+    vec3 color = textureLod(environmentMap, TexCoords, lod).rgb;
+    vec3 mapped = vec3(1.0) - exp(-color * exposure);
+    FragColor = vec4(pow(mapped, vec3(1.0 / 2.2)), 1.0);
+}
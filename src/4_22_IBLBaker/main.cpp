@@ -0,0 +1,509 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "IBLBaker.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_22_IBLBaker/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+CustomCamera camera(glm::vec3(0.0f, 0.0f, 24.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//球体排成网格：每行金属度相同，每列粗糙度相同
+const int SPHERE_ROWS = 7;
+const int SPHERE_COLUMNS = 7;
+const float SPHERE_SPACING = 2.5f;
+const unsigned int SPHERE_SEGMENTS = 64;
+const float EXPOSURE = 1.5f;
+//预计算结果的缓存，每个环境一个文件，BRDF积分表所有环境共用
+const string CACHE_DIRECTORY = "./output/";
+const string BRDF_CACHE = CACHE_DIRECTORY + "ibl_brdf.bin";
+
+int currentEnvironment = 0;
+int backgroundLevel = -1;//-1显示原始环境贴图，0~IBL_SPECULAR_LEVELS-1显示预过滤贴图的一级
+bool rebakeRequested = false;
+bool jobsEnabled = true;
+bool environmentKeyDown = false;
+bool backgroundKeyDown = false;
+bool rebakeKeyDown = false;
+bool jobsKeyDown = false;
+bool traceKeyDown = false;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window, int environmentCount){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //E键切换环境，V键让背景依次显示原始环境与预过滤的各级，B键忽略缓存重新烘焙当前环境，J键在任务系统与单线程之间切换
+    bool key = glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
+    if(key && !environmentKeyDown)
+        currentEnvironment = (currentEnvironment + 1) % environmentCount;
+    environmentKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS;
+    if(key && !backgroundKeyDown)
+        backgroundLevel = backgroundLevel + 1 < IBL_SPECULAR_LEVELS ? backgroundLevel + 1 : -1;
+    backgroundKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+    if(key && !rebakeKeyDown)
+        rebakeRequested = true;
+    rebakeKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS;
+    if(key && !jobsKeyDown)
+        jobsEnabled = !jobsEnabled;
+    jobsKeyDown = key;
+    //T键导出最近的帧为Chrome trace，并在控制台输出各作用域的平均耗时
+    key = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+    if(key && !traceKeyDown){
+        Profiler::Get().ExportChromeTrace("./output/profile_trace.json");
+        vector<ProfileSummary> summary = Profiler::Get().Summarize();
+        cout << left << setw(28) << "scope" << right << setw(10) << "cpu ms" << setw(10) << "gpu ms" << setw(8) << "calls" << endl;
+        cout << fixed << setprecision(3);
+        for(unsigned int i = 0; i < summary.size(); i++)
+            cout << left << setw(28) << summary[i].name << right << setw(10) << summary[i].cpuMs << setw(10) << summary[i].gpuMs << setw(8) << summary[i].calls << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+    }
+    traceKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+//环境贴图的6个面，按 +X -X +Y -Y +Z -Z 的顺序
+struct EnvironmentSource {
+    string name;
+    vector<string> faces;
+};
+
+vector<EnvironmentSource> environmentSources(){
+    vector<EnvironmentSource> sources(2);
+    sources[0].name = "Park3Med";
+    sources[0].faces = {"px.jpg", "nx.jpg", "py.jpg", "ny.jpg", "pz.jpg", "nz.jpg"};
+    sources[1].name = "skybox";
+    sources[1].faces = {"right.jpg", "left.jpg", "top.jpg", "bottom.jpg", "front.jpg", "back.jpg"};
+    for(unsigned int i = 0; i < sources.size(); i++){
+        for(unsigned int f = 0; f < 6; f++)
+            sources[i].faces[f] = "./static/texture/" + sources[i].name + "/" + sources[i].faces[f];
+    }
+    return sources;
+}
+
+string environmentCache(const EnvironmentSource &source){
+    return CACHE_DIRECTORY + source.name + "_ibl.bin";
+}
+
+//一个环境在GPU上的资源，第一次切换到这个环境时才加载
+struct EnvironmentResources {
+    bool loaded = false;
+    unsigned int skybox = 0;
+    unsigned int prefilter = 0;
+    glm::vec3 sh[9];
+    double decodeMs = 0.0;
+    IBLBakeStats stats;
+};
+
+//原始环境作为天空盒，面是sRGB的JPEG，用GL_SRGB8让采样结果在线性空间
+unsigned int uploadSkybox(const CubeFaces &faces){
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for(int f = 0; f < 6; f++)
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, GL_SRGB8, faces.size, faces.size, 0, GL_RGB, GL_UNSIGNED_BYTE, faces.data[f]);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+//预过滤的各级直接作为立方体贴图的mipmap上传
+unsigned int uploadPrefilter(const IBLEnvironment &environment){
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for(unsigned int level = 0; level < environment.specular.size(); level++){
+        const CubeLevel &cube = environment.specular[level];
+        for(int f = 0; f < 6; f++)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, level, GL_RGB16F, cube.size, cube.size, 0, GL_RGBA, GL_FLOAT, cube.Face(f));
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, static_cast<int>(environment.specular.size()) - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+unsigned int uploadBRDF(const IBLBRDFTable &table){
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, table.size, table.size, 0, GL_RG, GL_FLOAT, table.texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+void printBakeStats(const string &name, double decodeMs, const IBLBakeStats &stats){
+    cout << name << ": decoded in " << decodeMs << " ms, ";
+    if(stats.fromCache)
+        cout << "IBL loaded from cache in " << stats.cacheMs << " ms" << endl;
+    else
+        cout << "IBL baked in " << stats.sourceMs + stats.shMs + stats.specularMs << " ms (source " << stats.sourceMs << " ms, SH "
+            << stats.shMs << " ms, specular " << stats.specularMs << " ms)" << endl;
+}
+
+//解码6个面作为天空盒上传，再读取缓存或烘焙IBL；force为true时忽略缓存
+bool loadEnvironment(const EnvironmentSource &source, IBLBaker &baker, EnvironmentResources &resources, bool force){
+    PROFILE_SCOPE("Load " + source.name);
+    auto start = chrono::steady_clock::now();
+    CubeFaces faces;
+    if(!DecodeCubeFaces(source.faces, faces, jobsEnabled))
+        return false;
+    resources.decodeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    IBLEnvironment environment;
+    baker.parallel = jobsEnabled;
+    if(!baker.LoadOrBake(source.faces, faces, environmentCache(source), environment, force))
+        return false;
+    resources.stats = baker.stats;
+    if(resources.skybox != 0)
+        glDeleteTextures(1, &resources.skybox);
+    if(resources.prefilter != 0)
+        glDeleteTextures(1, &resources.prefilter);
+    resources.skybox = uploadSkybox(faces);
+    resources.prefilter = uploadPrefilter(environment);
+    for(int i = 0; i < 9; i++)
+        resources.sh[i] = environment.sh[i];
+    resources.loaded = true;
+    printBakeStats(source.name, resources.decodeMs, resources.stats);
+    return true;
+}
+
+//不创建窗口，忽略缓存重新烘焙所有环境与BRDF积分表并写入缓存，输出各阶段的耗时
+int bakeAll(){
+    IBLBaker baker;
+    vector<EnvironmentSource> sources = environmentSources();
+    cout << "IBL bake: " << JobSystem::Get().ThreadCount() << " threads, source " << IBL_SOURCE_SIZE << ", specular " << IBL_SPECULAR_SIZE << " x "
+        << IBL_SPECULAR_LEVELS << " levels, " << IBL_SPECULAR_SAMPLES << " samples" << endl;
+    cout << left << setw(12) << "environment" << right << setw(10) << "decode" << setw(10) << "source" << setw(10) << "SH" << setw(10) << "specular"
+        << setw(10) << "cache KB" << setw(10) << "reload" << endl;
+    cout << fixed << setprecision(2);
+    for(unsigned int i = 0; i < sources.size(); i++){
+        auto start = chrono::steady_clock::now();
+        CubeFaces faces;
+        if(!DecodeCubeFaces(sources[i].faces, faces, true))
+            return -1;
+        double decodeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        IBLEnvironment environment;
+        string cache = environmentCache(sources[i]);
+        baker.LoadOrBake(sources[i].faces, faces, cache, environment, true);
+        IBLBakeStats bakeStats = baker.stats;
+        //再从刚写入的缓存读取一次，对比启动时的开销
+        ifstream file(cache.c_str(), ios::binary | ios::ate);
+        double cacheKB = file.is_open() ? static_cast<double>(file.tellg()) / 1024.0 : 0.0;
+        baker.LoadOrBake(sources[i].faces, faces, cache, environment, false);
+        cout << left << setw(12) << sources[i].name << right << setw(10) << decodeMs << setw(10) << bakeStats.sourceMs << setw(10) << bakeStats.shMs
+            << setw(10) << bakeStats.specularMs << setw(10) << cacheKB << setw(10) << baker.stats.cacheMs << endl;
+    }
+    IBLBRDFTable table;
+    baker.LoadOrBakeBRDF(BRDF_CACHE, table, true);
+    cout << "BRDF LUT " << IBL_BRDF_SIZE << "x" << IBL_BRDF_SIZE << ", " << IBL_BRDF_SAMPLES << " samples: " << baker.stats.brdfMs << " ms" << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+    return 0;
+}
+
+//UV球：经线与纬线各segments段，单位球上的法线就是位置，顶点格式为 位置3 法线3
+void buildSphere(unsigned int segments, vector<float> &vertices, vector<unsigned int> &indices){
+    for(unsigned int y = 0; y <= segments; y++){
+        for(unsigned int x = 0; x <= segments; x++){
+            float u = static_cast<float>(x) / segments, v = static_cast<float>(y) / segments;
+            float theta = v * glm::pi<float>(), phi = u * glm::two_pi<float>();
+            glm::vec3 p(cos(phi) * sin(theta), cos(theta), sin(phi) * sin(theta));
+            vertices.insert(vertices.end(), {p.x, p.y, p.z, p.x, p.y, p.z});
+        }
+    }
+    for(unsigned int y = 0; y < segments; y++){
+        for(unsigned int x = 0; x < segments; x++){
+            unsigned int i0 = y * (segments + 1) + x, i1 = i0 + segments + 1;
+            indices.insert(indices.end(), {i0, i0 + 1, i1, i1, i0 + 1, i1 + 1});
+        }
+    }
+}
+
+int main(int argc, char *argv[]){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    //--threads N指定参与执行任务的线程数，默认为硬件线程数
+    //--bake  不创建窗口，重新烘焙所有环境并写入缓存
+    int threads = 0;
+    bool bake = false;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--threads" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(arg == "--bake")
+            bake = true;
+    }
+    JobSystem::Get().Init(threads > 0 ? threads - 1 : -1);
+    if(bake){
+        int result = bakeAll();
+        JobSystem::Get().Shutdown();
+        return result;
+    }
+    cout << "Job system: " << JobSystem::Get().ThreadCount() << " threads" << endl;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 8.0f;
+    Profiler::Get().InitGPU();
+    glEnable(GL_DEPTH_TEST);
+    //天空盒的深度为1，需要GL_LEQUAL才能通过深度测试
+    glDepthFunc(GL_LEQUAL);
+    //立方体贴图在面的边缘跨面过滤，预过滤的低分辨率级别不会出现接缝
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    CustomShader iblShader((Path + "IBLVertexShader.glsl").c_str(), (Path + "IBLFragmentShader.glsl").c_str());
+    CustomShader skyboxShader((Path + "SkyboxVertexShader.glsl").c_str(), (Path + "SkyboxFragmentShader.glsl").c_str());
+
+    vector<float> sphereVertices;
+    vector<unsigned int> sphereIndices;
+    buildSphere(SPHERE_SEGMENTS, sphereVertices, sphereIndices);
+    unsigned int sphereVAO, sphereVBO, sphereEBO;
+    glGenVertexArrays(1, &sphereVAO);
+    glGenBuffers(1, &sphereVBO);
+    glGenBuffers(1, &sphereEBO);
+    glBindVertexArray(sphereVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER, sphereVertices.size() * sizeof(float), sphereVertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereIndices.size() * sizeof(unsigned int), sphereIndices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    float skyboxVertices[] = {
+        -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f,
+        -1.0f, -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f,  1.0f,
+         1.0f, -1.0f, -1.0f,  1.0f, -1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f, -1.0f,
+        -1.0f, -1.0f,  1.0f, -1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,
+        -1.0f,  1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f,
+        -1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f
+    };
+    unsigned int skyboxVAO, skyboxVBO;
+    glGenVertexArrays(1, &skyboxVAO);
+    glGenBuffers(1, &skyboxVBO);
+    glBindVertexArray(skyboxVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), skyboxVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    //BRDF积分表与环境无关，启动时读取一次
+    IBLBaker baker;
+    IBLBRDFTable brdfTable;
+    baker.LoadOrBakeBRDF(BRDF_CACHE, brdfTable);
+    cout << "BRDF LUT " << (baker.stats.fromCache ? "loaded from cache in " + to_string(baker.stats.cacheMs) : "baked in " + to_string(baker.stats.brdfMs))
+        << " ms" << endl;
+    unsigned int brdfTexture = uploadBRDF(brdfTable);
+
+    vector<EnvironmentSource> sources = environmentSources();
+    vector<EnvironmentResources> environments(sources.size());
+    int loadedEnvironment = -1;
+
+    iblShader.use();
+    iblShader.setInt("prefilterMap", 0);
+    iblShader.setInt("brdfLUT", 1);
+    iblShader.setFloat("maxReflectionLod", static_cast<float>(IBL_SPECULAR_LEVELS - 1));
+    iblShader.setFloat("exposure", EXPOSURE);
+    skyboxShader.use();
+    skyboxShader.setInt("environmentMap", 0);
+    skyboxShader.setFloat("exposure", EXPOSURE);
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    while (!glfwWindowShouldClose(window)){
+        Profiler::Get().BeginFrame();
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        processInput(window, static_cast<int>(sources.size()));
+
+        //第一次使用某个环境时加载，B键请求的重新烘焙也在这里进行
+        EnvironmentResources &environment = environments[currentEnvironment];
+        if(!environment.loaded || rebakeRequested){
+            if(!loadEnvironment(sources[currentEnvironment], baker, environment, rebakeRequested) && !environment.loaded){
+                glfwTerminate();
+                JobSystem::Get().Shutdown();
+                return -1;
+            }
+            rebakeRequested = false;
+            loadedEnvironment = -1;
+        }
+        if(loadedEnvironment != currentEnvironment){
+            iblShader.use();
+            for(int i = 0; i < 9; i++)
+                iblShader.setVec3("sh[" + to_string(i) + "]", environment.sh[i]);
+            loadedEnvironment = currentEnvironment;
+        }
+
+        //显示平均帧时间与当前环境的加载方式
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            const IBLBakeStats &stats = environment.stats;
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame - " + sources[currentEnvironment].name + ": "
+                + (stats.fromCache ? "IBL cache " + to_string(stats.cacheMs) + " ms"
+                    : "baked " + to_string(stats.sourceMs + stats.shMs + stats.specularMs) + " ms ("
+                    + (jobsEnabled ? to_string(JobSystem::Get().ThreadCount()) + " threads)" : string("single thread)")))
+                + ", decode " + to_string(environment.decodeMs) + " ms - background: "
+                + (backgroundLevel < 0 ? string("source") : "prefiltered level " + to_string(backgroundLevel))
+                + " - E: environment, V: background, B: rebake, J: jobs, T: export trace";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+        }
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        {
+            PROFILE_PASS("Spheres");
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            iblShader.use();
+            iblShader.setMat4("view", view);
+            iblShader.setMat4("projection", projection);
+            iblShader.setVec3("camPos", camera.Position);
+            iblShader.setVec3("albedo", 0.9f, 0.6f, 0.3f);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, environment.prefilter);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, brdfTexture);
+            glBindVertexArray(sphereVAO);
+            for(int row = 0; row < SPHERE_ROWS; row++){
+                iblShader.setFloat("metallic", static_cast<float>(row) / (SPHERE_ROWS - 1));
+                for(int column = 0; column < SPHERE_COLUMNS; column++){
+                    //粗糙度为0时镜面高光退化为一个点，从0.05开始
+                    iblShader.setFloat("roughness", glm::clamp(static_cast<float>(column) / (SPHERE_COLUMNS - 1), 0.05f, 1.0f));
+                    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((column - (SPHERE_COLUMNS - 1) * 0.5f) * SPHERE_SPACING,
+                        (row - (SPHERE_ROWS - 1) * 0.5f) * SPHERE_SPACING, 0.0f));
+                    iblShader.setMat4("model", model);
+                    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(sphereIndices.size()), GL_UNSIGNED_INT, 0);
+                }
+            }
+        }
+        {
+            PROFILE_PASS("Skybox");
+            skyboxShader.use();
+            skyboxShader.setMat4("view", view);
+            skyboxShader.setMat4("projection", projection);
+            skyboxShader.setFloat("lod", backgroundLevel < 0 ? 0.0f : static_cast<float>(backgroundLevel));
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, backgroundLevel < 0 ? environment.skybox : environment.prefilter);
+            glBindVertexArray(skyboxVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
+
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+    }
+    for(unsigned int i = 0; i < environments.size(); i++){
+        glDeleteTextures(1, &environments[i].skybox);
+        glDeleteTextures(1, &environments[i].prefilter);
+    }
+    glDeleteTextures(1, &brdfTexture);
+    glDeleteVertexArrays(1, &sphereVAO);
+    glDeleteVertexArrays(1, &skyboxVAO);
+    glDeleteBuffers(1, &sphereVBO);
+    glDeleteBuffers(1, &sphereEBO);
+    glDeleteBuffers(1, &skyboxVBO);
+    Profiler::Get().Release();
+    JobSystem::Get().Shutdown();
+
+    glfwTerminate();
+
+    return 0;
+}
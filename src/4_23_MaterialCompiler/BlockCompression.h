@@ -0,0 +1,219 @@
+#ifndef BLOCKCOMPRESSION_H
+#define BLOCKCOMPRESSION_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "JobSystem.h"
+using namespace std;
+
+//块压缩（BC）的CPU编码器：图像分成4x4的块，每块用两个端点加每像素的插值下标表示，GPU采样时硬件解压
+//  BC1：RGB，每块8字节（每像素4位），端点为RGB565，端点之间插出4种颜色
+//  BC4：单通道，每块8字节，端点为8位，端点之间插出8个值，适合粗糙度这类标量贴图
+//  BC5：两个BC4块，每块16字节，适合法线贴图的xy与两个标量通道
+//编码器只追求“足够好”：BC1用主成分方向确定端点，BC4直接取最小最大值，没有迭代优化
+enum BlockFormat {
+    BLOCK_BC1 = 1,
+    BLOCK_BC4 = 2,
+    BLOCK_BC5 = 3
+};
+
+inline unsigned int BlockBytes(BlockFormat format){
+    return format == BLOCK_BC5 ? 16 : 8;
+}
+
+//尺寸不是4的倍数时最后一行（列）块只用到一部分，数据量按向上取整的块数计算
+inline size_t CompressedSize(BlockFormat format, int width, int height){
+    return static_cast<size_t>((width + 3) / 4) * static_cast<size_t>((height + 3) / 4) * BlockBytes(format);
+}
+
+inline uint16_t packRGB565(const float *color){
+    int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((min(max(r, 0), 31) << 11) | (min(max(g, 0), 63) << 5) | min(max(b, 0), 31));
+}
+
+//把565扩展回8位，低位用高位填充，与硬件解码一致
+inline void unpackRGB565(uint16_t packed, int *color){
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+//pixels为16个RGBA像素（按行存放），只使用RGB
+void EncodeBC1Block(const unsigned char *pixels, unsigned char *block){
+    //求颜色的均值与协方差，主成分方向用幂迭代求得
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for(int i = 0; i < 16; i++){
+        for(int c = 0; c < 3; c++)
+            mean[c] += pixels[i * 4 + c];
+    }
+    for(int c = 0; c < 3; c++)
+        mean[c] /= 16.0f;
+    float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};//rr rg rb gg gb bb
+    for(int i = 0; i < 16; i++){
+        float d[3] = {pixels[i * 4] - mean[0], pixels[i * 4 + 1] - mean[1], pixels[i * 4 + 2] - mean[2]};
+        covariance[0] += d[0] * d[0]; covariance[1] += d[0] * d[1]; covariance[2] += d[0] * d[2];
+        covariance[3] += d[1] * d[1]; covariance[4] += d[1] * d[2]; covariance[5] += d[2] * d[2];
+    }
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for(int iteration = 0; iteration < 4; iteration++){
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+        float length = max(max(fabs(next[0]), fabs(next[1])), fabs(next[2]));
+        if(length < 1e-6f)
+            break;
+        for(int c = 0; c < 3; c++)
+            axis[c] = next[c] / length;
+    }
+    //像素在主方向上的投影范围就是两个端点
+    float minT = 1e30f, maxT = -1e30f;
+    for(int i = 0; i < 16; i++){
+        float t = (pixels[i * 4] - mean[0]) * axis[0] + (pixels[i * 4 + 1] - mean[1]) * axis[1] + (pixels[i * 4 + 2] - mean[2]) * axis[2];
+        minT = min(minT, t);
+        maxT = max(maxT, t);
+    }
+    float lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float endpoint0[3], endpoint1[3];
+    for(int c = 0; c < 3; c++){
+        endpoint0[c] = min(max(mean[c] + axis[c] * maxT / lengthSquared, 0.0f), 255.0f);
+        endpoint1[c] = min(max(mean[c] + axis[c] * minT / lengthSquared, 0.0f), 255.0f);
+    }
+    uint16_t color0 = packRGB565(endpoint0), color1 = packRGB565(endpoint1);
+    //color0 > color1时为4色模式，相等时只能用3色模式，全部取第0种颜色
+    if(color0 < color1)
+        swap(color0, color1);
+    uint32_t indices = 0;
+    if(color0 != color1){
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for(int c = 0; c < 3; c++){
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for(int i = 0; i < 16; i++){
+            int best = 0, bestError = 1 << 30;
+            for(int p = 0; p < 4; p++){
+                int dr = pixels[i * 4] - palette[p][0], dg = pixels[i * 4 + 1] - palette[p][1], db = pixels[i * 4 + 2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if(error < bestError){
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (i * 2);
+        }
+    }
+    block[0] = color0 & 0xFF; block[1] = color0 >> 8;
+    block[2] = color1 & 0xFF; block[3] = color1 >> 8;
+    for(int i = 0; i < 4; i++)
+        block[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+//values为16个像素的同一通道，stride为相邻像素间隔的字节数
+void EncodeBC4Block(const unsigned char *values, int stride, unsigned char *block){
+    int minValue = 255, maxValue = 0;
+    for(int i = 0; i < 16; i++){
+        minValue = min(minValue, static_cast<int>(values[i * stride]));
+        maxValue = max(maxValue, static_cast<int>(values[i * stride]));
+    }
+    //a0 > a1时为8值模式：下标0为a0，1为a1，2~7依次从a0插值到a1
+    block[0] = static_cast<unsigned char>(maxValue);
+    block[1] = static_cast<unsigned char>(minValue);
+    uint64_t indices = 0;
+    if(maxValue > minValue){
+        float scale = 7.0f / (maxValue - minValue);
+        for(int i = 0; i < 16; i++){
+            int step = static_cast<int>((values[i * stride] - minValue) * scale + 0.5f);//0为a1，7为a0
+            int index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+            indices |= static_cast<uint64_t>(index) << (i * 3);
+        }
+    }
+    for(int i = 0; i < 6; i++)
+        block[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+//驱动不支持S3TC时在CPU上解压BC1，输出16个RGBA像素
+void DecodeBC1Block(const unsigned char *block, unsigned char *pixels){
+    uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8)), color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    int palette[4][4];
+    unpackRGB565(color0, palette[0]);
+    unpackRGB565(color1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    for(int c = 0; c < 3; c++){
+        if(color0 > color1){
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }else{
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[3][3] = color0 > color1 ? 255 : 0;
+    uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    for(int i = 0; i < 16; i++){
+        int index = (indices >> (i * 2)) & 3;
+        for(int c = 0; c < 4; c++)
+            pixels[i * 4 + c] = static_cast<unsigned char>(palette[index][c]);
+    }
+}
+
+//压缩一张RGBA8图像，每行块作为一个任务；BC4使用R通道，BC5使用RG通道
+//超出图像的像素取边缘像素，不影响尺寸不是4的倍数的图像
+void CompressImage(const unsigned char *rgba, int width, int height, BlockFormat format, vector<unsigned char> &output, bool parallel){
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    unsigned int blockBytes = BlockBytes(format);
+    output.resize(CompressedSize(format, width, height));
+    auto compressRows = [&](unsigned int begin, unsigned int end){
+        unsigned char pixels[16 * 4];
+        for(unsigned int by = begin; by < end; by++){
+            for(int bx = 0; bx < blocksX; bx++){
+                for(int y = 0; y < 4; y++){
+                    int sy = min(static_cast<int>(by) * 4 + y, height - 1);
+                    for(int x = 0; x < 4; x++){
+                        int sx = min(bx * 4 + x, width - 1);
+                        memcpy(pixels + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                    }
+                }
+                unsigned char *block = output.data() + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+                if(format == BLOCK_BC1)
+                    EncodeBC1Block(pixels, block);
+                else if(format == BLOCK_BC4)
+                    EncodeBC4Block(pixels, 4, block);
+                else{
+                    EncodeBC4Block(pixels, 4, block);
+                    EncodeBC4Block(pixels + 1, 4, block + 8);
+                }
+            }
+        }
+    };
+    if(parallel)
+        JobSystem::Get().ParallelFor(blocksY, 4, compressRows);
+    else
+        compressRows(0, blocksY);
+}
+
+//把BC1数据解压为RGBA8
+void DecompressBC1(const unsigned char *blocks, int width, int height, vector<unsigned char> &rgba){
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    rgba.resize(static_cast<size_t>(width) * height * 4);
+    unsigned char pixels[16 * 4];
+    for(int by = 0; by < blocksY; by++){
+        for(int bx = 0; bx < blocksX; bx++){
+            DecodeBC1Block(blocks + (static_cast<size_t>(by) * blocksX + bx) * 8, pixels);
+            for(int y = 0; y < 4 && by * 4 + y < height; y++){
+                for(int x = 0; x < 4 && bx * 4 + x < width; x++)
+                    memcpy(&rgba[(static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4], pixels + (y * 4 + x) * 4, 4);
+            }
+        }
+    }
+}
+
+#endif
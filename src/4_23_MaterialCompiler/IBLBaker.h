@@ -0,0 +1,693 @@
+#ifndef IBLBAKER_H
+#define IBLBAKER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <sys/stat.h>
+//stb_image的实现由Model.h提供，Model.h定义了STB_IMAGE_IMPLEMENTATION，已经包含过时不能再次包含
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include <tool/stb_image.h>
+#endif
+#include "JobSystem.h"
+#include "Profiler.h"
+using namespace std;
+
+//SIMD指令集选择：RGBA四个分量放在一个寄存器中做滤波与累加，BRDF积分表一次计算4个采样
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IBL_USE_SSE
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+//基于图像的光照（IBL）的CPU预计算，结果写入缓存文件，之后启动时直接读取：
+//  漫反射：辐照度投影到3阶（9个系数）球谐函数，着色器中按法线求值，不需要辐照度贴图
+//  镜面反射：按GGX分布重要性采样预过滤环境贴图，每级mipmap对应一个粗糙度（split-sum的第一项）
+//  BRDF积分表：split-sum的第二项，与环境无关，所有环境共用一张
+//环境的6个面先转换到线性空间并降采样为IBL_SOURCE_SIZE，再生成mipmap链；预过滤时按采样的概率密度选择源mipmap层级，
+//少量采样也不会出现明显的噪点（filtered importance sampling）
+#define IBL_CACHE_MAGIC 0x434C4249 //"IBLC"
+#define IBL_CACHE_VERSION 1
+#define IBL_SOURCE_SIZE 256 //预计算使用的源立方体贴图边长
+#define IBL_SPECULAR_SIZE 128 //预过滤镜面反射第0级的边长
+#define IBL_SPECULAR_LEVELS 5 //第i级的粗糙度为 i / (IBL_SPECULAR_LEVELS - 1)
+#define IBL_SPECULAR_SAMPLES 128 //预过滤每个纹素的采样数
+#define IBL_BRDF_SIZE 128
+#define IBL_BRDF_SAMPLES 512 //必须是4的倍数
+#define IBL_ROW_GRAIN 8 //并行时每个任务处理的行数
+
+//立方体贴图的一级：6个面依次存放，顺序与GL_TEXTURE_CUBE_MAP_POSITIVE_X开始的顺序相同，每个纹素4个float（RGBA，A不使用）
+//每个面的第0行对应图片的第一行，与上传到OpenGL立方体贴图时的约定相同
+struct CubeLevel {
+    int size = 0;
+    vector<float> texels;
+
+    void Resize(int size){
+        this->size = size;
+        texels.assign(static_cast<size_t>(size) * size * 6 * 4, 0.0f);
+    }
+    float *Texel(int face, int x, int y){
+        return &texels[((static_cast<size_t>(face) * size + y) * size + x) * 4];
+    }
+    const float *Texel(int face, int x, int y) const{
+        return &texels[((static_cast<size_t>(face) * size + y) * size + x) * 4];
+    }
+    const float *Face(int face) const{
+        return &texels[static_cast<size_t>(face) * size * size * 4];
+    }
+};
+
+//一个环境的预计算结果
+struct IBLEnvironment {
+    glm::vec3 sh[9];//辐照度除以π的球谐系数，乘以反照率就是漫反射光照
+    vector<CubeLevel> specular;//预过滤的镜面反射，共IBL_SPECULAR_LEVELS级
+};
+
+//split-sum的BRDF积分表，每个纹素两个分量：F0的系数与偏移；列为NdotV，行为粗糙度
+struct IBLBRDFTable {
+    int size = 0;
+    vector<float> texels;
+};
+
+//解码后的6个面（8位RGB），面的顺序为 +X -X +Y -Y +Z -Z
+struct CubeFaces {
+    unsigned char *data[6] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+    int size = 0;
+
+    CubeFaces(){}
+    ~CubeFaces(){
+        Release();
+    }
+    CubeFaces(const CubeFaces &) = delete;
+    CubeFaces &operator=(const CubeFaces &) = delete;
+
+    void Release(){
+        for(int i = 0; i < 6; i++){
+            stbi_image_free(data[i]);
+            data[i] = nullptr;
+        }
+        size = 0;
+    }
+};
+
+//6个面各作为一个任务解码，parallel为false时在当前线程上依次解码；面必须是边长相同的正方形
+bool DecodeCubeFaces(const vector<string> &paths, CubeFaces &faces, bool parallel){
+    PROFILE_FUNCTION();
+    faces.Release();
+    if(paths.size() != 6){
+        cout << "ERROR::IBL::CUBEMAP_NEEDS_6_FACES" << endl;
+        return false;
+    }
+    int width[6] = {0}, height[6] = {0};
+    auto decode = [&](int i){
+        PROFILE_SCOPE("Decode " + paths[i].substr(paths[i].find_last_of('/') + 1));
+        int components;
+        faces.data[i] = stbi_load(paths[i].c_str(), &width[i], &height[i], &components, 3);
+    };
+    if(parallel){
+        JobCounter counter;
+        for(int i = 0; i < 6; i++)
+            JobSystem::Get().Run([&, i](){
+                decode(i);
+            }, &counter);
+        JobSystem::Get().Wait(counter);
+    }else{
+        for(int i = 0; i < 6; i++)
+            decode(i);
+    }
+    for(int i = 0; i < 6; i++){
+        if(faces.data[i] == nullptr){
+            cout << "ERROR::IBL::FACE_FAILED_TO_LOAD: " << paths[i] << endl;
+            faces.Release();
+            return false;
+        }
+        if(width[i] != height[i] || width[i] != width[0]){
+            cout << "ERROR::IBL::FACE_SIZE_MISMATCH: " << paths[i] << endl;
+            faces.Release();
+            return false;
+        }
+    }
+    faces.size = width[0];
+    return true;
+}
+
+//各阶段的耗时，从缓存读取时只有cacheMs
+struct IBLBakeStats {
+    bool fromCache = false;
+    double cacheMs = 0.0;
+    double sourceMs = 0.0;//转换到线性空间、降采样与生成mipmap
+    double shMs = 0.0;
+    double specularMs = 0.0;
+    double brdfMs = 0.0;
+};
+
+class IBLBaker {
+public:
+    bool parallel = true;//false时全部在当前线程上执行
+    IBLBakeStats stats;
+
+    //缓存存在、参数一致并且6个面的文件没有变化时直接读取，否则用已解码的面烘焙并写入缓存
+    //force为true时总是重新烘焙
+    bool LoadOrBake(const vector<string> &paths, const CubeFaces &faces, const string &cachePath, IBLEnvironment &environment, bool force = false){
+        stats = IBLBakeStats();
+        CacheHeader expected = makeHeader(KIND_ENVIRONMENT, paths);
+        if(!force && readEnvironment(cachePath, expected, environment))
+            return true;
+        if(faces.size == 0)
+            return false;
+        Bake(faces, environment);
+        writeEnvironment(cachePath, expected, environment);
+        return true;
+    }
+
+    bool LoadOrBakeBRDF(const string &cachePath, IBLBRDFTable &table, bool force = false){
+        stats = IBLBakeStats();
+        CacheHeader expected = makeHeader(KIND_BRDF, vector<string>());
+        if(!force && readBRDF(cachePath, expected, table))
+            return true;
+        BakeBRDF(table);
+        writeBRDF(cachePath, expected, table);
+        return true;
+    }
+
+    void Bake(const CubeFaces &faces, IBLEnvironment &environment){
+        PROFILE_FUNCTION();
+        auto start = chrono::steady_clock::now();
+        vector<CubeLevel> source;
+        buildSource(faces, source);
+        auto sourceEnd = chrono::steady_clock::now();
+        projectSH(source[0], environment.sh);
+        auto shEnd = chrono::steady_clock::now();
+        prefilterSpecular(source, environment.specular);
+        auto specularEnd = chrono::steady_clock::now();
+        stats.sourceMs = chrono::duration<double, milli>(sourceEnd - start).count();
+        stats.shMs = chrono::duration<double, milli>(shEnd - sourceEnd).count();
+        stats.specularMs = chrono::duration<double, milli>(specularEnd - shEnd).count();
+    }
+
+    //行为粗糙度，列为NdotV，都取纹素中心；每行的重要性采样方向只与粗糙度有关，预先算好后一次处理4个采样
+    void BakeBRDF(IBLBRDFTable &table){
+        PROFILE_FUNCTION();
+        auto start = chrono::steady_clock::now();
+        table.size = IBL_BRDF_SIZE;
+        table.texels.assign(static_cast<size_t>(IBL_BRDF_SIZE) * IBL_BRDF_SIZE * 2, 0.0f);
+        run(IBL_BRDF_SIZE, 1, [&](unsigned int begin, unsigned int end){
+            alignas(16) float hx[IBL_BRDF_SAMPLES], hz[IBL_BRDF_SAMPLES];
+            for(unsigned int row = begin; row < end; row++){
+                float roughness = (row + 0.5f) / IBL_BRDF_SIZE;
+                for(unsigned int i = 0; i < IBL_BRDF_SAMPLES; i++){
+                    //V在xz平面内，只需要H的x与z分量
+                    glm::vec3 h = importanceSampleGGX(hammersley(i, IBL_BRDF_SAMPLES), roughness);
+                    hx[i] = h.x;
+                    hz[i] = h.z;
+                }
+                float k = roughness * roughness * 0.5f;
+                for(int column = 0; column < IBL_BRDF_SIZE; column++){
+                    float NdotV = (column + 0.5f) / IBL_BRDF_SIZE;
+                    float scale, bias;
+                    integrateBRDF(NdotV, k, hx, hz, scale, bias);
+                    table.texels[(static_cast<size_t>(row) * IBL_BRDF_SIZE + column) * 2] = scale;
+                    table.texels[(static_cast<size_t>(row) * IBL_BRDF_SIZE + column) * 2 + 1] = bias;
+                }
+            }
+        });
+        stats.brdfMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    //纹素中心(x, y)在面face上对应的方向（未归一化），与OpenGL选择立方体贴图面的规则互逆
+    static glm::vec3 TexelDirection(int face, float x, float y, int size){
+        float s = 2.0f * (x + 0.5f) / size - 1.0f, t = 2.0f * (y + 0.5f) / size - 1.0f;
+        switch(face){
+        case 0: return glm::vec3(1.0f, -t, -s);
+        case 1: return glm::vec3(-1.0f, -t, s);
+        case 2: return glm::vec3(s, 1.0f, t);
+        case 3: return glm::vec3(s, -1.0f, -t);
+        case 4: return glm::vec3(s, -t, 1.0f);
+        default: return glm::vec3(-s, -t, -1.0f);
+        }
+    }
+
+private:
+    enum CacheKind {
+        KIND_ENVIRONMENT = 1,
+        KIND_BRDF = 2
+    };
+
+    //缓存文件的头部，后面依次是各级镜面反射的纹素（或BRDF积分表）；参数或源文件的大小、修改时间不同时缓存失效
+    struct CacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t kind;
+        uint32_t sourceSize, specularSize, specularLevels, specularSamples, brdfSize, brdfSamples;
+        uint32_t padding;
+        uint64_t faceBytes[6];
+        int64_t faceTimes[6];
+        float sh[27];
+    };
+
+#if defined(IBL_USE_SSE)
+    typedef __m128 Texel4;
+    static Texel4 zero4(){
+        return _mm_setzero_ps();
+    }
+    static Texel4 load4(const float *p){
+        return _mm_loadu_ps(p);
+    }
+    static Texel4 madd4(Texel4 sum, Texel4 value, float weight){
+        return _mm_add_ps(sum, _mm_mul_ps(value, _mm_set1_ps(weight)));
+    }
+    static void store4(float *p, Texel4 value){
+        _mm_storeu_ps(p, value);
+    }
+#else
+    typedef glm::vec4 Texel4;
+    static Texel4 zero4(){
+        return glm::vec4(0.0f);
+    }
+    static Texel4 load4(const float *p){
+        return glm::vec4(p[0], p[1], p[2], p[3]);
+    }
+    static Texel4 madd4(Texel4 sum, Texel4 value, float weight){
+        return sum + value * weight;
+    }
+    static void store4(float *p, Texel4 value){
+        p[0] = value.x; p[1] = value.y; p[2] = value.z; p[3] = value.w;
+    }
+#endif
+
+    //预过滤使用的一个采样：切线空间（法线为z）中的入射方向、NdotL权重与源mipmap层级
+    struct PrefilterSample {
+        glm::vec3 direction;
+        float weight;
+        float lod;
+    };
+
+    void run(unsigned int count, unsigned int grainSize, const function<void(unsigned int, unsigned int)> &func){
+        if(parallel)
+            JobSystem::Get().ParallelFor(count, grainSize, func);
+        else if(count > 0)
+            func(0, count);
+    }
+
+    static float hammersleyRadical(unsigned int bits){
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return static_cast<float>(bits) * 2.3283064365386963e-10f;
+    }
+    static glm::vec2 hammersley(unsigned int i, unsigned int count){
+        return glm::vec2(static_cast<float>(i) / count, hammersleyRadical(i));
+    }
+
+    //切线空间中按GGX分布采样的半程向量，alpha = roughness^2
+    static glm::vec3 importanceSampleGGX(const glm::vec2 &xi, float roughness){
+        float a = roughness * roughness;
+        float phi = 2.0f * glm::pi<float>() * xi.x;
+        float cosTheta = sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+        float sinTheta = sqrt(max(1.0f - cosTheta * cosTheta, 0.0f));
+        return glm::vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+    }
+
+    static float distributionGGX(float NdotH, float roughness){
+        float a = roughness * roughness;
+        float a2 = a * a;
+        float denom = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+        return a2 / (glm::pi<float>() * denom * denom);
+    }
+
+    //对NdotV的一组采样求 ∫(1 - Fc) * G_Vis 与 ∫Fc * G_Vis，G使用IBL的k = roughness^2 / 2
+    static void integrateBRDF(float NdotV, float k, const float *hx, const float *hz, float &scale, float &bias){
+        float vx = sqrt(1.0f - NdotV * NdotV), vz = NdotV;
+        float gv = NdotV / (NdotV * (1.0f - k) + k);
+#if defined(IBL_USE_SSE)
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+        const __m128 VX = _mm_set1_ps(vx), VZ = _mm_set1_ps(vz), K = _mm_set1_ps(k), oneMinusK = _mm_set1_ps(1.0f - k);
+        const __m128 GV = _mm_set1_ps(gv / NdotV);
+        __m128 sumA = zero, sumB = zero;
+        for(int i = 0; i < IBL_BRDF_SAMPLES; i += 4){
+            __m128 HX = _mm_load_ps(hx + i), HZ = _mm_load_ps(hz + i);
+            __m128 VdotH = _mm_add_ps(_mm_mul_ps(VX, HX), _mm_mul_ps(VZ, HZ));
+            __m128 NdotL = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(two, VdotH), HZ), VZ);
+            __m128 valid = _mm_cmpgt_ps(NdotL, zero);
+            VdotH = _mm_max_ps(VdotH, zero);
+            NdotL = _mm_max_ps(NdotL, zero);
+            //G_Vis = G_V * G_L * VdotH / (NdotH * NdotV)
+            __m128 gl = _mm_div_ps(NdotL, _mm_add_ps(_mm_mul_ps(NdotL, oneMinusK), K));
+            __m128 gVis = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(GV, gl), VdotH), HZ);
+            __m128 f = _mm_sub_ps(one, VdotH);
+            __m128 f2 = _mm_mul_ps(f, f);
+            __m128 fc = _mm_mul_ps(_mm_mul_ps(f2, f2), f);
+            gVis = _mm_and_ps(gVis, valid);
+            sumA = _mm_add_ps(sumA, _mm_mul_ps(_mm_sub_ps(one, fc), gVis));
+            sumB = _mm_add_ps(sumB, _mm_mul_ps(fc, gVis));
+        }
+        alignas(16) float a[4], b[4];
+        _mm_store_ps(a, sumA);
+        _mm_store_ps(b, sumB);
+        scale = (a[0] + a[1] + a[2] + a[3]) / IBL_BRDF_SAMPLES;
+        bias = (b[0] + b[1] + b[2] + b[3]) / IBL_BRDF_SAMPLES;
+#else
+        float sumA = 0.0f, sumB = 0.0f;
+        for(int i = 0; i < IBL_BRDF_SAMPLES; i++){
+            float VdotH = vx * hx[i] + vz * hz[i];
+            float NdotL = 2.0f * VdotH * hz[i] - vz;
+            if(NdotL <= 0.0f)
+                continue;
+            VdotH = max(VdotH, 0.0f);
+            float gl = NdotL / (NdotL * (1.0f - k) + k);
+            float gVis = gv * gl * VdotH / (hz[i] * NdotV);
+            float fc = pow(1.0f - VdotH, 5.0f);
+            sumA += (1.0f - fc) * gVis;
+            sumB += fc * gVis;
+        }
+        scale = sumA / IBL_BRDF_SAMPLES;
+        bias = sumB / IBL_BRDF_SAMPLES;
+#endif
+    }
+
+    //源立方体贴图：sRGB转换到线性空间，按整数倍box滤波降采样到IBL_SOURCE_SIZE（面更小时保持原大小），再逐级2x2平均到1x1
+    void buildSource(const CubeFaces &faces, vector<CubeLevel> &levels){
+        PROFILE_FUNCTION();
+        float toLinear[256];
+        for(int i = 0; i < 256; i++){
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        int factor = max(1, faces.size / IBL_SOURCE_SIZE);
+        int size = faces.size / factor;
+        levels.assign(1, CubeLevel());
+        levels[0].Resize(size);
+        float invCount = 1.0f / (factor * factor);
+        run(6 * size, IBL_ROW_GRAIN, [&](unsigned int begin, unsigned int end){
+            for(unsigned int row = begin; row < end; row++){
+                int face = row / size, y = row % size;
+                for(int x = 0; x < size; x++){
+                    float sum[3] = {0.0f, 0.0f, 0.0f};
+                    for(int sy = 0; sy < factor; sy++){
+                        const unsigned char *src = faces.data[face] + (static_cast<size_t>(y * factor + sy) * faces.size + x * factor) * 3;
+                        for(int sx = 0; sx < factor; sx++, src += 3){
+                            sum[0] += toLinear[src[0]];
+                            sum[1] += toLinear[src[1]];
+                            sum[2] += toLinear[src[2]];
+                        }
+                    }
+                    float *dst = levels[0].Texel(face, x, y);
+                    dst[0] = sum[0] * invCount;
+                    dst[1] = sum[1] * invCount;
+                    dst[2] = sum[2] * invCount;
+                    dst[3] = 1.0f;
+                }
+            }
+        });
+        while(levels.back().size > 1){
+            const CubeLevel &previous = levels.back();
+            CubeLevel next;
+            next.Resize(previous.size / 2);
+            run(6 * next.size, IBL_ROW_GRAIN, [&](unsigned int begin, unsigned int end){
+                for(unsigned int row = begin; row < end; row++){
+                    int face = row / next.size, y = row % next.size;
+                    for(int x = 0; x < next.size; x++){
+                        Texel4 sum = zero4();
+                        sum = madd4(sum, load4(previous.Texel(face, x * 2, y * 2)), 0.25f);
+                        sum = madd4(sum, load4(previous.Texel(face, x * 2 + 1, y * 2)), 0.25f);
+                        sum = madd4(sum, load4(previous.Texel(face, x * 2, y * 2 + 1)), 0.25f);
+                        sum = madd4(sum, load4(previous.Texel(face, x * 2 + 1, y * 2 + 1)), 0.25f);
+                        store4(next.Texel(face, x, y), sum);
+                    }
+                }
+            });
+            levels.push_back(move(next));
+        }
+    }
+
+    //纹素在单位立方体上所占面积投影到单位球面上的立体角
+    static float areaElement(float x, float y){
+        return atan2(x * y, sqrt(x * x + y * y + 1.0f));
+    }
+    static float texelSolidAngle(int x, int y, int size){
+        float x0 = 2.0f * x / size - 1.0f, x1 = 2.0f * (x + 1) / size - 1.0f;
+        float y0 = 2.0f * y / size - 1.0f, y1 = 2.0f * (y + 1) / size - 1.0f;
+        return fabs(areaElement(x0, y0) - areaElement(x0, y1) - areaElement(x1, y0) + areaElement(x1, y1));
+    }
+
+    //辐射度投影到9个球谐基函数上，再与余弦核卷积得到辐照度；系数除以π，着色器中直接乘反照率
+    //每一行的部分和单独保存，最后按顺序相加，结果与线程数无关
+    void projectSH(const CubeLevel &source, glm::vec3 sh[9]){
+        PROFILE_FUNCTION();
+        int size = source.size;
+        vector<float> rowSums(static_cast<size_t>(6) * size * 9 * 4, 0.0f);
+        run(6 * size, IBL_ROW_GRAIN, [&](unsigned int begin, unsigned int end){
+            for(unsigned int row = begin; row < end; row++){
+                int face = row / size, y = row % size;
+                Texel4 sums[9];
+                for(int i = 0; i < 9; i++)
+                    sums[i] = zero4();
+                for(int x = 0; x < size; x++){
+                    glm::vec3 d = glm::normalize(TexelDirection(face, static_cast<float>(x), static_cast<float>(y), size));
+                    float dw = texelSolidAngle(x, y, size);
+                    float basis[9];
+                    evaluateSH(d, basis);
+                    Texel4 radiance = load4(source.Texel(face, x, y));
+                    for(int i = 0; i < 9; i++)
+                        sums[i] = madd4(sums[i], radiance, basis[i] * dw);
+                }
+                for(int i = 0; i < 9; i++)
+                    store4(&rowSums[(static_cast<size_t>(row) * 9 + i) * 4], sums[i]);
+            }
+        });
+        //余弦核的卷积系数A_l除以π：1、2/3、1/4
+        const float band[9] = {1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+        for(int i = 0; i < 9; i++){
+            glm::dvec3 sum(0.0);
+            for(int row = 0; row < 6 * size; row++){
+                const float *value = &rowSums[(static_cast<size_t>(row) * 9 + i) * 4];
+                sum += glm::dvec3(value[0], value[1], value[2]);
+            }
+            sh[i] = glm::vec3(sum) * band[i];
+        }
+    }
+
+    //实数球谐基函数，顺序与IBLFragmentShader.glsl中的相同
+    static void evaluateSH(const glm::vec3 &d, float basis[9]){
+        basis[0] = 0.282095f;
+        basis[1] = 0.488603f * d.y;
+        basis[2] = 0.488603f * d.z;
+        basis[3] = 0.488603f * d.x;
+        basis[4] = 1.092548f * d.x * d.y;
+        basis[5] = 1.092548f * d.y * d.z;
+        basis[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+        basis[7] = 1.092548f * d.x * d.z;
+        basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+    }
+
+    //方向d在第level级上的双线性采样，面内坐标限制在边缘（不跨面过滤）
+    static Texel4 sampleBilinear(const CubeLevel &level, const glm::vec3 &d){
+        glm::vec3 a = glm::abs(d);
+        int face;
+        float sc, tc, ma;
+        if(a.x >= a.y && a.x >= a.z){
+            face = d.x > 0.0f ? 0 : 1;
+            ma = a.x;
+            sc = d.x > 0.0f ? -d.z : d.z;
+            tc = -d.y;
+        }else if(a.y >= a.z){
+            face = d.y > 0.0f ? 2 : 3;
+            ma = a.y;
+            sc = d.x;
+            tc = d.y > 0.0f ? d.z : -d.z;
+        }else{
+            face = d.z > 0.0f ? 4 : 5;
+            ma = a.z;
+            sc = d.z > 0.0f ? d.x : -d.x;
+            tc = -d.y;
+        }
+        float x = (sc / ma * 0.5f + 0.5f) * level.size - 0.5f;
+        float y = (tc / ma * 0.5f + 0.5f) * level.size - 0.5f;
+        x = min(max(x, 0.0f), level.size - 1.0f);
+        y = min(max(y, 0.0f), level.size - 1.0f);
+        int x0 = static_cast<int>(x), y0 = static_cast<int>(y);
+        int x1 = min(x0 + 1, level.size - 1), y1 = min(y0 + 1, level.size - 1);
+        float fx = x - x0, fy = y - y0;
+        Texel4 result = zero4();
+        result = madd4(result, load4(level.Texel(face, x0, y0)), (1.0f - fx) * (1.0f - fy));
+        result = madd4(result, load4(level.Texel(face, x1, y0)), fx * (1.0f - fy));
+        result = madd4(result, load4(level.Texel(face, x0, y1)), (1.0f - fx) * fy);
+        result = madd4(result, load4(level.Texel(face, x1, y1)), fx * fy);
+        return result;
+    }
+
+    //在相邻两级之间线性插值（三线性过滤）
+    static Texel4 sampleTrilinear(const vector<CubeLevel> &levels, const glm::vec3 &d, float lod){
+        lod = min(max(lod, 0.0f), static_cast<float>(levels.size() - 1));
+        int level = static_cast<int>(lod);
+        float f = lod - level;
+        if(f <= 0.0f || level + 1 >= static_cast<int>(levels.size()))
+            return sampleBilinear(levels[level], d);
+        Texel4 result = zero4();
+        result = madd4(result, sampleBilinear(levels[level], d), 1.0f - f);
+        return madd4(result, sampleBilinear(levels[level + 1], d), f);
+    }
+
+    //一个粗糙度的采样集合，假设N = V = R，所有纹素共用，只需要旋转到各自的切线空间
+    //源层级按采样的概率密度选择：一个采样代表的立体角覆盖多少个源纹素，就取相应的mipmap
+    static void buildPrefilterSamples(float roughness, int sourceSize, int outputSize, vector<PrefilterSample> &samples){
+        samples.clear();
+        if(roughness <= 0.0f){
+            //粗糙度为0时就是镜面反射，按输出分辨率取对应的源层级
+            PrefilterSample sample;
+            sample.direction = glm::vec3(0.0f, 0.0f, 1.0f);
+            sample.weight = 1.0f;
+            sample.lod = log2(static_cast<float>(sourceSize) / outputSize);
+            samples.push_back(sample);
+            return;
+        }
+        float texelSolidAngle = 4.0f * glm::pi<float>() / (6.0f * sourceSize * sourceSize);
+        for(unsigned int i = 0; i < IBL_SPECULAR_SAMPLES; i++){
+            glm::vec3 h = importanceSampleGGX(hammersley(i, IBL_SPECULAR_SAMPLES), roughness);
+            glm::vec3 l = glm::vec3(2.0f * h.z * h.x, 2.0f * h.z * h.y, 2.0f * h.z * h.z - 1.0f);
+            if(l.z <= 0.0f)
+                continue;
+            //N = V时 pdf = D * NdotH / (4 * VdotH) = D / 4
+            float pdf = distributionGGX(h.z, roughness) * 0.25f;
+            float sampleSolidAngle = 1.0f / (IBL_SPECULAR_SAMPLES * pdf + 1e-4f);
+            PrefilterSample sample;
+            sample.direction = l;
+            sample.weight = l.z;
+            sample.lod = 0.5f * log2(sampleSolidAngle / texelSolidAngle) + 1.0f;
+            samples.push_back(sample);
+        }
+    }
+
+    void prefilterSpecular(const vector<CubeLevel> &source, vector<CubeLevel> &levels){
+        PROFILE_FUNCTION();
+        levels.assign(IBL_SPECULAR_LEVELS, CubeLevel());
+        vector<PrefilterSample> samples;
+        for(int level = 0; level < IBL_SPECULAR_LEVELS; level++){
+            CubeLevel &target = levels[level];
+            target.Resize(max(1, IBL_SPECULAR_SIZE >> level));
+            float roughness = static_cast<float>(level) / (IBL_SPECULAR_LEVELS - 1);
+            buildPrefilterSamples(roughness, source[0].size, target.size, samples);
+            run(6 * target.size, 1, [&](unsigned int begin, unsigned int end){
+                for(unsigned int row = begin; row < end; row++){
+                    int face = row / target.size, y = row % target.size;
+                    for(int x = 0; x < target.size; x++){
+                        glm::vec3 n = glm::normalize(TexelDirection(face, static_cast<float>(x), static_cast<float>(y), target.size));
+                        glm::vec3 up = fabs(n.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                        glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+                        glm::vec3 bitangent = glm::cross(n, tangent);
+                        Texel4 sum = zero4();
+                        float weight = 0.0f;
+                        for(unsigned int s = 0; s < samples.size(); s++){
+                            const PrefilterSample &sample = samples[s];
+                            glm::vec3 l = tangent * sample.direction.x + bitangent * sample.direction.y + n * sample.direction.z;
+                            sum = madd4(sum, sampleTrilinear(source, l, sample.lod), sample.weight);
+                            weight += sample.weight;
+                        }
+                        store4(target.Texel(face, x, y), madd4(zero4(), sum, 1.0f / weight));
+                    }
+                }
+            });
+        }
+    }
+
+    //源文件的大小与修改时间记录在缓存头部
+    static CacheHeader makeHeader(uint32_t kind, const vector<string> &paths){
+        CacheHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = IBL_CACHE_MAGIC;
+        header.version = IBL_CACHE_VERSION;
+        header.kind = kind;
+        header.sourceSize = IBL_SOURCE_SIZE;
+        header.specularSize = IBL_SPECULAR_SIZE;
+        header.specularLevels = IBL_SPECULAR_LEVELS;
+        header.specularSamples = IBL_SPECULAR_SAMPLES;
+        header.brdfSize = IBL_BRDF_SIZE;
+        header.brdfSamples = IBL_BRDF_SAMPLES;
+        for(unsigned int i = 0; i < paths.size() && i < 6; i++){
+            struct stat info;
+            if(stat(paths[i].c_str(), &info) == 0){
+                header.faceBytes[i] = static_cast<uint64_t>(info.st_size);
+                header.faceTimes[i] = static_cast<int64_t>(info.st_mtime);
+            }
+        }
+        return header;
+    }
+
+    //除了球谐系数以外的字段都必须一致
+    static bool sameHeader(const CacheHeader &a, const CacheHeader &b){
+        return memcmp(&a, &b, offsetof(CacheHeader, sh)) == 0;
+    }
+
+    bool readEnvironment(const string &path, const CacheHeader &expected, IBLEnvironment &environment){
+        PROFILE_FUNCTION();
+        auto start = chrono::steady_clock::now();
+        ifstream file(path.c_str(), ios::binary);
+        CacheHeader header;
+        if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !sameHeader(header, expected))
+            return false;
+        environment.specular.assign(IBL_SPECULAR_LEVELS, CubeLevel());
+        for(int level = 0; level < IBL_SPECULAR_LEVELS; level++){
+            CubeLevel &target = environment.specular[level];
+            target.Resize(max(1, IBL_SPECULAR_SIZE >> level));
+            if(!file.read(reinterpret_cast<char*>(target.texels.data()), target.texels.size() * sizeof(float)))
+                return false;
+        }
+        for(int i = 0; i < 9; i++)
+            environment.sh[i] = glm::vec3(header.sh[i * 3], header.sh[i * 3 + 1], header.sh[i * 3 + 2]);
+        stats.fromCache = true;
+        stats.cacheMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    void writeEnvironment(const string &path, CacheHeader header, const IBLEnvironment &environment){
+        for(int i = 0; i < 9; i++){
+            header.sh[i * 3] = environment.sh[i].x;
+            header.sh[i * 3 + 1] = environment.sh[i].y;
+            header.sh[i * 3 + 2] = environment.sh[i].z;
+        }
+        ofstream file(path.c_str(), ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for(unsigned int level = 0; level < environment.specular.size(); level++)
+            file.write(reinterpret_cast<const char*>(environment.specular[level].texels.data()), environment.specular[level].texels.size() * sizeof(float));
+        if(!file)
+            cout << "ERROR::IBL::CACHE_NOT_WRITTEN: " << path << endl;
+    }
+
+    bool readBRDF(const string &path, const CacheHeader &expected, IBLBRDFTable &table){
+        PROFILE_FUNCTION();
+        auto start = chrono::steady_clock::now();
+        ifstream file(path.c_str(), ios::binary);
+        CacheHeader header;
+        if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !sameHeader(header, expected))
+            return false;
+        table.size = IBL_BRDF_SIZE;
+        table.texels.resize(static_cast<size_t>(IBL_BRDF_SIZE) * IBL_BRDF_SIZE * 2);
+        if(!file.read(reinterpret_cast<char*>(table.texels.data()), table.texels.size() * sizeof(float)))
+            return false;
+        stats.fromCache = true;
+        stats.cacheMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    void writeBRDF(const string &path, const CacheHeader &header, const IBLBRDFTable &table){
+        ofstream file(path.c_str(), ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(table.texels.data()), table.texels.size() * sizeof(float));
+        if(!file)
+            cout << "ERROR::IBL::CACHE_NOT_WRITTEN: " << path << endl;
+    }
+};
+
+#endif
@@ -0,0 +1,532 @@
+#ifndef MATERIALCOMPILER_H
+#define MATERIALCOMPILER_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <sys/stat.h>
+//stb_image的实现由Model.h提供，Model.h定义了STB_IMAGE_IMPLEMENTATION，已经包含过时不能再次包含
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include <tool/stb_image.h>
+#endif
+#include "BlockCompression.h"
+#include "MaterialFormat.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+using namespace std;
+
+//材质编译工具：把金属度-粗糙度工作流的分散贴图编译成MaterialFormat.h描述的格式
+//源定义文件每行一条指令，#开头为注释，名称与路径中不能有空格
+//  material 名称 反照率 法线 AO 粗糙度 金属度
+//反照率与法线为贴图路径或"-"；AO、粗糙度、金属度可以是：
+//  路径[:通道]   使用贴图的一个通道，通道为r g b a，默认为r，例如已经打包好的Cerberus_RM.jpg:g
+//  数值          常数
+//  -             默认值，AO为1，粗糙度为0.5，金属度为0
+//编译时检查每个通道的取值范围，最大最小值相差不超过MATERIAL_CONSTANT_TOLERANCE的通道视为常数，不生成纹理
+#define MATERIAL_CONSTANT_TOLERANCE 4
+
+struct MaterialScalar {
+    string path;//空表示常数
+    int channel = 0;
+    float constant = 1.0f;
+};
+
+enum MaterialScalarSlot {
+    MATERIAL_AO,
+    MATERIAL_ROUGHNESS,
+    MATERIAL_METALLIC
+};
+
+struct MaterialSource {
+    string name;
+    string definition;//名称与各项输入用一个空格连接，写入描述文件用于判断定义是否变化
+    string albedo;
+    string normal;
+    MaterialScalar scalars[3];//按MaterialScalarSlot的顺序
+};
+
+struct MaterialCompileStats {
+    bool fromCache = false;
+    double decodeMs = 0.0;
+    double buildMs = 0.0;//分析通道、打包与生成mipmap
+    double compressMs = 0.0;
+    unsigned int sourceTextures = 0;//不编译时需要绑定的贴图数量
+    size_t sourceBytes = 0;//不编译时按RGBA8加mipmap上传的显存
+    size_t compiledBytes = 0;
+    string albedoFormat = "-", normalFormat = "-", ormFormat = "-";
+};
+
+class MaterialCompiler {
+public:
+    bool parallel = true;//false时全部在当前线程上执行
+    MaterialCompileStats stats;
+
+    //解析源定义文件，出错时输出行号并返回false
+    static bool Parse(const string &path, vector<MaterialSource> &sources){
+        ifstream file(path.c_str());
+        if(!file.is_open()){
+            cout << "ERROR::MATERIAL::FILE_NOT_SUCCESFULLY_READ " << path << endl;
+            return false;
+        }
+        string line;
+        unsigned int lineNumber = 0;
+        while(getline(file, line)){
+            lineNumber++;
+            size_t start = line.find_first_not_of(" \t\r");
+            if(start == string::npos || line[start] == '#')
+                continue;
+            istringstream stream(line);
+            string command;
+            stream >> command;
+            string error = command == "material" ? parseMaterial(stream, sources) : "unknown command " + command;
+            if(!error.empty()){
+                cout << "ERROR::MATERIAL::PARSE_FAILED " << path << ":" << lineNumber << ": " << error << endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //描述文件存在、引用的纹理都在、并且源贴图与定义都没有变化时直接读取，否则重新编译；force为true时总是重新编译
+    bool LoadOrCompile(const MaterialSource &source, const string &directory, MaterialDescriptor &descriptor, bool force = false){
+        if(!force && ReadMaterialDescriptor(MaterialDescriptorPath(directory, source.name), descriptor) && isFresh(source, directory, descriptor)){
+            stats = MaterialCompileStats();
+            stats.fromCache = true;
+            return true;
+        }
+        return Compile(source, directory, descriptor);
+    }
+
+    bool Compile(const MaterialSource &source, const string &directory, MaterialDescriptor &descriptor){
+        PROFILE_SCOPE("Compile " + source.name);
+        stats = MaterialCompileStats();
+        descriptor = MaterialDescriptor();
+        descriptor.name = source.name;
+        descriptor.definition = source.definition;
+        descriptor.stamps = stampSources(source);
+
+        //同一张贴图可能被多个通道引用（例如打包好的RM贴图），每个文件只解码一次
+        auto start = chrono::steady_clock::now();
+        map<string, SourceImage> images;
+        vector<string> paths = sourcePaths(source);
+        for(unsigned int i = 0; i < paths.size(); i++)
+            images[paths[i]] = SourceImage();
+        {
+            PROFILE_SCOPE("Decode");
+            JobCounter counter;
+            for(auto &entry : images){
+                const string &path = entry.first;
+                SourceImage *image = &entry.second;
+                auto decode = [path, image](){
+                    image->data = stbi_load(path.c_str(), &image->width, &image->height, nullptr, 4);
+                };
+                if(parallel)
+                    JobSystem::Get().Run(decode, &counter);
+                else
+                    decode();
+            }
+            JobSystem::Get().Wait(counter);
+        }
+        stats.decodeMs = elapsedMs(start);
+        bool success = true;
+        for(auto &entry : images){
+            if(entry.second.data == nullptr){
+                cout << "ERROR::MATERIAL::TEXTURE_FAILED_TO_LOAD " << entry.first << endl;
+                success = false;
+            }
+        }
+        if(success){
+            //不编译时每个有贴图的输入都是一张RGBA8纹理
+            countSource(images, source.albedo);
+            countSource(images, source.normal);
+            for(int s = 0; s < 3; s++)
+                countSource(images, source.scalars[s].path);
+            success = compileAlbedo(source, images, directory, descriptor) && compileNormal(source, images, directory, descriptor)
+                && compileORM(source, images, directory, descriptor) && writeDescriptor(MaterialDescriptorPath(directory, source.name), descriptor);
+        }
+        for(auto &entry : images)
+            stbi_image_free(entry.second.data);
+        return success;
+    }
+
+private:
+    struct SourceImage {
+        unsigned char *data = nullptr;//RGBA8
+        int width = 0, height = 0;
+    };
+
+    struct MaterialImage {
+        int width = 0, height = 0;
+        vector<unsigned char> rgba;
+    };
+
+    //生成mipmap时的滤波方式
+    enum MipFilter {
+        MIP_SRGB,//在线性空间平均后转换回sRGB
+        MIP_NORMAL,//平均后重新归一化
+        MIP_LINEAR
+    };
+
+    static double elapsedMs(chrono::steady_clock::time_point start){
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    static string parseMaterial(istringstream &stream, vector<MaterialSource> &sources){
+        MaterialSource source;
+        string scalars[3];
+        if(!(stream >> source.name >> source.albedo >> source.normal >> scalars[0] >> scalars[1] >> scalars[2]))
+            return "material expects name, albedo, normal, ao, roughness and metallic";
+        for(unsigned int i = 0; i < sources.size(); i++){
+            if(sources[i].name == source.name)
+                return "duplicate material " + source.name;
+        }
+        source.definition = source.name + " " + source.albedo + " " + source.normal + " " + scalars[0] + " " + scalars[1] + " " + scalars[2];
+        if(source.albedo == "-")
+            source.albedo.clear();
+        if(source.normal == "-")
+            source.normal.clear();
+        const float defaults[3] = {1.0f, 0.5f, 0.0f};
+        for(int s = 0; s < 3; s++){
+            MaterialScalar &scalar = source.scalars[s];
+            scalar.constant = defaults[s];
+            if(scalars[s] == "-")
+                continue;
+            char *end = nullptr;
+            float value = strtof(scalars[s].c_str(), &end);
+            if(*end == '\0'){
+                scalar.constant = value;
+                continue;
+            }
+            scalar.path = scalars[s];
+            size_t colon = scalar.path.size() >= 2 ? scalar.path.size() - 2 : string::npos;
+            if(colon != string::npos && scalar.path[colon] == ':'){
+                size_t channel = string("rgba").find(scalar.path[colon + 1]);
+                if(channel == string::npos)
+                    return "unknown channel in " + scalars[s];
+                scalar.channel = static_cast<int>(channel);
+                scalar.path.erase(colon);
+            }
+        }
+        sources.push_back(source);
+        return "";
+    }
+
+    //材质用到的所有源文件，不重复
+    static vector<string> sourcePaths(const MaterialSource &source){
+        vector<string> paths;
+        string candidates[5] = {source.albedo, source.normal, source.scalars[0].path, source.scalars[1].path, source.scalars[2].path};
+        for(int i = 0; i < 5; i++){
+            if(!candidates[i].empty() && find(paths.begin(), paths.end(), candidates[i]) == paths.end())
+                paths.push_back(candidates[i]);
+        }
+        return paths;
+    }
+
+    static vector<MaterialStamp> stampSources(const MaterialSource &source){
+        vector<string> paths = sourcePaths(source);
+        vector<MaterialStamp> stamps(paths.size());
+        for(unsigned int i = 0; i < paths.size(); i++){
+            struct stat info;
+            stamps[i].path = paths[i];
+            stamps[i].size = stat(paths[i].c_str(), &info) == 0 ? static_cast<long long>(info.st_size) : -1;
+            stamps[i].mtime = stamps[i].size >= 0 ? static_cast<long long>(info.st_mtime) : -1;
+        }
+        return stamps;
+    }
+
+    static bool isFresh(const MaterialSource &source, const string &directory, const MaterialDescriptor &descriptor){
+        if(descriptor.definition != source.definition)
+            return false;
+        vector<MaterialStamp> stamps = stampSources(source);
+        if(stamps.size() != descriptor.stamps.size())
+            return false;
+        for(unsigned int i = 0; i < stamps.size(); i++){
+            if(stamps[i].path != descriptor.stamps[i].path || stamps[i].size != descriptor.stamps[i].size || stamps[i].mtime != descriptor.stamps[i].mtime)
+                return false;
+        }
+        string textures[3] = {descriptor.albedoTexture, descriptor.normalTexture, descriptor.ormTexture};
+        for(int i = 0; i < 3; i++){
+            struct stat info;
+            if(!textures[i].empty() && stat((directory + textures[i]).c_str(), &info) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    void countSource(const map<string, SourceImage> &images, const string &path){
+        if(path.empty())
+            return;
+        const SourceImage &image = images.at(path);
+        stats.sourceTextures++;
+        stats.sourceBytes += static_cast<size_t>(image.width) * image.height * 4 * 4 / 3;
+    }
+
+    //通道的取值范围，用于判断是否为常数
+    static void channelRange(const SourceImage &image, int channel, int &minValue, int &maxValue, float &mean){
+        minValue = 255;
+        maxValue = 0;
+        double sum = 0.0;
+        size_t count = static_cast<size_t>(image.width) * image.height;
+        for(size_t i = 0; i < count; i++){
+            int value = image.data[i * 4 + channel];
+            minValue = min(minValue, value);
+            maxValue = max(maxValue, value);
+            sum += value;
+        }
+        mean = static_cast<float>(sum / count);
+    }
+
+    static bool isConstant(int minValue, int maxValue){
+        return maxValue - minValue <= MATERIAL_CONSTANT_TOLERANCE;
+    }
+
+    static const float *srgbTable(){
+        static float table[256];
+        static bool initialized = false;
+        if(!initialized){
+            for(int i = 0; i < 256; i++){
+                float c = i / 255.0f;
+                table[i] = c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            initialized = true;
+        }
+        return table;
+    }
+
+    static unsigned char linearToSRGB(float c){
+        c = c <= 0.0031308f ? c * 12.92f : 1.055f * pow(c, 1.0f / 2.4f) - 0.055f;
+        return static_cast<unsigned char>(min(max(c * 255.0f + 0.5f, 0.0f), 255.0f));
+    }
+
+    //2x2盒式滤波生成下一级，奇数尺寸时最后一行（列）与自身平均
+    void downsample(const MaterialImage &source, MaterialImage &target, MipFilter filter){
+        target.width = max(source.width / 2, 1);
+        target.height = max(source.height / 2, 1);
+        target.rgba.resize(static_cast<size_t>(target.width) * target.height * 4);
+        const float *toLinear = srgbTable();
+        auto filterRows = [&](unsigned int begin, unsigned int end){
+            for(unsigned int y = begin; y < end; y++){
+                int y0 = min(static_cast<int>(y) * 2, source.height - 1), y1 = min(static_cast<int>(y) * 2 + 1, source.height - 1);
+                for(int x = 0; x < target.width; x++){
+                    int x0 = min(x * 2, source.width - 1), x1 = min(x * 2 + 1, source.width - 1);
+                    const unsigned char *texels[4] = {&source.rgba[(static_cast<size_t>(y0) * source.width + x0) * 4],
+                        &source.rgba[(static_cast<size_t>(y0) * source.width + x1) * 4], &source.rgba[(static_cast<size_t>(y1) * source.width + x0) * 4],
+                        &source.rgba[(static_cast<size_t>(y1) * source.width + x1) * 4]};
+                    unsigned char *out = &target.rgba[(static_cast<size_t>(y) * target.width + x) * 4];
+                    if(filter == MIP_SRGB){
+                        for(int c = 0; c < 3; c++)
+                            out[c] = linearToSRGB((toLinear[texels[0][c]] + toLinear[texels[1][c]] + toLinear[texels[2][c]] + toLinear[texels[3][c]]) * 0.25f);
+                        out[3] = static_cast<unsigned char>((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+                    }else if(filter == MIP_NORMAL){
+                        glm::vec3 n(0.0f);
+                        for(int t = 0; t < 4; t++)
+                            n += glm::vec3(texels[t][0], texels[t][1], texels[t][2]) / 127.5f - 1.0f;
+                        float length = glm::length(n);
+                        n = length > 1e-6f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                        for(int c = 0; c < 3; c++)
+                            out[c] = static_cast<unsigned char>(min(max((n[c] + 1.0f) * 127.5f + 0.5f, 0.0f), 255.0f));
+                        out[3] = 255;
+                    }else{
+                        for(int c = 0; c < 4; c++)
+                            out[c] = static_cast<unsigned char>((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+                    }
+                }
+            }
+        };
+        if(parallel)
+            JobSystem::Get().ParallelFor(target.height, 16, filterRows);
+        else
+            filterRows(0, target.height);
+    }
+
+    //生成完整的mipmap链，逐级压缩后写入.ctex
+    bool writeTexture(const string &path, MaterialImage &image, BlockFormat format, bool srgb, MipFilter filter){
+        ofstream file(path.c_str(), ios::binary);
+        if(!file.is_open()){
+            cout << "ERROR::MATERIAL::TEXTURE_NOT_SUCCESFULLY_WRITTEN " << path << endl;
+            return false;
+        }
+        CompiledTextureHeader header = {MATERIAL_TEXTURE_MAGIC, MATERIAL_TEXTURE_VERSION, static_cast<uint32_t>(format), srgb ? 1u : 0u,
+            static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), 0};
+        int size = max(image.width, image.height);
+        while(size > 0){
+            header.levels++;
+            size /= 2;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        MaterialImage level = move(image), next;
+        vector<unsigned char> blocks;
+        for(unsigned int i = 0; i < header.levels; i++){
+            auto start = chrono::steady_clock::now();
+            CompressImage(level.rgba.data(), level.width, level.height, format, blocks, parallel);
+            stats.compressMs += elapsedMs(start);
+            uint32_t bytes = static_cast<uint32_t>(blocks.size());
+            file.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+            file.write(reinterpret_cast<const char*>(blocks.data()), bytes);
+            stats.compiledBytes += bytes;
+            if(i + 1 < header.levels){
+                start = chrono::steady_clock::now();
+                downsample(level, next, filter);
+                swap(level, next);
+                stats.buildMs += elapsedMs(start);
+            }
+        }
+        if(!file.good()){
+            cout << "ERROR::MATERIAL::TEXTURE_NOT_SUCCESFULLY_WRITTEN " << path << endl;
+            return false;
+        }
+        return true;
+    }
+
+    static MaterialImage copyImage(const SourceImage &source){
+        MaterialImage image;
+        image.width = source.width;
+        image.height = source.height;
+        image.rgba.assign(source.data, source.data + static_cast<size_t>(source.width) * source.height * 4);
+        return image;
+    }
+
+    //反照率是常数时只写入系数，否则压缩为BC1 sRGB
+    bool compileAlbedo(const MaterialSource &source, const map<string, SourceImage> &images, const string &directory, MaterialDescriptor &descriptor){
+        if(source.albedo.empty())
+            return true;
+        PROFILE_SCOPE("Albedo");
+        auto start = chrono::steady_clock::now();
+        const SourceImage &image = images.at(source.albedo);
+        bool constant = true;
+        glm::vec3 mean;
+        for(int c = 0; c < 3; c++){
+            int minValue, maxValue;
+            channelRange(image, c, minValue, maxValue, mean[c]);
+            constant = constant && isConstant(minValue, maxValue);
+        }
+        if(constant){
+            for(int c = 0; c < 3; c++)
+                descriptor.albedoFactor[c] = srgbTable()[static_cast<int>(mean[c] + 0.5f)];
+            stats.buildMs += elapsedMs(start);
+            return true;
+        }
+        MaterialImage albedo = copyImage(image);
+        stats.buildMs += elapsedMs(start);
+        descriptor.albedoTexture = source.name + "_albedo.ctex";
+        stats.albedoFormat = "BC1 sRGB";
+        return writeTexture(directory + descriptor.albedoTexture, albedo, BLOCK_BC1, true, MIP_SRGB);
+    }
+
+    //xy都是0（颜色128）附近的常数时法线贴图是平的，不生成纹理；否则xy压缩为BC5
+    bool compileNormal(const MaterialSource &source, const map<string, SourceImage> &images, const string &directory, MaterialDescriptor &descriptor){
+        if(source.normal.empty())
+            return true;
+        PROFILE_SCOPE("Normal");
+        auto start = chrono::steady_clock::now();
+        const SourceImage &image = images.at(source.normal);
+        bool flat = true;
+        for(int c = 0; c < 2; c++){
+            int minValue, maxValue;
+            float mean;
+            channelRange(image, c, minValue, maxValue, mean);
+            flat = flat && isConstant(minValue, maxValue) && fabs(mean - 127.5f) <= MATERIAL_CONSTANT_TOLERANCE;
+        }
+        if(flat){
+            stats.buildMs += elapsedMs(start);
+            return true;
+        }
+        MaterialImage normal = copyImage(image);
+        stats.buildMs += elapsedMs(start);
+        descriptor.normalTexture = source.name + "_normal.ctex";
+        stats.normalFormat = "BC5";
+        return writeTexture(directory + descriptor.normalTexture, normal, BLOCK_BC5, false, MIP_NORMAL);
+    }
+
+    //AO、粗糙度、金属度中不是常数的通道依次打包到r、g、b，尺寸取这些贴图中最大的，尺寸不同时最近点采样
+    bool compileORM(const MaterialSource &source, const map<string, SourceImage> &images, const string &directory, MaterialDescriptor &descriptor){
+        PROFILE_SCOPE("ORM");
+        auto start = chrono::steady_clock::now();
+        int varying[3], varyingCount = 0;
+        int width = 0, height = 0;
+        for(int s = 0; s < 3; s++){
+            const MaterialScalar &scalar = source.scalars[s];
+            descriptor.ormFactor[s] = scalar.constant;
+            descriptor.ormSwizzle[s] = '1';
+            if(scalar.path.empty())
+                continue;
+            const SourceImage &image = images.at(scalar.path);
+            int minValue, maxValue;
+            float mean;
+            channelRange(image, scalar.channel, minValue, maxValue, mean);
+            if(isConstant(minValue, maxValue)){
+                descriptor.ormFactor[s] = mean / 255.0f;
+                continue;
+            }
+            descriptor.ormFactor[s] = 1.0f;
+            descriptor.ormSwizzle[s] = "rgb"[varyingCount];
+            varying[varyingCount++] = s;
+            width = max(width, image.width);
+            height = max(height, image.height);
+        }
+        if(varyingCount == 0){
+            stats.buildMs += elapsedMs(start);
+            return true;
+        }
+        MaterialImage orm;
+        orm.width = width;
+        orm.height = height;
+        orm.rgba.assign(static_cast<size_t>(width) * height * 4, 255);
+        auto packRows = [&](unsigned int begin, unsigned int end){
+            for(int v = 0; v < varyingCount; v++){
+                const MaterialScalar &scalar = source.scalars[varying[v]];
+                const SourceImage &image = images.at(scalar.path);
+                for(unsigned int y = begin; y < end; y++){
+                    int sy = static_cast<int>(y) * image.height / height;
+                    for(int x = 0; x < width; x++){
+                        int sx = x * image.width / width;
+                        orm.rgba[(static_cast<size_t>(y) * width + x) * 4 + v] = image.data[(static_cast<size_t>(sy) * image.width + sx) * 4 + scalar.channel];
+                    }
+                }
+            }
+        };
+        if(parallel)
+            JobSystem::Get().ParallelFor(height, 64, packRows);
+        else
+            packRows(0, height);
+        stats.buildMs += elapsedMs(start);
+        BlockFormat format = varyingCount == 1 ? BLOCK_BC4 : (varyingCount == 2 ? BLOCK_BC5 : BLOCK_BC1);
+        descriptor.ormTexture = source.name + "_orm.ctex";
+        stats.ormFormat = string(format == BLOCK_BC4 ? "BC4" : (format == BLOCK_BC5 ? "BC5" : "BC1")) + " " + string(descriptor.ormSwizzle, 3);
+        return writeTexture(directory + descriptor.ormTexture, orm, format, false, MIP_LINEAR);
+    }
+
+    static bool writeDescriptor(const string &path, const MaterialDescriptor &descriptor){
+        ofstream file(path.c_str());
+        if(!file.is_open()){
+            cout << "ERROR::MATERIAL::DESCRIPTOR_NOT_SUCCESFULLY_WRITTEN " << path << endl;
+            return false;
+        }
+        auto texture = [](const string &name){
+            return name.empty() ? string("-") : name;
+        };
+        file << "# 由MaterialCompiler生成，Materials.txt中的定义或源贴图变化后会重新生成" << endl;
+        file << "version " << MATERIAL_DESCRIPTOR_VERSION << endl;
+        file << "material " << descriptor.name << endl;
+        file << "definition " << descriptor.definition << endl;
+        for(unsigned int i = 0; i < descriptor.stamps.size(); i++)
+            file << "stamp " << descriptor.stamps[i].size << " " << descriptor.stamps[i].mtime << " " << descriptor.stamps[i].path << endl;
+        file << "albedo " << texture(descriptor.albedoTexture) << " " << descriptor.albedoFactor.x << " " << descriptor.albedoFactor.y << " "
+            << descriptor.albedoFactor.z << endl;
+        file << "normal " << texture(descriptor.normalTexture) << endl;
+        file << "orm " << texture(descriptor.ormTexture) << " " << string(descriptor.ormSwizzle, 3) << " " << descriptor.ormFactor.x << " "
+            << descriptor.ormFactor.y << " " << descriptor.ormFactor.z << endl;
+        return file.good();
+    }
+};
+
+#endif
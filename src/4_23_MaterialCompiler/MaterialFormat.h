@@ -0,0 +1,234 @@
+#ifndef MATERIALFORMAT_H
+#define MATERIALFORMAT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "BlockCompression.h"
+using namespace std;
+
+//S3TC（BC1）来自扩展，glad生成的核心模式头文件中没有这些常量
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+
+//编译后的材质，运行时只需要这个文件，编译工具在MaterialCompiler.h中
+//每个材质一个文本描述文件（.material）加最多三张压缩纹理（.ctex）：
+//  albedo 反照率，BC1 sRGB
+//  normal 切线空间法线的xy，BC5，着色器中重建z
+//  orm    AO、粗糙度、金属度中不是常数的通道打包在一起，1个通道BC4，2个BC5，3个BC1
+//贴图是常数的通道不生成纹理，值写入描述文件的系数；采样结果的通道顺序用纹理的swizzle参数调整为AO 粗糙度 金属度
+#define MATERIAL_TEXTURE_MAGIC 0x58455443 //"CTEX"
+#define MATERIAL_TEXTURE_VERSION 1
+#define MATERIAL_DESCRIPTOR_VERSION 1
+
+//.ctex文件：头部后依次是从第0级开始的每级mipmap，每级前有一个uint32_t表示字节数
+struct CompiledTextureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;//BlockFormat
+    uint32_t srgb;//1表示数据在sRGB空间
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+};
+
+//源文件的大小与修改时间，任意一个变化都需要重新编译
+struct MaterialStamp {
+    string path;
+    long long size;
+    long long mtime;
+};
+
+struct MaterialDescriptor {
+    string name;
+    string definition;//Materials.txt中定义这个材质的一行，定义变化也需要重新编译
+    vector<MaterialStamp> stamps;
+    string albedoTexture;//相对描述文件所在的目录，空表示没有贴图，只使用albedoFactor
+    string normalTexture;//空表示法线贴图是平的，直接使用顶点法线
+    string ormTexture;
+    char ormSwizzle[3] = {'1', '1', '1'};//AO、粗糙度、金属度分别来自贴图的哪个通道，'1'表示常数
+    glm::vec3 albedoFactor = glm::vec3(1.0f);//线性空间
+    glm::vec3 ormFactor = glm::vec3(1.0f);
+
+    unsigned int TextureCount() const{
+        return !albedoTexture.empty() + !normalTexture.empty() + !ormTexture.empty();
+    }
+};
+
+inline string MaterialDescriptorPath(const string &directory, const string &name){
+    return directory + name + ".material";
+}
+
+//读取描述文件，文件不存在或版本不同时返回false
+bool ReadMaterialDescriptor(const string &path, MaterialDescriptor &descriptor){
+    ifstream file(path.c_str());
+    if(!file.is_open())
+        return false;
+    descriptor = MaterialDescriptor();
+    string line;
+    unsigned int version = 0;
+    while(getline(file, line)){
+        if(line.empty() || line[0] == '#')
+            continue;
+        istringstream stream(line);
+        string key;
+        stream >> key;
+        if(key == "version")
+            stream >> version;
+        else if(key == "material")
+            stream >> descriptor.name;
+        else if(key == "definition"){
+            getline(stream >> ws, descriptor.definition);
+        }else if(key == "stamp"){
+            MaterialStamp stamp;
+            stream >> stamp.size >> stamp.mtime;
+            getline(stream >> ws, stamp.path);
+            descriptor.stamps.push_back(stamp);
+        }else if(key == "albedo"){
+            stream >> descriptor.albedoTexture >> descriptor.albedoFactor.x >> descriptor.albedoFactor.y >> descriptor.albedoFactor.z;
+        }else if(key == "normal"){
+            stream >> descriptor.normalTexture;
+        }else if(key == "orm"){
+            string swizzle;
+            stream >> descriptor.ormTexture >> swizzle >> descriptor.ormFactor.x >> descriptor.ormFactor.y >> descriptor.ormFactor.z;
+            if(swizzle.size() == 3)
+                memcpy(descriptor.ormSwizzle, swizzle.data(), 3);
+        }
+        if(stream.fail()){
+            cout << "ERROR::MATERIAL::DESCRIPTOR_PARSE_FAILED " << path << ": " << line << endl;
+            return false;
+        }
+    }
+    if(descriptor.albedoTexture == "-")
+        descriptor.albedoTexture.clear();
+    if(descriptor.normalTexture == "-")
+        descriptor.normalTexture.clear();
+    if(descriptor.ormTexture == "-")
+        descriptor.ormTexture.clear();
+    return version == MATERIAL_DESCRIPTOR_VERSION;
+}
+
+//驱动是否支持BC1，sRGB的BC1还需要EXT_texture_sRGB
+bool SupportsS3TC(){
+    static int supported = -1;
+    if(supported < 0){
+        bool s3tc = false, srgb = false;
+        int count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for(int i = 0; i < count; i++){
+            string name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            s3tc = s3tc || name == "GL_EXT_texture_compression_s3tc";
+            srgb = srgb || name == "GL_EXT_texture_sRGB" || name == "GL_EXT_texture_compression_s3tc_srgb";
+        }
+        supported = s3tc && srgb ? 1 : 0;
+    }
+    return supported == 1;
+}
+
+//读取.ctex并上传所有mipmap，bytes返回显存中的大小；BC1不被支持时在CPU上解压为RGBA8
+unsigned int LoadCompiledTexture(const string &path, size_t &bytes){
+    ifstream file(path.c_str(), ios::binary);
+    CompiledTextureHeader header;
+    if(!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != MATERIAL_TEXTURE_MAGIC
+        || header.version != MATERIAL_TEXTURE_VERSION){
+        cout << "ERROR::MATERIAL::TEXTURE_NOT_SUCCESFULLY_READ " << path << endl;
+        return 0;
+    }
+    BlockFormat format = static_cast<BlockFormat>(header.format);
+    bool decompress = format == BLOCK_BC1 && !SupportsS3TC();
+    GLenum internalFormat = format == BLOCK_BC4 ? GL_COMPRESSED_RED_RGTC1 : (format == BLOCK_BC5 ? GL_COMPRESSED_RG_RGTC2
+        : (header.srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT));
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    vector<unsigned char> data, rgba;
+    bytes = 0;
+    int width = header.width, height = header.height;
+    for(unsigned int level = 0; level < header.levels; level++){
+        uint32_t size = 0;
+        file.read(reinterpret_cast<char*>(&size), sizeof(size));
+        data.resize(size);
+        if(!file.read(reinterpret_cast<char*>(data.data()), size) || size != CompressedSize(format, width, height)){
+            cout << "ERROR::MATERIAL::TEXTURE_TRUNCATED " << path << endl;
+            glDeleteTextures(1, &texture);
+            return 0;
+        }
+        if(decompress){
+            DecompressBC1(data.data(), width, height, rgba);
+            glTexImage2D(GL_TEXTURE_2D, level, header.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+            bytes += rgba.size();
+        }else{
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, size, data.data());
+            bytes += size;
+        }
+        width = max(width / 2, 1);
+        height = max(height / 2, 1);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+//一个材质在GPU上的纹理，没有的贴图为0
+struct MaterialTextures {
+    unsigned int albedo = 0;
+    unsigned int normal = 0;
+    unsigned int orm = 0;
+    size_t bytes = 0;
+
+    void Release(){
+        unsigned int textures[3] = {albedo, normal, orm};
+        for(int i = 0; i < 3; i++){
+            if(textures[i] != 0)
+                glDeleteTextures(1, &textures[i]);
+        }
+        albedo = normal = orm = 0;
+        bytes = 0;
+    }
+};
+
+//swizzle字符对应的纹理通道
+inline GLint SwizzleSource(char channel){
+    return channel == 'r' ? GL_RED : (channel == 'g' ? GL_GREEN : (channel == 'b' ? GL_BLUE : (channel == 'a' ? GL_ALPHA : GL_ONE)));
+}
+
+//上传描述文件引用的纹理，orm纹理的swizzle设置为采样结果的rgb依次是AO、粗糙度、金属度
+bool LoadMaterialTextures(const string &directory, const MaterialDescriptor &descriptor, MaterialTextures &textures){
+    textures.Release();
+    size_t bytes = 0;
+    if(!descriptor.albedoTexture.empty()){
+        textures.albedo = LoadCompiledTexture(directory + descriptor.albedoTexture, bytes);
+        textures.bytes += bytes;
+    }
+    if(!descriptor.normalTexture.empty()){
+        textures.normal = LoadCompiledTexture(directory + descriptor.normalTexture, bytes);
+        textures.bytes += bytes;
+    }
+    if(!descriptor.ormTexture.empty()){
+        textures.orm = LoadCompiledTexture(directory + descriptor.ormTexture, bytes);
+        textures.bytes += bytes;
+        if(textures.orm != 0){
+            GLint swizzle[4] = {SwizzleSource(descriptor.ormSwizzle[0]), SwizzleSource(descriptor.ormSwizzle[1]), SwizzleSource(descriptor.ormSwizzle[2]), GL_ONE};
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+    }
+    return (descriptor.albedoTexture.empty() || textures.albedo != 0) && (descriptor.normalTexture.empty() || textures.normal != 0)
+        && (descriptor.ormTexture.empty() || textures.orm != 0);
+}
+
+#endif
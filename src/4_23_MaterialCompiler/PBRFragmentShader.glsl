@@ -0,0 +1,118 @@
+#version 330 core
+in vec3 WorldPos;
+in vec2 TexCoords;
+in mat3 TBN;
+out vec4 FragColor;
+
+//编译后的材质最多三张纹理：反照率、法线（只有xy）、AO 粗糙度 金属度打包的ORM
+//ORM纹理的swizzle参数已经把通道排成AO 粗糙度 金属度，常数通道为1，乘以ormFactor得到实际值
+uniform sampler2D albedoMap;
+uniform sampler2D normalMap;
+uniform sampler2D ormMap;
+uniform bool hasAlbedoMap;
+uniform bool hasNormalMap;
+uniform bool hasOrmMap;
+uniform vec3 albedoFactor;
+uniform vec3 ormFactor;
+//未编译的材质：AO、粗糙度、金属度是三张单独的贴图（ormMap、roughnessMap、metallicMap的r通道），用于对比
+uniform bool separateMaps;
+uniform sampler2D roughnessMap;
+uniform sampler2D metallicMap;
+
+//预计算的IBL，与4_22_IBLBaker相同
+uniform vec3 sh[9];
+uniform samplerCube prefilterMap;
+uniform sampler2D brdfLUT;
+uniform float maxReflectionLod;
+
+uniform vec3 lightDirection;
+uniform vec3 lightColor;
+uniform vec3 camPos;
+uniform float exposure;
+
+const float PI = 3.14159265359;
+
+vec3 irradianceSH(vec3 n)
+{
+    vec3 result = sh[0] * 0.282095
+        + sh[1] * 0.488603 * n.y
+        + sh[2] * 0.488603 * n.z
+        + sh[3] * 0.488603 * n.x
+        + sh[4] * 1.092548 * n.x * n.y
+        + sh[5] * 1.092548 * n.y * n.z
+        + sh[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + sh[7] * 1.092548 * n.x * n.z
+        + sh[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
+vec3 fresnelSchlick(float cosTheta, vec3 F0)
+{
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
+{
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+float distributionGGX(float NdotH, float roughness)
+{
+    float a2 = roughness * roughness * roughness * roughness;
+    float d = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    return a2 / (PI * d * d);
+}
+
+float geometrySmith(float NdotV, float NdotL, float roughness)
+{
+    float k = (roughness + 1.0) * (roughness + 1.0) / 8.0;
+    return NdotV / (NdotV * (1.0 - k) + k) * NdotL / (NdotL * (1.0 - k) + k);
+}
+
+void main()
+{
+    vec3 albedo = albedoFactor;
+    if(hasAlbedoMap)
+        albedo *= texture(albedoMap, TexCoords).rgb;
+    vec3 orm = ormFactor;
+    if(separateMaps)
+        orm *= vec3(texture(ormMap, TexCoords).r, texture(roughnessMap, TexCoords).r, texture(metallicMap, TexCoords).r);
+    else if(hasOrmMap)
+        orm *= texture(ormMap, TexCoords).rgb;
+    float ao = orm.r;
+    float roughness = clamp(orm.g, 0.05, 1.0);
+    float metallic = orm.b;
+    //法线贴图只保存xy，z由单位长度重建
+    vec3 N = TBN[2];
+    if(hasNormalMap){
+        vec3 n;
+        n.xy = texture(normalMap, TexCoords).rg * 2.0 - 1.0;
+        n.z = sqrt(max(1.0 - dot(n.xy, n.xy), 0.0));
+        N = TBN * n;
+    }
+    N = normalize(N);
+    vec3 V = normalize(camPos - WorldPos);
+    vec3 R = reflect(-V, N);
+    float NdotV = max(dot(N, V), 1e-4);
+    vec3 F0 = mix(vec3(0.04), albedo, metallic);
+
+    //方向光的Cook-Torrance直接光照
+    vec3 L = normalize(-lightDirection);
+    vec3 H = normalize(V + L);
+    float NdotL = max(dot(N, L), 0.0);
+    vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+    vec3 specularDirect = distributionGGX(max(dot(N, H), 0.0), roughness) * geometrySmith(NdotV, NdotL, roughness) * F / (4.0 * NdotV * max(NdotL, 1e-4));
+    vec3 kDDirect = (1.0 - F) * (1.0 - metallic);
+    vec3 direct = (kDDirect * albedo / PI + specularDirect) * lightColor * NdotL;
+
+    //IBL环境光，AO只作用于环境光
+    vec3 FR = fresnelSchlickRoughness(NdotV, F0, roughness);
+    vec3 kD = (1.0 - FR) * (1.0 - metallic);
+    vec3 prefiltered = textureLod(prefilterMap, R, roughness * maxReflectionLod).rgb;
+    vec2 brdf = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+    vec3 ambient = (kD * irradianceSH(N) * albedo + prefiltered * (FR * brdf.x + brdf.y)) * ao;
+
+    vec3 color = direct + ambient;
+    vec3 mapped = vec3(1.0) - exp(-color * exposure);
+    FragColor = vec4(pow(mapped, vec3(1.0 / 2.2)), 1.0);
+}
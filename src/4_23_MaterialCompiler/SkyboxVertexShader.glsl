@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+out vec3 TexCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    TexCoords = aPos;
+    //去掉观察矩阵的平移，天空盒总是围绕摄像机
+    vec4 pos = projection * mat4(mat3(view)) * vec4(aPos, 1.0);
+    //z = w，透视除法后深度为1，只在没有物体的地方通过GL_LEQUAL深度测试
+    gl_Position = pos.xyww;
+}
@@ -0,0 +1,595 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "Model.h"
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "IBLBaker.h"
+#include "MaterialFormat.h"
+#include "MaterialCompiler.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_23_MaterialCompiler/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+CustomCamera camera(glm::vec3(0.0f, 0.0f, 5.5f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//编译结果与IBL缓存都放在output目录，IBL缓存与4_22_IBLBaker共用
+const string MATERIAL_DIRECTORY = "./output/";
+const string ENVIRONMENT_CACHE = "./output/Park3Med_ibl.bin";
+const string BRDF_CACHE = "./output/ibl_brdf.bin";
+const float EXPOSURE = 1.5f;
+const float SPIN_SPEED = 0.4f;//弧度/秒
+
+bool compiledEnabled = true;//false时使用未编译的分散贴图，用于对比绑定次数与显存
+bool recompileRequested = false;
+bool jobsEnabled = true;
+bool compiledKeyDown = false;
+bool recompileKeyDown = false;
+bool jobsKeyDown = false;
+bool traceKeyDown = false;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //C键在编译后的材质与分散贴图之间切换，R键忽略描述文件重新编译所有材质，J键在任务系统与单线程之间切换
+    bool key = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    if(key && !compiledKeyDown)
+        compiledEnabled = !compiledEnabled;
+    compiledKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+    if(key && !recompileKeyDown)
+        recompileRequested = true;
+    recompileKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS;
+    if(key && !jobsKeyDown)
+        jobsEnabled = !jobsEnabled;
+    jobsKeyDown = key;
+    //T键导出最近的帧为Chrome trace，并在控制台输出各作用域的平均耗时
+    key = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+    if(key && !traceKeyDown){
+        Profiler::Get().ExportChromeTrace("./output/profile_trace.json");
+        vector<ProfileSummary> summary = Profiler::Get().Summarize();
+        cout << left << setw(28) << "scope" << right << setw(10) << "cpu ms" << setw(10) << "gpu ms" << setw(8) << "calls" << endl;
+        cout << fixed << setprecision(3);
+        for(unsigned int i = 0; i < summary.size(); i++)
+            cout << left << setw(28) << summary[i].name << right << setw(10) << summary[i].cpuMs << setw(10) << summary[i].gpuMs << setw(8) << summary[i].calls << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+    }
+    traceKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+//场景中的一个材质：编译后的纹理，以及对比用的分散贴图（第一次切换时才加载）
+struct SceneMaterial {
+    MaterialSource source;
+    MaterialDescriptor descriptor;
+    MaterialTextures compiled;
+    MaterialCompileStats stats;
+    unsigned int separate[5] = {0, 0, 0, 0, 0};//反照率 法线 AO 粗糙度 金属度，没有贴图的为0
+    size_t separateBytes = 0;
+    bool separateLoaded = false;
+};
+
+int findMaterial(const vector<SceneMaterial> &materials, const string &name){
+    for(unsigned int i = 0; i < materials.size(); i++){
+        if(materials[i].source.name == name)
+            return i;
+    }
+    return -1;
+}
+
+void printCompileStats(const string &name, const MaterialDescriptor &descriptor, const MaterialCompileStats &stats){
+    cout << name << ": ";
+    if(stats.fromCache)
+        cout << "up to date, " << descriptor.TextureCount() << " textures" << endl;
+    else
+        cout << "compiled " << stats.sourceTextures << " maps into " << descriptor.TextureCount() << " textures in " << stats.decodeMs + stats.buildMs + stats.compressMs
+            << " ms (albedo " << stats.albedoFormat << ", normal " << stats.normalFormat << ", orm " << stats.ormFormat << ")" << endl;
+}
+
+//读取描述文件或重新编译，然后上传编译后的纹理
+bool loadMaterial(SceneMaterial &material, MaterialCompiler &compiler, bool force){
+    compiler.parallel = jobsEnabled;
+    if(!compiler.LoadOrCompile(material.source, MATERIAL_DIRECTORY, material.descriptor, force))
+        return false;
+    material.stats = compiler.stats;
+    printCompileStats(material.source.name, material.descriptor, material.stats);
+    return LoadMaterialTextures(MATERIAL_DIRECTORY, material.descriptor, material.compiled);
+}
+
+//不编译时的做法：每张贴图解码为RGBA8单独上传，标量贴图用swizzle取出指定的通道
+void loadSeparateMaps(SceneMaterial &material){
+    const MaterialSource &source = material.source;
+    string paths[5] = {source.albedo, source.normal, source.scalars[0].path, source.scalars[1].path, source.scalars[2].path};
+    struct SeparateImage {
+        unsigned char *data = nullptr;
+        int width = 0, height = 0;
+    } images[5];
+    JobCounter counter;
+    for(int i = 0; i < 5; i++){
+        if(paths[i].empty())
+            continue;
+        SeparateImage *image = &images[i];
+        string path = paths[i];
+        JobSystem::Get().Run([image, path](){
+            image->data = stbi_load(path.c_str(), &image->width, &image->height, nullptr, 4);
+        }, &counter);
+    }
+    JobSystem::Get().Wait(counter);
+    for(int i = 0; i < 5; i++){
+        if(images[i].data == nullptr){
+            if(!paths[i].empty())
+                cout << "ERROR::MATERIAL::TEXTURE_FAILED_TO_LOAD " << paths[i] << endl;
+            continue;
+        }
+        glGenTextures(1, &material.separate[i]);
+        glBindTexture(GL_TEXTURE_2D, material.separate[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, i == 0 ? GL_SRGB8_ALPHA8 : GL_RGBA8, images[i].width, images[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, images[i].data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        if(i >= 2)
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_RED + source.scalars[i - 2].channel);
+        material.separateBytes += static_cast<size_t>(images[i].width) * images[i].height * 4 * 4 / 3;
+        stbi_image_free(images[i].data);
+    }
+    material.separateLoaded = true;
+}
+
+//绑定材质的纹理并设置uniform，返回绑定的纹理数量
+//分散贴图中没有的标量贴图绑定1x1的白色纹理，值由ormFactor给出
+unsigned int bindMaterial(CustomShader &shader, const SceneMaterial &material, bool compiled, unsigned int whiteTexture){
+    unsigned int binds = 0;
+    auto bind = [&](unsigned int unit, unsigned int texture){
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        binds++;
+    };
+    if(compiled){
+        const MaterialDescriptor &descriptor = material.descriptor;
+        const MaterialTextures &textures = material.compiled;
+        if(textures.albedo != 0)
+            bind(0, textures.albedo);
+        if(textures.normal != 0)
+            bind(1, textures.normal);
+        if(textures.orm != 0)
+            bind(2, textures.orm);
+        shader.setBool("hasAlbedoMap", textures.albedo != 0);
+        shader.setBool("hasNormalMap", textures.normal != 0);
+        shader.setBool("hasOrmMap", textures.orm != 0);
+        shader.setBool("separateMaps", false);
+        shader.setVec3("albedoFactor", descriptor.albedoFactor);
+        shader.setVec3("ormFactor", descriptor.ormFactor);
+    }else{
+        const MaterialSource &source = material.source;
+        if(material.separate[0] != 0)
+            bind(0, material.separate[0]);
+        if(material.separate[1] != 0)
+            bind(1, material.separate[1]);
+        glm::vec3 ormFactor;
+        for(int s = 0; s < 3; s++){
+            bind(2 + s, material.separate[2 + s] != 0 ? material.separate[2 + s] : whiteTexture);
+            ormFactor[s] = material.separate[2 + s] != 0 ? 1.0f : source.scalars[s].constant;
+        }
+        shader.setBool("hasAlbedoMap", material.separate[0] != 0);
+        shader.setBool("hasNormalMap", material.separate[1] != 0);
+        shader.setBool("hasOrmMap", true);
+        shader.setBool("separateMaps", true);
+        shader.setVec3("albedoFactor", glm::vec3(1.0f));
+        shader.setVec3("ormFactor", ormFactor);
+    }
+    return binds;
+}
+
+//不创建窗口，忽略描述文件重新编译所有材质，输出格式选择、显存与各阶段的耗时
+int compileAll(){
+    vector<MaterialSource> sources;
+    if(!MaterialCompiler::Parse(Path + "Materials.txt", sources))
+        return -1;
+    MaterialCompiler compiler;
+    cout << "Material compiler: " << JobSystem::Get().ThreadCount() << " threads, " << sources.size() << " materials" << endl;
+    cout << left << setw(10) << "material" << right << setw(6) << "maps" << setw(9) << "src MB" << setw(6) << "tex" << setw(8) << "MB"
+        << "  " << left << setw(10) << "albedo" << setw(8) << "normal" << setw(10) << "orm" << right << setw(9) << "decode" << setw(9) << "build"
+        << setw(10) << "compress" << endl;
+    cout << fixed << setprecision(2);
+    for(unsigned int i = 0; i < sources.size(); i++){
+        MaterialDescriptor descriptor;
+        if(!compiler.Compile(sources[i], MATERIAL_DIRECTORY, descriptor))
+            return -1;
+        const MaterialCompileStats &stats = compiler.stats;
+        cout << left << setw(10) << sources[i].name << right << setw(6) << stats.sourceTextures << setw(9) << stats.sourceBytes / 1048576.0
+            << setw(6) << descriptor.TextureCount() << setw(8) << stats.compiledBytes / 1048576.0 << "  " << left << setw(10) << stats.albedoFormat
+            << setw(8) << stats.normalFormat << setw(10) << stats.ormFormat << right << setw(9) << stats.decodeMs << setw(9) << stats.buildMs
+            << setw(10) << stats.compressMs << endl;
+    }
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+    return 0;
+}
+
+//UV球，顶点格式与模型相同；切线沿经线方向，副切线指向北极（贴图的上方）
+Mesh buildSphere(unsigned int segments){
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    for(unsigned int y = 0; y <= segments; y++){
+        for(unsigned int x = 0; x <= segments; x++){
+            float u = static_cast<float>(x) / segments, v = static_cast<float>(y) / segments;
+            float theta = v * glm::pi<float>(), phi = u * glm::two_pi<float>();
+            Vertex vertex = {};
+            vertex.Position = glm::vec3(cos(phi) * sin(theta), cos(theta), -sin(phi) * sin(theta));
+            vertex.Normal = vertex.Position;
+            vertex.TexCoords = glm::vec2(u * 2.0f, v);
+            vertex.Tangent = glm::vec3(-sin(phi), 0.0f, -cos(phi));
+            vertex.Bitangent = glm::vec3(-cos(phi) * cos(theta), sin(theta), sin(phi) * cos(theta));
+            vertices.push_back(vertex);
+        }
+    }
+    for(unsigned int y = 0; y < segments; y++){
+        for(unsigned int x = 0; x < segments; x++){
+            unsigned int i0 = y * (segments + 1) + x, i1 = i0 + segments + 1;
+            indices.insert(indices.end(), {i0, i1, i0 + 1, i0 + 1, i1, i1 + 1});
+        }
+    }
+    return Mesh(vertices, indices, vector<Texture>());
+}
+
+//原始环境作为天空盒，面是sRGB的JPEG
+unsigned int uploadSkybox(const CubeFaces &faces){
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for(int f = 0; f < 6; f++)
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, GL_SRGB8, faces.size, faces.size, 0, GL_RGB, GL_UNSIGNED_BYTE, faces.data[f]);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+unsigned int uploadPrefilter(const IBLEnvironment &environment){
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for(unsigned int level = 0; level < environment.specular.size(); level++){
+        const CubeLevel &cube = environment.specular[level];
+        for(int f = 0; f < 6; f++)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, level, GL_RGB16F, cube.size, cube.size, 0, GL_RGBA, GL_FLOAT, cube.Face(f));
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, static_cast<int>(environment.specular.size()) - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+unsigned int uploadBRDF(const IBLBRDFTable &table){
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, table.size, table.size, 0, GL_RG, GL_FLOAT, table.texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+int main(int argc, char *argv[]){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    //--threads N指定参与执行任务的线程数，默认为硬件线程数
+    //--compile  不创建窗口，重新编译所有材质
+    int threads = 0;
+    bool compile = false;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--threads" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(arg == "--compile")
+            compile = true;
+    }
+    JobSystem::Get().Init(threads > 0 ? threads - 1 : -1);
+    if(compile){
+        int result = compileAll();
+        JobSystem::Get().Shutdown();
+        return result;
+    }
+    cout << "Job system: " << JobSystem::Get().ThreadCount() << " threads" << endl;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 2.0f;
+    Profiler::Get().InitGPU();
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    cout << "S3TC: " << (SupportsS3TC() ? "supported" : "not supported, BC1 textures are decompressed on load") << endl;
+
+    CustomShader pbrShader((Path + "PBRVertexShader.glsl").c_str(), (Path + "PBRFragmentShader.glsl").c_str());
+    CustomShader skyboxShader((Path + "SkyboxVertexShader.glsl").c_str(), (Path + "SkyboxFragmentShader.glsl").c_str());
+
+    //环境光照：读取4_22_IBLBaker写入的缓存，缓存不存在时在这里烘焙
+    vector<string> faces = {"px.jpg", "nx.jpg", "py.jpg", "ny.jpg", "pz.jpg", "nz.jpg"};
+    for(unsigned int f = 0; f < faces.size(); f++)
+        faces[f] = "./static/texture/Park3Med/" + faces[f];
+    CubeFaces cubeFaces;
+    IBLBaker baker;
+    IBLEnvironment environment;
+    IBLBRDFTable brdfTable;
+    if(!DecodeCubeFaces(faces, cubeFaces, true) || !baker.LoadOrBake(faces, cubeFaces, ENVIRONMENT_CACHE, environment)
+        || !baker.LoadOrBakeBRDF(BRDF_CACHE, brdfTable)){
+        glfwTerminate();
+        JobSystem::Get().Shutdown();
+        return -1;
+    }
+    unsigned int skyboxTexture = uploadSkybox(cubeFaces);
+    unsigned int prefilterTexture = uploadPrefilter(environment);
+    unsigned int brdfTexture = uploadBRDF(brdfTable);
+    cubeFaces.Release();
+
+    //编译（或读取）所有材质
+    vector<MaterialSource> sources;
+    if(!MaterialCompiler::Parse(Path + "Materials.txt", sources)){
+        glfwTerminate();
+        JobSystem::Get().Shutdown();
+        return -1;
+    }
+    MaterialCompiler compiler;
+    vector<SceneMaterial> materials(sources.size());
+    for(unsigned int i = 0; i < sources.size(); i++){
+        materials[i].source = sources[i];
+        if(!loadMaterial(materials[i], compiler, false))
+            cout << "ERROR::MATERIAL::LOAD_FAILED " << sources[i].name << endl;
+    }
+    unsigned int whiteTexture;
+    const unsigned char white[4] = {255, 255, 255, 255};
+    glGenTextures(1, &whiteTexture);
+    glBindTexture(GL_TEXTURE_2D, whiteTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    //Cerberus使用cerberus材质，两侧的球分别使用solar与tiles
+    Model cerberus;
+    if(cerberus.Import("./static/model/cerberus/Cerberus.obj"))
+        cerberus.Upload();
+    int cerberusMaterial = findMaterial(materials, "cerberus");
+    Mesh sphere = buildSphere(64);
+    int sphereMaterials[2] = {findMaterial(materials, "solar"), findMaterial(materials, "tiles")};
+    const glm::vec3 spherePositions[2] = {glm::vec3(-2.2f, 0.0f, 0.0f), glm::vec3(2.2f, 0.0f, 0.0f)};
+    glm::mat4 cerberusModel(1.0f);
+    if(cerberus.sphere.radius > 0.0f)
+        cerberusModel = glm::scale(glm::mat4(1.0f), glm::vec3(1.2f / cerberus.sphere.radius)) * glm::translate(glm::mat4(1.0f), -cerberus.sphere.center);
+
+    float skyboxVertices[] = {
+        -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f,
+        -1.0f, -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f,  1.0f,
+         1.0f, -1.0f, -1.0f,  1.0f, -1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f, -1.0f,
+        -1.0f, -1.0f,  1.0f, -1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f, -1.0f,  1.0f,
+        -1.0f,  1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f,  1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f, -1.0f,
+        -1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f, -1.0f,  1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  1.0f,  1.0f, -1.0f,  1.0f
+    };
+    unsigned int skyboxVAO, skyboxVBO;
+    glGenVertexArrays(1, &skyboxVAO);
+    glGenBuffers(1, &skyboxVBO);
+    glBindVertexArray(skyboxVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), skyboxVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    pbrShader.use();
+    pbrShader.setInt("albedoMap", 0);
+    pbrShader.setInt("normalMap", 1);
+    pbrShader.setInt("ormMap", 2);
+    pbrShader.setInt("roughnessMap", 3);
+    pbrShader.setInt("metallicMap", 4);
+    pbrShader.setInt("prefilterMap", 5);
+    pbrShader.setInt("brdfLUT", 6);
+    pbrShader.setFloat("maxReflectionLod", static_cast<float>(IBL_SPECULAR_LEVELS - 1));
+    for(int i = 0; i < 9; i++)
+        pbrShader.setVec3("sh[" + to_string(i) + "]", environment.sh[i]);
+    pbrShader.setVec3("lightDirection", glm::normalize(glm::vec3(-0.5f, -0.6f, -0.6f)));
+    pbrShader.setVec3("lightColor", 2.5f, 2.4f, 2.2f);
+    pbrShader.setFloat("exposure", EXPOSURE);
+    skyboxShader.use();
+    skyboxShader.setInt("environmentMap", 0);
+    skyboxShader.setFloat("lod", 0.0f);
+    skyboxShader.setFloat("exposure", EXPOSURE);
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    unsigned int binds = 0;
+    while (!glfwWindowShouldClose(window)){
+        Profiler::Get().BeginFrame();
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        processInput(window);
+
+        if(recompileRequested){
+            for(unsigned int i = 0; i < materials.size(); i++){
+                if(!loadMaterial(materials[i], compiler, true))
+                    cout << "ERROR::MATERIAL::LOAD_FAILED " << materials[i].source.name << endl;
+            }
+            recompileRequested = false;
+        }
+        if(!compiledEnabled){
+            for(unsigned int i = 0; i < materials.size(); i++){
+                if(!materials[i].separateLoaded)
+                    loadSeparateMaps(materials[i]);
+            }
+        }
+
+        //显示当前模式下所有材质的纹理数量、每帧的纹理绑定次数与纹理显存
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            unsigned int textureCount = 0;
+            size_t bytes = 0;
+            for(unsigned int i = 0; i < materials.size(); i++){
+                if(compiledEnabled)
+                    textureCount += materials[i].descriptor.TextureCount();
+                for(int t = 0; t < 5 && !compiledEnabled; t++)
+                    textureCount += materials[i].separate[t] != 0;
+                bytes += compiledEnabled ? materials[i].compiled.bytes : materials[i].separateBytes;
+            }
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame - " + (compiledEnabled ? "compiled" : "separate maps") + ": "
+                + to_string(textureCount) + " textures, " + to_string(binds) + " binds/frame, " + to_string(bytes / 1048576.0) + " MB"
+                + " - C: compiled/separate, R: recompile, J: jobs, T: export trace";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+        }
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        glm::mat4 spin = glm::rotate(glm::mat4(1.0f), currentFrame * SPIN_SPEED, glm::vec3(0.0f, 1.0f, 0.0f));
+        binds = 0;
+        {
+            PROFILE_PASS("Objects");
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            pbrShader.use();
+            pbrShader.setMat4("view", view);
+            pbrShader.setMat4("projection", projection);
+            pbrShader.setVec3("camPos", camera.Position);
+            glActiveTexture(GL_TEXTURE5);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterTexture);
+            glActiveTexture(GL_TEXTURE6);
+            glBindTexture(GL_TEXTURE_2D, brdfTexture);
+            if(cerberusMaterial >= 0 && !cerberus.meshes.empty()){
+                binds += bindMaterial(pbrShader, materials[cerberusMaterial], compiledEnabled, whiteTexture);
+                pbrShader.setMat4("model", spin * cerberusModel);
+                cerberus.Draw(pbrShader);
+            }
+            for(int i = 0; i < 2; i++){
+                if(sphereMaterials[i] < 0)
+                    continue;
+                binds += bindMaterial(pbrShader, materials[sphereMaterials[i]], compiledEnabled, whiteTexture);
+                pbrShader.setMat4("model", glm::translate(glm::mat4(1.0f), spherePositions[i]) * spin * glm::scale(glm::mat4(1.0f), glm::vec3(0.8f)));
+                sphere.Draw(pbrShader);
+            }
+        }
+        {
+            PROFILE_PASS("Skybox");
+            skyboxShader.use();
+            skyboxShader.setMat4("view", view);
+            skyboxShader.setMat4("projection", projection);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
+            glBindVertexArray(skyboxVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
+
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+    }
+    for(unsigned int i = 0; i < materials.size(); i++){
+        materials[i].compiled.Release();
+        for(int t = 0; t < 5; t++){
+            if(materials[i].separate[t] != 0)
+                glDeleteTextures(1, &materials[i].separate[t]);
+        }
+    }
+    glDeleteTextures(1, &whiteTexture);
+    glDeleteTextures(1, &skyboxTexture);
+    glDeleteTextures(1, &prefilterTexture);
+    glDeleteTextures(1, &brdfTexture);
+    glDeleteVertexArrays(1, &skyboxVAO);
+    glDeleteBuffers(1, &skyboxVBO);
+    Profiler::Get().Release();
+    JobSystem::Get().Shutdown();
+
+    glfwTerminate();
+
+    return 0;
+}
@@ -0,0 +1,308 @@
+#ifndef CONESTEPMAP_H
+#define CONESTEPMAP_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <sys/stat.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+#include "JobSystem.h"
+#include "Profiler.h"
+using namespace std;
+
+//SIMD指令集选择：一次处理同一行上相邻的4个纹素，它们的邻域在内存中也是相邻的
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONE_USE_SSE
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+//松弛锥步进（relaxed cone stepping）贴图的离线生成
+//深度图中每个纹素放一个顶点在表面上、开口向上的圆锥，锥的半径与深度之比（锥比）存进贴图，着色器中光线每步前进到当前纹素的锥面上
+//松弛锥允许圆锥与高度场相交，只要求从纹素正上方出发的光线在锥内最多穿过表面一次，两步之间最多有一个交点，最后用二分查找求出交点
+//光线离开实体的点一定在背向出发点的表面上，所以锥比就是所有比顶点浅、且背向顶点正上方的纹素q中：
+//  |q - p| / (depth(p) - depth(q))  的最小值（距离以纹理坐标为单位，深度为0~1）
+//邻域只搜索CONE_SEARCH_RADIUS个纹素，锥比同时限制为不超过 半径 / (depth(p) - 最浅深度)，更远的纹素给出的锥比一定更大，结果仍然是保守的
+//结果为RG8：r为深度，g为锥比的平方根（小锥比的精度更高），锥比最大为1
+#define CONE_CACHE_MAGIC 0x454E4F43 //"CONE"
+#define CONE_CACHE_VERSION 2
+#define CONE_MAX_SIZE 512 //边长超过这个值的深度图先缩小
+#define CONE_SEARCH_RADIUS 48 //搜索半径（纹素）
+#define CONE_ROW_GRAIN 4
+
+struct ConeStepMap {
+    int width = 0, height = 0;
+    vector<unsigned char> texels;//每个纹素2字节：深度、锥比的平方根
+};
+
+struct ConeStepStats {
+    bool fromCache = false;
+    double cacheMs = 0.0;
+    double decodeMs = 0.0;
+    double buildMs = 0.0;
+    double averageRatio = 0.0;
+    double averageSearch = 0.0;//每个纹素平均检查的邻域纹素数
+};
+
+class ConeStepGenerator {
+public:
+    bool parallel = true;//false时全部在当前线程上执行
+    ConeStepStats stats;
+
+    //heightPath为灰度图，isHeight为true时白色为高处（需要翻转为深度），false时白色为深处（例如bricks2_disp）
+    //缓存记录源文件的大小、修改时间与生成参数，都没有变化时直接读取；force为true时总是重新生成
+    bool LoadOrBuild(const string &heightPath, bool isHeight, const string &cachePath, ConeStepMap &map, bool force = false){
+        stats = ConeStepStats();
+        CacheHeader expected = {};
+        if(!stampSource(heightPath, isHeight, expected)){
+            cout << "ERROR::CONE::HEIGHT_MAP_NOT_FOUND " << heightPath << endl;
+            return false;
+        }
+        auto start = chrono::steady_clock::now();
+        if(!force && readCache(cachePath, expected, map)){
+            stats.fromCache = true;
+            stats.cacheMs = elapsedMs(start);
+            return true;
+        }
+        vector<float> depth;
+        int width, height;
+        if(!decodeDepth(heightPath, isHeight, depth, width, height))
+            return false;
+        stats.decodeMs = elapsedMs(start);
+        Build(depth, width, height, map);
+        expected.width = map.width;
+        expected.height = map.height;
+        writeCache(cachePath, expected, map);
+        return true;
+    }
+
+    //depth为0（表面最高处）~1（最深处），边长小于CONE_SEARCH_RADIUS的贴图也能正确平铺
+    void Build(const vector<float> &depth, int width, int height, ConeStepMap &map){
+        PROFILE_FUNCTION();
+        auto start = chrono::steady_clock::now();
+        //四周按平铺方式扩展CONE_SEARCH_RADIUS个纹素，邻域访问不需要取模；行尾多留3个，最后一组4个纹素可以直接读取
+        const int radius = CONE_SEARCH_RADIUS;
+        int paddedWidth = width + radius * 2 + 3, paddedHeight = height + radius * 2;
+        vector<float> padded(static_cast<size_t>(paddedWidth) * paddedHeight), gradientX(padded.size()), gradientY(padded.size());
+        for(int y = 0; y < paddedHeight; y++){
+            int sy = wrap(y - radius, height);
+            for(int x = 0; x < paddedWidth; x++)
+                padded[static_cast<size_t>(y) * paddedWidth + x] = depth[static_cast<size_t>(sy) * width + wrap(x - radius, width)];
+        }
+        //中心差分梯度，单位为深度/纹素
+        for(int y = 0; y < paddedHeight; y++){
+            for(int x = 0; x < paddedWidth; x++){
+                size_t i = static_cast<size_t>(y) * paddedWidth + x;
+                gradientX[i] = (padded[static_cast<size_t>(y) * paddedWidth + min(x + 1, paddedWidth - 1)] - padded[static_cast<size_t>(y) * paddedWidth + max(x - 1, 0)]) * 0.5f;
+                gradientY[i] = (padded[static_cast<size_t>(min(y + 1, paddedHeight - 1)) * paddedWidth + x] - padded[static_cast<size_t>(max(y - 1, 0)) * paddedWidth + x]) * 0.5f;
+            }
+        }
+        //邻域按距离从近到远排序，锥比不可能再变小时提前结束
+        vector<Offset> offsets;
+        for(int dy = -radius; dy <= radius; dy++){
+            for(int dx = -radius; dx <= radius; dx++){
+                if((dx == 0 && dy == 0) || dx * dx + dy * dy > radius * radius)
+                    continue;
+                Offset offset;
+                offset.dx = static_cast<float>(dx);
+                offset.dy = static_cast<float>(dy);
+                offset.distance = sqrt((dx / static_cast<float>(width)) * (dx / static_cast<float>(width)) + (dy / static_cast<float>(height)) * (dy / static_cast<float>(height)));
+                offset.index = static_cast<ptrdiff_t>(dy) * paddedWidth + dx;
+                offsets.push_back(offset);
+            }
+        }
+        sort(offsets.begin(), offsets.end(), [](const Offset &a, const Offset &b){
+            return a.distance < b.distance;
+        });
+        //搜索范围是dx² + dy² <= radius²，范围之外的纹素离顶点大于radius（例如(radius, 1)只比radius远一点）；任何纹素都不比最浅处更浅，锥比的分母不超过 depth(p) - minDepth
+        float searchLimit = radius / static_cast<float>(max(width, height));
+        float minDepth = *min_element(depth.begin(), depth.end());
+
+        map.width = width;
+        map.height = height;
+        map.texels.assign(static_cast<size_t>(width) * height * 2, 0);
+        vector<double> rowRatio(height, 0.0), rowSearch(height, 0.0);
+        auto buildRows = [&](unsigned int begin, unsigned int end){
+            for(unsigned int y = begin; y < end; y++){
+                const size_t rowStart = static_cast<size_t>(y + radius) * paddedWidth + radius;
+                for(int x = 0; x < width; x += 4){
+                    size_t center = rowStart + x;
+                    float ratios[4];
+                    rowSearch[y] += searchGroup(padded.data(), gradientX.data(), gradientY.data(), center, offsets, searchLimit, minDepth, ratios);
+                    for(int k = 0; k < 4 && x + k < width; k++){
+                        unsigned char *texel = &map.texels[(static_cast<size_t>(y) * width + x + k) * 2];
+                        texel[0] = static_cast<unsigned char>(min(max(padded[center + k] * 255.0f + 0.5f, 0.0f), 255.0f));
+                        //向下取整，保存的锥比不会比算出的大
+                        texel[1] = static_cast<unsigned char>(min(sqrt(ratios[k]), 1.0f) * 255.0f);
+                        rowRatio[y] += ratios[k];
+                    }
+                }
+            }
+        };
+        if(parallel)
+            JobSystem::Get().ParallelFor(height, CONE_ROW_GRAIN, buildRows);
+        else
+            buildRows(0, height);
+        for(int y = 0; y < height; y++){
+            stats.averageRatio += rowRatio[y];
+            stats.averageSearch += rowSearch[y];
+        }
+        stats.averageRatio /= static_cast<double>(width) * height;
+        stats.averageSearch /= static_cast<double>(width) * height;
+        stats.buildMs = elapsedMs(start);
+    }
+
+private:
+    struct CacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width, height;
+        uint32_t maxSize, radius;
+        uint32_t isHeight;
+        uint32_t sourceSize;
+        int64_t sourceTime;
+    };
+
+    struct Offset {
+        float dx, dy;//纹素
+        float distance;//纹理坐标
+        ptrdiff_t index;//在扩展后数组中的偏移
+    };
+
+    static double elapsedMs(chrono::steady_clock::time_point start){
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    static int wrap(int value, int size){
+        return ((value % size) + size) % size;
+    }
+
+    //从center开始同一行上4个纹素的锥比，返回每个纹素平均检查的邻域数
+    //q背向p正上方的点：沿p到q的方向深度增加得比视线快，即 dot(q - p, grad(q)) > depth(q)
+#ifdef CONE_USE_SSE
+    static double searchGroup(const float *depth, const float *gradientX, const float *gradientY, size_t center, const vector<Offset> &offsets,
+        float searchLimit, float minDepth, float *ratios){
+        __m128 apex = _mm_loadu_ps(depth + center);
+        __m128 range = _mm_max_ps(_mm_sub_ps(apex, _mm_set1_ps(minDepth)), _mm_set1_ps(1e-6f));
+        //锥比的初值：搜索范围之外的纹素给出的锥比至少是 searchLimit / (depth(p) - minDepth)，同时不超过1
+        __m128 best = _mm_min_ps(_mm_div_ps(_mm_set1_ps(searchLimit), range), _mm_set1_ps(1.0f));
+        unsigned int searched = 0;
+        for(; searched < offsets.size(); searched++){
+            const Offset &offset = offsets[searched];
+            //当前距离上的纹素给出的锥比也不小于 distance / (depth(p) - minDepth)，4个纹素都不可能再变小时结束
+            __m128 bound = _mm_mul_ps(best, range);
+            if(_mm_movemask_ps(_mm_cmplt_ps(_mm_set1_ps(offset.distance), bound)) == 0)
+                break;
+            size_t q = center + offset.index;
+            __m128 depthQ = _mm_loadu_ps(depth + q);
+            __m128 slope = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(offset.dx), _mm_loadu_ps(gradientX + q)), _mm_mul_ps(_mm_set1_ps(offset.dy), _mm_loadu_ps(gradientY + q)));
+            __m128 difference = _mm_sub_ps(apex, depthQ);
+            __m128 valid = _mm_and_ps(_mm_cmpgt_ps(slope, depthQ), _mm_cmpgt_ps(difference, _mm_setzero_ps()));
+            __m128 ratio = _mm_div_ps(_mm_set1_ps(offset.distance), _mm_max_ps(difference, _mm_set1_ps(1e-6f)));
+            best = _mm_min_ps(best, _mm_or_ps(_mm_and_ps(valid, ratio), _mm_andnot_ps(valid, best)));
+        }
+        _mm_storeu_ps(ratios, best);
+        return searched * 4.0;
+    }
+#else
+    static double searchGroup(const float *depth, const float *gradientX, const float *gradientY, size_t center, const vector<Offset> &offsets,
+        float searchLimit, float minDepth, float *ratios){
+        double searched = 0.0;
+        for(int k = 0; k < 4; k++){
+            float apex = depth[center + k], range = max(apex - minDepth, 1e-6f);
+            float best = min(searchLimit / range, 1.0f);
+            unsigned int i = 0;
+            for(; i < offsets.size() && offsets[i].distance < best * range; i++){
+                size_t q = center + k + offsets[i].index;
+                float slope = offsets[i].dx * gradientX[q] + offsets[i].dy * gradientY[q];
+                float difference = apex - depth[q];
+                if(slope > depth[q] && difference > 0.0f)
+                    best = min(best, offsets[i].distance / max(difference, 1e-6f));
+            }
+            ratios[k] = best;
+            searched += i;
+        }
+        return searched;
+    }
+#endif
+
+    //读取灰度图并转换为深度，边长超过CONE_MAX_SIZE时双线性缩小
+    bool decodeDepth(const string &path, bool isHeight, vector<float> &depth, int &width, int &height){
+        PROFILE_SCOPE("Decode " + path.substr(path.find_last_of('/') + 1));
+        int sourceWidth, sourceHeight;
+        unsigned char *data = stbi_load(path.c_str(), &sourceWidth, &sourceHeight, nullptr, 1);
+        if(data == nullptr){
+            cout << "ERROR::CONE::HEIGHT_MAP_FAILED_TO_LOAD " << path << endl;
+            return false;
+        }
+        float scale = min(1.0f, CONE_MAX_SIZE / static_cast<float>(max(sourceWidth, sourceHeight)));
+        width = max(static_cast<int>(sourceWidth * scale), 1);
+        height = max(static_cast<int>(sourceHeight * scale), 1);
+        depth.resize(static_cast<size_t>(width) * height);
+        for(int y = 0; y < height; y++){
+            float sy = min((y + 0.5f) * sourceHeight / height - 0.5f, sourceHeight - 1.0f);
+            int y0 = max(static_cast<int>(sy), 0), y1 = min(y0 + 1, sourceHeight - 1);
+            float fy = max(sy - y0, 0.0f);
+            for(int x = 0; x < width; x++){
+                float sx = min((x + 0.5f) * sourceWidth / width - 0.5f, sourceWidth - 1.0f);
+                int x0 = max(static_cast<int>(sx), 0), x1 = min(x0 + 1, sourceWidth - 1);
+                float fx = max(sx - x0, 0.0f);
+                float top = data[static_cast<size_t>(y0) * sourceWidth + x0] * (1.0f - fx) + data[static_cast<size_t>(y0) * sourceWidth + x1] * fx;
+                float bottom = data[static_cast<size_t>(y1) * sourceWidth + x0] * (1.0f - fx) + data[static_cast<size_t>(y1) * sourceWidth + x1] * fx;
+                float value = (top * (1.0f - fy) + bottom * fy) / 255.0f;
+                depth[static_cast<size_t>(y) * width + x] = isHeight ? 1.0f - value : value;
+            }
+        }
+        stbi_image_free(data);
+        return true;
+    }
+
+    static bool stampSource(const string &path, bool isHeight, CacheHeader &header){
+        struct stat info;
+        if(stat(path.c_str(), &info) != 0)
+            return false;
+        header.magic = CONE_CACHE_MAGIC;
+        header.version = CONE_CACHE_VERSION;
+        header.maxSize = CONE_MAX_SIZE;
+        header.radius = CONE_SEARCH_RADIUS;
+        header.isHeight = isHeight ? 1 : 0;
+        header.sourceSize = static_cast<uint32_t>(info.st_size);
+        header.sourceTime = static_cast<int64_t>(info.st_mtime);
+        return true;
+    }
+
+    //除尺寸以外的字段都必须与当前的源文件和参数相同
+    static bool readCache(const string &path, const CacheHeader &expected, ConeStepMap &map){
+        ifstream file(path.c_str(), ios::binary);
+        CacheHeader header;
+        if(!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return false;
+        if(header.magic != expected.magic || header.version != expected.version || header.maxSize != expected.maxSize || header.radius != expected.radius
+            || header.isHeight != expected.isHeight || header.sourceSize != expected.sourceSize || header.sourceTime != expected.sourceTime
+            || header.width == 0 || header.height == 0 || header.width > CONE_MAX_SIZE || header.height > CONE_MAX_SIZE)
+            return false;
+        map.width = header.width;
+        map.height = header.height;
+        map.texels.resize(static_cast<size_t>(map.width) * map.height * 2);
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(map.texels.data()), map.texels.size()));
+    }
+
+    static void writeCache(const string &path, const CacheHeader &header, const ConeStepMap &map){
+        ofstream file(path.c_str(), ios::binary);
+        if(file.is_open()){
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(map.texels.data()), map.texels.size());
+        }
+        if(!file.is_open() || !file.good())
+            cout << "ERROR::CONE::CACHE_NOT_WRITTEN " << path << endl;
+    }
+};
+
+#endif
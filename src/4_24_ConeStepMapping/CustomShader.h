@@ -0,0 +1,193 @@
+#ifndef CUSTOMSHADER_H
+#define CUSTOMSHADER_H
+
+#include <glad/glad.h> // 包含glad来获取所有的必须OpenGL头文件
+#include <glm/glm.hpp>
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "Profiler.h"
+using namespace std;
+
+class CustomShader
+{
+public:
+    unsigned int ID;
+    //构造函数负责读取并构建着色器
+    //defines为着色器宏，例如"INSTANCED;NR_LIGHTS 8"，多个宏之间用分号分隔，会被插入到#version之后
+    //同一份glsl文件可以借此编译出不同的变体（例如普通绘制与实例化绘制）
+    CustomShader(const char* vertexPath, const char* fragmentPath, const std::string &defines = ""){
+        //读取、编译与链接的时间按片元着色器的文件名记录
+        string fragmentName = fragmentPath;
+        PROFILE_SCOPE("Shader " + fragmentName.substr(fragmentName.find_last_of('/') + 1));
+        //从文件路径中获取顶点和片元着色器
+        string vertexCode, fragmentCode;
+        ifstream vShaderFile, fShaderFile;
+        //保证文件处理器对象可以抛出异常
+        vShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
+        fShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
+        try{
+            //打开文件
+            vShaderFile.open(vertexPath);
+            fShaderFile.open(fragmentPath);
+            stringstream vShaderStream, fShaderStream;
+            //拂去文件的缓冲内容到数据流中
+            vShaderStream << vShaderFile.rdbuf();
+            fShaderStream << fShaderFile.rdbuf();
+            //关闭文件处理器
+            vShaderFile.close();
+            fShaderFile.close();
+            //转换数据流到string
+            vertexCode = vShaderStream.str();
+            fragmentCode = fShaderStream.str();
+        }catch(ifstream::failure e){
+            cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << endl;
+        }
+        vertexCode = injectDefines(vertexCode, defines);
+        fragmentCode = injectDefines(fragmentCode, defines);
+        const char* vShaderCode = vertexCode.c_str();
+        const char* fShaderCode = fragmentCode.c_str();
+
+        //编译着色器
+        unsigned int vertex, fragment;
+        //顶点着色器
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+        //片元着色器
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+
+        //着色器程序
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, fragment);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+
+        //删除已链接的着色器
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+    }
+    //使用/激活着色器程序
+    void use(){
+        glUseProgram(ID);
+    }
+    // uniform工具函数，用于设置uniform属性的值
+    void setBool(const std::string &name, bool value) const{
+        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    }   
+    void setInt(const std::string &name, int value) const{ 
+        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    }
+    void setFloat(const std::string &name, float value) const{ 
+        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    } 
+    // ------------------------------------------------------------------------
+    void setVec2(const std::string &name, const glm::vec2 &value) const
+    { 
+        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    }
+    void setVec2(const std::string &name, float x, float y) const
+    { 
+        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+    }
+    // ------------------------------------------------------------------------
+    void setVec3(const std::string &name, const glm::vec3 &value) const
+    { 
+        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    }
+    void setVec3(const std::string &name, float x, float y, float z) const
+    { 
+        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+    }
+    // ------------------------------------------------------------------------
+    void setVec4(const std::string &name, const glm::vec4 &value) const
+    { 
+        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    }
+    void setVec4(const std::string &name, float x, float y, float z, float w) const
+    { 
+        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+    }
+    // ------------------------------------------------------------------------
+    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    {
+        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    }
+
+private:
+    //把宏定义插入到#version行之后，#version必须是着色器的第一条语句
+    static std::string injectDefines(const std::string &code, const std::string &defines){
+        if(defines.empty())
+            return code;
+        std::string block;
+        std::stringstream ss(defines);
+        std::string name;
+        while(std::getline(ss, name, ';')){
+            if(!name.empty())
+                block += "#define " + name + "\n";
+        }
+        size_t pos = 0;
+        if(code.compare(0, 8, "#version") == 0){
+            pos = code.find('\n');
+            pos = (pos == std::string::npos) ? code.size() : pos + 1;
+        }
+        return code.substr(0, pos) + block + code.substr(pos);
+    }
+    //编译错误检测
+    void checkCompileErrors(unsigned int shader, std::string type) {
+        int success;
+        char infoLog[1024];
+        if (type != "PROGRAM") {
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success) {
+                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        } else {
+            glGetProgramiv(shader, GL_LINK_STATUS, &success);
+            if (!success) {
+                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+    }
+};
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+#endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#version 330 core
+in vec3 WorldPos;
+in vec2 TexCoords;
+in mat3 TBN;
+out vec4 FragColor;
+
+uniform sampler2D diffuseMap;
+uniform sampler2D normalMap;
+//r为深度（0为表面最高处），g为锥比的平方根，由ConeStepMap.h离线生成
+uniform sampler2D coneMap;
+uniform float heightScale;
+//true时用松弛锥步进，false时用线性搜索的视差遮挡映射
+uniform bool coneStepping;
+//true时输出每个片元的纹理读取次数：红色越多读取越多，FETCH_SCALE次为纯红
+uniform bool showFetches;
+
+uniform vec3 lightDirection;
+uniform vec3 lightColor;
+uniform vec3 camPos;
+
+const float MIN_LAYERS = 8.0;
+const float MAX_LAYERS = 32.0;
+const int MAX_CONE_STEPS = 16;
+const int BINARY_STEPS = 6;
+//距离表面不到深度图的一级精度时停止步进
+const float CONE_EPSILON = 0.5 / 255.0;
+const float FETCH_SCALE = 64.0;
+
+//视差遮挡映射：按层线性搜索第一个低于表面的层，再在前后两层之间线性插值
+//斜视时层数更多，每层读取一次深度
+vec2 parallaxOcclusion(vec2 texCoords, vec3 viewDir, out float fetches)
+{
+    float numLayers = mix(MAX_LAYERS, MIN_LAYERS, abs(viewDir.z));
+    float layerDepth = 1.0 / numLayers;
+    vec2 deltaTexCoords = viewDir.xy / viewDir.z * heightScale / numLayers;
+    float currentLayerDepth = 0.0;
+    vec2 currentTexCoords = texCoords;
+    float currentDepth = textureLod(coneMap, currentTexCoords, 0.0).r;
+    fetches = 1.0;
+    while(currentLayerDepth < currentDepth && currentLayerDepth < 1.0){
+        currentTexCoords -= deltaTexCoords;
+        currentDepth = textureLod(coneMap, currentTexCoords, 0.0).r;
+        currentLayerDepth += layerDepth;
+        fetches += 1.0;
+    }
+    vec2 prevTexCoords = currentTexCoords + deltaTexCoords;
+    float afterDepth = currentDepth - currentLayerDepth;
+    float beforeDepth = textureLod(coneMap, prevTexCoords, 0.0).r - currentLayerDepth + layerDepth;
+    fetches += 1.0;
+    float weight = afterDepth / (afterDepth - beforeDepth);
+    return prevTexCoords * weight + currentTexCoords * (1.0 - weight);
+}
+
+//松弛锥步进：光线每步前进到当前纹素的锥面上，锥越宽步子越大
+//松弛锥保证光线在每一步之间最多穿过表面一次，穿过表面后在最后一步上二分查找交点
+vec2 relaxedConeStep(vec2 texCoords, vec3 viewDir, out float fetches)
+{
+    //深度每增加1，纹理坐标的偏移
+    vec3 rayStep = vec3(-viewDir.xy / viewDir.z * heightScale, 1.0);
+    float distFactor = length(rayStep.xy);
+    vec3 position = vec3(texCoords, 0.0);
+    vec3 previous = position;
+    bool crossed = false;
+    fetches = 0.0;
+    for(int i = 0; i < MAX_CONE_STEPS; i++){
+        vec2 cone = textureLod(coneMap, position.xy, 0.0).rg;
+        fetches += 1.0;
+        float height = cone.r - position.z;
+        if(height <= CONE_EPSILON){
+            crossed = height < 0.0;
+            break;
+        }
+        float ratio = cone.g * cone.g;
+        previous = position;
+        position += rayStep * (ratio * height / (distFactor + ratio));
+    }
+    for(int i = 0; i < BINARY_STEPS && crossed; i++){
+        vec3 middle = (previous + position) * 0.5;
+        float depth = textureLod(coneMap, middle.xy, 0.0).r;
+        fetches += 1.0;
+        if(middle.z < depth)
+            previous = middle;
+        else
+            position = middle;
+    }
+    return position.xy;
+}
+
+void main()
+{
+    //切线空间的视线方向，TBN正交，转置即为逆
+    vec3 viewDir = normalize(transpose(TBN) * (camPos - WorldPos));
+    float fetches;
+    vec2 texCoords = coneStepping ? relaxedConeStep(TexCoords, viewDir, fetches) : parallaxOcclusion(TexCoords, viewDir, fetches);
+    if(showFetches){
+        float heat = min(fetches / FETCH_SCALE, 1.0);
+        FragColor = vec4(heat, 1.0 - heat, 0.0, 1.0);
+        return;
+    }
+
+    //偏移后的纹理坐标在深度突变处不连续，mipmap级别用原始纹理坐标的导数选择，避免边缘出现一圈模糊的像素
+    vec2 dx = dFdx(TexCoords), dy = dFdy(TexCoords);
+    vec3 color = textureGrad(diffuseMap, texCoords, dx, dy).rgb;
+    vec3 normal = normalize(TBN * (textureGrad(normalMap, texCoords, dx, dy).rgb * 2.0 - 1.0));
+    vec3 L = normalize(-lightDirection);
+    vec3 V = normalize(camPos - WorldPos);
+    vec3 H = normalize(L + V);
+    vec3 ambient = 0.1 * color;
+    vec3 diffuse = max(dot(normal, L), 0.0) * color;
+    vec3 specular = vec3(0.2) * pow(max(dot(normal, H), 0.0), 32.0);
+    vec3 result = ambient + (diffuse + specular) * lightColor;
+    FragColor = vec4(pow(result, vec3(1.0 / 2.2)), 1.0);
+}
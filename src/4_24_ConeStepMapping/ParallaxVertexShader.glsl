@@ -0,0 +1,31 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec3 aTangent;
+layout (location = 4) in vec3 aBitangent;
+
+out vec3 WorldPos;
+out vec2 TexCoords;
+out mat3 TBN;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec2 uvScale;
+
+void main()
+{
+    WorldPos = vec3(model * vec4(aPos, 1.0));
+    TexCoords = aTexCoords * uvScale;
+    mat3 normalMatrix = mat3(transpose(inverse(model)));
+    vec3 N = normalize(normalMatrix * aNormal);
+    //视差偏移在切线空间中计算，T、B必须分别沿纹理坐标u、v增大的方向
+    vec3 T = normalize(mat3(model) * aTangent);
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = cross(N, T);
+    if(dot(B, mat3(model) * aBitangent) < 0.0)
+        B = -B;
+    TBN = mat3(T, B, N);
+    gl_Position = projection * view * vec4(WorldPos, 1.0);
+}
@@ -0,0 +1,433 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "ConeStepMap.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_24_ConeStepMapping/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+//低角度看向地面，视差偏移最大、线性搜索的层数最多
+CustomCamera camera(glm::vec3(0.0f, 1.2f, 4.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -18.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+const float FLOOR_SIZE = 12.0f;
+const float FETCH_SCALE = 64.0f;//与着色器中的FETCH_SCALE一致
+
+unsigned int currentMaterial = 0;
+bool coneEnabled = true;//false时使用线性搜索的视差遮挡映射，用于对比
+bool heatmapEnabled = false;
+bool regenerateRequested = false;
+bool jobsEnabled = true;
+bool materialKeyDown = false;
+bool coneKeyDown = false;
+bool heatmapKeyDown = false;
+bool regenerateKeyDown = false;
+bool jobsKeyDown = false;
+bool traceKeyDown = false;
+
+//一种带深度图的材质；isHeight为true时贴图白色为高处，生成时翻转为深度
+struct ParallaxMaterial {
+    string name;
+    string diffuse, normal, height;
+    bool isHeight;
+    float heightScale;
+    float uvScale;//地面上的平铺次数
+    unsigned int diffuseTexture = 0, normalTexture = 0, coneTexture = 0;
+    ConeStepStats stats = {};
+    bool loaded = false;//已经尝试加载过，失败时不再每帧重试
+};
+
+vector<ParallaxMaterial> materials = {
+    {"bricks2", "./static/texture/bricks2.jpg", "./static/texture/bricks2_normal.jpg", "./static/texture/bricks2_disp.jpg", false, 0.08f, 4.0f},
+    {"toy_box", "./static/texture/wood.png", "./static/texture/toy_box_normal.png", "./static/texture/toy_box_disp.png", false, 0.06f, 6.0f},
+    {"MuddySand", "./static/texture/TexturesCom_MuddySand2_2x2_2K_albedo.png", "./static/texture/TexturesCom_MuddySand2_2x2_2K_normal.png",
+        "./static/texture/TexturesCom_MuddySand2_2x2_2K_height.png", true, 0.05f, 3.0f}
+};
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //E键切换材质，P键在松弛锥步进与视差遮挡映射之间切换，H键显示每个片元的纹理读取次数
+    //G键忽略缓存重新生成当前材质的锥步进贴图，J键在任务系统与单线程之间切换
+    bool key = glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
+    if(key && !materialKeyDown)
+        currentMaterial = (currentMaterial + 1) % materials.size();
+    materialKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+    if(key && !coneKeyDown)
+        coneEnabled = !coneEnabled;
+    coneKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+    if(key && !heatmapKeyDown)
+        heatmapEnabled = !heatmapEnabled;
+    heatmapKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+    if(key && !regenerateKeyDown)
+        regenerateRequested = true;
+    regenerateKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS;
+    if(key && !jobsKeyDown)
+        jobsEnabled = !jobsEnabled;
+    jobsKeyDown = key;
+    //T键导出最近的帧为Chrome trace，并在控制台输出各作用域的平均耗时
+    key = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+    if(key && !traceKeyDown){
+        Profiler::Get().ExportChromeTrace("./output/profile_trace.json");
+        vector<ProfileSummary> summary = Profiler::Get().Summarize();
+        cout << left << setw(28) << "scope" << right << setw(10) << "cpu ms" << setw(10) << "gpu ms" << setw(8) << "calls" << endl;
+        cout << fixed << setprecision(3);
+        for(unsigned int i = 0; i < summary.size(); i++)
+            cout << left << setw(28) << summary[i].name << right << setw(10) << summary[i].cpuMs << setw(10) << summary[i].gpuMs << setw(8) << summary[i].calls << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+    }
+    traceKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+string coneCachePath(const ParallaxMaterial &material){
+    return "./output/" + material.name + "_cone.bin";
+}
+
+void printConeStats(const ParallaxMaterial &material, const ConeStepMap &map){
+    cout << material.name << ": ";
+    if(material.stats.fromCache)
+        cout << map.width << "x" << map.height << " cone map loaded from cache in " << material.stats.cacheMs << " ms" << endl;
+    else
+        cout << map.width << "x" << map.height << " cone map generated in " << material.stats.decodeMs + material.stats.buildMs << " ms (decode "
+            << material.stats.decodeMs << " ms, build " << material.stats.buildMs << " ms)" << endl;
+}
+
+unsigned int loadTexture(const string &path, bool srgb){
+    int width, height;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, nullptr, 4);
+    if(data == nullptr){
+        cout << "ERROR::TEXTURE::FAILED_TO_LOAD " << path << endl;
+        return 0;
+    }
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    stbi_image_free(data);
+    return texture;
+}
+
+//锥步进贴图不需要mipmap：步进总是读取第0级，远处的锥比被平均后就不再保守
+unsigned int uploadConeMap(const ConeStepMap &map, unsigned int texture){
+    if(texture == 0)
+        glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, map.width, map.height, 0, GL_RG, GL_UNSIGNED_BYTE, map.texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+//读取缓存或生成锥步进贴图并上传，第一次用到材质时才加载贴图
+bool loadMaterial(ParallaxMaterial &material, ConeStepGenerator &generator, bool force){
+    generator.parallel = jobsEnabled;
+    material.loaded = true;
+    ConeStepMap map;
+    if(!generator.LoadOrBuild(material.height, material.isHeight, coneCachePath(material), map, force))
+        return false;
+    material.stats = generator.stats;
+    printConeStats(material, map);
+    material.coneTexture = uploadConeMap(map, material.coneTexture);
+    if(material.diffuseTexture == 0)
+        material.diffuseTexture = loadTexture(material.diffuse, true);
+    if(material.normalTexture == 0)
+        material.normalTexture = loadTexture(material.normal, false);
+    return material.diffuseTexture != 0 && material.normalTexture != 0;
+}
+
+//不创建窗口，忽略缓存重新生成所有锥步进贴图，对比任务系统与单线程的耗时
+int generateAll(){
+    ConeStepGenerator generator;
+    cout << "Cone step generator: " << JobSystem::Get().ThreadCount() << " threads, search radius " << CONE_SEARCH_RADIUS << " texels" << endl;
+    cout << left << setw(11) << "material" << right << setw(10) << "size" << setw(9) << "decode" << setw(10) << "build" << setw(11) << "1 thread"
+        << setw(9) << "speedup" << setw(8) << "ratio" << setw(10) << "searched" << endl;
+    cout << fixed << setprecision(2);
+    for(unsigned int i = 0; i < materials.size(); i++){
+        const ParallaxMaterial &material = materials[i];
+        ConeStepMap map;
+        generator.parallel = false;
+        if(!generator.LoadOrBuild(material.height, material.isHeight, coneCachePath(material), map, true))
+            return -1;
+        double serialMs = generator.stats.buildMs;
+        generator.parallel = true;
+        if(!generator.LoadOrBuild(material.height, material.isHeight, coneCachePath(material), map, true))
+            return -1;
+        const ConeStepStats &stats = generator.stats;
+        cout << left << setw(11) << material.name << right << setw(10) << to_string(map.width) + "x" + to_string(map.height) << setw(9) << stats.decodeMs
+            << setw(10) << stats.buildMs << setw(11) << serialMs << setw(9) << serialMs / max(stats.buildMs, 1e-3) << setw(8) << stats.averageRatio
+            << setw(10) << stats.averageSearch << endl;
+    }
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+    return 0;
+}
+
+//读回读取次数视图，求地面覆盖的像素上平均每个片元的纹理读取次数；背景为黑色
+float averageFetches(){
+    vector<unsigned char> pixels(SCR_WIDTH * SCR_HEIGHT * 4);
+    glReadPixels(0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    double total = 0.0;
+    unsigned int covered = 0;
+    for(size_t i = 0; i < pixels.size(); i += 4){
+        if(pixels[i] == 0 && pixels[i + 1] == 0)
+            continue;
+        total += pixels[i] / 255.0 * FETCH_SCALE;
+        covered++;
+    }
+    return covered > 0 ? static_cast<float>(total / covered) : 0.0f;
+}
+
+int main(int argc, char *argv[]){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    //--threads N指定参与执行任务的线程数，默认为硬件线程数
+    //--generate 不创建窗口，重新生成所有锥步进贴图
+    int threads = 0;
+    bool generate = false;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--threads" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(arg == "--generate")
+            generate = true;
+    }
+    JobSystem::Get().Init(threads > 0 ? threads - 1 : -1);
+    if(generate){
+        int result = generateAll();
+        JobSystem::Get().Shutdown();
+        return result;
+    }
+    cout << "Job system: " << JobSystem::Get().ThreadCount() << " threads" << endl;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 2.0f;
+    Profiler::Get().InitGPU();
+    glEnable(GL_DEPTH_TEST);
+
+    CustomShader parallaxShader((Path + "ParallaxVertexShader.glsl").c_str(), (Path + "ParallaxFragmentShader.glsl").c_str());
+
+    ConeStepGenerator generator;
+    if(!loadMaterial(materials[currentMaterial], generator, false))
+        cout << "ERROR::CONE::LOAD_FAILED " << materials[currentMaterial].name << endl;
+
+    //y=0平面上的地面，切线沿u（+x），副切线沿v（-z）
+    float half = FLOOR_SIZE * 0.5f;
+    float floorVertices[] = {
+        //位置                  法线              纹理坐标      切线              副切线
+        -half, 0.0f,  half,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f, -1.0f,
+         half, 0.0f,  half,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f, -1.0f,
+         half, 0.0f, -half,  0.0f, 1.0f, 0.0f,  1.0f, 1.0f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f, -1.0f,
+         half, 0.0f, -half,  0.0f, 1.0f, 0.0f,  1.0f, 1.0f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f, -1.0f,
+        -half, 0.0f, -half,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f, -1.0f,
+        -half, 0.0f,  half,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f, -1.0f
+    };
+    unsigned int floorVAO, floorVBO;
+    glGenVertexArrays(1, &floorVAO);
+    glGenBuffers(1, &floorVBO);
+    glBindVertexArray(floorVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, floorVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(floorVertices), floorVertices, GL_STATIC_DRAW);
+    const unsigned int sizes[5] = {3, 3, 2, 3, 3};
+    unsigned int offset = 0;
+    for(unsigned int a = 0; a < 5; a++){
+        glVertexAttribPointer(a, sizes[a], GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(offset * sizeof(float)));
+        glEnableVertexAttribArray(a);
+        offset += sizes[a];
+    }
+    glBindVertexArray(0);
+
+    parallaxShader.use();
+    parallaxShader.setInt("diffuseMap", 0);
+    parallaxShader.setInt("normalMap", 1);
+    parallaxShader.setInt("coneMap", 2);
+    parallaxShader.setMat4("model", glm::mat4(1.0f));
+    parallaxShader.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
+
+    //画一次地面，showFetches为true时输出纹理读取次数
+    auto drawFloor = [&](const ParallaxMaterial &material, const glm::mat4 &view, const glm::mat4 &projection, float time, bool showFetches){
+        glClearColor(showFetches ? 0.0f : 0.1f, showFetches ? 0.0f : 0.1f, showFetches ? 0.0f : 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        parallaxShader.use();
+        parallaxShader.setMat4("view", view);
+        parallaxShader.setMat4("projection", projection);
+        parallaxShader.setVec3("camPos", camera.Position);
+        parallaxShader.setVec3("lightDirection", glm::normalize(glm::vec3(cos(time * 0.5f), -0.7f, sin(time * 0.5f))));
+        parallaxShader.setFloat("heightScale", material.heightScale);
+        parallaxShader.setVec2("uvScale", glm::vec2(material.uvScale));
+        parallaxShader.setBool("coneStepping", coneEnabled);
+        parallaxShader.setBool("showFetches", showFetches);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, material.diffuseTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, material.normalTexture);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, material.coneTexture);
+        glBindVertexArray(floorVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    };
+
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    while (!glfwWindowShouldClose(window)){
+        Profiler::Get().BeginFrame();
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        processInput(window);
+
+        ParallaxMaterial &material = materials[currentMaterial];
+        if(regenerateRequested || !material.loaded){
+            if(!loadMaterial(material, generator, regenerateRequested))
+                cout << "ERROR::CONE::LOAD_FAILED " << material.name << endl;
+            regenerateRequested = false;
+        }
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+
+        //显示地面一帧的GPU耗时与平均每个片元的纹理读取次数
+        //读取次数在更新标题时用读取次数视图单独画一次再读回，随后的清屏会覆盖掉，不会显示出来
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float fetches;
+            {
+                PROFILE_PASS("FetchCount");
+                drawFloor(material, view, projection, currentFrame, true);
+                fetches = averageFetches();
+            }
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            float surfaceMs = 0.0f;
+            vector<ProfileSummary> summary = Profiler::Get().Summarize();
+            for(unsigned int i = 0; i < summary.size(); i++){
+                if(summary[i].name == "Surface")
+                    surfaceMs = static_cast<float>(summary[i].gpuMs);
+            }
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame - " + material.name + " " + (coneEnabled ? "relaxed cone stepping" : "parallax occlusion")
+                + ": " + to_string(surfaceMs) + " ms GPU, " + to_string(fetches) + " fetches/fragment"
+                + " - E: material, P: cone/POM, H: fetch heatmap, G: regenerate, J: jobs, T: export trace";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+        }
+
+        {
+            PROFILE_PASS("Surface");
+            drawFloor(material, view, projection, currentFrame, heatmapEnabled);
+        }
+
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+    }
+    for(unsigned int i = 0; i < materials.size(); i++){
+        unsigned int textures[3] = {materials[i].diffuseTexture, materials[i].normalTexture, materials[i].coneTexture};
+        for(int t = 0; t < 3; t++){
+            if(textures[t] != 0)
+                glDeleteTextures(1, &textures[t]);
+        }
+    }
+    glDeleteVertexArrays(1, &floorVAO);
+    glDeleteBuffers(1, &floorVBO);
+    Profiler::Get().Release();
+    JobSystem::Get().Shutdown();
+
+    glfwTerminate();
+
+    return 0;
+}
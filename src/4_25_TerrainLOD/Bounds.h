@@ -0,0 +1,91 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+//轴对齐包围盒
+struct AABB {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool IsValid() const{
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+    void Expand(const glm::vec3 &point){
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    void Expand(const AABB &box){
+        if(!box.IsValid())
+            return;
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+    glm::vec3 Center() const{
+        return (min + max) * 0.5f;
+    }
+    glm::vec3 Extents() const{
+        return (max - min) * 0.5f;
+    }
+    //变换到另一个空间后重新求包围盒：新的半长为|M| * 半长（Arvo的方法），不需要变换8个顶点
+    AABB Transform(const glm::mat4 &m) const{
+        glm::vec3 center = glm::vec3(m * glm::vec4(Center(), 1.0f));
+        glm::vec3 extents = Extents();
+        glm::vec3 newExtents;
+        for(int i = 0; i < 3; i++){
+            newExtents[i] = fabs(m[0][i]) * extents.x + fabs(m[1][i]) * extents.y + fabs(m[2][i]) * extents.z;
+        }
+        AABB result;
+        result.min = center - newExtents;
+        result.max = center + newExtents;
+        return result;
+    }
+};
+
+//包围球
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    //变换后的半径按最大的轴缩放计算，对非均匀缩放是保守的
+    BoundingSphere Transform(const glm::mat4 &m) const{
+        BoundingSphere result;
+        result.center = glm::vec3(m * glm::vec4(center, 1.0f));
+        float sx = glm::dot(glm::vec3(m[0]), glm::vec3(m[0]));
+        float sy = glm::dot(glm::vec3(m[1]), glm::vec3(m[1]));
+        float sz = glm::dot(glm::vec3(m[2]), glm::vec3(m[2]));
+        result.radius = radius * sqrt(std::max(sx, std::max(sy, sz)));
+        return result;
+    }
+};
+
+//由一组点求包围盒
+template<typename VertexType>
+AABB ComputeAABB(const vector<VertexType> &vertices){
+    AABB box;
+    for(unsigned int i = 0; i < vertices.size(); i++)
+        box.Expand(vertices[i].Position);
+    return box;
+}
+
+//以包围盒中心为球心，半径取到最远顶点的距离
+template<typename VertexType>
+BoundingSphere ComputeBoundingSphere(const vector<VertexType> &vertices, const AABB &box){
+    BoundingSphere sphere;
+    if(!box.IsValid())
+        return sphere;
+    sphere.center = box.Center();
+    float radius2 = 0.0f;
+    for(unsigned int i = 0; i < vertices.size(); i++){
+        glm::vec3 d = vertices[i].Position - sphere.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    sphere.radius = sqrt(radius2);
+    return sphere;
+}
+#endif
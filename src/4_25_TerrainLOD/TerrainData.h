@@ -0,0 +1,230 @@
+#ifndef TERRAINDATA_H
+#define TERRAINDATA_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <sys/stat.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include <tool/stb_image.h>
+#include "JobSystem.h"
+#include "Profiler.h"
+using namespace std;
+
+//分块的地形高度数据：高度图按四叉树切成节点，每个节点一块固定大小的高度瓦片，瓦片按节点下标连续存放在一个文件中
+//第0层为根节点，覆盖整个地形；每往下一层节点边长减半，瓦片的采样间隔也减半，所以所有节点的瓦片大小相同
+//上层瓦片直接取下层的偶数采样点（不做滤波），粗一级的网格顶点与细一级网格的偶数顶点高度完全相同，LOD之间的顶点变形才不会产生裂缝
+//运行时只常驻文件头与每个节点的高度范围（用于包围盒），瓦片按需从文件流式读取，内存与读取量只和屏幕上需要的节点有关，与高度图的大小无关
+#define TERRAIN_MAGIC 0x52524554 //"TERR"
+#define TERRAIN_VERSION 1
+#define TERRAIN_PATCH_QUADS 32 //每个节点的网格为32x32个四边形
+#define TERRAIN_TILE_SAMPLES (TERRAIN_PATCH_QUADS + 1)
+#define TERRAIN_TILE_BYTES (TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES * 2)
+#define TERRAIN_LEVELS 7 //四叉树层数，最细一层共有32*2^6+1=2049个采样
+#define TERRAIN_REPEAT 2 //源高度图可以平铺，平铺2x2后作为地形
+
+//文件头之后是每个节点的高度范围（TerrainNodeBounds），然后是每个节点的瓦片（uint16_t高度，按行存放）
+struct TerrainHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t levels;
+    uint32_t patchQuads;
+    uint32_t repeat;
+    uint32_t nodeCount;
+    uint32_t sourceSize;
+    int64_t sourceTime;
+};
+
+//节点覆盖区域内的最低与最高高度，与瓦片一样是0~65535
+struct TerrainNodeBounds {
+    uint16_t minHeight;
+    uint16_t maxHeight;
+};
+
+//第level层第(x, y)个节点的下标：前面各层共有(4^level - 1) / 3个节点
+inline unsigned int TerrainNodeIndex(unsigned int level, unsigned int x, unsigned int y){
+    return ((1u << (2 * level)) - 1) / 3 + y * (1u << level) + x;
+}
+
+inline unsigned int TerrainNodeCount(unsigned int levels){
+    return ((1u << (2 * levels)) - 1) / 3;
+}
+
+inline size_t TerrainTileOffset(unsigned int nodeCount, unsigned int node){
+    return sizeof(TerrainHeader) + nodeCount * sizeof(TerrainNodeBounds) + static_cast<size_t>(node) * TERRAIN_TILE_BYTES;
+}
+
+struct TerrainBuildStats {
+    bool fromCache = false;
+    double decodeMs = 0.0;
+    double buildMs = 0.0;
+    double writeMs = 0.0;
+    size_t fileBytes = 0;
+};
+
+class TerrainBuilder {
+public:
+    bool parallel = true;//false时全部在当前线程上执行
+    TerrainBuildStats stats;
+
+    //读取缓存文件的头与节点高度范围；缓存不存在、源文件或参数变化、force为true时重新生成
+    bool LoadOrBuild(const string &heightPath, const string &cachePath, vector<TerrainNodeBounds> &bounds, bool force = false){
+        stats = TerrainBuildStats();
+        TerrainHeader expected = {};
+        if(!stampSource(heightPath, expected)){
+            cout << "ERROR::TERRAIN::HEIGHT_MAP_NOT_FOUND " << heightPath << endl;
+            return false;
+        }
+        if(!force && readBounds(cachePath, expected, bounds)){
+            stats.fromCache = true;
+            return true;
+        }
+        return Build(heightPath, cachePath, expected, bounds);
+    }
+
+private:
+    static double elapsedMs(chrono::steady_clock::time_point start){
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    static bool stampSource(const string &path, TerrainHeader &header){
+        struct stat info;
+        if(stat(path.c_str(), &info) != 0)
+            return false;
+        header.magic = TERRAIN_MAGIC;
+        header.version = TERRAIN_VERSION;
+        header.levels = TERRAIN_LEVELS;
+        header.patchQuads = TERRAIN_PATCH_QUADS;
+        header.repeat = TERRAIN_REPEAT;
+        header.nodeCount = TerrainNodeCount(TERRAIN_LEVELS);
+        header.sourceSize = static_cast<uint32_t>(info.st_size);
+        header.sourceTime = static_cast<int64_t>(info.st_mtime);
+        return true;
+    }
+
+    static bool readBounds(const string &path, const TerrainHeader &expected, vector<TerrainNodeBounds> &bounds){
+        ifstream file(path.c_str(), ios::binary | ios::ate);
+        if(!file.is_open())
+            return false;
+        size_t fileSize = static_cast<size_t>(file.tellg());
+        file.seekg(0);
+        TerrainHeader header;
+        if(!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(&header, &expected, sizeof(header)) != 0
+            || fileSize != TerrainTileOffset(header.nodeCount, header.nodeCount))
+            return false;
+        bounds.resize(header.nodeCount);
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(bounds.data()), bounds.size() * sizeof(TerrainNodeBounds)));
+    }
+
+    bool Build(const string &heightPath, const string &cachePath, TerrainHeader header, vector<TerrainNodeBounds> &bounds){
+        PROFILE_FUNCTION();
+        //源高度图解码为16位灰度，8位的图片由stb_image扩展
+        auto start = chrono::steady_clock::now();
+        int sourceWidth, sourceHeight;
+        unsigned short *source = stbi_load_16(heightPath.c_str(), &sourceWidth, &sourceHeight, nullptr, 1);
+        if(source == nullptr){
+            cout << "ERROR::TERRAIN::HEIGHT_MAP_FAILED_TO_LOAD " << heightPath << endl;
+            return false;
+        }
+        stats.decodeMs = elapsedMs(start);
+
+        //平铺后的高度图双线性重采样到最细一层的采样数
+        start = chrono::steady_clock::now();
+        const unsigned int leafLevel = TERRAIN_LEVELS - 1;
+        const int samples = TERRAIN_PATCH_QUADS * (1 << leafLevel) + 1;
+        vector<uint16_t> heights(static_cast<size_t>(samples) * samples);
+        auto resampleRows = [&](unsigned int begin, unsigned int end){
+            for(unsigned int y = begin; y < end; y++){
+                float sy = static_cast<float>(y) / (samples - 1) * sourceHeight * TERRAIN_REPEAT;
+                int y0 = static_cast<int>(sy);
+                float fy = sy - y0;
+                const unsigned short *row0 = source + static_cast<size_t>(y0 % sourceHeight) * sourceWidth;
+                const unsigned short *row1 = source + static_cast<size_t>((y0 + 1) % sourceHeight) * sourceWidth;
+                for(int x = 0; x < samples; x++){
+                    float sx = static_cast<float>(x) / (samples - 1) * sourceWidth * TERRAIN_REPEAT;
+                    int x0 = static_cast<int>(sx);
+                    float fx = sx - x0;
+                    int xa = x0 % sourceWidth, xb = (x0 + 1) % sourceWidth;
+                    float top = row0[xa] + (row0[xb] - row0[xa]) * fx;
+                    float bottom = row1[xa] + (row1[xb] - row1[xa]) * fx;
+                    heights[static_cast<size_t>(y) * samples + x] = static_cast<uint16_t>(top + (bottom - top) * fy + 0.5f);
+                }
+            }
+        };
+        if(parallel)
+            JobSystem::Get().ParallelFor(samples, 16, resampleRows);
+        else
+            resampleRows(0, samples);
+        stbi_image_free(source);
+
+        //每个节点取间隔为stride的采样点，高度范围为瓦片中的最小与最大值
+        //瓦片包含节点区域内的所有顶点，节点变形后的高度都在两个采样点之间，所以这个范围对任何LOD都是准确的
+        bounds.resize(header.nodeCount);
+        vector<uint16_t> tiles(static_cast<size_t>(header.nodeCount) * TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES);
+        for(unsigned int level = 0; level < TERRAIN_LEVELS; level++){
+            const unsigned int nodesPerSide = 1u << level;
+            const int stride = 1 << (leafLevel - level);
+            auto buildNodes = [&](unsigned int begin, unsigned int end){
+                for(unsigned int i = begin; i < end; i++){
+                    unsigned int x = i % nodesPerSide, y = i / nodesPerSide;
+                    unsigned int node = TerrainNodeIndex(level, x, y);
+                    uint16_t *tile = &tiles[static_cast<size_t>(node) * TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES];
+                    uint16_t minHeight = 65535, maxHeight = 0;
+                    for(int j = 0; j < TERRAIN_TILE_SAMPLES; j++){
+                        const uint16_t *row = &heights[static_cast<size_t>((y * TERRAIN_PATCH_QUADS + j) * stride) * samples];
+                        for(int k = 0; k < TERRAIN_TILE_SAMPLES; k++){
+                            uint16_t height = row[(x * TERRAIN_PATCH_QUADS + k) * stride];
+                            tile[j * TERRAIN_TILE_SAMPLES + k] = height;
+                            minHeight = min(minHeight, height);
+                            maxHeight = max(maxHeight, height);
+                        }
+                    }
+                    bounds[node].minHeight = minHeight;
+                    bounds[node].maxHeight = maxHeight;
+                }
+            };
+            if(parallel)
+                JobSystem::Get().ParallelFor(nodesPerSide * nodesPerSide, 16, buildNodes);
+            else
+                buildNodes(0, nodesPerSide * nodesPerSide);
+        }
+        //上层瓦片只取了部分采样，高度范围改为子节点范围的并集，保证包含更细的LOD
+        for(int level = static_cast<int>(leafLevel) - 1; level >= 0; level--){
+            unsigned int nodesPerSide = 1u << level;
+            for(unsigned int y = 0; y < nodesPerSide; y++){
+                for(unsigned int x = 0; x < nodesPerSide; x++){
+                    TerrainNodeBounds &parent = bounds[TerrainNodeIndex(level, x, y)];
+                    for(unsigned int c = 0; c < 4; c++){
+                        const TerrainNodeBounds &child = bounds[TerrainNodeIndex(level + 1, x * 2 + (c & 1), y * 2 + (c >> 1))];
+                        parent.minHeight = min(parent.minHeight, child.minHeight);
+                        parent.maxHeight = max(parent.maxHeight, child.maxHeight);
+                    }
+                }
+            }
+        }
+        stats.buildMs = elapsedMs(start);
+
+        start = chrono::steady_clock::now();
+        ofstream file(cachePath.c_str(), ios::binary);
+        if(file.is_open()){
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(bounds.data()), bounds.size() * sizeof(TerrainNodeBounds));
+            file.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(uint16_t));
+        }
+        if(!file.is_open() || !file.good()){
+            cout << "ERROR::TERRAIN::CACHE_NOT_WRITTEN " << cachePath << endl;
+            return false;
+        }
+        stats.fileBytes = TerrainTileOffset(header.nodeCount, header.nodeCount);
+        stats.writeMs = elapsedMs(start);
+        return true;
+    }
+};
+
+#endif
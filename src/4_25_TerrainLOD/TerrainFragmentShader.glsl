@@ -0,0 +1,26 @@
+#version 330 core
+in vec3 WorldPos;
+in vec3 Normal;
+in float Morph;
+out vec4 FragColor;
+
+uniform sampler2D albedoMap;
+uniform float textureScale;//反照率贴图在世界空间中重复的间隔
+uniform vec3 lightDirection;
+uniform vec3 cameraPos;
+uniform vec3 fogColor;
+uniform float fogDensity;
+//true时按节点所在的层着色，变形越多颜色越暗
+uniform bool showLod;
+uniform vec3 lodColor;
+
+void main()
+{
+    vec3 normal = normalize(Normal);
+    vec3 albedo = showLod ? lodColor * (1.0 - 0.5 * Morph) : texture(albedoMap, WorldPos.xz / textureScale).rgb;
+    float diffuse = max(dot(normal, -lightDirection), 0.0);
+    vec3 color = albedo * (0.25 + 0.9 * diffuse);
+    float fog = 1.0 - exp(-fogDensity * length(cameraPos - WorldPos));
+    color = mix(color, fogColor, fog);
+    FragColor = vec4(pow(color, vec3(1.0 / 2.2)), 1.0);
+}
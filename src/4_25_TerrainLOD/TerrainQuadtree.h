@@ -0,0 +1,162 @@
+#ifndef TERRAINQUADTREE_H
+#define TERRAINQUADTREE_H
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <vector>
+#include <functional>
+#include "Bounds.h"
+#include "Frustum.h"
+#include "TerrainData.h"
+using namespace std;
+
+//CDLOD（Continuous Distance-Dependent LOD）的节点选择
+//每一层有一个LOD距离，越细的层距离越短，相邻两层的距离相差一倍；节点与以相机为球心、本层距离为半径的球相交时才可能被细分
+//节点的四个子节点中，与下一层的球相交的继续细分，不相交的象限用本节点的网格（只画对应的四分之一）绘制
+//层的距离由屏幕空间误差决定：网格一个四边形投影到屏幕上不超过pixelError个像素，所以地形的开销只取决于屏幕上的误差，与高度图多大无关
+//节点在本层距离的后一段内把奇数顶点逐渐移到相邻的偶数顶点上（顶点着色器中），到达距离时与上一层的网格完全一致，相邻LOD之间没有裂缝
+#define TERRAIN_MORPH_START 0.7f //从本层距离的70%开始变形
+#define TERRAIN_PREFETCH 1.25f //距离下一层的球不到这个倍数时提前请求子节点的瓦片
+
+//一次绘制：quadrant为-1时绘制整个节点，0~3时只绘制对应的象限（x + y * 2）
+struct TerrainDrawNode {
+    unsigned int node;
+    unsigned int level;
+    unsigned int x, y;
+    int quadrant;
+};
+
+struct TerrainSelectStats {
+    unsigned int visited = 0;//访问的节点数
+    unsigned int culled = 0;//视锥体剔除的节点数
+    unsigned int fallbacks = 0;//子节点的瓦片还没有加载，用本节点代替的次数
+    unsigned int missing = 0;//需要但还没有加载的瓦片数
+};
+
+class TerrainQuadtree {
+public:
+    TerrainSelectStats stats;
+
+    //worldSize为地形在x、z方向上的边长，中心在原点；heightScale为高度65535对应的世界空间高度
+    TerrainQuadtree(const vector<TerrainNodeBounds> &bounds, float worldSize, float heightScale)
+        : bounds(bounds), worldSize(worldSize), heightScale(heightScale), ranges(TERRAIN_LEVELS){
+    }
+
+    //一个四边形在距离d处投影的像素数约为 边长 * screenHeight / (2 * d * tan(fovY / 2))，最细一层的距离取投影等于pixelError的位置
+    //返回实际使用的误差：距离被下面的下限抬高时，实际误差比pixelError小
+    float SetScreenError(float pixelError, float screenHeight, float fovY){
+        float leafQuad = NodeSize(TERRAIN_LEVELS - 1) / TERRAIN_PATCH_QUADS;
+        float projection = leafQuad * screenHeight / (2.0f * tan(fovY * 0.5f));
+        float leafRange = projection / pixelError;
+        //第L层与第L-1层交界处的顶点离相机最远为 本层距离 + 节点对角线，此时上一层的节点还不能开始变形，
+        //而上一层从 2 * 本层距离 * TERRAIN_MORPH_START 处开始变形，所以本层距离 * (2 * TERRAIN_MORPH_START - 1)不能小于节点对角线（含高度跨度）
+        //误差较大时这个下限起作用，否则交界处粗的一侧的奇数顶点已经开始移动，会出现T形裂缝
+        for(unsigned int level = 1; level < TERRAIN_LEVELS; level++){
+            unsigned int nodesPerSide = 1u << level;
+            float heightSpan = 0.0f;
+            for(unsigned int i = 0; i < nodesPerSide * nodesPerSide; i++){
+                const TerrainNodeBounds &range = bounds[TerrainNodeIndex(level, i % nodesPerSide, i / nodesPerSide)];
+                heightSpan = max(heightSpan, (range.maxHeight - range.minHeight) / 65535.0f * heightScale);
+            }
+            float size = NodeSize(level);
+            float diagonal = sqrt(2.0f * size * size + heightSpan * heightSpan);
+            float minRange = diagonal / (2.0f * TERRAIN_MORPH_START - 1.0f);
+            leafRange = max(leafRange, minRange / static_cast<float>(1 << (TERRAIN_LEVELS - 1 - level)));
+        }
+        for(int level = TERRAIN_LEVELS - 1; level >= 0; level--)
+            ranges[level] = leafRange * static_cast<float>(1 << (TERRAIN_LEVELS - 1 - level));
+        return projection / leafRange;
+    }
+
+    float Range(unsigned int level) const{
+        return ranges[level];
+    }
+
+    float NodeSize(unsigned int level) const{
+        return worldSize / static_cast<float>(1 << level);
+    }
+
+    //节点在x、z方向上的起点
+    glm::vec2 NodeOrigin(unsigned int level, unsigned int x, unsigned int y) const{
+        float size = NodeSize(level);
+        return glm::vec2(-worldSize * 0.5f + x * size, -worldSize * 0.5f + y * size);
+    }
+
+    AABB NodeBox(unsigned int level, unsigned int x, unsigned int y) const{
+        const TerrainNodeBounds &range = bounds[TerrainNodeIndex(level, x, y)];
+        glm::vec2 origin = NodeOrigin(level, x, y);
+        float size = NodeSize(level);
+        AABB box;
+        box.min = glm::vec3(origin.x, range.minHeight / 65535.0f * heightScale, origin.y);
+        box.max = glm::vec3(origin.x + size, range.maxHeight / 65535.0f * heightScale, origin.y + size);
+        return box;
+    }
+
+    //选择要绘制的节点；resident判断节点的瓦片是否已经在缓存中，request为缺少的瓦片发出请求
+    //子节点的瓦片没有全部加载时先用本节点绘制整个区域，此时与相邻的更细的节点之间可能有短暂的裂缝，提前请求可以让这种情况很少出现
+    void Select(const glm::vec3 &camera, const Frustum &frustum, const function<bool(unsigned int)> &resident,
+        const function<void(unsigned int)> &request, vector<TerrainDrawNode> &output){
+        stats = TerrainSelectStats();
+        output.clear();
+        selectNode(0, 0, 0, camera, frustum, resident, request, output);
+    }
+
+private:
+    const vector<TerrainNodeBounds> &bounds;
+    float worldSize, heightScale;
+    vector<float> ranges;
+
+    static bool intersectsSphere(const AABB &box, const glm::vec3 &center, float radius){
+        glm::vec3 closest = glm::clamp(center, box.min, box.max);
+        glm::vec3 d = closest - center;
+        return glm::dot(d, d) <= radius * radius;
+    }
+
+    //返回false表示节点不在本层的距离内，由父节点绘制这个象限
+    bool selectNode(unsigned int level, unsigned int x, unsigned int y, const glm::vec3 &camera, const Frustum &frustum,
+        const function<bool(unsigned int)> &resident, const function<void(unsigned int)> &request, vector<TerrainDrawNode> &output){
+        stats.visited++;
+        AABB box = NodeBox(level, x, y);
+        if(level > 0 && !intersectsSphere(box, camera, ranges[level]))
+            return false;
+        //在距离内但看不到：当作已经处理，父节点也不绘制这个象限
+        if(!frustum.TestAABB(box)){
+            stats.culled++;
+            return true;
+        }
+        unsigned int node = TerrainNodeIndex(level, x, y);
+        if(level + 1 == TERRAIN_LEVELS || !intersectsSphere(box, camera, ranges[level + 1])){
+            if(level + 1 < TERRAIN_LEVELS && intersectsSphere(box, camera, ranges[level + 1] * TERRAIN_PREFETCH)){
+                for(unsigned int c = 0; c < 4; c++){
+                    unsigned int child = TerrainNodeIndex(level + 1, x * 2 + (c & 1), y * 2 + (c >> 1));
+                    if(!resident(child))
+                        request(child);
+                }
+            }
+            output.push_back({node, level, x, y, -1});
+            return true;
+        }
+        //四个子节点的瓦片都加载后才细分，避免在同一个节点中混用两层的网格
+        bool childrenResident = true;
+        for(unsigned int c = 0; c < 4; c++){
+            unsigned int child = TerrainNodeIndex(level + 1, x * 2 + (c & 1), y * 2 + (c >> 1));
+            if(!resident(child)){
+                request(child);
+                stats.missing++;
+                childrenResident = false;
+            }
+        }
+        if(!childrenResident){
+            stats.fallbacks++;
+            output.push_back({node, level, x, y, -1});
+            return true;
+        }
+        for(unsigned int c = 0; c < 4; c++){
+            if(!selectNode(level + 1, x * 2 + (c & 1), y * 2 + (c >> 1), camera, frustum, resident, request, output))
+                output.push_back({node, level, x, y, static_cast<int>(c)});
+        }
+        return true;
+    }
+};
+
+#endif
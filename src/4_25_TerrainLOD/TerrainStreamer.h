@@ -0,0 +1,201 @@
+#ifndef TERRAINSTREAMER_H
+#define TERRAINSTREAMER_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "TerrainData.h"
+using namespace std;
+
+//高度瓦片的流式加载与GPU缓存
+//GPU上是一个固定层数的R16纹理数组，每层放一个节点的瓦片；缓存满时替换最久没有用到的瓦片（LRU）
+//请求的瓦片由任务系统在工作线程上从文件读取，主线程每帧取回已经读完的瓦片并上传，上传数量有上限，避免一帧内卡顿
+//根节点与第1层的节点在初始化时同步读取并常驻，任何位置都至少有一个可以绘制的节点
+#define TERRAIN_RESIDENT_LEVELS 2
+#define TERRAIN_MAX_IN_FLIGHT 32 //同时在读取的瓦片数
+
+struct TerrainStreamStats {
+    unsigned int resident = 0;//缓存中的瓦片数
+    unsigned int inFlight = 0;//正在读取的瓦片数
+    unsigned int uploaded = 0;//本帧上传的瓦片数
+    unsigned int evicted = 0;//累计替换的瓦片数
+    size_t streamedBytes = 0;//累计从文件读取的字节数
+};
+
+class TerrainStreamer {
+public:
+    TerrainStreamStats stats;
+
+    bool Init(const string &path, unsigned int nodeCount, unsigned int capacity){
+        filePath = path;
+        this->nodeCount = nodeCount;
+        this->capacity = capacity;
+        layerOfNode.assign(nodeCount, -1);
+        pending.assign(nodeCount, false);
+        slots.assign(capacity, CacheSlot());
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R16, TERRAIN_TILE_SAMPLES, TERRAIN_TILE_SAMPLES, capacity, 0, GL_RED, GL_UNSIGNED_SHORT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        unsigned int residentNodes = TerrainNodeCount(TERRAIN_RESIDENT_LEVELS);
+        if(capacity <= residentNodes){
+            cout << "ERROR::TERRAIN::CACHE_TOO_SMALL " << capacity << endl;
+            return false;
+        }
+        vector<uint16_t> tile;
+        for(unsigned int node = 0; node < residentNodes; node++){
+            if(!readTile(filePath, nodeCount, node, tile)){
+                cout << "ERROR::TERRAIN::TILE_NOT_SUCCESFULLY_READ " << node << endl;
+                return false;
+            }
+            upload(node, tile, UINT_MAX);
+        }
+        return true;
+    }
+
+    //节点瓦片在纹理数组中的层，不在缓存中时返回-1；frame用于LRU
+    int Layer(unsigned int node, unsigned int frame){
+        int layer = layerOfNode[node];
+        if(layer >= 0 && slots[layer].lastUsed != UINT_MAX)
+            slots[layer].lastUsed = frame;
+        return layer;
+    }
+
+    bool Resident(unsigned int node) const{
+        return layerOfNode[node] >= 0;
+    }
+
+    //请求读取瓦片，已经在缓存中或正在读取时忽略；同时读取的数量达到上限时返回false，下一帧再请求
+    //parallel为false时直接在当前线程上读取，用于对比
+    bool Request(unsigned int node, bool parallel = true){
+        if(layerOfNode[node] >= 0 || pending[node])
+            return true;
+        if(loads.size() >= TERRAIN_MAX_IN_FLIGHT)
+            return false;
+        pending[node] = true;
+        shared_ptr<TileLoad> load = make_shared<TileLoad>();
+        load->node = node;
+        loads.push_back(load);
+        string path = filePath;
+        unsigned int count = nodeCount;
+        auto read = [load, path, count](){
+            PROFILE_SCOPE("ReadTile");
+            load->ok = readTile(path, count, load->node, load->heights);
+            load->done.store(true);
+        };
+        if(parallel)
+            JobSystem::Get().Run(read, &counter);
+        else
+            read();
+        return true;
+    }
+
+    //上传已经读完的瓦片，最多uploadBudget个，frame为当前帧号
+    void Update(unsigned int frame, unsigned int uploadBudget){
+        PROFILE_SCOPE("TerrainStreaming");
+        stats.uploaded = 0;
+        for(unsigned int i = 0; i < loads.size() && stats.uploaded < uploadBudget;){
+            if(!loads[i]->done.load()){
+                i++;
+                continue;
+            }
+            shared_ptr<TileLoad> load = loads[i];
+            loads.erase(loads.begin() + i);
+            pending[load->node] = false;
+            if(!load->ok){
+                cout << "ERROR::TERRAIN::TILE_NOT_SUCCESFULLY_READ " << load->node << endl;
+                continue;
+            }
+            upload(load->node, load->heights, frame);
+            stats.uploaded++;
+            stats.streamedBytes += TERRAIN_TILE_BYTES;
+        }
+        stats.inFlight = static_cast<unsigned int>(loads.size());
+    }
+
+    unsigned int Texture() const{
+        return texture;
+    }
+
+    //等待还在读取的瓦片，然后释放纹理
+    void Release(){
+        JobSystem::Get().Wait(counter);
+        loads.clear();
+        if(texture != 0)
+            glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+
+private:
+    struct CacheSlot {
+        int node = -1;
+        unsigned int lastUsed = 0;//UINT_MAX表示常驻
+    };
+
+    struct TileLoad {
+        unsigned int node = 0;
+        vector<uint16_t> heights;
+        bool ok = false;
+        atomic<bool> done{false};
+    };
+
+    string filePath;
+    unsigned int nodeCount = 0, capacity = 0;
+    unsigned int texture = 0;
+    vector<int> layerOfNode;
+    vector<bool> pending;
+    vector<CacheSlot> slots;
+    vector<shared_ptr<TileLoad>> loads;
+    JobCounter counter;
+
+    //每次打开文件读取一块，工作线程之间不共享文件流
+    static bool readTile(const string &path, unsigned int nodeCount, unsigned int node, vector<uint16_t> &heights){
+        ifstream file(path.c_str(), ios::binary);
+        if(!file.is_open())
+            return false;
+        heights.resize(TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES);
+        file.seekg(static_cast<streamoff>(TerrainTileOffset(nodeCount, node)));
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(heights.data()), TERRAIN_TILE_BYTES));
+    }
+
+    //放入空闲的层，没有空闲层时替换最久没有用到的瓦片
+    void upload(unsigned int node, const vector<uint16_t> &heights, unsigned int frame){
+        int target = -1;
+        for(unsigned int i = 0; i < capacity; i++){
+            if(slots[i].node < 0){
+                target = i;
+                break;
+            }
+            if(slots[i].lastUsed != UINT_MAX && slots[i].lastUsed < frame && (target < 0 || slots[i].lastUsed < slots[target].lastUsed))
+                target = i;
+        }
+        //缓存中的瓦片这一帧都要用到，放弃这次上传，需要时会重新请求
+        if(target < 0)
+            return;
+        if(slots[target].node >= 0){
+            layerOfNode[slots[target].node] = -1;
+            stats.evicted++;
+        }else{
+            stats.resident++;
+        }
+        slots[target].node = node;
+        slots[target].lastUsed = frame;
+        layerOfNode[node] = target;
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, target, TERRAIN_TILE_SAMPLES, TERRAIN_TILE_SAMPLES, 1, GL_RED, GL_UNSIGNED_SHORT, heights.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+};
+
+#endif
@@ -0,0 +1,50 @@
+#version 330 core
+//共用的网格：(0, 0)~(PATCH_QUADS, PATCH_QUADS)的整数网格坐标，每个节点把它放缩到自己的区域
+layout (location = 0) in vec2 aGrid;
+
+out vec3 WorldPos;
+out vec3 Normal;
+out float Morph;
+
+uniform mat4 view;
+uniform mat4 projection;
+//每个节点的瓦片是纹理数组的一层，R16，0~1对应0~heightScale
+uniform sampler2DArray heightTiles;
+uniform float layer;
+uniform vec2 nodeOrigin;
+uniform float nodeSize;
+//本层的变形范围：距离相机morphRange.x处开始，morphRange.y处完全变成上一层的网格
+uniform vec2 morphRange;
+uniform vec3 cameraPos;
+uniform float heightScale;
+
+const float PATCH_QUADS = 32.0;
+const float TILE_SAMPLES = PATCH_QUADS + 1.0;
+
+//grid为网格坐标，采样点在纹素中心，非整数坐标由硬件线性插值
+float sampleHeight(vec2 grid)
+{
+    vec2 uv = (grid + 0.5) / TILE_SAMPLES;
+    return textureLod(heightTiles, vec3(uv, layer), 0.0).r * heightScale;
+}
+
+void main()
+{
+    float quadSize = nodeSize / PATCH_QUADS;
+    vec2 world = nodeOrigin + aGrid * quadSize;
+    float distanceToCamera = length(cameraPos - vec3(world.x, sampleHeight(aGrid), world.y));
+    Morph = clamp((distanceToCamera - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+    //奇数顶点向前一个偶数顶点移动，morph为1时与上一层（边长为两个四边形）的网格重合
+    vec2 grid = aGrid - fract(aGrid * 0.5) * 2.0 * Morph;
+    world = nodeOrigin + grid * quadSize;
+    float height = sampleHeight(grid);
+    //中心差分求法线，瓦片边缘处改为单侧差分
+    vec2 low = max(grid - 1.0, 0.0), high = min(grid + 1.0, PATCH_QUADS);
+    float left = sampleHeight(vec2(low.x, grid.y));
+    float right = sampleHeight(vec2(high.x, grid.y));
+    float down = sampleHeight(vec2(grid.x, low.y));
+    float up = sampleHeight(vec2(grid.x, high.y));
+    Normal = normalize(vec3((left - right) / (high.x - low.x), quadSize, (down - up) / (high.y - low.y)));
+    WorldPos = vec3(world.x, height, world.y);
+    gl_Position = projection * view * vec4(WorldPos, 1.0);
+}
@@ -0,0 +1,425 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <tool/GLContext.h>
+#include "CustomShader.h"
+#include "CustomCamera.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "Frustum.h"
+#include "TerrainData.h"
+#include "TerrainStreamer.h"
+#include "TerrainQuadtree.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <iomanip>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+using namespace std;
+
+string Path = "./src/4_25_TerrainLOD/";
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+
+CustomCamera camera(glm::vec3(100.0f, 120.0f, 700.0f), glm::vec3(0.0f, 1.0f, 0.0f), -70.0f, -20.0f);
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+//高度图平铺后铺满2048米见方的区域，最细一层的采样间隔为1米
+const string HEIGHT_MAP = "./static/texture/TexturesCom_MuddySand2_2x2_2K_height.png";
+const string ALBEDO_MAP = "./static/texture/TexturesCom_MuddySand2_2x2_2K_albedo.png";
+const string TERRAIN_CACHE = "./output/MuddySand_terrain.bin";
+const float WORLD_SIZE = 2048.0f;
+const float HEIGHT_SCALE = 160.0f;
+const float FAR_PLANE = 5000.0f;
+const unsigned int TILE_CACHE_SIZE = 512;//GPU上缓存的瓦片数，约1MB
+const unsigned int UPLOAD_BUDGET = 16;//每帧最多上传的瓦片数
+const glm::vec3 FOG_COLOR(0.55f, 0.62f, 0.7f);
+const glm::vec3 LOD_COLORS[TERRAIN_LEVELS] = {
+    glm::vec3(0.9f, 0.2f, 0.2f), glm::vec3(0.9f, 0.6f, 0.1f), glm::vec3(0.9f, 0.9f, 0.2f), glm::vec3(0.3f, 0.9f, 0.3f),
+    glm::vec3(0.2f, 0.8f, 0.9f), glm::vec3(0.3f, 0.4f, 0.95f), glm::vec3(0.8f, 0.3f, 0.9f)
+};
+
+float pixelError = 4.0f;//最细一层网格的四边形在屏幕上的最大像素数，超过无裂缝的上限时被SetScreenError限制
+bool lodColorsEnabled = false;
+bool wireframeEnabled = false;
+bool freezeEnabled = false;//冻结选择用的相机，可以从外面观察视锥体剔除与LOD的分布
+bool jobsEnabled = true;
+bool lodColorsKeyDown = false;
+bool wireframeKeyDown = false;
+bool freezeKeyDown = false;
+bool finerKeyDown = false;
+bool coarserKeyDown = false;
+bool jobsKeyDown = false;
+bool traceKeyDown = false;
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void processInput(GLFWwindow* window){
+    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
+        glfwSetWindowShouldClose(window, true);
+    }
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, deltaTime);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, deltaTime);
+    //L键按层着色，F键线框模式，C键冻结选择用的相机，[与]键把屏幕空间误差减半或加倍，J键在任务系统与主线程读取瓦片之间切换
+    bool key = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+    if(key && !lodColorsKeyDown)
+        lodColorsEnabled = !lodColorsEnabled;
+    lodColorsKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+    if(key && !wireframeKeyDown)
+        wireframeEnabled = !wireframeEnabled;
+    wireframeKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    if(key && !freezeKeyDown)
+        freezeEnabled = !freezeEnabled;
+    freezeKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS;
+    if(key && !finerKeyDown)
+        pixelError = max(pixelError * 0.5f, 0.5f);
+    finerKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS;
+    if(key && !coarserKeyDown)
+        pixelError = min(pixelError * 2.0f, 64.0f);
+    coarserKeyDown = key;
+    key = glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS;
+    if(key && !jobsKeyDown)
+        jobsEnabled = !jobsEnabled;
+    jobsKeyDown = key;
+    //T键导出最近的帧为Chrome trace，并在控制台输出各作用域的平均耗时
+    key = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+    if(key && !traceKeyDown){
+        Profiler::Get().ExportChromeTrace("./output/profile_trace.json");
+        vector<ProfileSummary> summary = Profiler::Get().Summarize();
+        cout << left << setw(28) << "scope" << right << setw(10) << "cpu ms" << setw(10) << "gpu ms" << setw(8) << "calls" << endl;
+        cout << fixed << setprecision(3);
+        for(unsigned int i = 0; i < summary.size(); i++)
+            cout << left << setw(28) << summary[i].name << right << setw(10) << summary[i].cpuMs << setw(10) << summary[i].gpuMs << setw(8) << summary[i].calls << endl;
+        cout.unsetf(ios::floatfield);
+        cout << setprecision(6);
+    }
+    traceKeyDown = key;
+}
+
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+    if(firstMouse){
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos;
+    lastX = xpos;
+    lastY = ypos;
+
+    camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+//每个绘制的三角形数：整个节点或一个象限
+inline unsigned int drawTriangles(const TerrainDrawNode &draw){
+    return draw.quadrant < 0 ? TERRAIN_PATCH_QUADS * TERRAIN_PATCH_QUADS * 2 : TERRAIN_PATCH_QUADS * TERRAIN_PATCH_QUADS / 2;
+}
+
+//不创建窗口，忽略缓存重新切分高度图，然后在初始视角下对比不同屏幕空间误差需要的节点、三角形与瓦片
+int buildTerrain(){
+    TerrainBuilder builder;
+    vector<TerrainNodeBounds> bounds;
+    if(!builder.LoadOrBuild(HEIGHT_MAP, TERRAIN_CACHE, bounds, true))
+        return -1;
+    const TerrainBuildStats &stats = builder.stats;
+    unsigned int samples = TERRAIN_PATCH_QUADS * (1 << (TERRAIN_LEVELS - 1)) + 1;
+    cout << "Terrain builder: " << JobSystem::Get().ThreadCount() << " threads, " << samples << "x" << samples << " samples, " << TERRAIN_LEVELS
+        << " levels, " << bounds.size() << " nodes" << endl;
+    cout << fixed << setprecision(2);
+    cout << "decode " << stats.decodeMs << " ms, build " << stats.buildMs << " ms, write " << stats.writeMs << " ms, "
+        << stats.fileBytes / 1048576.0 << " MB" << endl;
+
+    TerrainQuadtree quadtree(bounds, WORLD_SIZE, HEIGHT_SCALE);
+    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, FAR_PLANE);
+    Frustum frustum = Frustum::FromMatrix(projection * camera.GetViewMatrix());
+    cout << right << setw(8) << "request" << setw(10) << "error px" << setw(8) << "draws" << setw(11) << "triangles" << setw(8) << "tiles" << setw(10) << "tile KB"
+        << setw(9) << "visited" << setw(8) << "culled" << setw(11) << "select ms" << endl;
+    for(float error = 1.0f; error <= 16.0f; error *= 2.0f){
+        float effective = quadtree.SetScreenError(error, static_cast<float>(SCR_HEIGHT), glm::radians(camera.Zoom));
+        vector<TerrainDrawNode> draws;
+        auto start = chrono::steady_clock::now();
+        quadtree.Select(camera.Position, frustum, [](unsigned int){ return true; }, [](unsigned int){}, draws);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        unsigned int triangles = 0;
+        vector<bool> needed(bounds.size(), false);
+        for(unsigned int i = 0; i < draws.size(); i++){
+            triangles += drawTriangles(draws[i]);
+            needed[draws[i].node] = true;
+        }
+        unsigned int tiles = static_cast<unsigned int>(count(needed.begin(), needed.end(), true));
+        cout << setw(8) << error << setw(10) << effective << setw(8) << draws.size() << setw(11) << triangles << setw(8) << tiles << setw(10) << tiles * TERRAIN_TILE_BYTES / 1024.0
+            << setw(9) << quadtree.stats.visited << setw(8) << quadtree.stats.culled << setw(11) << ms << endl;
+    }
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+    return 0;
+}
+
+unsigned int loadTexture(const string &path){
+    int width, height;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, nullptr, 4);
+    if(data == nullptr){
+        cout << "ERROR::TEXTURE::FAILED_TO_LOAD " << path << endl;
+        return 0;
+    }
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    stbi_image_free(data);
+    return texture;
+}
+
+int main(int argc, char *argv[]){
+    GLContext::Get().Configure(argc, argv);//--headless等命令行参数，见tool/GLContext.h
+    GLContext::Get().AttachCamera(camera);//--benchmark回放相机路径时控制这个相机
+    //--threads N指定参与执行任务的线程数，默认为硬件线程数
+    //--build    不创建窗口，重新切分高度图并输出不同屏幕空间误差下的开销
+    int threads = 0;
+    bool build = false;
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--threads" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(arg == "--build")
+            build = true;
+    }
+    JobSystem::Get().Init(threads > 0 ? threads - 1 : -1);
+    if(build){
+        int result = buildTerrain();
+        JobSystem::Get().Shutdown();
+        return result;
+    }
+    cout << "Job system: " << JobSystem::Get().ThreadCount() << " threads" << endl;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if(window == nullptr){
+        cout << "Failed to create GLFW window" << endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)){
+        cout << "Failed to initialize GLAD" << endl;
+        return -1;
+    }
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glfwSwapInterval(0);
+    camera.MovementSpeed = 80.0f;
+    Profiler::Get().InitGPU();
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    CustomShader terrainShader((Path + "TerrainVertexShader.glsl").c_str(), (Path + "TerrainFragmentShader.glsl").c_str());
+
+    //切分好的高度数据：常驻的只有每个节点的高度范围，瓦片由streamer按需读取
+    TerrainBuilder builder;
+    vector<TerrainNodeBounds> bounds;
+    TerrainStreamer streamer;
+    if(!builder.LoadOrBuild(HEIGHT_MAP, TERRAIN_CACHE, bounds) || !streamer.Init(TERRAIN_CACHE, static_cast<unsigned int>(bounds.size()), TILE_CACHE_SIZE)){
+        streamer.Release();
+        glfwTerminate();
+        JobSystem::Get().Shutdown();
+        return -1;
+    }
+    if(builder.stats.fromCache)
+        cout << "Terrain: " << bounds.size() << " nodes loaded from cache" << endl;
+    else
+        cout << "Terrain: " << bounds.size() << " nodes built in " << builder.stats.decodeMs + builder.stats.buildMs + builder.stats.writeMs << " ms, "
+            << builder.stats.fileBytes / 1048576.0 << " MB" << endl;
+    TerrainQuadtree quadtree(bounds, WORLD_SIZE, HEIGHT_SCALE);
+    unsigned int albedoTexture = loadTexture(ALBEDO_MAP);
+
+    //所有节点共用的网格，索引按象限排列，一个象限是连续的一段，可以单独绘制
+    vector<float> gridVertices;
+    for(unsigned int y = 0; y <= TERRAIN_PATCH_QUADS; y++){
+        for(unsigned int x = 0; x <= TERRAIN_PATCH_QUADS; x++){
+            gridVertices.push_back(static_cast<float>(x));
+            gridVertices.push_back(static_cast<float>(y));
+        }
+    }
+    vector<unsigned int> gridIndices;
+    const unsigned int half = TERRAIN_PATCH_QUADS / 2;
+    for(unsigned int quadrant = 0; quadrant < 4; quadrant++){
+        unsigned int startX = (quadrant & 1) * half, startY = (quadrant >> 1) * half;
+        for(unsigned int y = startY; y < startY + half; y++){
+            for(unsigned int x = startX; x < startX + half; x++){
+                unsigned int i0 = y * (TERRAIN_PATCH_QUADS + 1) + x, i1 = i0 + TERRAIN_PATCH_QUADS + 1;
+                gridIndices.insert(gridIndices.end(), {i0, i1, i0 + 1, i0 + 1, i1, i1 + 1});
+            }
+        }
+    }
+    const unsigned int quadrantIndices = static_cast<unsigned int>(gridIndices.size()) / 4;
+    unsigned int gridVAO, gridVBO, gridEBO;
+    glGenVertexArrays(1, &gridVAO);
+    glGenBuffers(1, &gridVBO);
+    glGenBuffers(1, &gridEBO);
+    glBindVertexArray(gridVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+    glBufferData(GL_ARRAY_BUFFER, gridVertices.size() * sizeof(float), gridVertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, gridIndices.size() * sizeof(unsigned int), gridIndices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    terrainShader.use();
+    terrainShader.setInt("heightTiles", 0);
+    terrainShader.setInt("albedoMap", 1);
+    terrainShader.setFloat("heightScale", HEIGHT_SCALE);
+    terrainShader.setFloat("textureScale", 16.0f);
+    terrainShader.setVec3("lightDirection", glm::normalize(glm::vec3(-0.4f, -0.6f, -0.5f)));
+    terrainShader.setVec3("fogColor", FOG_COLOR);
+    terrainShader.setFloat("fogDensity", 0.00025f);
+
+    glm::vec3 selectPosition = camera.Position;
+    Frustum selectFrustum;
+    vector<TerrainDrawNode> draws;
+    float lastTitleTime = 0.0f;
+    unsigned int frameCount = 0;
+    unsigned int frame = 0;
+    while (!glfwWindowShouldClose(window)){
+        Profiler::Get().BeginFrame();
+        frame++;
+
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        processInput(window);
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, FAR_PLANE);
+        if(!freezeEnabled){
+            selectPosition = camera.Position;
+            selectFrustum = Frustum::FromMatrix(projection * view);
+        }
+
+        //先上传上一帧请求且已经读完的瓦片，再选择节点；选择时访问到的瓦片都标记为这一帧用到
+        streamer.Update(frame, UPLOAD_BUDGET);
+        {
+            PROFILE_SCOPE("SelectNodes");
+            pixelError = quadtree.SetScreenError(pixelError, static_cast<float>(SCR_HEIGHT), glm::radians(camera.Zoom));
+            quadtree.Select(selectPosition, selectFrustum,
+                [&](unsigned int node){ return streamer.Layer(node, frame) >= 0; },
+                [&](unsigned int node){ streamer.Request(node, jobsEnabled); }, draws);
+        }
+
+        unsigned int triangles = 0;
+        {
+            PROFILE_PASS("Terrain");
+            glClearColor(FOG_COLOR.r, FOG_COLOR.g, FOG_COLOR.b, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glPolygonMode(GL_FRONT_AND_BACK, wireframeEnabled ? GL_LINE : GL_FILL);
+            terrainShader.use();
+            terrainShader.setMat4("view", view);
+            terrainShader.setMat4("projection", projection);
+            terrainShader.setVec3("cameraPos", selectPosition);
+            terrainShader.setBool("showLod", lodColorsEnabled);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, streamer.Texture());
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, albedoTexture);
+            glBindVertexArray(gridVAO);
+            for(unsigned int i = 0; i < draws.size(); i++){
+                const TerrainDrawNode &draw = draws[i];
+                int layer = streamer.Layer(draw.node, frame);
+                if(layer < 0)
+                    continue;
+                float range = quadtree.Range(draw.level);
+                terrainShader.setFloat("layer", static_cast<float>(layer));
+                terrainShader.setVec2("nodeOrigin", quadtree.NodeOrigin(draw.level, draw.x, draw.y));
+                terrainShader.setFloat("nodeSize", quadtree.NodeSize(draw.level));
+                terrainShader.setVec2("morphRange", range * TERRAIN_MORPH_START, range);
+                terrainShader.setVec3("lodColor", LOD_COLORS[draw.level]);
+                if(draw.quadrant < 0)
+                    glDrawElements(GL_TRIANGLES, quadrantIndices * 4, GL_UNSIGNED_INT, (void*)0);
+                else
+                    glDrawElements(GL_TRIANGLES, quadrantIndices, GL_UNSIGNED_INT, (void*)(draw.quadrant * quadrantIndices * sizeof(unsigned int)));
+                triangles += drawTriangles(draw);
+            }
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        }
+
+        //显示节点与三角形数、瓦片缓存与流式读取的状态
+        frameCount++;
+        if(currentFrame - lastTitleTime >= 0.5f){
+            float ms = (currentFrame - lastTitleTime) * 1000.0f / frameCount;
+            float terrainMs = 0.0f;
+            vector<ProfileSummary> summary = Profiler::Get().Summarize();
+            for(unsigned int i = 0; i < summary.size(); i++){
+                if(summary[i].name == "Terrain")
+                    terrainMs = static_cast<float>(summary[i].gpuMs);
+            }
+            const TerrainStreamStats &stats = streamer.stats;
+            string title = string("LearnOpenGL - ") + to_string(ms) + " ms/frame - " + to_string(pixelError) + " px error: " + to_string(draws.size())
+                + " draws, " + to_string(triangles / 1000) + "k tris, " + to_string(terrainMs) + " ms GPU - tiles " + to_string(stats.resident) + "/"
+                + to_string(TILE_CACHE_SIZE) + ", " + to_string(stats.inFlight) + " loading, " + to_string(stats.streamedBytes / 1048576.0) + " MB streamed"
+                + (freezeEnabled ? " - frozen" : "") + " - L: lod colors, F: wireframe, C: freeze, [ ]: error, J: jobs, T: export trace";
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitleTime = currentFrame;
+            frameCount = 0;
+        }
+
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+    }
+    streamer.Release();
+    glDeleteTextures(1, &albedoTexture);
+    glDeleteVertexArrays(1, &gridVAO);
+    glDeleteBuffers(1, &gridVBO);
+    glDeleteBuffers(1, &gridEBO);
+    Profiler::Get().Release();
+    JobSystem::Get().Shutdown();
+
+    glfwTerminate();
+
+    return 0;
+}